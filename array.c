@@ -3,61 +3,681 @@
 #include "array.h"
 #include "number.h"
 #include "string.h"
+#include "sort.h"
+#include "vector.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-#define NUMBER_UNWRAP(X) ((X)->primitive->value)
-#define ARRAY_UNWRAP(X) ((PrimitiveArray*)(X)->primitive)
+#define NUMBER_UNWRAP(X) (VALUE_PRIMITIVE(X)->value)
+#define ARRAY_UNWRAP(X) ((PrimitiveArray*)VALUE_PRIMITIVE(X))
 
-Value* value_array_new(Binding *binding) {
-  Value *klass = env_get(binding->global, "Array");
-  Value *proto = value_object_get(klass, value_string_new("prototype"));
+#define ARRAY_MIN_CAP 8
+
+// a store this far past the end makes the array sparse instead of allocating the gap
+#define ARRAY_SPARSE_GAP 1024
+// a sparse array becomes dense again once at least half of its length is filled
+#define ARRAY_DENSE_LOAD(COUNT, SIZE) ((COUNT) * 2 >= (SIZE))
+
+#define IS_NUMBER(X) ((X) != NULL && VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_NUMBER)
+
+size_t value_array_element_size(ArrayKind kind) {
+  return kind == ARRAY_KIND_PACKED_DOUBLE ? sizeof(double) : sizeof(HEAP_REF(Value));
+}
+
+Value* value_array_create(Value *proto) {
   Value *v = value_object_create(proto);
 
-  PrimitiveArray *a = malloc(sizeof(PrimitiveArray));
+  PrimitiveArray *a = heap_alloc(sizeof(PrimitiveArray));
   a->type = PRIMITIVE_ARRAY;
-  a->cap = 10;
+  a->flags = 0;
+  a->value = 0;
+  a->kind = ARRAY_KIND_PACKED_DOUBLE;
+  a->cap = ARRAY_MIN_CAP;
   a->size = 0;
+  a->count = 0;
+  a->elements = heap_encode(heap_alloc(a->cap * sizeof(double)));
+  v->primitive = heap_encode((Primitive*)a);
 
-  a->values = malloc(a->cap * sizeof(Value*));
-  memset(a->values, (int)NULL, a->cap * sizeof(Value*));
-  v->primitive = (Primitive*)a;
+  return v;
+}
+
+Value* value_array_new(Binding *binding) {
+  return value_array_create(binding->array_prototype);
+}
+
+// a new array reading the elements of a literal template. cap 0 marks elements
+// that belong to the template; value_array_own copies them before the first write
+Value* value_array_from_template(Value *proto, Value *template) {
+  Value *v = value_object_create(proto);
+
+  PrimitiveArray *a = heap_alloc(sizeof(PrimitiveArray));
+  *a = *ARRAY_UNWRAP(template);
+  a->cap = 0;
+  v->primitive = heap_encode((Primitive*)a);
 
   return v;
 }
 
-Value* value_array_get(Value *v, Value *index) {
+// gives a copy-on-write array its own elements. every write path calls this first
+void value_array_own(PrimitiveArray *array) {
+  if (array->cap != 0) return;
+
+  size_t element_size = value_array_element_size(array->kind);
+  unsigned int cap = ARRAY_MIN_CAP;
+  while (cap < array->size) cap *= 2;
+
+  char *elements = heap_alloc(cap * element_size);
+  memcpy(elements, heap_decode(array->elements), array->size * element_size);
+  memset(elements + array->size * element_size, 0, (cap - array->size) * element_size);
+  array->cap = cap;
+  array->elements = heap_encode((void*)elements);
+}
+
+ArrayKind value_array_kind(Value *v) {
+  return ARRAY_UNWRAP(v)->kind;
+}
+
+// the unboxed elements of a packed double array, or NULL for other kinds
+double* value_array_doubles(Value *v) {
   PrimitiveArray *array = ARRAY_UNWRAP(v);
-  int i = (int)NUMBER_UNWRAP(index);
-  return array->values[i];
+  if (array->kind != ARRAY_KIND_PACKED_DOUBLE) return NULL;
+
+  return heap_decode(array->elements);
 }
 
-void value_array_resize(PrimitiveArray *array, unsigned int new_cap) {
+// hands the elements of a packed double array over without copying them, e.g. to another
+// isolate. the array is left empty with new elements. NULL for other kinds
+double* value_array_detach_doubles(Value *v, unsigned int *cap, unsigned int *size) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  if (array->kind != ARRAY_KIND_PACKED_DOUBLE) return NULL;
+
+  value_array_own(array);
+  double *elements = heap_decode(array->elements);
+  *cap = array->cap;
+  *size = array->size;
+
+  array->cap = ARRAY_MIN_CAP;
+  array->size = 0;
+  array->elements = heap_encode(heap_alloc(array->cap * sizeof(double)));
+  return elements;
+}
+
+// a packed double array taking over elements: cap > 0 doubles from heap_alloc, the first
+// size of them set
+Value* value_array_adopt_doubles(Binding *binding, double *elements, unsigned int cap, unsigned int size) {
+  Value *v = value_array_new(binding);
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  heap_free(heap_decode(array->elements), array->cap * sizeof(double));
+
+  array->cap = cap;
+  array->size = size;
+  array->elements = heap_encode(elements);
+  return v;
+}
+
+// moves the array to a more general kind. leaving ARRAY_KIND_PACKED_DOUBLE boxes every element
+void value_array_transition(PrimitiveArray *array, ArrayKind kind) {
+  if (kind <= array->kind) return;
+
+  if (array->kind == ARRAY_KIND_PACKED_DOUBLE) {
+    double *doubles = heap_decode(array->elements);
+    HEAP_REF(Value) *values = heap_alloc(array->cap * sizeof(HEAP_REF(Value)));
+    for (unsigned int i = 0; i < array->size; i++) {
+      values[i] = heap_encode(value_number_new(doubles[i]));
+    }
+    // slots past the end read as holes once the array grows into them
+    memset(values + array->size, 0, (array->cap - array->size) * sizeof(HEAP_REF(Value)));
+
+    heap_free(doubles, array->cap * sizeof(double));
+    array->elements = heap_encode(values);
+  }
+
+  array->kind = kind;
+}
+
+size_t value_array_sparse_slot(ArraySparseEntry *entries, unsigned int cap, uint32_t index) {
+  uint32_t h = index * 0x9e3779b1u;
+  size_t mask = cap - 1;
+  for (size_t i = (h ^ (h >> 16)) & mask; ; i = (i + 1) & mask) {
+    if (entries[i].value == heap_encode(NULL) || entries[i].index == index) return i;
+  }
+}
+
+ArraySparseEntry* value_array_sparse_table(unsigned int cap) {
+  ArraySparseEntry *entries = heap_alloc(cap * sizeof(ArraySparseEntry));
+  memset(entries, 0, cap * sizeof(ArraySparseEntry));
+  return entries;
+}
+
+void value_array_sparse_resize(PrimitiveArray *array, unsigned int new_cap) {
+  ArraySparseEntry *old_entries = heap_decode(array->elements);
+  ArraySparseEntry *entries = value_array_sparse_table(new_cap);
+  for (unsigned int i = 0; i < array->cap; i++) {
+    if (old_entries[i].value == heap_encode(NULL)) continue;
+    entries[value_array_sparse_slot(entries, new_cap, old_entries[i].index)] = old_entries[i];
+  }
+
+  heap_free(old_entries, array->cap * sizeof(ArraySparseEntry));
   array->cap = new_cap;
-  array->values = realloc(array->values, array->cap * sizeof(Primitive*));
-  for (unsigned int i = array->size; i < array->cap; i++) {
-    array->values[i] = NULL;
+  array->elements = heap_encode(entries);
+}
+
+void value_array_sparse_set(PrimitiveArray *array, uint32_t index, Value *value) {
+  if ((array->count + 1) * 2 > array->cap) {
+    value_array_sparse_resize(array, array->cap * 2);
   }
+
+  ArraySparseEntry *entries = heap_decode(array->elements);
+  ArraySparseEntry *entry = &entries[value_array_sparse_slot(entries, array->cap, index)];
+  if (entry->value == heap_encode(NULL)) array->count++;
+  entry->index = index;
+  entry->value = heap_encode(value);
 }
 
-void value_array_resize_if_needed(PrimitiveArray *array) {
-  if (array->cap <= array->size * 2) {
-    value_array_resize(array, array->cap * 2);
+// removes the entry and shifts the following entries of the cluster back,
+// so that lookups never need tombstones
+void value_array_sparse_delete(PrimitiveArray *array, uint32_t index) {
+  ArraySparseEntry *entries = heap_decode(array->elements);
+  size_t mask = array->cap - 1;
+  size_t i = value_array_sparse_slot(entries, array->cap, index);
+  if (entries[i].value == heap_encode(NULL)) return;
+
+  for (size_t j = (i + 1) & mask; entries[j].value != heap_encode(NULL); j = (j + 1) & mask) {
+    uint32_t h = entries[j].index * 0x9e3779b1u;
+    size_t home = (h ^ (h >> 16)) & mask;
+    // entry j may move into the hole at i unless its home lies cyclically in (i, j]
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      entries[i] = entries[j];
+      i = j;
+    }
+  }
+
+  entries[i].value = heap_encode(NULL);
+  array->count--;
+}
+
+// moves the elements of a dense array into a hash table
+void value_array_to_sparse(PrimitiveArray *array) {
+  value_array_transition(array, ARRAY_KIND_HOLEY);
+
+  HEAP_REF(Value) *values = heap_decode(array->elements);
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < array->size; i++) {
+    if (values[i] != heap_encode(NULL)) count++;
+  }
+
+  unsigned int cap = ARRAY_MIN_CAP;
+  while (cap < count * 2 + 2) cap *= 2;
+
+  ArraySparseEntry *entries = value_array_sparse_table(cap);
+  for (unsigned int i = 0; i < array->size; i++) {
+    if (values[i] == heap_encode(NULL)) continue;
+    ArraySparseEntry *entry = &entries[value_array_sparse_slot(entries, cap, i)];
+    entry->index = i;
+    entry->value = values[i];
+  }
+
+  heap_free(values, array->cap * sizeof(HEAP_REF(Value)));
+  array->kind = ARRAY_KIND_DICTIONARY;
+  array->cap = cap;
+  array->count = count;
+  array->elements = heap_encode(entries);
+}
+
+// back to a dense array, holey unless every index below the length is present
+void value_array_to_dense(PrimitiveArray *array) {
+  ArraySparseEntry *entries = heap_decode(array->elements);
+
+  unsigned int cap = ARRAY_MIN_CAP;
+  while (cap < array->size) cap *= 2;
+
+  HEAP_REF(Value) *values = heap_alloc(cap * sizeof(HEAP_REF(Value)));
+  memset(values, 0, cap * sizeof(HEAP_REF(Value)));
+  for (unsigned int i = 0; i < array->cap; i++) {
+    if (entries[i].value == heap_encode(NULL)) continue;
+    values[entries[i].index] = entries[i].value;
+  }
+
+  heap_free(entries, array->cap * sizeof(ArraySparseEntry));
+  array->kind = array->count == array->size ? ARRAY_KIND_PACKED : ARRAY_KIND_HOLEY;
+  array->cap = cap;
+  array->count = 0;
+  array->elements = heap_encode(values);
+}
+
+Value* value_array_get(Value *v, Value *index) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  double n = NUMBER_UNWRAP(index);
+  if (!(n >= 0 && n < array->size)) return NULL;
+
+  unsigned int i = n;
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    ArraySparseEntry *entries = heap_decode(array->elements);
+    return heap_decode(entries[value_array_sparse_slot(entries, array->cap, i)].value);
+  }
+
+  if (array->kind == ARRAY_KIND_PACKED_DOUBLE) {
+    double *doubles = heap_decode(array->elements);
+    return value_number_new(doubles[i]);
   }
+
+  HEAP_REF(Value) *values = heap_decode(array->elements);
+  return heap_decode(values[i]);
+}
+
+void value_array_resize(PrimitiveArray *array, unsigned int new_cap) {
+  size_t element_size = value_array_element_size(array->kind);
+  void *old_elements = heap_decode(array->elements);
+  char *elements = heap_alloc(new_cap * element_size);
+  memcpy(elements, old_elements, array->size * element_size);
+  // zero is a NULL reference in both heap modes
+  memset(elements + array->size * element_size, 0, (new_cap - array->size) * element_size);
+
+  heap_free(old_elements, array->cap * element_size);
+  array->cap = new_cap;
+  array->elements = heap_encode((void*)elements);
+}
+
+void value_array_reserve(PrimitiveArray *array, unsigned int length) {
+  if (length <= array->cap) return;
+
+  unsigned int new_cap = array->cap * 2;
+  while (new_cap < length) new_cap *= 2;
+  value_array_resize(array, new_cap);
 }
 
 void value_array_set(Value *v, Value *index, Value *value) {
   PrimitiveArray *array = ARRAY_UNWRAP(v);
-  int i = NUMBER_UNWRAP(index);
-  array->values[i] = value;
+  unsigned int i = NUMBER_UNWRAP(index);
+  value_array_own(array);
+
+  if (array->kind != ARRAY_KIND_DICTIONARY && i >= array->cap && i - array->size > ARRAY_SPARSE_GAP) {
+    value_array_to_sparse(array);
+  }
+
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    // NULL would read as an empty slot
+    value_array_sparse_set(array, i, value == NULL ? value_undefined_new() : value);
+    if (i >= array->size) array->size = i + 1;
+    if (ARRAY_DENSE_LOAD(array->count, array->size)) value_array_to_dense(array);
+    return;
+  }
+
+  if (i > array->size || value == NULL) {
+    value_array_transition(array, ARRAY_KIND_HOLEY);
+  } else if (!IS_NUMBER(value)) {
+    value_array_transition(array, ARRAY_KIND_PACKED);
+  }
 
-  if (i + 1 >= array->size) {
+  value_array_reserve(array, i + 1);
+  if (array->kind == ARRAY_KIND_PACKED_DOUBLE) {
+    double *doubles = heap_decode(array->elements);
+    doubles[i] = NUMBER_UNWRAP(value);
+  } else {
+    HEAP_REF(Value) *values = heap_decode(array->elements);
+    values[i] = heap_encode(value);
+  }
+
+  if (i >= array->size) {
     array->size = i + 1;
-    value_array_resize_if_needed(array);
   }
 }
 
+// the element at index of a packed double array, for updating it in place.
+// NULL when the array holds other kinds of elements or index is not an element
+double* value_array_double_slot(Value *v, double index) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  if (array->kind != ARRAY_KIND_PACKED_DOUBLE) return NULL;
+  if (!(index >= 0 && index < array->size) || index != (unsigned int)index) return NULL;
+
+  value_array_own(array);
+  double *doubles = heap_decode(array->elements);
+  return doubles + (unsigned int)index;
+}
+
 Value* value_array_length(Value *v) {
   return value_number_new((double)ARRAY_UNWRAP(v)->size);
 }
+
+// raises the length to length, the new elements being holes. a shorter length is ignored
+void value_array_extend(Value *v, unsigned int length) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  if (length <= array->size) return;
+  value_array_own(array);
+
+  if (array->kind != ARRAY_KIND_DICTIONARY && length > array->cap && length - array->size > ARRAY_SPARSE_GAP) {
+    value_array_to_sparse(array);
+  }
+
+  if (array->kind != ARRAY_KIND_DICTIONARY) {
+    value_array_transition(array, ARRAY_KIND_HOLEY);
+    value_array_reserve(array, length);
+  }
+  array->size = length;
+}
+
+// leaves a hole: the element reads as undefined and the length is unchanged
+void value_array_delete(Value *v, Value *index) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  double n = NUMBER_UNWRAP(index);
+  if (!(n >= 0 && n < array->size)) return;
+  value_array_own(array);
+
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    value_array_sparse_delete(array, n);
+    return;
+  }
+
+  value_array_transition(array, ARRAY_KIND_HOLEY);
+  HEAP_REF(Value) *values = heap_decode(array->elements);
+  values[(unsigned int)n] = heap_encode(NULL);
+}
+
+// bulk operations. packed double arrays go through the kernels in vector.c,
+// other kinds element by element.
+
+// first index at or after from holding x, or -1. includes() passes same_value_zero
+long value_array_index_of(Value *v, Value *x, unsigned int from, int same_value_zero) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  if (from >= array->size) return -1;
+
+  double *doubles = value_array_doubles(v);
+  if (doubles != NULL) {
+    if (!IS_NUMBER(x)) return -1;
+
+    double n = NUMBER_UNWRAP(x);
+    long i = same_value_zero ? vector_find(doubles + from, array->size - from, n) : vector_index_of(doubles + from, array->size - from, n);
+    return i < 0 ? -1 : i + from;
+  }
+
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    // only visit the present indices; a sparse array always has holes
+    if (same_value_zero && x->kind == VALUE_KIND_UNDEFINED) return from;
+
+    unsigned int count;
+    uint32_t *indices = value_array_indices(v, &count);
+    long found = -1;
+    for (unsigned int j = 0; j < count && found < 0; j++) {
+      if (indices[j] < from) continue;
+      Value *element = value_array_get(v, value_number_new(indices[j]));
+      if (same_value_zero ? value_same_value_zero(element, x) : value_strict_equal(element, x)) found = indices[j];
+    }
+
+    free(indices);
+    return found;
+  }
+
+  for (unsigned int i = from; i < array->size; i++) {
+    Value *element = value_array_get(v, value_number_new(i));
+    if (element == NULL) {
+      // a hole reads as undefined for includes(), and is skipped by indexOf()
+      if (same_value_zero && x->kind == VALUE_KIND_UNDEFINED) return i;
+      continue;
+    }
+
+    if (same_value_zero ? value_same_value_zero(element, x) : value_strict_equal(element, x)) return i;
+  }
+
+  return -1;
+}
+
+void value_array_fill(Value *v, Value *x, unsigned int start, unsigned int end) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  if (end > array->size) end = array->size;
+  if (start >= end) return;
+  value_array_own(array);
+
+  double *doubles = value_array_doubles(v);
+  if (doubles != NULL && IS_NUMBER(x)) {
+    vector_fill(doubles + start, end - start, NUMBER_UNWRAP(x));
+    return;
+  }
+
+  for (unsigned int i = start; i < end; i++) {
+    value_array_set(v, value_number_new(i), x);
+  }
+}
+
+// appends the elements [start, end) of source to target. between double arrays this is a memcpy
+void value_array_append(Value *target, Value *source, unsigned int start, unsigned int end) {
+  PrimitiveArray *to = ARRAY_UNWRAP(target);
+  PrimitiveArray *from = ARRAY_UNWRAP(source);
+  if (end > from->size) end = from->size;
+  if (start >= end) return;
+  value_array_own(to);
+
+  double *source_doubles = value_array_doubles(source);
+  if (source_doubles != NULL && to->kind == ARRAY_KIND_PACKED_DOUBLE) {
+    value_array_reserve(to, to->size + (end - start));
+    double *doubles = heap_decode(to->elements);
+    memcpy(doubles + to->size, source_doubles + start, (end - start) * sizeof(double));
+    to->size += end - start;
+    return;
+  }
+
+  unsigned int size = to->size;
+  for (unsigned int i = start; i < end; i++) {
+    Value *element = value_array_get(source, value_number_new(i));
+    if (element != NULL) {
+      value_array_set(target, value_number_new(size + (i - start)), element);
+    }
+  }
+
+  // trailing holes still count towards the length
+  value_array_extend(target, size + (end - start));
+}
+
+void value_array_push(Value *v, Value *x) {
+  value_array_set(v, value_number_new(ARRAY_UNWRAP(v)->size), x);
+}
+
+// removes and returns the last element, or undefined when the array is empty or it is a hole
+Value* value_array_pop(Value *v) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  if (array->size == 0) return value_undefined_new();
+  value_array_own(array);
+
+  unsigned int i = array->size - 1;
+  Value *element = value_array_get(v, value_number_new(i));
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    value_array_sparse_delete(array, i);
+  } else if (array->kind != ARRAY_KIND_PACKED_DOUBLE) {
+    // a packed array stays packed: the slot is past the end now
+    HEAP_REF(Value) *values = heap_decode(array->elements);
+    values[i] = heap_encode(NULL);
+  }
+  array->size--;
+
+  return element == NULL ? value_undefined_new() : element;
+}
+
+// sum of a numeric array, added up in order. returns 0 when it is not a packed double array
+int value_array_sum(Value *v, double initial, double *sum) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  double *doubles = value_array_doubles(v);
+  if (doubles == NULL) return 0;
+
+  // the vector sum adds in a different order, which only gives the same result
+  // when no rounding happens along the way
+  double total;
+  if (vector_sum_exact(doubles, array->size, initial, &total)) {
+    *sum = total;
+    return 1;
+  }
+
+  total = initial;
+  for (unsigned int i = 0; i < array->size; i++) total += doubles[i];
+  *sum = total;
+  return 1;
+}
+
+int value_array_index_compare(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+// indices of the elements present, in ascending order. the caller frees the result.
+// sparse arrays are not walked up to their length.
+uint32_t* value_array_indices(Value *v, unsigned int *count) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  uint32_t *indices;
+  unsigned int n = 0;
+
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    ArraySparseEntry *entries = heap_decode(array->elements);
+    indices = malloc((array->count + 1) * sizeof(uint32_t));
+    for (unsigned int i = 0; i < array->cap; i++) {
+      if (entries[i].value != heap_encode(NULL)) indices[n++] = entries[i].index;
+    }
+    qsort(indices, n, sizeof(uint32_t), value_array_index_compare);
+  } else {
+    indices = malloc((array->size + 1) * sizeof(uint32_t));
+    HEAP_REF(Value) *values = heap_decode(array->elements);
+    for (unsigned int i = 0; i < array->size; i++) {
+      if (array->kind == ARRAY_KIND_HOLEY && values[i] == heap_encode(NULL)) continue;
+      indices[n++] = i;
+    }
+  }
+
+  *count = n;
+  return indices;
+}
+
+// elements are appended to one string builder. holes, undefined and null are empty.
+// separator defaults to ','
+Value* value_array_join(Value *v, Value *separator) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  double *doubles = value_array_doubles(v);
+  HEAP_REF(Value) *values = array->kind == ARRAY_KIND_DICTIONARY ? NULL : heap_decode(array->elements);
+
+  StringBuilder builder;
+  string_builder_init(&builder);
+  for (unsigned int i = 0; i < array->size; i++) {
+    if (i > 0) {
+      if (separator == NULL) {
+        string_builder_append(&builder, ",", 1);
+      } else {
+        string_builder_append_value(&builder, separator);
+      }
+    }
+
+    if (doubles != NULL) {
+      char buf[32];
+      value_number_format(doubles[i], buf);
+      string_builder_append(&builder, buf, strlen(buf));
+      continue;
+    }
+
+    Value *element = values == NULL ? value_array_get(v, value_number_new(i)) : heap_decode(values[i]);
+    if (element == NULL || element->kind != VALUE_KIND_OBJECT) continue;
+    string_builder_append_value(&builder, element);
+  }
+
+  return string_builder_finish(&builder);
+}
+
+// sorts numbers ascending (or descending) in place, directly on the double[]
+void value_array_sort_doubles(Value *v, int descending) {
+  PrimitiveArray *array = ARRAY_UNWRAP(v);
+  value_array_own(array);
+  double *doubles = value_array_doubles(v);
+  sort_doubles(doubles, array->size);
+
+  if (descending) {
+    for (unsigned int i = 0, j = array->size; i + 1 < j; i++, j--) {
+      double tmp = doubles[i];
+      doubles[i] = doubles[j - 1];
+      doubles[j - 1] = tmp;
+    }
+  }
+}
+
+typedef struct ArraySortKey {
+  Value *value;
+  const char *chars;
+  unsigned int length;
+} ArraySortKey;
+
+int value_array_compare_keys(void *a, void *b, void *data) {
+  ArraySortKey *x = a;
+  ArraySortKey *y = b;
+  unsigned int length = x->length < y->length ? x->length : y->length;
+  int result = memcmp(x->chars, y->chars, length);
+  if (result != 0) return result;
+
+  return (x->length > y->length) - (x->length < y->length);
+}
+
+// sorts in place with compare, or by string order when compare is NULL.
+// undefined elements go after the sorted ones, then holes, as in Array.prototype.sort
+void value_array_sort(Value *v, SortCompare *compare, void *data) {
+  unsigned int count;
+  uint32_t *indices = value_array_indices(v, &count);
+
+  Value **items = malloc((count + 1) * sizeof(Value*));
+  unsigned int size = 0;
+  unsigned int undefined_count = 0;
+  for (unsigned int i = 0; i < count; i++) {
+    Value *element = value_array_get(v, value_number_new(indices[i]));
+    if (element->kind == VALUE_KIND_UNDEFINED) {
+      undefined_count++;
+    } else {
+      items[size++] = element;
+    }
+  }
+
+  if (compare == NULL) {
+    // each element is converted to a string once, not on every comparison
+    ArraySortKey *keys = malloc((size + 1) * sizeof(ArraySortKey));
+    for (unsigned int i = 0; i < size; i++) {
+      Value *string = value_to_string(items[i]);
+      keys[i].value = items[i];
+      keys[i].chars = value_string_unwrap(string);
+      keys[i].length = value_string_length(string);
+      items[i] = (Value*)&keys[i];
+    }
+
+    sort_pointers((void**)items, size, value_array_compare_keys, NULL);
+    for (unsigned int i = 0; i < size; i++) {
+      items[i] = ((ArraySortKey*)items[i])->value;
+    }
+    free(keys);
+  } else {
+    sort_pointers((void**)items, size, compare, data);
+  }
+
+  for (unsigned int i = 0; i < size; i++) {
+    value_array_set(v, value_number_new(i), items[i]);
+  }
+
+  for (unsigned int i = size; i < size + undefined_count; i++) {
+    value_array_set(v, value_number_new(i), value_undefined_new());
+  }
+
+  for (unsigned int i = 0; i < count; i++) {
+    if (indices[i] >= size + undefined_count) {
+      value_array_delete(v, value_number_new(indices[i]));
+    }
+  }
+
+  free(items);
+  free(indices);
+}
+
+// returns the index as a number when key addresses an element: a number, or a string like '12'
+Value* value_array_index_key(Value *key) {
+  Primitive *primitive = VALUE_PRIMITIVE(key);
+  if (primitive == NULL) return NULL;
+  if (primitive->type == PRIMITIVE_NUMBER) {
+    // -1 and 1.5 are ordinary property names
+    double n = primitive->value;
+    return n >= 0 && n < ATOM_NOT_INDEX && n == (unsigned int)n ? key : NULL;
+  }
+  if (primitive->type != PRIMITIVE_STRING) return NULL;
+
+  AtomIndex probe;
+  Atom *atom = value_string_index_atom(key, &probe);
+  return atom == NULL ? NULL : value_number_new(atom->index);
+}
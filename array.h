@@ -1,4 +1,33 @@
+#include "sort.h"
+
+// slot of a sparse array. open addressing with linear probing, at most half full
+typedef struct ArraySparseEntry {
+  uint32_t index;
+  // NULL for an empty slot
+  HEAP_REF(Value) value;
+} ArraySparseEntry;
+
 Value* value_array_new(Binding *binding);
+Value* value_array_create(Value *proto);
+Value* value_array_from_template(Value *proto, Value *template);
+ArrayKind value_array_kind(Value *array);
+double* value_array_doubles(Value *array);
+double* value_array_detach_doubles(Value *array, unsigned int *cap, unsigned int *size);
+Value* value_array_adopt_doubles(Binding *binding, double *elements, unsigned int cap, unsigned int size);
+uint32_t* value_array_indices(Value *array, unsigned int *count);
 Value* value_array_get(Value *array, Value *index);
 void value_array_set(Value *array, Value *index, Value *value);
+double* value_array_double_slot(Value *array, double index);
 Value* value_array_length(Value *array);
+void value_array_extend(Value *array, unsigned int length);
+void value_array_delete(Value *array, Value *index);
+Value* value_array_index_key(Value *key);
+Value* value_array_join(Value *array, Value *separator);
+void value_array_sort_doubles(Value *array, int descending);
+void value_array_sort(Value *array, SortCompare *compare, void *data);
+long value_array_index_of(Value *array, Value *x, unsigned int from, int same_value_zero);
+void value_array_fill(Value *array, Value *x, unsigned int start, unsigned int end);
+void value_array_append(Value *target, Value *source, unsigned int start, unsigned int end);
+void value_array_push(Value *array, Value *x);
+Value* value_array_pop(Value *array);
+int value_array_sum(Value *array, double initial, double *sum);
@@ -0,0 +1,141 @@
+#include "value.h"
+#include "object.h"
+#include "number.h"
+#include "array.h"
+#include "string.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Value* get(Value *array, int i) {
+  return value_array_get(array, value_number_new(i));
+}
+
+void set(Value *array, int i, Value *value) {
+  value_array_set(array, value_number_new(i), value);
+}
+
+void test_array_packed_double() {
+  Value *array = value_array_create(NULL);
+  for (int i = 0; i < 100; i++) {
+    set(array, i, value_number_new(i * 2));
+  }
+
+  assert(value_array_kind(array) == ARRAY_KIND_PACKED_DOUBLE);
+  assert(value_number_unwrap(value_array_length(array)) == 100);
+  assert(value_number_unwrap(get(array, 42)) == 84);
+  assert(get(array, 100) == NULL);
+  assert(get(array, -1) == NULL);
+
+  double *doubles = value_array_doubles(array);
+  assert(doubles != NULL);
+  assert(doubles[99] == 198);
+}
+
+void test_array_transition() {
+  Value *array = value_array_create(NULL);
+  set(array, 0, value_number_new(1));
+  set(array, 1, value_number_new(2));
+  assert(value_array_kind(array) == ARRAY_KIND_PACKED_DOUBLE);
+
+  // storing a string boxes the numbers stored so far
+  set(array, 2, value_string_new("three"));
+  assert(value_array_kind(array) == ARRAY_KIND_PACKED);
+  assert(value_array_doubles(array) == NULL);
+  assert(value_number_unwrap(get(array, 1)) == 2);
+  assert(strcmp(value_string_unwrap(get(array, 2)), "three") == 0);
+
+  // storing a number again does not go back
+  set(array, 2, value_number_new(3));
+  assert(value_array_kind(array) == ARRAY_KIND_PACKED);
+  assert(value_number_unwrap(get(array, 2)) == 3);
+}
+
+void test_array_holey() {
+  Value *array = value_array_create(NULL);
+  set(array, 0, value_number_new(0));
+  set(array, 5, value_number_new(5));
+  assert(value_array_kind(array) == ARRAY_KIND_HOLEY);
+  assert(value_number_unwrap(value_array_length(array)) == 6);
+  assert(get(array, 3) == NULL);
+  assert(value_number_unwrap(get(array, 5)) == 5);
+
+  Value *packed = value_array_create(NULL);
+  set(packed, 0, value_number_new(0));
+  set(packed, 1, value_number_new(1));
+  value_array_delete(packed, value_number_new(0));
+  assert(value_array_kind(packed) == ARRAY_KIND_HOLEY);
+  assert(get(packed, 0) == NULL);
+  assert(value_number_unwrap(get(packed, 1)) == 1);
+  assert(value_number_unwrap(value_array_length(packed)) == 2);
+}
+
+void test_array_sparse() {
+  Value *array = value_array_create(NULL);
+  set(array, 0, value_number_new(0));
+  set(array, 1000000, value_number_new(1));
+  assert(value_array_kind(array) == ARRAY_KIND_DICTIONARY);
+  assert(value_number_unwrap(value_array_length(array)) == 1000001);
+  assert(value_number_unwrap(get(array, 1000000)) == 1);
+  assert(get(array, 500000) == NULL);
+
+  for (int i = 0; i < 1000; i++) {
+    set(array, i * 4096, value_number_new(i));
+  }
+  assert(value_array_kind(array) == ARRAY_KIND_DICTIONARY);
+  for (int i = 0; i < 1000; i++) {
+    assert(value_number_unwrap(get(array, i * 4096)) == i);
+  }
+
+  for (int i = 0; i < 1000; i += 2) {
+    value_array_delete(array, value_number_new(i * 4096));
+  }
+  for (int i = 0; i < 1000; i++) {
+    Value *element = get(array, i * 4096);
+    assert(i % 2 == 0 ? element == NULL : value_number_unwrap(element) == i);
+  }
+
+  unsigned int count;
+  uint32_t *indices = value_array_indices(array, &count);
+  assert(count == 501);
+  assert(indices[0] == 4096);
+  assert(indices[count - 1] == 999 * 4096);
+  for (unsigned int i = 1; i < count; i++) assert(indices[i - 1] < indices[i]);
+  free(indices);
+}
+
+void test_array_sparse_to_dense() {
+  Value *array = value_array_create(NULL);
+  set(array, 5000, value_number_new(5000));
+  assert(value_array_kind(array) == ARRAY_KIND_DICTIONARY);
+
+  // filling in the front makes it dense again
+  for (int i = 0; i < 5000; i++) {
+    set(array, i, value_number_new(i));
+  }
+  assert(value_array_kind(array) != ARRAY_KIND_DICTIONARY);
+  for (int i = 0; i <= 5000; i++) {
+    assert(value_number_unwrap(get(array, i)) == i);
+  }
+}
+
+void test_array_join() {
+  Value *array = value_array_create(NULL);
+  set(array, 0, value_number_new(1));
+  set(array, 1, value_number_new(2));
+  assert(strcmp(value_string_unwrap(value_array_join(array, NULL)), "1,2") == 0);
+
+  set(array, 3, value_string_new("x"));
+  assert(strcmp(value_string_unwrap(value_array_join(array, value_string_new(" "))), "1 2  x") == 0);
+}
+
+int main() {
+  test_array_packed_double();
+  test_array_transition();
+  test_array_holey();
+  test_array_sparse();
+  test_array_sparse_to_dense();
+  test_array_join();
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "atom.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#define ATOM_MIN_CAP 1024
+
+// open addressing with linear probing, kept at most half full. the table is shared by
+// all isolates. lookups don't lock: an atom is written before the slot pointing to it,
+// and a grown table is filled before it replaces the old one, which is kept for threads
+// still probing it. adding an atom takes atom_lock
+typedef struct AtomTable {
+  size_t cap;
+  HEAP_REF(Atom) slots[];
+} AtomTable;
+
+AtomTable *atom_table = NULL;
+size_t atom_used = 0;
+pthread_mutex_t atom_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint32_t atom_array_index(const char *s, size_t length) {
+  if (length == 0 || length > 10 || !isdigit(s[0]) || (s[0] == '0' && length > 1)) {
+    return ATOM_NOT_INDEX;
+  }
+
+  uint64_t index = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (!isdigit(s[i])) return ATOM_NOT_INDEX;
+    index = index * 10 + (s[i] - '0');
+  }
+
+  return index < ATOM_NOT_INDEX ? (uint32_t)index : ATOM_NOT_INDEX;
+}
+
+Atom* atom_index_init(AtomIndex *atom, uint32_t index) {
+  char digits[10];
+  uint32_t length = 0;
+  uint32_t n = index;
+  do {
+    digits[length++] = '0' + n % 10;
+    n /= 10;
+  } while (n != 0);
+
+  for (uint32_t i = 0; i < length; i++) atom->string[i] = digits[length - 1 - i];
+  atom->string[length] = '\0';
+  atom->length = length;
+  atom->hash = hash_bytes(atom->string, atom->length);
+  atom->index = index;
+  return (Atom*)atom;
+}
+
+// returns the slot holding the string, or the empty slot where it belongs
+size_t atom_find_slot(AtomTable *table, const char *s, size_t length, uint32_t hash) {
+  size_t mask = table->cap - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    Atom *atom = heap_decode(__atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE));
+    if (atom == NULL) return i;
+    if (atom->hash == hash && atom->length == length && memcmp(atom->string, s, length) == 0) {
+      return i;
+    }
+  }
+}
+
+// the atom for the string, or NULL if it has not been interned. takes no lock
+Atom* atom_lookup(const char *s, size_t length, uint32_t hash) {
+  AtomTable *table = __atomic_load_n(&atom_table, __ATOMIC_ACQUIRE);
+  if (table == NULL) return NULL;
+  return heap_decode(__atomic_load_n(&table->slots[atom_find_slot(table, s, length, hash)], __ATOMIC_ACQUIRE));
+}
+
+// the old table is not freed, since other threads may be probing it
+void atom_table_resize(size_t new_cap) {
+  AtomTable *old = atom_table;
+  AtomTable *table = heap_alloc(sizeof(AtomTable) + new_cap * sizeof(HEAP_REF(Atom)));
+  table->cap = new_cap;
+  memset(table->slots, 0, new_cap * sizeof(HEAP_REF(Atom)));
+
+  for (size_t i = 0; old != NULL && i < old->cap; i++) {
+    Atom *atom = heap_decode(old->slots[i]);
+    if (atom == NULL) continue;
+
+    size_t mask = new_cap - 1;
+    size_t j = atom->hash & mask;
+    while (table->slots[j] != heap_encode(NULL)) j = (j + 1) & mask;
+    table->slots[j] = heap_encode(atom);
+  }
+
+  __atomic_store_n(&atom_table, table, __ATOMIC_RELEASE);
+}
+
+// adds atom unless an equal one was added first, and returns the one in the table.
+// called with atom_lock held
+Atom* atom_insert(Atom *atom) {
+  if (atom_table == NULL || (atom_used + 1) * 2 > atom_table->cap) {
+    atom_table_resize(atom_table == NULL ? ATOM_MIN_CAP : atom_table->cap * 2);
+  }
+
+  size_t i = atom_find_slot(atom_table, atom->string, atom->length, atom->hash);
+  Atom *found = heap_decode(atom_table->slots[i]);
+  if (found != NULL) return found;
+
+  __atomic_store_n(&atom_table->slots[i], heap_encode(atom), __ATOMIC_RELEASE);
+  atom_used++;
+  return atom;
+}
+
+Atom* atom_intern_length(const char *s, size_t length) {
+  uint32_t hash = hash_bytes(s, length);
+  Atom *atom = atom_lookup(s, length, hash);
+  if (atom != NULL) return atom;
+
+  atom = heap_alloc(sizeof(Atom) + length + 1);
+  atom->hash = hash;
+  atom->length = length;
+  atom->index = atom_array_index(s, length);
+  memcpy(atom->string, s, length);
+  atom->string[length] = '\0';
+
+  pthread_mutex_lock(&atom_lock);
+  Atom *found = atom_insert(atom);
+  pthread_mutex_unlock(&atom_lock);
+
+  // another thread added the string since the lookup
+  if (found != atom) heap_free(atom, sizeof(Atom) + length + 1);
+  return found;
+}
+
+Atom* atom_adopt(Atom *atom) {
+  pthread_mutex_lock(&atom_lock);
+  Atom *found = atom_insert(atom);
+  pthread_mutex_unlock(&atom_lock);
+  return found;
+}
+
+Atom* atom_intern(const char *s) {
+  return atom_intern_length(s, strlen(s));
+}
+
+Atom* atom_find_length(const char *s, size_t length) {
+  return atom_lookup(s, length, hash_bytes(s, length));
+}
+
+Atom* atom_find(const char *s) {
+  return atom_find_length(s, strlen(s));
+}
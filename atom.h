@@ -0,0 +1,51 @@
+#ifndef MJS_ATOM_H
+#define MJS_ATOM_H
+
+#include "heap.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// interned strings. there is one atom per distinct string, so atoms are compared
+// by pointer and their hash is computed once. identifiers, property keys and
+// runtime strings used as keys are atoms, except integer names (see AtomIndex).
+#define ATOM_NOT_INDEX UINT32_MAX
+
+typedef struct Atom {
+  uint32_t hash;
+  uint32_t length;
+  // the array index this string denotes ('0', '12'), or ATOM_NOT_INDEX
+  uint32_t index;
+  char string[];
+} Atom;
+
+// integer property names ('0', '12') need not be interned: dicts match them by index,
+// so an object keeps an atom of its own for each, and a lookup probes with one on the
+// stack. its fields are laid out as in Atom
+typedef struct AtomIndex {
+  uint32_t hash;
+  uint32_t length;
+  uint32_t index;
+  char string[12];
+} AtomIndex;
+
+// whether two atoms are the same string, either of which may be an integer name
+static inline int atom_equal(Atom *a, Atom *b) {
+  return a->index == ATOM_NOT_INDEX ? a == b : a->index == b->index;
+}
+
+// the array index the string denotes, or ATOM_NOT_INDEX
+uint32_t atom_array_index(const char *s, size_t length);
+Atom* atom_index_init(AtomIndex *atom, uint32_t index);
+
+Atom* atom_intern(const char *s);
+Atom* atom_intern_length(const char *s, size_t length);
+// returns NULL if the string has never been interned. lookups take no lock, and only
+// adding a string to the table does
+Atom* atom_find(const char *s);
+Atom* atom_find_length(const char *s, size_t length);
+// the interned atom equal to atom, which becomes the interned one if there is none. its
+// hash must have been computed with the current seed, and it is never freed, e.g. an
+// atom mapped from a snapshot
+Atom* atom_adopt(Atom *atom);
+
+#endif
@@ -0,0 +1,136 @@
+#!/bin/bash
+# compares the default build with the compressed reference build (make COMPRESSED=1).
+# both are built with optimizations.
+
+set -e
+
+make -s RELEASE=1 DIR=build-release build-release/main build-release/hash_test build-release/sort_test build-release/vector_test build-release/generator_test build-release/json_test
+make -s RELEASE=1 COMPRESSED=1 DIR=build-release-compressed build-release-compressed/main
+
+for path in $(ls bench/*.js); do
+  echo "$path"
+  for executable in ./build-release/main ./build-release-compressed/main; do
+    echo "  $executable"
+    TIMEFORMAT="time: %R s"
+    { time $executable --stats $path >/dev/null ; } 2>&1 | sed 's/^/    /'
+  done
+  echo
+done
+
+# the same script 16 times on one thread and on every core
+scripts=$(for i in $(seq 16); do echo bench/inline.js; done)
+for jobs in 1 $(nproc); do
+  echo "--jobs $jobs (16 x bench/inline.js)"
+  TIMEFORMAT="time: %R s"
+  { time ./build-release/main --jobs $jobs $scripts >/dev/null ; } 2>&1 | sed 's/^/  /'
+done
+echo
+
+# parallelMap and parallelReduce on the calling thread only, and on every core
+for threads in 1 $(nproc); do
+  echo "--threads $threads (bench/parallel.js)"
+  TIMEFORMAT="time: %R s"
+  { time ./build-release/main --threads $threads bench/parallel.js >/dev/null ; } 2>&1 | sed 's/^/  /'
+done
+echo
+
+# the same sum on the main thread, and split over 4 workers that get their part transferred
+for path in bench/worker/serial.js bench/worker/parallel.js; do
+  echo "$path"
+  for executable in ./build-release/main ./build-release-compressed/main; do
+    echo "  $executable"
+    TIMEFORMAT="time: %R s"
+    { time $executable $path >/dev/null ; } 2>&1 | sed 's/^/    /'
+  done
+done
+echo
+
+# 256 files of 64 KiB read one after the other, then with all of the reads in flight
+files=/tmp/mjs-bench-files
+mkdir -p $files
+for i in $(seq 0 255); do
+  [ -f $files/$i ] || head -c 49152 /dev/urandom | base64 -w 0 >$files/$i
+done
+for path in bench/loop/serial.js bench/loop/parallel.js; do
+  echo "$path"
+  TIMEFORMAT="time: %R s"
+  { time ./build-release/main $path >/dev/null ; } 2>&1 | sed 's/^/  /'
+done
+echo
+
+# a pipeline of three stages over 1000000 records, with an array between the stages,
+# then with generators handing one record at a time through them
+for path in bench/generator/arrays.js bench/generator/generators.js; do
+  echo "$path"
+  TIMEFORMAT="time: %R s"
+  { time ./build-release/main --stats $path >/dev/null ; } 2>&1 | sed 's/^/  /'
+done
+echo
+
+# 4000000 lines of a log (65 MB) piped in, as views into the block they were read into,
+# then as a copy per readLine
+log=/tmp/mjs-bench-log.txt
+[ -f $log ] || awk 'BEGIN { split("GET /index.html 200,POST /api 500,GET /a.png 404", r, ",");
+                          for (i = 0; i < 4000000; i++) print r[i % 3 + 1] }' >$log
+for path in bench/stdin/lines.js bench/stdin/readline.js; do
+  echo "$path"
+  TIMEFORMAT="time: %R s"
+  { time ./build-release/main --stats $path <$log >/dev/null ; } 2>&1 | sed 's/^/  /'
+done
+echo
+
+# 20000 records (3 MB) as a JS literal run through the whole interpreter, the way a
+# document was read before JSON.parse, then parsed natively, then written back 10 times
+json=/tmp/mjs-bench-json
+mkdir -p $json
+if [ ! -f $json/corpus.json ]; then
+  awk 'BEGIN { printf "[";
+               for (i = 0; i < 20000; i++) printf "%s\n  {\"id\": %d, \"name\": \"user %d\", \"email\": \"user%d@example.com\", \"active\": %s, \"score\": %d, \"tags\": [\"alpha\", \"beta\"], \"location\": {\"x\": %d, \"y\": %d}}",
+                                            (i ? "," : ""), i, i, i, (i % 3 ? "false" : "true"), i % 1000, i % 7, i % 11;
+               print "\n]" }' >$json/corpus.json
+  # object literals take their keys unquoted
+  { printf "var doc = "; sed 's/"\([a-z]*\)":/\1:/g' $json/corpus.json; printf ";\nconsole.log(doc.length);\n"; } >$json/literal.js
+fi
+for path in $json/literal.js bench/json/parse.js bench/json/stringify.js; do
+  echo "$path"
+  TIMEFORMAT="time: %R s"
+  { time ./build-release/main --stats $path >/dev/null ; } 2>&1 | sed 's/^/  /'
+done
+echo
+
+# a request that needs an expensive prelude: a process per script, then a --serve pool
+# that ran the prelude once
+socket=$(mktemp -u /tmp/mjs-bench.XXXXXX)
+cat bench/serve/prelude.js bench/serve/request.js >$socket.js
+echo "process per script (10 x bench/serve/request.js)"
+TIMEFORMAT="time: %R s"
+{ time for i in $(seq 10); do ./build-release/main $socket.js >/dev/null; done ; } 2>&1 | sed 's/^/  /'
+./build-release/main --serve $socket --workers $(nproc) bench/serve/prelude.js &
+server=$!
+while [ ! -S $socket ]; do sleep 0.1; done
+echo "--connect (100 x bench/serve/request.js)"
+{ time for i in $(seq 100); do ./build-release/main --connect $socket bench/serve/request.js >/dev/null; done ; } 2>&1 | sed 's/^/  /'
+kill $server
+wait $server
+
+# the same, with the prelude's heap mapped from a snapshot
+./build-release/main --snapshot bench/serve/prelude.js -o $socket.snap
+echo "--load-snapshot (10 x bench/serve/request.js)"
+{ time for i in $(seq 10); do ./build-release/main --load-snapshot $socket.snap bench/serve/request.js >/dev/null; done ; } 2>&1 | sed 's/^/  /'
+rm -f $socket.js $socket.snap
+echo
+
+echo "hash_test --bench"
+./build-release/hash_test --bench | sed 's/^/  /'
+
+echo "sort_test --bench"
+./build-release/sort_test --bench | sed 's/^/  /'
+
+echo "vector_test --bench"
+./build-release/vector_test --bench | sed 's/^/  /'
+
+echo "generator_test --bench"
+./build-release/generator_test --bench | sed 's/^/  /'
+
+echo "json_test --bench"
+./build-release/json_test --bench | sed 's/^/  /'
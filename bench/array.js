@@ -0,0 +1,23 @@
+var n = 600;
+var items = [];
+for (var i = 0; i < n; i = i + 1) {
+  items[i] = n - i;
+}
+
+for (var i = 0; i < n; i = i + 1) {
+  var stop = n - 1 - i;
+  for (var j = 0; j < stop; j = j + 1) {
+    var next = j + 1;
+    if (items[j] > items[next]) {
+      var temp = items[j];
+      items[j] = items[next];
+      items[next] = temp;
+    }
+  }
+}
+
+var sum = 0;
+for (var i = 0; i < n; i = i + 1) {
+  sum = sum + items[i];
+}
+console.log(sum);
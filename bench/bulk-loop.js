@@ -0,0 +1,30 @@
+var n = 100000;
+var items = [];
+for (var i = 0; i < n; i = i + 1) {
+  items[i] = i;
+}
+
+var total = 0;
+for (var round = 0; round < 5; round = round + 1) {
+  var found = 0 - 1;
+  for (var i = 0; i < n; i = i + 1) {
+    if (found < 0) {
+      if (items[i] === n - 1) {
+        found = i;
+      }
+    }
+  }
+
+  var sum = 0;
+  for (var i = 0; i < n; i = i + 1) {
+    sum = sum + items[i];
+  }
+
+  var copy = [];
+  for (var i = 0; i < n; i = i + 1) {
+    copy[i] = items[i];
+  }
+
+  total = total + found + sum + copy.length;
+}
+console.log(total);
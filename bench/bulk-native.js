@@ -0,0 +1,15 @@
+var n = 100000;
+var items = [];
+for (var i = 0; i < n; i = i + 1) {
+  items[i] = i;
+}
+
+var add = function (a, b) { return a + b; };
+var total = 0;
+for (var round = 0; round < 5; round = round + 1) {
+  var found = items.indexOf(n - 1);
+  var sum = items.reduce(add, 0);
+  var copy = items.slice();
+  total = total + found + sum + copy.length;
+}
+console.log(total);
@@ -0,0 +1,10 @@
+var items = [];
+var total = 0;
+for (var i = 0; i < 300000; i++) {
+  items.push(i);
+  total = Math.max(total, Math.abs(i - 1000));
+}
+while (items.length > 0) {
+  items.pop();
+}
+console.log(total);
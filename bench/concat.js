@@ -0,0 +1,17 @@
+var n = 100000;
+
+var log = '';
+for (var i = 0; i < n; i = i + 1) {
+  log = log + 'line ' + i + '\n';
+}
+
+var lines = [];
+for (var j = 0; j < n; j = j + 1) {
+  lines[j] = 'line ' + j;
+}
+var joined = lines.join('\n');
+
+var o = {};
+o[log] = 1;
+o[joined] = 2;
+console.log(o[log] + o[joined]);
@@ -0,0 +1,19 @@
+var o = {};
+for (var i = 0; i < 2000; i = i + 1) {
+  o[i] = i;
+}
+
+var total = 0;
+for (var n = 0; n < 50; n = n + 1) {
+  for (var key in o) {
+    total = total + o[key];
+  }
+}
+
+for (var i = 0; i < 2000; i = i + 2) {
+  delete o[i];
+}
+
+console.log(total);
+var keys = Object.keys(o);
+console.log(keys.length);
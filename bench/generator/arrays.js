@@ -0,0 +1,25 @@
+var n = 1000000;
+
+var records = [];
+for (var i = 0; i < n; i++) {
+  records.push(i);
+}
+
+var scaled = [];
+for (var i = 0; i < records.length; i++) {
+  scaled.push(records[i] * 3);
+}
+
+var even = [];
+for (var i = 0; i < scaled.length; i++) {
+  var x = scaled[i];
+  if (Math.floor(x / 2) * 2 === x) {
+    even.push(x);
+  }
+}
+
+var sum = 0;
+for (var i = 0; i < even.length; i++) {
+  sum = sum + even[i];
+}
+console.log(sum);
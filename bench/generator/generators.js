@@ -0,0 +1,27 @@
+var n = 1000000;
+
+function* records() {
+  for (var i = 0; i < n; i++) {
+    yield i;
+  }
+}
+
+function* scaled(source) {
+  for (var x of source) {
+    yield x * 3;
+  }
+}
+
+function* even(source) {
+  for (var x of source) {
+    if (Math.floor(x / 2) * 2 === x) {
+      yield x;
+    }
+  }
+}
+
+var sum = 0;
+for (var x of even(scaled(records()))) {
+  sum = sum + x;
+}
+console.log(sum);
@@ -0,0 +1,8 @@
+function add(a, b) { return a + b; }
+function getX(p) { return p.x; }
+var point = { x: 2 };
+var total = 0;
+for (var i = 0; i < 300000; i++) {
+  total = add(total, getX(point));
+}
+console.log(total);
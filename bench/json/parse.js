@@ -0,0 +1,4 @@
+fs.readFile('/tmp/mjs-bench-json/corpus.json').then(function (text) {
+  var doc = JSON.parse(text);
+  console.log(doc.length, doc[19999].location.y);
+});
@@ -0,0 +1,7 @@
+fs.readFile('/tmp/mjs-bench-json/corpus.json').then(function (text) {
+  var doc = JSON.parse(text);
+  for (var i = 0; i < 10; i++) {
+    var out = JSON.stringify(doc);
+  }
+  console.log(JSON.parse(out).length);
+});
@@ -0,0 +1,9 @@
+var items = [1, 2, 3, 4, 5, 6, 7, 8];
+var bytes = new Uint8Array(16);
+var total = 0;
+for (var round = 0; round < 40000; round++) {
+  for (var i = 0; i < items.length; i++) {
+    total += items[i] + bytes.length;
+  }
+}
+console.log(total);
@@ -0,0 +1,8 @@
+var total = 0;
+for (var i = 0; i < 200000; i = i + 1) {
+  var point = { x: 1, y: 2, z: 3, w: 4 };
+  var items = [1, 2, 3, 4, 5, 6, 7, 8];
+  var names = ['a', 'b', 'c', 'd'];
+  total = total + point.x + items[7] + names.length;
+}
+console.log(total);
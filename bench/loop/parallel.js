@@ -0,0 +1,8 @@
+var reads = [];
+for (var i = 0; i < 256; i++) {
+  reads.push(fs.readFile('/tmp/mjs-bench-files/' + i));
+}
+
+Promise.all(reads).then(function (texts) {
+  console.log(texts.length);
+});
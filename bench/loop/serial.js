@@ -0,0 +1,11 @@
+var state = { i: 0 };
+
+function next(text) {
+  state.i = state.i + 1;
+  if (state.i < 256) {
+    return fs.readFile('/tmp/mjs-bench-files/' + state.i).then(next);
+  }
+  console.log(state.i);
+}
+
+fs.readFile('/tmp/mjs-bench-files/0').then(next);
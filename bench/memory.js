@@ -0,0 +1,12 @@
+var nodes = [];
+for (var i = 0; i < 50000; i = i + 1) {
+  nodes[i] = { id: i, weight: i * 2, edges: [i, i + 1, i + 2] };
+}
+
+var total = 0;
+for (var i = 0; i < nodes.length; i = i + 1) {
+  var node = nodes[i];
+  total = total + node.weight;
+}
+
+console.log(total);
@@ -0,0 +1,14 @@
+var size = 200000;
+var data = [];
+for (var i = 0; i < size; i++) {
+  data.push(i);
+}
+
+var weights = data.parallelMap(function (x) {
+  var sum = 0;
+  for (var j = 0; j < 50; j++) {
+    sum = sum + Math.sqrt(x * j);
+  }
+  return Math.floor(sum);
+});
+console.log(weights.parallelReduce(function (a, b) { return a + b; }, 0, function (a, b) { return a + b; }));
@@ -0,0 +1,15 @@
+var limit = 200000;
+var composite = new Uint8Array(limit);
+var primes = [];
+for (var i = 2; i < limit; i++) {
+  if (composite[i] === 0) {
+    primes.push(i);
+    for (var j = i * i; j < limit; j += i) {
+      composite[j] = 1;
+    }
+  }
+}
+
+function isPrime(n) {
+  return composite[n] === 0;
+}
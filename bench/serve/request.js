@@ -0,0 +1,7 @@
+var count = 0;
+for (var n = 1000; n < 1100; n++) {
+  if (isPrime(n)) {
+    count++;
+  }
+}
+console.log(count, primes.length);
@@ -0,0 +1,20 @@
+var n = 1000000;
+var items = [];
+var i = 0;
+while (i < n) {
+  items[i] = n - i;
+  items[i + 1] = i;
+  i = i + 2;
+}
+items.sort(function (a, b) { return a - b; });
+console.log(items[0], items[n - 1]);
+
+
+var m = 20000;
+var records = [];
+for (var j = 0; j < m; j = j + 1) {
+  records[j] = { key: m - j };
+}
+records.sort(function (a, b) { var d = a.key - b.key; return d; });
+var first = records[0];
+console.log(first.key);
@@ -0,0 +1,9 @@
+var table = [];
+for (var i = 0; i < 20000; i = i + 1) {
+  table[i * 7919 + 100000] = i;
+}
+var sum = 0;
+for (var i = 0; i < 20000; i = i + 1) {
+  sum = sum + table[i * 7919 + 100000];
+}
+console.log(sum);
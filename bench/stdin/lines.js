@@ -0,0 +1,7 @@
+var hits = 0;
+var errors = 0;
+for (var line of stdin.lines()) {
+  if (line === 'GET /index.html 200') { hits++; }
+  if (line === 'POST /api 500') { errors++; }
+}
+console.log(hits, errors);
@@ -0,0 +1,9 @@
+var hits = 0;
+var errors = 0;
+while (true) {
+  var line = stdin.readLine();
+  if (line === null) { break; }
+  if (line === 'GET /index.html 200') { hits++; }
+  if (line === 'POST /api 500') { errors++; }
+}
+console.log(hits, errors);
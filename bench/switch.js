@@ -0,0 +1,19 @@
+var program = [0, 1, 2, 3, 4, 5, 6, 7, 1, 1, 2, 0];
+var acc = 0;
+var steps = 0;
+for (var round = 0; round < 50000; round++) {
+  for (var pc = 0; pc < 12; pc++) {
+    switch (program[pc]) {
+      case 0: acc += 1; break;
+      case 1: acc += 2; break;
+      case 2: acc -= 1; break;
+      case 3: acc *= 1; break;
+      case 4: acc += 3; break;
+      case 5: acc -= 2; break;
+      case 6: acc += 4; break;
+      case 7: acc -= 4; break;
+    }
+    steps++;
+  }
+}
+console.log(acc, steps);
@@ -0,0 +1,17 @@
+var n = 200000;
+var samples = new Float64Array(n);
+var counts = new Int32Array(256);
+var bytes = new Uint8Array(n);
+
+for (var i = 0; i < n; i = i + 1) {
+  samples[i] = i * 3;
+  bytes[i] = i;
+}
+
+for (var i = 0; i < n; i = i + 1) {
+  var b = bytes[i];
+  counts[b] = counts[b] + 1;
+}
+
+var window = samples.subarray(n / 2, n / 2 + 4);
+console.log(counts[0], counts[255], window, window.byteOffset);
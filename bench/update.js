@@ -0,0 +1,9 @@
+var total = 0;
+var counts = [0, 0, 0, 0];
+var bytes = new Uint8Array(4);
+for (var i = 0; i < 1000000; i++) {
+  total += i;
+  counts[1]++;
+  bytes[2] += 3;
+}
+console.log(total, counts[1], bytes[2]);
@@ -0,0 +1,20 @@
+var parts = 4;
+var size = 200000;
+var data = [];
+for (var i = 0; i < size; i++) {
+  data.push(i);
+}
+
+var results = { total: 0, done: 0 };
+for (var p = 0; p < parts; p++) {
+  var part = data.slice(p * size / parts, (p + 1) * size / parts);
+  var worker = new Worker('bench/worker/part.js');
+  worker.onmessage = function (event) {
+    results.total = results.total + event.data;
+    results.done = results.done + 1;
+    if (results.done === parts) {
+      console.log(results.total);
+    }
+  };
+  worker.postMessage(part, [part]);
+}
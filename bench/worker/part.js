@@ -0,0 +1,12 @@
+function onmessage(event) {
+  var part = event.data;
+  var sum = 0;
+  for (var i = 0; i < part.length; i++) {
+    var x = part[i];
+    for (var j = 0; j < 50; j++) {
+      sum = sum + x * j;
+    }
+  }
+  postMessage(sum);
+  close();
+}
@@ -0,0 +1,14 @@
+var size = 200000;
+var data = [];
+for (var i = 0; i < size; i++) {
+  data.push(i);
+}
+
+var sum = 0;
+for (var i = 0; i < data.length; i++) {
+  var x = data[i];
+  for (var j = 0; j < 50; j++) {
+    sum = sum + x * j;
+  }
+}
+console.log(sum);
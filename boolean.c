@@ -2,20 +2,17 @@
 #include "object.h"
 
 Primitive* primitive_boolean_init(int value) {
-  Primitive *primitive = malloc(sizeof(Primitive));
+  Primitive *primitive = heap_alloc(sizeof(Primitive));
   primitive->type = PRIMITIVE_BOOLEAN;
+  primitive->flags = 0;
   primitive->value = value;
   return primitive;
 }
 
 Value* value_true_new() {
-  Value *v = value_object_create(NULL);
-  v->primitive = primitive_boolean_init(1);
-  return v;
+  return value_primitive_new(primitive_boolean_init(1));
 }
 
 Value* value_false_new() {
-  Value *v = value_object_create(NULL);
-  v->primitive = primitive_boolean_init(0);
-  return v;
+  return value_primitive_new(primitive_boolean_init(0));
 }
@@ -0,0 +1,138 @@
+#ifndef MJS_BUILTIN_H
+#define MJS_BUILTIN_H
+
+#include "value.h"
+
+// native methods and accessors of the builtin objects, installed from this table.
+//
+// M(ID, OWNER, NAME, KIND, FN, ARITY, ENTRY)
+//   ID     intrinsic id, BUILTIN_<ID>. the evaluator knows some of them by id
+//   OWNER  the object it is installed on, BUILTIN_OWNER_<OWNER>, or GLOBAL for globals
+//          and WORKER_SCOPE for the globals of a worker's scripts
+//   NAME   the property name
+//   KIND   METHOD, or ACCESSOR for a getter such as arr.length
+//   FN     the native taking an argument array
+//   ARITY  the argument count ENTRY takes (0 to 3), or NONE
+//   ENTRY  the fixed-arity entry point, or NULL
+#define BUILTIN_ENUM(M) \
+  M(OBJECT_KEYS, OBJECT, keys, METHOD, native_object_keys, NONE, NULL) \
+  M(ARRAY_LENGTH, ARRAY_PROTOTYPE, length, ACCESSOR, native_value_array_length, NONE, NULL) \
+  M(ARRAY_JOIN, ARRAY_PROTOTYPE, join, METHOD, native_value_array_join, NONE, NULL) \
+  M(ARRAY_SORT, ARRAY_PROTOTYPE, sort, METHOD, native_value_array_sort, NONE, NULL) \
+  M(ARRAY_INDEX_OF, ARRAY_PROTOTYPE, indexOf, METHOD, native_value_array_index_of, NONE, NULL) \
+  M(ARRAY_INCLUDES, ARRAY_PROTOTYPE, includes, METHOD, native_value_array_includes, NONE, NULL) \
+  M(ARRAY_FILL, ARRAY_PROTOTYPE, fill, METHOD, native_value_array_fill, NONE, NULL) \
+  M(ARRAY_SLICE, ARRAY_PROTOTYPE, slice, METHOD, native_value_array_slice, NONE, NULL) \
+  M(ARRAY_CONCAT, ARRAY_PROTOTYPE, concat, METHOD, native_value_array_concat, NONE, NULL) \
+  M(ARRAY_PUSH, ARRAY_PROTOTYPE, push, METHOD, native_value_array_push, 1, native_value_array_push1) \
+  M(ARRAY_POP, ARRAY_PROTOTYPE, pop, METHOD, native_value_array_pop, 0, native_value_array_pop0) \
+  M(ARRAY_REDUCE, ARRAY_PROTOTYPE, reduce, METHOD, native_value_array_reduce, NONE, NULL) \
+  M(ARRAY_PARALLEL_MAP, ARRAY_PROTOTYPE, parallelMap, METHOD, native_value_array_parallel_map, NONE, NULL) \
+  M(ARRAY_PARALLEL_REDUCE, ARRAY_PROTOTYPE, parallelReduce, METHOD, native_value_array_parallel_reduce, NONE, NULL) \
+  M(ARRAY_BUFFER_BYTE_LENGTH, ARRAY_BUFFER_PROTOTYPE, byteLength, ACCESSOR, native_array_buffer_byte_length, NONE, NULL) \
+  M(TYPED_ARRAY_LENGTH, TYPED_ARRAY_PROTOTYPE, length, ACCESSOR, native_typed_array_length, NONE, NULL) \
+  M(TYPED_ARRAY_BYTE_LENGTH, TYPED_ARRAY_PROTOTYPE, byteLength, ACCESSOR, native_typed_array_byte_length, NONE, NULL) \
+  M(TYPED_ARRAY_BYTE_OFFSET, TYPED_ARRAY_PROTOTYPE, byteOffset, ACCESSOR, native_typed_array_byte_offset, NONE, NULL) \
+  M(TYPED_ARRAY_BUFFER, TYPED_ARRAY_PROTOTYPE, buffer, ACCESSOR, native_typed_array_buffer, NONE, NULL) \
+  M(TYPED_ARRAY_SUBARRAY, TYPED_ARRAY_PROTOTYPE, subarray, METHOD, native_typed_array_subarray, NONE, NULL) \
+  M(TYPED_ARRAY_FILL, TYPED_ARRAY_PROTOTYPE, fill, METHOD, native_typed_array_fill, NONE, NULL) \
+  M(CONSOLE_LOG, CONSOLE, log, METHOD, native_console_log, 1, native_console_log1) \
+  M(MATH_ABS, MATH, abs, METHOD, native_math_abs, 1, native_math_abs1) \
+  M(MATH_FLOOR, MATH, floor, METHOD, native_math_floor, 1, native_math_floor1) \
+  M(MATH_CEIL, MATH, ceil, METHOD, native_math_ceil, 1, native_math_ceil1) \
+  M(MATH_TRUNC, MATH, trunc, METHOD, native_math_trunc, 1, native_math_trunc1) \
+  M(MATH_SQRT, MATH, sqrt, METHOD, native_math_sqrt, 1, native_math_sqrt1) \
+  M(MATH_MIN, MATH, min, METHOD, native_math_min, 2, native_math_min2) \
+  M(MATH_MAX, MATH, max, METHOD, native_math_max, 2, native_math_max2) \
+  M(WORKER_POST_MESSAGE, WORKER_PROTOTYPE, postMessage, METHOD, native_worker_post_message, NONE, NULL) \
+  M(WORKER_TERMINATE, WORKER_PROTOTYPE, terminate, METHOD, native_worker_terminate, NONE, NULL) \
+  M(WORKER_SCOPE_POST_MESSAGE, WORKER_SCOPE, postMessage, METHOD, native_worker_scope_post_message, NONE, NULL) \
+  M(WORKER_SCOPE_CLOSE, WORKER_SCOPE, close, METHOD, native_worker_scope_close, NONE, NULL) \
+  M(GLOBAL_SET_TIMEOUT, GLOBAL, setTimeout, METHOD, native_set_timeout, NONE, NULL) \
+  M(GLOBAL_CLEAR_TIMEOUT, GLOBAL, clearTimeout, METHOD, native_clear_timeout, NONE, NULL) \
+  M(PROMISE_RESOLVE, PROMISE, resolve, METHOD, native_promise_resolve, NONE, NULL) \
+  M(PROMISE_REJECT, PROMISE, reject, METHOD, native_promise_reject, NONE, NULL) \
+  M(PROMISE_ALL, PROMISE, all, METHOD, native_promise_all, NONE, NULL) \
+  M(PROMISE_THEN, PROMISE_PROTOTYPE, then, METHOD, native_promise_then, NONE, NULL) \
+  M(PROMISE_CATCH, PROMISE_PROTOTYPE, catch, METHOD, native_promise_catch, NONE, NULL) \
+  M(FS_READ_FILE, FS, readFile, METHOD, native_fs_read_file, NONE, NULL) \
+  M(FS_WRITE_FILE, FS, writeFile, METHOD, native_fs_write_file, NONE, NULL) \
+  M(GENERATOR_NEXT, GENERATOR_PROTOTYPE, next, METHOD, native_generator_next, NONE, NULL) \
+  M(STDIN_READ_LINE, STDIN, readLine, METHOD, native_stdin_read_line, NONE, NULL) \
+  M(STDIN_LINES, STDIN, lines, METHOD, native_stdin_lines, NONE, NULL) \
+  M(JSON_PARSE, JSON, parse, METHOD, native_json_parse, NONE, NULL) \
+  M(JSON_STRINGIFY, JSON, stringify, METHOD, native_json_stringify, NONE, NULL)
+
+#define BUILTIN_OWNER_ENUM(M) \
+  M(OBJECT) \
+  M(ARRAY_PROTOTYPE) \
+  M(ARRAY_BUFFER_PROTOTYPE) \
+  M(TYPED_ARRAY_PROTOTYPE) \
+  M(CONSOLE) \
+  M(MATH) \
+  M(WORKER_PROTOTYPE) \
+  M(WORKER_SCOPE) \
+  M(GLOBAL) \
+  M(PROMISE) \
+  M(PROMISE_PROTOTYPE) \
+  M(FS) \
+  M(GENERATOR_PROTOTYPE) \
+  M(STDIN) \
+  M(JSON)
+
+#define BUILTIN_TO_ENUM(ID, OWNER, NAME, KIND, FN, ARITY, ENTRY) BUILTIN_##ID,
+#define BUILTIN_OWNER_TO_ENUM(OWNER) BUILTIN_OWNER_##OWNER,
+
+typedef enum BuiltinId {
+  BUILTIN_ENUM(BUILTIN_TO_ENUM)
+  BUILTIN_COUNT,
+} BuiltinId;
+
+// PrimitiveFunction.intrinsic of functions not in the table
+#define BUILTIN_NONE -1
+
+typedef enum BuiltinOwner {
+  BUILTIN_OWNER_ENUM(BUILTIN_OWNER_TO_ENUM)
+} BuiltinOwner;
+
+typedef struct Builtin {
+  const char *name;
+  BuiltinOwner owner;
+  int is_property;
+  NativeFunction *fn;
+  // -1 without an entry point
+  int arity;
+  NativeEntry entry;
+} Builtin;
+
+#define BUILTIN_KIND_METHOD 0
+#define BUILTIN_KIND_ACCESSOR 1
+#define BUILTIN_ARITY_NONE -1
+#define BUILTIN_ARITY_0 0
+#define BUILTIN_ARITY_1 1
+#define BUILTIN_ARITY_2 2
+#define BUILTIN_ARITY_3 3
+#define BUILTIN_ENTRY_NONE(ENTRY) { .fn0 = NULL }
+#define BUILTIN_ENTRY_0(ENTRY) { .fn0 = ENTRY }
+#define BUILTIN_ENTRY_1(ENTRY) { .fn1 = ENTRY }
+#define BUILTIN_ENTRY_2(ENTRY) { .fn2 = ENTRY }
+#define BUILTIN_ENTRY_3(ENTRY) { .fn3 = ENTRY }
+
+#define BUILTIN_TO_TABLE(ID, OWNER, NAME, KIND, FN, ARITY, ENTRY) \
+  { #NAME, BUILTIN_OWNER_##OWNER, BUILTIN_KIND_##KIND, FN, BUILTIN_ARITY_##ARITY, BUILTIN_ENTRY_##ARITY(ENTRY) },
+
+// installs the builtins of owner as global functions, e.g. those of a worker's scope
+void require_global_builtins(BuiltinOwner owner, Env *global);
+
+BuiltinOwner builtin_owner(int id);
+// whether every builtin of owner is still installed on object
+int builtin_owner_intact(Value *object, BuiltinOwner owner);
+
+// every native function and entry point by index, so that a snapshot can name them:
+// the fn and the entry of each builtin, then the constructors
+int builtin_native_count();
+// -1 for a native that is not known
+int builtin_native_index(void *native);
+void* builtin_native(int index);
+
+#endif
@@ -0,0 +1,180 @@
+#include "coroutine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+// stacks of finished coroutines, for the next ones the thread makes
+_Thread_local char *coroutine_stacks[COROUTINE_STACK_CACHE];
+_Thread_local int coroutine_stack_count = 0;
+// stacks given out and not freed yet
+_Thread_local int coroutine_stack_live = 0;
+
+// linux 6.13 and later mark pages as guards without changing the mapping's protection
+#ifndef MADV_GUARD_INSTALL
+#define MADV_GUARD_INSTALL 102
+#endif
+
+// a page
+size_t coroutine_guard_size() {
+  return sysconf(_SC_PAGESIZE);
+}
+
+char* coroutine_stack_alloc() {
+  if (coroutine_stack_live == COROUTINE_STACK_MAX) {
+    fprintf(stderr, "coroutine: more than %d unfinished coroutines\n", COROUTINE_STACK_MAX);
+    abort();
+  }
+  coroutine_stack_live++;
+  if (coroutine_stack_count > 0) return coroutine_stacks[--coroutine_stack_count];
+
+  size_t guard = coroutine_guard_size();
+  char *stack = mmap(NULL, guard + COROUTINE_STACK_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (stack == MAP_FAILED) {
+    perror("coroutine: mmap");
+    abort();
+  }
+
+  // overflowing the stack faults instead of writing over whatever is mapped below. a
+  // guard page made with madvise leaves the stack one mapping with its neighbours, a
+  // PROT_NONE one splits it from them, and the process can only have vm.max_map_count
+  // mappings
+  if (madvise(stack, guard, MADV_GUARD_INSTALL) != 0) mprotect(stack, guard, PROT_NONE);
+  return stack;
+}
+
+void coroutine_stack_free(char *stack) {
+  coroutine_stack_live--;
+  if (coroutine_stack_count < COROUTINE_STACK_CACHE) {
+    coroutine_stacks[coroutine_stack_count++] = stack;
+    return;
+  }
+
+  munmap(stack, coroutine_guard_size() + COROUTINE_STACK_SIZE);
+}
+
+void coroutine_main(Coroutine *coroutine);
+
+#if defined(__x86_64__)
+
+// coroutine_switch(save, load) pushes the callee-saved registers, stores the stack
+// pointer in *save and returns on the stack at load, popping the registers saved there.
+// a new stack starts in coroutine_start, which calls r13 with r12
+void coroutine_switch(void **save, void *load);
+void coroutine_start();
+
+__asm__(
+  ".text\n"
+  "coroutine_switch:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  "coroutine_start:\n"
+  "  movq %r12, %rdi\n"
+  "  call *%r13\n"
+  "  ud2\n"
+);
+
+void coroutine_context_init(Coroutine *coroutine) {
+  void **sp = (void**)(coroutine->stack + coroutine_guard_size() + COROUTINE_STACK_SIZE);
+  // coroutine_start is entered with the stack aligned to 16 bytes, so the call in it
+  // enters coroutine_main as any call would
+  *--sp = (void*)coroutine_start;
+  *--sp = NULL;
+  *--sp = NULL;
+  *--sp = coroutine;
+  *--sp = (void*)coroutine_main;
+  *--sp = NULL;
+  *--sp = NULL;
+  coroutine->sp = sp;
+  coroutine->context = NULL;
+}
+
+// the same switch goes both ways: sp holds the side that is not running
+static inline void coroutine_context_switch(Coroutine *coroutine) {
+  coroutine_switch(&coroutine->sp, coroutine->sp);
+}
+
+#else
+
+// context[0] is the side that resumed the coroutine, context[1] the coroutine
+_Thread_local Coroutine *coroutine_starting;
+
+void coroutine_context_start() {
+  coroutine_main(coroutine_starting);
+}
+
+void coroutine_context_init(Coroutine *coroutine) {
+  ucontext_t *context = malloc(2 * sizeof(ucontext_t));
+  getcontext(&context[1]);
+  context[1].uc_stack.ss_sp = coroutine->stack + coroutine_guard_size();
+  context[1].uc_stack.ss_size = COROUTINE_STACK_SIZE;
+  context[1].uc_link = NULL;
+  makecontext(&context[1], coroutine_context_start, 0);
+  coroutine->context = context;
+  coroutine->sp = NULL;
+}
+
+static inline void coroutine_context_switch(Coroutine *coroutine) {
+  ucontext_t *context = coroutine->context;
+  // sp is set while the coroutine runs
+  if (coroutine->sp == NULL) {
+    coroutine->sp = coroutine;
+    coroutine_starting = coroutine;
+    swapcontext(&context[0], &context[1]);
+  } else {
+    coroutine->sp = NULL;
+    swapcontext(&context[1], &context[0]);
+  }
+}
+
+#endif
+
+void coroutine_main(Coroutine *coroutine) {
+  coroutine->fn(coroutine->data);
+  coroutine->done = 1;
+  coroutine_context_switch(coroutine);
+  // a coroutine that is done is never resumed
+  abort();
+}
+
+Coroutine* coroutine_new(CoroutineFunction *fn, void *data) {
+  Coroutine *coroutine = malloc(sizeof(Coroutine));
+  coroutine->fn = fn;
+  coroutine->data = data;
+  coroutine->done = 0;
+  coroutine->stack = coroutine_stack_alloc();
+  coroutine_context_init(coroutine);
+  return coroutine;
+}
+
+void coroutine_resume(Coroutine *coroutine) {
+  coroutine_context_switch(coroutine);
+}
+
+void coroutine_yield(Coroutine *coroutine) {
+  coroutine_context_switch(coroutine);
+}
+
+void coroutine_free(Coroutine *coroutine) {
+  coroutine_stack_free(coroutine->stack);
+  free(coroutine->context);
+  free(coroutine);
+}
@@ -0,0 +1,47 @@
+#ifndef MJS_COROUTINE_H
+#define MJS_COROUTINE_H
+
+#include <stddef.h>
+
+// a function running on a stack of its own, which it leaves with coroutine_yield and
+// is resumed at by coroutine_resume. the evaluator is recursive, so a generator keeps
+// its place in the body as the C frames on its coroutine's stack.
+//
+// stacks are COROUTINE_STACK_SIZE bytes of address space with a guard page below, of
+// which only the pages touched are backed by memory. stacks of finished coroutines are
+// kept by the thread, up to COROUTINE_STACK_CACHE of them, for the next ones it makes. a
+// stack is only given back by coroutine_free, so a thread can have at most
+// COROUTINE_STACK_MAX coroutines that are not freed. on linux 6.13 and later the guard
+// pages don't take mappings of their own; on older kernels each stack takes two, and
+// vm.max_map_count (65530 by default) runs out at about 32000 stacks.
+// on x86-64 a switch saves the callee-saved registers and swaps stack pointers, other
+// machines use swapcontext. a coroutine is only run by the thread that made it.
+#define COROUTINE_STACK_SIZE (1024 * 1024)
+#define COROUTINE_STACK_CACHE 64
+#define COROUTINE_STACK_MAX (1 << 17)
+
+typedef void (CoroutineFunction)(void *data);
+
+typedef struct Coroutine {
+  CoroutineFunction *fn;
+  void *data;
+  // set once fn returned
+  int done;
+  // the lowest address of the stack, its guard page
+  char *stack;
+  // the stack pointer of the side that is not running, saved by the switch
+  void *sp;
+  void *context;
+} Coroutine;
+
+// fn(data) starts on the first coroutine_resume
+Coroutine* coroutine_new(CoroutineFunction *fn, void *data);
+// runs the coroutine until it yields or fn returns
+void coroutine_resume(Coroutine *coroutine);
+// called on the coroutine's stack, goes back to the coroutine_resume that ran it
+void coroutine_yield(Coroutine *coroutine);
+// a coroutine that is done, or will never be resumed again. the frames on its stack are
+// dropped without running the rest of them
+void coroutine_free(Coroutine *coroutine);
+
+#endif
@@ -0,0 +1,288 @@
+#include "dict.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DICT_MIN_CAP 8
+#define DICT_INDEX_EMPTY (-1)
+#define DICT_INDEX_DELETED (-2)
+#define DICT_PERTURB_SHIFT 5
+
+// at most 2/3 of the index slots are in use
+#define DICT_USABLE(CAP) ((CAP) * 2 / 3)
+
+size_t dict_index_width(unsigned int cap) {
+  if (cap <= 128) return 1;
+  if (cap <= 32768) return 2;
+  return 4;
+}
+
+size_t dict_indices_size(unsigned int cap) {
+  size_t size = cap * dict_index_width(cap);
+  return (size + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+}
+
+size_t dict_storage_size(unsigned int cap) {
+  return dict_indices_size(cap) + DICT_USABLE(cap) * sizeof(DictEntry);
+}
+
+DictEntry* dict_entries(Dict *dict) {
+  uint8_t *storage = heap_decode(dict->storage);
+  return (DictEntry*)(storage + dict_indices_size(dict->cap));
+}
+
+int32_t dict_index_get(Dict *dict, size_t i) {
+  uint8_t *indices = heap_decode(dict->storage);
+  switch (dict_index_width(dict->cap)) {
+    case 1: return ((int8_t*)indices)[i];
+    case 2: return ((int16_t*)indices)[i];
+    default: return ((int32_t*)indices)[i];
+  }
+}
+
+void dict_index_set(Dict *dict, size_t i, int32_t index) {
+  uint8_t *indices = heap_decode(dict->storage);
+  switch (dict_index_width(dict->cap)) {
+    case 1: ((int8_t*)indices)[i] = index; break;
+    case 2: ((int16_t*)indices)[i] = index; break;
+    default: ((int32_t*)indices)[i] = index; break;
+  }
+}
+
+Dict* dict_new() {
+  Dict *dict = heap_alloc(sizeof(Dict));
+  dict->cap = 0;
+  dict->size = 0;
+  dict->used = 0;
+  dict->shared = 0;
+  dict->storage = heap_encode(NULL);
+  return dict;
+}
+
+Dict* dict_copy(Dict *dict) {
+  Dict *copy = dict_new();
+  copy->cap = dict->cap;
+  copy->size = dict->size;
+  copy->used = dict->used;
+  if (dict->cap != 0) {
+    uint8_t *storage = heap_alloc(dict_storage_size(dict->cap));
+    memcpy(storage, heap_decode(dict->storage), dict_storage_size(dict->cap));
+    copy->storage = heap_encode(storage);
+  }
+
+  return copy;
+}
+
+// returns the index slot holding key, or -1.
+// empty_slot receives the first free slot of the probe sequence.
+long dict_find_slot(Dict *dict, Atom *key, size_t *empty_slot) {
+  if (dict->cap == 0) return -1;
+
+  DictEntry *entries = dict_entries(dict);
+  // an index key may be a probe on the stack (see AtomIndex), which has no ref
+  uint32_t key_index = key->index;
+  HEAP_REF(Atom) ref = key_index == ATOM_NOT_INDEX ? heap_encode(key) : heap_encode(NULL);
+  size_t mask = dict->cap - 1;
+  size_t i = key->hash & mask;
+  long free_slot = -1;
+
+  for (uint32_t perturb = key->hash; ; ) {
+    int32_t index = dict_index_get(dict, i);
+    if (index == DICT_INDEX_EMPTY) {
+      if (empty_slot != NULL) *empty_slot = free_slot >= 0 ? (size_t)free_slot : i;
+      return -1;
+    }
+
+    if (index == DICT_INDEX_DELETED) {
+      if (free_slot < 0) free_slot = i;
+    } else {
+      if (key_index == ATOM_NOT_INDEX ? entries[index].key == ref : HEAP_GET(Atom, entries[index].key)->index == key_index) {
+        return i;
+      }
+    }
+
+    perturb >>= DICT_PERTURB_SHIFT;
+    i = (i * 5 + perturb + 1) & mask;
+  }
+}
+
+// rebuilds the dictionary with the given capacity, dropping deleted entries
+void dict_resize(Dict *dict, unsigned int new_cap) {
+  uint8_t *old_storage = heap_decode(dict->storage);
+  DictEntry *old_entries = old_storage == NULL ? NULL : dict_entries(dict);
+  unsigned int old_cap = dict->cap;
+  unsigned int old_used = dict->used;
+
+  dict->cap = new_cap;
+  dict->used = 0;
+  if (new_cap == 0) {
+    dict->storage = heap_encode(NULL);
+  } else {
+    uint8_t *storage = heap_alloc(dict_storage_size(new_cap));
+    memset(storage, 0xff, dict_indices_size(new_cap));
+    dict->storage = heap_encode(storage);
+
+    DictEntry *entries = dict_entries(dict);
+    size_t mask = new_cap - 1;
+    for (unsigned int j = 0; j < old_used; j++) {
+      DictEntry *entry = &old_entries[j];
+      Atom *key = heap_decode(entry->key);
+      if (key == NULL) continue;
+
+      size_t i = key->hash & mask;
+      for (uint32_t perturb = key->hash; dict_index_get(dict, i) != DICT_INDEX_EMPTY; ) {
+        perturb >>= DICT_PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+      }
+
+      entries[dict->used] = *entry;
+      dict_index_set(dict, i, dict->used);
+      dict->used++;
+    }
+  }
+
+  if (old_storage != NULL) {
+    heap_free(old_storage, dict_storage_size(old_cap));
+  }
+}
+
+unsigned int dict_cap_for(unsigned int size) {
+  unsigned int cap = DICT_MIN_CAP;
+  while (DICT_USABLE(cap) < size + size / 2 + 1) cap *= 2;
+  return cap;
+}
+
+void dict_reserve(Dict *dict, unsigned int size) {
+  if (size <= DICT_USABLE(dict->cap)) return;
+
+  unsigned int cap = DICT_MIN_CAP;
+  while (DICT_USABLE(cap) < size) cap *= 2;
+  dict_resize(dict, cap);
+}
+
+int dict_set(Dict *dict, Atom *key, void *value) {
+  long slot = dict_find_slot(dict, key, NULL);
+  if (slot >= 0) {
+    dict_entries(dict)[dict_index_get(dict, slot)].value = heap_encode(value);
+    return 0;
+  }
+
+  if (dict->used == DICT_USABLE(dict->cap)) {
+    dict_resize(dict, dict_cap_for(dict->size + 1));
+  }
+
+  size_t empty_slot;
+  dict_find_slot(dict, key, &empty_slot);
+
+  DictEntry *entry = &dict_entries(dict)[dict->used];
+  entry->key = heap_encode(key);
+  entry->value = heap_encode(value);
+
+  dict_index_set(dict, empty_slot, dict->used);
+  dict->used++;
+  dict->size++;
+  return 1;
+}
+
+void* dict_get(Dict *dict, Atom *key) {
+  if (dict->size == 0) return NULL;
+
+  long slot = dict_find_slot(dict, key, NULL);
+  if (slot < 0) return NULL;
+
+  return heap_decode(dict_entries(dict)[dict_index_get(dict, slot)].value);
+}
+
+int dict_delete(Dict *dict, Atom *key) {
+  if (dict->size == 0) return 0;
+
+  long slot = dict_find_slot(dict, key, NULL);
+  if (slot < 0) return 0;
+
+  DictEntry *entry = &dict_entries(dict)[dict_index_get(dict, slot)];
+  entry->key = heap_encode(NULL);
+  entry->value = heap_encode(NULL);
+  dict_index_set(dict, slot, DICT_INDEX_DELETED);
+  dict->size--;
+
+  // compact once tombstones outnumber live entries. this also shrinks
+  // the storage, so memory is given back as properties are removed.
+  if (dict->size == 0) {
+    dict_resize(dict, 0);
+  } else if (dict->used - dict->size > dict->size) {
+    dict_resize(dict, dict_cap_for(dict->size));
+  }
+
+  return 1;
+}
+
+int dict_next(Dict *dict, unsigned int *pos, Atom **key, void **value) {
+  if (dict->cap == 0) return 0;
+
+  DictEntry *entries = dict_entries(dict);
+  while (*pos < dict->used) {
+    DictEntry *entry = &entries[(*pos)++];
+    if (entry->key == heap_encode(NULL)) continue;
+
+    if (key != NULL) *key = heap_decode(entry->key);
+    if (value != NULL) *value = heap_decode(entry->value);
+    return 1;
+  }
+
+  return 0;
+}
+
+int dict_compare_index_keys(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+void dict_iterator_init(DictIterator *it, Dict *dict) {
+  it->dict = dict;
+  it->pos = 0;
+  it->order = NULL;
+  if (dict == NULL || dict->cap == 0) return;
+
+  DictEntry *entries = dict_entries(dict);
+  unsigned int indices = 0;
+  for (unsigned int i = 0; i < dict->used; i++) {
+    Atom *key = heap_decode(entries[i].key);
+    if (key != NULL && key->index != ATOM_NOT_INDEX) indices++;
+  }
+  if (indices == 0) return;
+
+  // the index keys sorted by their index, with the position of their entry in the low
+  // bits, then the positions of the other entries as they come
+  uint64_t *order = malloc(dict->size * sizeof(uint64_t));
+  unsigned int before = 0, after = indices;
+  for (unsigned int i = 0; i < dict->used; i++) {
+    Atom *key = heap_decode(entries[i].key);
+    if (key == NULL) continue;
+
+    if (key->index != ATOM_NOT_INDEX) {
+      order[before++] = (uint64_t)key->index << 32 | i;
+    } else {
+      order[after++] = i;
+    }
+  }
+  qsort(order, indices, sizeof(uint64_t), dict_compare_index_keys);
+
+  it->order = order;
+  it->count = dict->size;
+}
+
+int dict_iterator_next(DictIterator *it, Atom **key, void **value) {
+  if (it->order == NULL) return it->dict != NULL && dict_next(it->dict, &it->pos, key, value);
+
+  if (it->pos == it->count) {
+    free(it->order);
+    it->order = NULL;
+    it->count = 0;
+    it->dict = NULL;
+    return 0;
+  }
+
+  DictEntry *entry = &dict_entries(it->dict)[(uint32_t)it->order[it->pos++]];
+  if (key != NULL) *key = heap_decode(entry->key);
+  if (value != NULL) *value = heap_decode(entry->value);
+  return 1;
+}
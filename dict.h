@@ -0,0 +1,70 @@
+#ifndef MJS_DICT_H
+#define MJS_DICT_H
+
+#include "heap.h"
+#include "atom.h"
+#include <stdint.h>
+
+// insertion-ordered dictionary for object properties.
+//
+// entries are appended to a dense array in insertion order, and a sparse index
+// array (open addressing, power-of-two size) maps hashes to entry positions.
+// deleting leaves a tombstone which is dropped by the next compaction.
+// index slots are 1, 2 or 4 bytes wide depending on the capacity.
+// keys are atoms and compared by pointer, except array indices ('0', '12'), which
+// are compared by index since they are not always interned (see AtomIndex).
+//
+// values must be allocated with heap_alloc
+typedef struct Dict {
+  // number of index slots. 0 until the first insert.
+  unsigned int cap;
+  // live entries
+  unsigned int size;
+  // entries written so far, including tombstones
+  unsigned int used;
+  // set on the table of a literal template, which objects share until their
+  // first write (see value_object_table). a shared dict is never modified
+  unsigned int shared;
+  // index slots followed by the entries array
+  HEAP_REF(uint8_t) storage;
+} Dict;
+
+typedef struct DictEntry {
+  // NULL for a deleted entry
+  HEAP_REF(Atom) key;
+  HEAP_REF(void) value;
+} DictEntry;
+
+Dict* dict_new();
+// a copy with its own storage, not shared
+Dict* dict_copy(Dict *dict);
+// makes room for size entries without growing again
+void dict_reserve(Dict *dict, unsigned int size);
+// returns 1 if the key was added, 0 if it was there and keeps its atom
+int dict_set(Dict *dict, Atom *key, void *value);
+void* dict_get(Dict *dict, Atom *key);
+int dict_delete(Dict *dict, Atom *key);
+
+// bytes of the index slots and entries of a dict with cap index slots
+size_t dict_storage_size(unsigned int cap);
+// the entries array in the storage, used of them written
+DictEntry* dict_entries(Dict *dict);
+
+// iterates entries in insertion order. pos starts at 0.
+int dict_next(Dict *dict, unsigned int *pos, Atom **key, void **value);
+
+// iterates entries in the order an object lists its properties: keys that are array
+// indices ('0', '12') in ascending order, then the others in insertion order. the dict
+// must not change during the iteration, which must run to the end. dict may be NULL
+typedef struct DictIterator {
+  Dict *dict;
+  unsigned int pos;
+  // positions of the entries, when there are index keys. NULL otherwise
+  uint64_t *order;
+  unsigned int count;
+} DictIterator;
+
+void dict_iterator_init(DictIterator *it, Dict *dict);
+int dict_iterator_next(DictIterator *it, Atom **key, void **value);
+
+#endif
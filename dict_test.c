@@ -0,0 +1,165 @@
+#include "dict.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+char* heap_string(const char *s) {
+  char *p = heap_alloc(strlen(s) + 1);
+  strcpy(p, s);
+  return p;
+}
+
+void test_dict() {
+  Dict *dict = dict_new();
+  assert(dict_get(dict, atom_intern("foo")) == NULL);
+
+  dict_set(dict, atom_intern("foo"), heap_string("bar"));
+  assert(strcmp(dict_get(dict, atom_intern("foo")), "bar") == 0);
+
+  dict_set(dict, atom_intern("foo"), heap_string("bar2"));
+  assert(strcmp(dict_get(dict, atom_intern("foo")), "bar2") == 0);
+  assert(dict->size == 1);
+
+  assert(dict_delete(dict, atom_intern("foo")) == 1);
+  assert(dict_delete(dict, atom_intern("foo")) == 0);
+  assert(dict_get(dict, atom_intern("foo")) == NULL);
+  assert(dict->size == 0);
+}
+
+void test_dict_order() {
+  Dict *dict = dict_new();
+  char key[32];
+  for (int i = 0; i < 1000; i++) {
+    sprintf(key, "k%d", i);
+    dict_set(dict, atom_intern(key), heap_string(key));
+  }
+
+  // delete every other key; the rest keep their insertion order
+  for (int i = 0; i < 1000; i += 2) {
+    sprintf(key, "k%d", i);
+    assert(dict_delete(dict, atom_intern(key)) == 1);
+  }
+  assert(dict->size == 500);
+
+  dict_set(dict, atom_intern("last"), heap_string("last"));
+
+  unsigned int pos = 0;
+  Atom *k;
+  void *value;
+  for (int i = 1; i < 1000; i += 2) {
+    assert(dict_next(dict, &pos, &k, &value));
+    sprintf(key, "k%d", i);
+    assert(strcmp(k->string, key) == 0);
+    assert(strcmp(value, key) == 0);
+  }
+  assert(dict_next(dict, &pos, &k, &value));
+  assert(strcmp(k->string, "last") == 0);
+  assert(!dict_next(dict, &pos, &k, &value));
+}
+
+void test_dict_shrink() {
+  Dict *dict = dict_new();
+  char key[32];
+  for (int i = 0; i < 10000; i++) {
+    sprintf(key, "k%d", i);
+    dict_set(dict, atom_intern(key), heap_string(key));
+  }
+  unsigned int cap = dict->cap;
+
+  for (int i = 0; i < 9990; i++) {
+    sprintf(key, "k%d", i);
+    dict_delete(dict, atom_intern(key));
+  }
+
+  // compaction gives the storage back
+  assert(dict->cap < cap);
+  assert(dict->used - dict->size <= dict->size);
+  for (int i = 9990; i < 10000; i++) {
+    sprintf(key, "k%d", i);
+    assert(strcmp(dict_get(dict, atom_intern(key)), key) == 0);
+  }
+
+  for (int i = 9990; i < 10000; i++) {
+    sprintf(key, "k%d", i);
+    dict_delete(dict, atom_intern(key));
+  }
+  assert(dict->cap == 0);
+}
+
+void test_dict_copy_reserve() {
+  Dict *dict = dict_new();
+  dict_reserve(dict, 20);
+  unsigned int cap = dict->cap;
+
+  char key[32];
+  for (int i = 0; i < 20; i++) {
+    sprintf(key, "r%d", i);
+    dict_set(dict, atom_intern(key), heap_string(key));
+  }
+  assert(dict->cap == cap);
+
+  Dict *copy = dict_copy(dict);
+  dict_set(copy, atom_intern("r0"), heap_string("changed"));
+  dict_delete(copy, atom_intern("r1"));
+  assert(strcmp(dict_get(dict, atom_intern("r0")), "r0") == 0);
+  assert(dict_get(dict, atom_intern("r1")) != NULL);
+  assert(strcmp(dict_get(copy, atom_intern("r0")), "changed") == 0);
+  assert(copy->size == 19 && dict->size == 20);
+}
+
+// index keys come first in ascending order, whatever order they were set in
+void test_dict_iterator_order() {
+  Dict *dict = dict_new();
+  const char *keys[] = { "1", "a", "0", "10", "01", "b", "2", "4294967295" };
+  for (int i = 0; i < 8; i++) dict_set(dict, atom_intern(keys[i]), heap_string(keys[i]));
+  dict_delete(dict, atom_intern("2"));
+
+  // "01" and 2^32 - 1 are not array indices
+  const char *expected[] = { "0", "1", "10", "a", "01", "b", "4294967295" };
+  DictIterator it;
+  dict_iterator_init(&it, dict);
+  Atom *k;
+  void *value;
+  for (int i = 0; i < 7; i++) {
+    assert(dict_iterator_next(&it, &k, &value));
+    assert(strcmp(k->string, expected[i]) == 0 && strcmp(value, expected[i]) == 0);
+  }
+  assert(!dict_iterator_next(&it, &k, &value));
+
+  dict_iterator_init(&it, NULL);
+  assert(!dict_iterator_next(&it, &k, &value));
+}
+
+// an index key is found by index, whether the atom is interned or not
+void test_dict_index_keys() {
+  Dict *dict = dict_new();
+  AtomIndex *own = heap_alloc(sizeof(AtomIndex));
+  assert(dict_set(dict, atom_index_init(own, 12), heap_string("12")) == 1);
+
+  AtomIndex probe;
+  assert(strcmp(dict_get(dict, atom_index_init(&probe, 12)), "12") == 0);
+  assert(strcmp(dict_get(dict, atom_intern("12")), "12") == 0);
+  assert(dict_get(dict, atom_index_init(&probe, 13)) == NULL);
+
+  // the entry keeps its atom
+  assert(dict_set(dict, atom_intern("12"), heap_string("twelve")) == 0);
+  DictIterator it;
+  dict_iterator_init(&it, dict);
+  Atom *k;
+  void *value;
+  assert(dict_iterator_next(&it, &k, &value) && k == (Atom*)own && strcmp(value, "twelve") == 0);
+  assert(!dict_iterator_next(&it, &k, &value));
+
+  assert(dict_delete(dict, atom_index_init(&probe, 12)));
+  assert(dict_get(dict, atom_intern("12")) == NULL);
+}
+
+int main(int argc, char const **argv) {
+  test_dict();
+  test_dict_order();
+  test_dict_shrink();
+  test_dict_copy_reserve();
+  test_dict_iterator_order();
+  test_dict_index_keys();
+  return 0;
+}
@@ -12,7 +12,7 @@ void eval(char *source) {
   Node *node = parse(token);
   node_pp(node);
   printf("\n");
-  evaluate(node);
+  evaluate(isolate_new(stdout), node);
   printf("\n");
 }
 
@@ -67,6 +67,21 @@ void test_example() {
 
   eval("var o = { a: 1, b: 2 }; function f() { return this.a + this.b; } o.f = f; console.log(o.f());");
   eval("var a = [1, 2]; console.log(a.length);");
+
+  eval("var o = { a: 1, b: 2 }; delete o.a; console.log(Object.keys(o));");
+  eval("var o = { a: 1, b: 2 }; for (var k in o) { console.log(k); }");
+  eval("console.log({ a: 1, b: [1, 2] });");
+
+  eval("console.log('foo' + 'bar' + 1);");
+  eval("console.log('a' === 'a', 'a' === 'b');");
+  eval("console.log(['a', 'b'].join(', '));");
+  eval("console.log([3, 1, 2].sort(function (a, b) { return a - b; }));");
+  eval("var a = [1, 2, 3]; console.log(a.indexOf(2), a.includes(4), a.slice(1), a.concat([4]));");
+  eval("var a = []; a.push(1, 2); a.pop(); console.log(a.fill(0), a.reduce(function (x, y) { return x + y; }, 1));");
+  eval("var t = new Int32Array(4); t[1] = 5; var v = t.subarray(1); console.log(v[0], v.length);");
+  eval("var i = 0; i++; var j = i++; i += 2; console.log(i, j, --i);");
+  eval("switch (2) { case 1: console.log(1); case 2: console.log(2); case 3: console.log(3); break; default: console.log(4); }");
+  eval("console.log(Math.floor(5 / 2), Math.max(1, 2, 3));");
 }
 
 int main(int argc, char const **argv) {
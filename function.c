@@ -5,26 +5,39 @@
 Value* value_function_new(Node *node) {
   Value *v = value_object_create(NULL);
 
-  PrimitiveFunction *function_value = malloc(sizeof(PrimitiveFunction));
+  PrimitiveFunction *function_value = heap_alloc(sizeof(PrimitiveFunction));
   function_value->type = PRIMITIVE_FUNCTION;
+  function_value->flags = 0;
   function_value->value = 0;
   function_value->is_property = 0;
   function_value->node = node;
   function_value->fn = NULL;
+  function_value->arity = -1;
+  function_value->intrinsic = -1;
+  function_value->bound = NULL;
   if (node != NULL) {
     function_value->name = node->value;
   } else {
     function_value->name = "";
   }
 
-  v->primitive = (Primitive*)function_value;
+  v->primitive = heap_encode((Primitive*)function_value);
 
   return v;
 }
 
 Value* value_function_native_new(NativeFunction *fn) {
   Value *v = value_function_new(NULL);
-  PrimitiveFunction *f = (PrimitiveFunction*)v->primitive;
+  PrimitiveFunction *f = (PrimitiveFunction*)VALUE_PRIMITIVE(v);
   f->fn = fn;
   return v;
 }
+
+// a native with an entry point for calls passing arity arguments. fn handles other calls
+Value* value_function_native_arity_new(NativeFunction *fn, int arity, NativeEntry entry) {
+  Value *v = value_function_native_new(fn);
+  PrimitiveFunction *f = (PrimitiveFunction*)VALUE_PRIMITIVE(v);
+  f->arity = arity;
+  f->entry = entry;
+  return v;
+}
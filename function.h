@@ -1,2 +1,3 @@
 Value* value_function_new(Node *node);
 Value* value_function_native_new(NativeFunction *fn);
+Value* value_function_native_arity_new(NativeFunction *fn, int arity, NativeEntry entry);
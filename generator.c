@@ -0,0 +1,142 @@
+#include "generator.h"
+#include "value.h"
+#include "object.h"
+#include "boolean.h"
+#include "heap.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RUNTIME_ERROR(...) \
+  fprintf(stderr, "runtime error: "); \
+  fprintf(stderr, __VA_ARGS__); \
+  fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
+  abort();
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+
+// the keys of the results of next
+Atom *generator_value_atom = NULL;
+Atom *generator_done_atom = NULL;
+pthread_once_t generator_atoms_once = PTHREAD_ONCE_INIT;
+
+void generator_atoms_init() {
+  generator_value_atom = atom_intern("value");
+  generator_done_atom = atom_intern("done");
+}
+
+Value* value_generator_new(Env *env, Node *function) {
+  Isolate *isolate = env->isolate;
+  Value *object = value_object_create(isolate->binding.generator_prototype);
+
+  Generator *generator = calloc(1, sizeof(Generator));
+  generator->env = env;
+  generator->body = function;
+  generator->value = value_undefined_new();
+
+  PrimitiveGenerator *primitive = heap_alloc(sizeof(PrimitiveGenerator));
+  primitive->type = PRIMITIVE_GENERATOR;
+  primitive->flags = 0;
+  primitive->value = 0;
+  primitive->generator = generator;
+  object->primitive = heap_encode((Primitive*)primitive);
+  return object;
+}
+
+Generator* value_generator_unwrap(Value *v) {
+  if (v == NULL || !PRIMITIVE_TYPE_IS(v, PRIMITIVE_GENERATOR)) return NULL;
+  return ((PrimitiveGenerator*)VALUE_PRIMITIVE(v))->generator;
+}
+
+// runs on the generator's coroutine, from the first next until the body is done
+void generator_main(void *data) {
+  Generator *generator = data;
+  Isolate *isolate = generator->env->isolate;
+
+  Value *result = evaluate_node_children(generator->body, generator->env);
+  isolate->returned = 0;
+  isolate->breaking = 0;
+  generator->value = result == NULL ? value_undefined_new() : result;
+}
+
+void generator_release(Generator *generator) {
+  if (generator->coroutine != NULL) coroutine_free(generator->coroutine);
+  generator->coroutine = NULL;
+  generator->done = 1;
+}
+
+Value* generator_next(Generator *generator, Value *sent) {
+  if (generator->done) return NULL;
+  if (generator->running) {
+    RUNTIME_ERROR("generator is already running");
+  }
+
+  Isolate *isolate = generator->env->isolate;
+  if (generator->coroutine == NULL) generator->coroutine = coroutine_new(generator_main, generator);
+
+  generator->sent = sent;
+  generator->running = 1;
+  generator->resumer = isolate->generator;
+  isolate->generator = generator;
+
+  coroutine_resume(generator->coroutine);
+
+  isolate->generator = generator->resumer;
+  generator->resumer = NULL;
+  generator->running = 0;
+
+  if (generator->coroutine->done) {
+    generator_release(generator);
+    return NULL;
+  }
+
+  return generator->value;
+}
+
+Value* generator_yield(Isolate *isolate, Value *value) {
+  Generator *generator = isolate->generator;
+  if (generator == NULL) {
+    RUNTIME_ERROR("yield outside of a generator");
+  }
+
+  generator->value = value;
+  coroutine_yield(generator->coroutine);
+
+  Value *sent = generator->sent;
+  generator->sent = NULL;
+  return sent == NULL ? value_undefined_new() : sent;
+}
+
+void generator_close(Generator *generator) {
+  if (generator->running) {
+    RUNTIME_ERROR("generator is already running");
+  }
+
+  generator_release(generator);
+  generator->value = value_undefined_new();
+}
+
+// { value, done }. the value a body returned is given once, with done
+Value* native_generator_next(Isolate *isolate, Value *this, int size, Value **args) {
+  Generator *generator = value_generator_unwrap(this);
+  if (generator == NULL) {
+    RUNTIME_ERROR("next called on something that is not a generator");
+  }
+
+  pthread_once(&generator_atoms_once, generator_atoms_init);
+
+  Value *value = generator_next(generator, size > 0 ? args[0] : NULL);
+  Value *result = value_object_new(&isolate->binding);
+  value_object_reserve(result, 2);
+
+  if (value != NULL) {
+    value_object_set_atom(result, generator_value_atom, value);
+    value_object_set_atom(result, generator_done_atom, value_false_new());
+  } else {
+    value_object_set_atom(result, generator_value_atom, generator->value);
+    value_object_set_atom(result, generator_done_atom, value_true_new());
+    generator->value = value_undefined_new();
+  }
+
+  return result;
+}
@@ -0,0 +1,46 @@
+#ifndef MJS_GENERATOR_H
+#define MJS_GENERATOR_H
+
+#include "value.h"
+#include "coroutine.h"
+
+// calling a function* makes a generator, which runs the body on a coroutine of its own
+// (see coroutine.h) when it is asked for its next value, up to the next yield:
+//
+//   function* range(n) { for (var i = 0; i < n; i++) { yield i; } }
+//   function* squares(source) { for (var x of source) { yield x * x; } }
+//   for (var y of squares(range(1000000))) { ... }
+//
+// a pipeline of generators hands one value at a time through its stages, so it needs
+// no arrays in between. gen.next(v) returns { value, done } and makes the yield it
+// resumes evaluate to v. for...of takes the values straight from the generator, and
+// breaking out of it closes the generator, dropping the rest of its body.
+typedef struct Generator {
+  // the function's scope, with the arguments bound
+  Env *env;
+  Node *body;
+  // made on the first next, freed once the body is done or the generator is closed
+  Coroutine *coroutine;
+  int running;
+  int done;
+  // what the last yield gave, or the body returned
+  Value *value;
+  // what the yield that is resumed evaluates to
+  Value *sent;
+  // the generator that resumed this one, which runs again once it yields
+  struct Generator *resumer;
+} Generator;
+
+Value* value_generator_new(Env *env, Node *function);
+// NULL unless v is a generator
+Generator* value_generator_unwrap(Value *v);
+// runs the generator up to its next yield and returns what it yielded. returns NULL
+// once its body is done
+Value* generator_next(Generator *generator, Value *sent);
+// the value of a yield expression, evaluated in the body of the running generator
+Value* generator_yield(Isolate *isolate, Value *value);
+void generator_close(Generator *generator);
+
+Value* native_generator_next(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
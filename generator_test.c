@@ -0,0 +1,214 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "coroutine.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+char* run(const char *source) {
+  char *output;
+  size_t size;
+  FILE *out = open_memstream(&output, &size);
+  evaluate(isolate_new(out), parse(tokenize((char*)source)));
+  fclose(out);
+  return output;
+}
+
+typedef struct Counter {
+  Coroutine *coroutine;
+  int value;
+} Counter;
+
+void count_to_three(void *data) {
+  Counter *counter = data;
+  for (int i = 1; i <= 3; i++) {
+    counter->value = i;
+    coroutine_yield(counter->coroutine);
+  }
+}
+
+void test_coroutine_resume_and_yield() {
+  Counter counter = { NULL, 0 };
+  counter.coroutine = coroutine_new(count_to_three, &counter);
+  assert(counter.value == 0);
+
+  for (int i = 1; i <= 3; i++) {
+    coroutine_resume(counter.coroutine);
+    assert(!counter.coroutine->done && counter.value == i);
+  }
+
+  coroutine_resume(counter.coroutine);
+  assert(counter.coroutine->done);
+  coroutine_free(counter.coroutine);
+}
+
+int depth(int n) {
+  volatile char frame[256];
+  frame[0] = (char)n;
+  return n == 0 ? frame[0] : depth(n - 1) + 1;
+}
+
+void recurse(void *data) {
+  *(int*)data = depth(2000);
+}
+
+// the stack is more than the few pages a yield needs
+void test_coroutine_deep_stack() {
+  int result = 0;
+  Coroutine *coroutine = coroutine_new(recurse, &result);
+  coroutine_resume(coroutine);
+  assert(coroutine->done && result == 2000);
+  coroutine_free(coroutine);
+}
+
+// whether a child process running fn failed: killed by SIGSEGV, or exiting with an error
+// under a sanitizer that handles it
+int fails_in_child(void (*fn)()) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    fn();
+    _exit(0);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+void write_below_stack() {
+  Coroutine *coroutine = coroutine_new(recurse, NULL);
+  coroutine->stack[0] = 1;
+}
+
+int generator_depth;
+
+void recurse_in_generator() {
+  char source[512];
+  sprintf(source,
+    "function deep(n) { if (n === 0) { return 0; } return deep(n - 1) + 1; }"
+    "function* g() { yield deep(%d); }"
+    "function* other() { yield 1; yield 2; }"
+    "var live = other(); live.next();"
+    "g().next();", generator_depth);
+  run(source);
+}
+
+// running off the end of a stack faults rather than writing over the one below
+void test_coroutine_stack_guard() {
+  assert(fails_in_child(write_below_stack));
+
+  generator_depth = 100;
+  assert(!fails_in_child(recurse_in_generator));
+  generator_depth = 100000;
+  assert(fails_in_child(recurse_in_generator));
+}
+
+void test_pipeline() {
+  char *output = run(
+    "function* range(n) { for (var i = 0; i < n; i++) { yield i; } return 'end'; }"
+    "function* squares(source) { for (var x of source) { yield x * x; } }"
+    "var sum = 0;"
+    "for (var y of squares(range(5))) { sum = sum + y; }"
+    "console.log(sum);"
+    "var g = range(1);"
+    "console.log(g.next().value, g.next().value, g.next().done);");
+  assert(strcmp(output, "30\n0\nend\ntrue\n") == 0);
+}
+
+void test_next_sends_value() {
+  char *output = run(
+    "function* echo() { var got = yield 1; got = yield got + 1; console.log(got); }"
+    "var e = echo();"
+    "console.log(e.next('ignored').value);"
+    "console.log(e.next(10).value);"
+    "console.log(e.next(20).done);");
+  assert(strcmp(output, "1\n11\n20\ntrue\n") == 0);
+}
+
+void test_break_closes_generator() {
+  char *output = run(
+    "function* naturals() { var i = 0; while (true) { yield i; i++; } }"
+    "var g = naturals();"
+    "for (var x of g) { if (x === 2) { break; } }"
+    "console.log(x, g.next().done);");
+  assert(strcmp(output, "2\ntrue\n") == 0);
+}
+
+// finished generators give their stacks to the next ones, so a program making many one
+// after another does not run out of mappings
+void test_many_generators() {
+  char *output = run(
+    "function* one() { yield 1; }"
+    "var sum = 0;"
+    "for (var i = 0; i < 100000; i++) { for (var x of one()) { sum = sum + x; } }"
+    "console.log(sum);");
+  assert(strcmp(output, "100000\n") == 0);
+}
+
+// a generator that is left unfinished keeps its stack. the guard pages don't split the
+// stacks into mappings of their own, so the process does not run out of mappings
+void test_many_unfinished_generators() {
+  char *output = run(
+    "function* naturals() { var n = 0; while (true) { yield n; n++; } }"
+    "var sum = 0;"
+    "for (var i = 0; i < 40000; i++) { sum = sum + naturals().next().value; }"
+    "console.log(sum);");
+  assert(strcmp(output, "0\n") == 0);
+}
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void count_forever(void *data) {
+  Counter *counter = data;
+  while (1) {
+    counter->value++;
+    coroutine_yield(counter->coroutine);
+  }
+}
+
+void bench() {
+  int n = 10000000;
+  Counter counter = { NULL, 0 };
+  counter.coroutine = coroutine_new(count_forever, &counter);
+  double start = bench_now();
+  for (int i = 0; i < n; i++) coroutine_resume(counter.coroutine);
+  double seconds = bench_now() - start;
+  assert(counter.value == n);
+  printf("  %-22s %8.2f ns\n", "resume and yield", seconds / n * 1e9);
+
+  n = 1000000;
+  char source[256];
+  sprintf(source, "function* range(n) { for (var i = 0; i < n; i++) { yield i; } }"
+                  "var count = 0; for (var x of range(%d)) { count++; }", n);
+  Node *program = parse(tokenize(source));
+  start = bench_now();
+  evaluate(isolate_new(stdout), program);
+  seconds = bench_now() - start;
+  printf("  %-22s %8.2f ns\n", "for...of a generator", seconds / n * 1e9);
+}
+
+int main(int argc, char const **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+    return 0;
+  }
+
+  test_coroutine_resume_and_yield();
+  test_coroutine_deep_stack();
+  test_coroutine_stack_guard();
+  test_pipeline();
+  test_next_sends_value();
+  test_break_closes_generator();
+  test_many_generators();
+  test_many_unfinished_generators();
+  return 0;
+}
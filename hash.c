@@ -2,111 +2,260 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 
-#define HASH_RESIZE_LOAD_FACTOR 0.5
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-HashTable* hash_table_new() {
-  HashTable* hash = malloc(sizeof(HashTable));
-  int cap = 10;
-  hash->cap = cap;
-  hash->used = 0;
-  hash->entries = malloc(cap * sizeof(HashTableEntry*));
+#define HASH_MIN_CAP 8
+#define HASH_H2(HASH) ((uint8_t)((HASH) >> 25))
+#define HASH_IS_FULL(CTRL) (((CTRL) & HASH_CTRL_EMPTY) == 0)
+#define HASH_ENTRIES(CTRL, CAP) ((HashTableEntry*)((CTRL) + (CAP) + HASH_GROUP_WIDTH))
+
+// keys may come from scripts, so the hash is keyed with a random seed (siphash-1-3)
+// to keep collisions from being predictable.
+uint64_t hash_seed[2];
+int hash_seeded = 0;
+pthread_once_t hash_seed_once = PTHREAD_ONCE_INIT;
+// set by hash_seed_adopt for hash_seed_init to take instead of a random seed
+uint64_t hash_seed_adopted[2];
+int hash_seed_has_adopted = 0;
+
+void hash_seed_init() {
+  if (__atomic_load_n(&hash_seed_has_adopted, __ATOMIC_ACQUIRE)) {
+    memcpy(hash_seed, hash_seed_adopted, sizeof(hash_seed));
+    __atomic_store_n(&hash_seeded, 1, __ATOMIC_RELEASE);
+    return;
+  }
 
-  for (int i = 0; i < cap; i++) {
-    hash->entries[i] = NULL;
+  FILE *fp = fopen("/dev/urandom", "r");
+  if (fp == NULL || fread(hash_seed, sizeof(hash_seed), 1, fp) != 1) {
+    hash_seed[0] = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+    hash_seed[1] = (uint64_t)(uintptr_t)&hash_seed ^ (uint64_t)clock();
   }
+  if (fp != NULL) fclose(fp);
 
-  return hash;
+  __atomic_store_n(&hash_seeded, 1, __ATOMIC_RELEASE);
 }
 
-unsigned int key_hash(const char *key) {
-  unsigned int value = 0;
-  for (const char *c = key; *c != '\0'; c++) {
-    value = (value * 31 + *c);
+void hash_seed_get(uint64_t seed[2]) {
+  pthread_once(&hash_seed_once, hash_seed_init);
+  memcpy(seed, hash_seed, sizeof(hash_seed));
+}
+
+int hash_seed_adopt(const uint64_t seed[2]) {
+  if (!__atomic_load_n(&hash_seeded, __ATOMIC_ACQUIRE)) {
+    memcpy(hash_seed_adopted, seed, sizeof(hash_seed_adopted));
+    __atomic_store_n(&hash_seed_has_adopted, 1, __ATOMIC_RELEASE);
+    pthread_once(&hash_seed_once, hash_seed_init);
   }
-  return value;
+
+  return memcmp(hash_seed, seed, sizeof(hash_seed)) == 0 ? 0 : -1;
 }
 
-HashTableEntry* hash_table_find_entry(HashTable* hash, const char *key) {
-  int i = key_hash(key) % hash->cap;
+#define ROTL(X, B) (uint64_t)(((X) << (B)) | ((X) >> (64 - (B))))
+#define SIPROUND \
+  v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+  v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2; \
+  v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+  v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32);
+
+uint32_t hash_bytes(const char *key, size_t length) {
+  // the first threads to hash wait until the seed is read
+  if (!__atomic_load_n(&hash_seeded, __ATOMIC_ACQUIRE)) pthread_once(&hash_seed_once, hash_seed_init);
+
+  const uint8_t *in = (const uint8_t*)key;
+  uint64_t v0 = 0x736f6d6570736575ULL ^ hash_seed[0];
+  uint64_t v1 = 0x646f72616e646f6dULL ^ hash_seed[1];
+  uint64_t v2 = 0x6c7967656e657261ULL ^ hash_seed[0];
+  uint64_t v3 = 0x7465646279746573ULL ^ hash_seed[1];
 
-  HashTableEntry *entry = hash->entries[i];
-  for (; entry != NULL; entry = entry->next) {
-    if (strcmp(entry->key, key) == 0) {
-      return entry;
+  const uint8_t *end = in + length - (length % 8);
+  for (; in != end; in += 8) {
+    uint64_t m = 0;
+    for (int i = 0; i < 8; i++) {
+      m |= (uint64_t)in[i] << (8 * i);
     }
+
+    v3 ^= m;
+    SIPROUND
+    v0 ^= m;
+  }
+
+  uint64_t b = (uint64_t)length << 56;
+  for (int i = 0; i < (int)(length & 7); i++) {
+    b |= (uint64_t)in[i] << (8 * i);
   }
 
-  return NULL;
+  v3 ^= b;
+  SIPROUND
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIPROUND
+  SIPROUND
+  SIPROUND
+
+  uint64_t h = v0 ^ v1 ^ v2 ^ v3;
+  return (uint32_t)(h ^ (h >> 32));
 }
 
-void hash_table_insert_entry(HashTable* hash, int index, HashTableEntry *new_entry) {
-  HashTableEntry *entry = hash->entries[index];
-  if (entry != NULL) {
-    while (entry->next != NULL) entry = entry->next;
-    entry->next = new_entry;
-  } else {
-    hash->entries[index] = new_entry;
+// bit i of the result is set when control byte i of the group matches
+#ifdef __SSE2__
+uint32_t hash_group_match(const uint8_t *ctrl, uint8_t h2) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+uint32_t hash_group_match_empty(const uint8_t *ctrl) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (uint32_t)_mm_movemask_epi8(group);
+}
+#else
+uint32_t hash_group_match(const uint8_t *ctrl, uint8_t h2) {
+  uint32_t mask = 0;
+  for (int i = 0; i < HASH_GROUP_WIDTH; i++) {
+    if (ctrl[i] == h2) mask |= 1u << i;
   }
+  return mask;
+}
 
-  hash->used += 1;
+uint32_t hash_group_match_empty(const uint8_t *ctrl) {
+  return hash_group_match(ctrl, HASH_CTRL_EMPTY);
+}
+#endif
+
+size_t hash_table_storage_size(unsigned int cap) {
+  return cap + HASH_GROUP_WIDTH + cap * sizeof(HashTableEntry);
 }
 
-void hash_table_resize(HashTable* hash, unsigned int new_size) {
-  HashTableEntry **new_entries = malloc(new_size * sizeof(HashTableEntry*));
-  // todo: memset?
-  for (int i = 0; i < new_size; i++) {
-    new_entries[i] = NULL;
+// the first HASH_GROUP_WIDTH control bytes are mirrored after the last slot,
+// so that a group can be loaded at any position without wrapping around.
+void hash_ctrl_set(uint8_t *ctrl, unsigned int cap, size_t i, uint8_t h2) {
+  ctrl[i] = h2;
+  for (size_t j = i + cap; j < cap + HASH_GROUP_WIDTH; j += cap) {
+    ctrl[j] = h2;
   }
+}
+
+HashTable* hash_table_new() {
+  HashTable* hash = heap_alloc(sizeof(HashTable));
+  hash->cap = 0;
+  hash->used = 0;
+  hash->ctrl = heap_encode(NULL);
+
+  return hash;
+}
 
-  unsigned int size = hash->cap;
-  HashTableEntry **old_entries = hash->entries;
-  hash->entries = new_entries;
+HashTableEntry* hash_table_find_entry(HashTable* hash, Atom *key) {
+  uint8_t *ctrl = heap_decode(hash->ctrl);
+  if (ctrl == NULL) return NULL;
 
-  for (int i = 0; i < size; i++) {
-    HashTableEntry *entry = old_entries[i];
-    while (entry != NULL) {
-      HashTableEntry *next_entry = entry->next;
-      entry->next = NULL;
+  HashTableEntry *entries = HASH_ENTRIES(ctrl, hash->cap);
+  size_t mask = hash->cap - 1;
+  size_t pos = key->hash & mask;
+  uint8_t h2 = HASH_H2(key->hash);
+  HEAP_REF(Atom) ref = heap_encode(key);
 
-      int table_index = key_hash(entry->key) % new_size;
-      hash_table_insert_entry(hash, table_index, entry);
-      entry = next_entry;
+  for (size_t stride = HASH_GROUP_WIDTH; ; stride += HASH_GROUP_WIDTH) {
+    for (uint32_t match = hash_group_match(ctrl + pos, h2); match != 0; match &= match - 1) {
+      HashTableEntry *entry = &entries[(pos + __builtin_ctz(match)) & mask];
+      if (entry->key == ref) {
+        return entry;
+      }
     }
+
+    if (hash_group_match_empty(ctrl + pos) != 0) return NULL;
+    pos = (pos + stride) & mask;
   }
+}
 
-  free(old_entries);
+size_t hash_table_find_empty(uint8_t *ctrl, unsigned int cap, uint32_t h) {
+  size_t mask = cap - 1;
+  size_t pos = h & mask;
+
+  for (size_t stride = HASH_GROUP_WIDTH; ; stride += HASH_GROUP_WIDTH) {
+    uint32_t empty = hash_group_match_empty(ctrl + pos);
+    if (empty != 0) {
+      return (pos + __builtin_ctz(empty)) & mask;
+    }
 
-  hash->cap = new_size;
+    pos = (pos + stride) & mask;
+  }
 }
 
-void hash_table_set(HashTable* hash, const char *key, void *value) {
+void hash_table_resize(HashTable* hash, unsigned int new_cap) {
+  uint8_t *new_ctrl = heap_alloc(hash_table_storage_size(new_cap));
+  memset(new_ctrl, HASH_CTRL_EMPTY, new_cap + HASH_GROUP_WIDTH);
+  HashTableEntry *new_entries = HASH_ENTRIES(new_ctrl, new_cap);
+
+  uint8_t *old_ctrl = heap_decode(hash->ctrl);
+  unsigned int old_cap = hash->cap;
+
+  if (old_ctrl != NULL) {
+    HashTableEntry *old_entries = HASH_ENTRIES(old_ctrl, old_cap);
+    for (unsigned int i = 0; i < old_cap; i++) {
+      if (!HASH_IS_FULL(old_ctrl[i])) continue;
+
+      HashTableEntry *entry = &old_entries[i];
+      uint32_t h = HEAP_GET(Atom, entry->key)->hash;
+      size_t index = hash_table_find_empty(new_ctrl, new_cap, h);
+      hash_ctrl_set(new_ctrl, new_cap, index, HASH_H2(h));
+      new_entries[index] = *entry;
+    }
+
+    heap_free(old_ctrl, hash_table_storage_size(old_cap));
+  }
+
+  hash->ctrl = heap_encode(new_ctrl);
+  hash->cap = new_cap;
+}
+
+void hash_table_set_atom(HashTable* hash, Atom *key, void *value) {
   HashTableEntry *found_entry = hash_table_find_entry(hash, key);
   if (found_entry != NULL) {
-    found_entry->value = value;
+    found_entry->value = heap_encode(value);
     return;
   }
 
-  if (hash->cap * HASH_RESIZE_LOAD_FACTOR <= hash->used) {
-    hash_table_resize(hash, hash->cap * 2);
+  // keep the load factor under 7/8 so that every probe sequence reaches an empty slot
+  if ((hash->used + 1) * 8 > hash->cap * 7) {
+    hash_table_resize(hash, hash->cap == 0 ? HASH_MIN_CAP : hash->cap * 2);
   }
 
-  int i = key_hash(key) % hash->cap;
+  uint8_t *ctrl = heap_decode(hash->ctrl);
+  size_t i = hash_table_find_empty(ctrl, hash->cap, key->hash);
+  hash_ctrl_set(ctrl, hash->cap, i, HASH_H2(key->hash));
 
-  HashTableEntry *new_entry = malloc(sizeof(HashTableEntry));
-  new_entry->key = malloc((strlen(key) + 1) * sizeof(char));
-  strcpy(new_entry->key, key);
-  new_entry->value = value;
-  new_entry->next = NULL;
+  HashTableEntry *new_entry = &HASH_ENTRIES(ctrl, hash->cap)[i];
+  new_entry->key = heap_encode(key);
+  new_entry->value = heap_encode(value);
 
-  hash_table_insert_entry(hash, i, new_entry);
+  hash->used += 1;
 }
 
-void* hash_table_get(HashTable* hash, const char *key) {
+void* hash_table_get_atom(HashTable* hash, Atom *key) {
+  if (hash->used == 0) return NULL;
+
   HashTableEntry *entry = hash_table_find_entry(hash, key);
   if (entry != NULL) {
-    return entry->value;
+    return heap_decode(entry->value);
   } else {
     return NULL;
   }
 }
+
+void hash_table_set(HashTable* hash, const char *key, void *value) {
+  hash_table_set_atom(hash, atom_intern(key), value);
+}
+
+// a string that was never interned cannot be a key
+void* hash_table_get(HashTable* hash, const char *key) {
+  Atom *atom = atom_find(key);
+  if (atom == NULL) return NULL;
+
+  return hash_table_get_atom(hash, atom);
+}
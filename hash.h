@@ -1,20 +1,47 @@
 #ifndef MJS_HASH_H
 #define MJS_HASH_H
 
+#include "heap.h"
+#include "atom.h"
+#include <stdint.h>
+
+// open addressing hash table in the style of swiss tables.
+//
+// each slot has one control byte: HASH_CTRL_EMPTY or the top 7 bits of the key hash.
+// control bytes are probed HASH_GROUP_WIDTH at a time, and an entry is compared
+// only when its control byte matches. capacity is always a power of two.
+//
+// keys are atoms, so a match is a pointer comparison and the hash comes from the atom.
+// values must be allocated with heap_alloc
+#define HASH_GROUP_WIDTH 16
+#define HASH_CTRL_EMPTY ((uint8_t)0x80)
+
 typedef struct HashTable {
   unsigned int cap;
   unsigned int used;
-  struct HashTableEntry **entries;
+  // cap + HASH_GROUP_WIDTH control bytes followed by cap entries. NULL until the first insert.
+  HEAP_REF(uint8_t) ctrl;
 } HashTable;
 
 typedef struct HashTableEntry {
-  struct HashTableEntry *next;
-  char *key;
-  void *value;
+  HEAP_REF(Atom) key;
+  HEAP_REF(void) value;
 } HashTableEntry;
 
 HashTable* hash_table_new();
+void hash_table_set_atom(HashTable *hash, Atom *key, void *value);
+void* hash_table_get_atom(HashTable *hash, Atom *key);
 void hash_table_set(HashTable *hash, const char *key, void *value);
 void* hash_table_get(HashTable *hash, const char *key);
 
+uint32_t hash_bytes(const char *key, size_t length);
+// bytes of the control bytes and entries of a table with cap slots
+size_t hash_table_storage_size(unsigned int cap);
+
+// the seed hashes are keyed with, e.g. for a snapshot to keep
+void hash_seed_get(uint64_t seed[2]);
+// keys hashes with the seed a snapshot was written with. returns -1 when something
+// was hashed with another seed already
+int hash_seed_adopt(const uint64_t seed[2]);
+
 #endif
@@ -1,18 +1,27 @@
 #include "hash.h"
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+// values live in the runtime heap, so they can be stored as compressed references
+char* heap_string(const char *s) {
+  char *p = heap_alloc(strlen(s) + 1);
+  strcpy(p, s);
+  return p;
+}
 
 void test_hash() {
   HashTable *hash = hash_table_new();
   char *value = hash_table_get(hash, "foo");
   assert(value == NULL);
 
-  hash_table_set(hash, "foo", "bar");
+  hash_table_set(hash, "foo", heap_string("bar"));
   value = hash_table_get(hash, "foo");
   assert(strcmp(value, "bar") == 0);
 
-  hash_table_set(hash, "foo", "bar2");
+  hash_table_set(hash, "foo", heap_string("bar2"));
   value = hash_table_get(hash, "foo");
   assert(strcmp(value, "bar2") == 0);
 
@@ -20,14 +29,210 @@ void test_hash() {
   for (int i = 0; i < 100; i++) {
     char ch = 'a' + i;
     char str[] = { ch, '\0' };
-    hash_table_set(hash, str, str);
+    hash_table_set(hash, str, heap_string(str));
   }
 
   assert(hash->used > 100);
   assert(hash->cap > 100);
 }
 
+void test_hash_many_keys() {
+  HashTable *hash = hash_table_new();
+  char key[64];
+
+  for (int i = 0; i < 10000; i++) {
+    sprintf(key, i % 2 == 0 ? "k%d" : "a-key-longer-than-the-inline-buffer-%d", i);
+    hash_table_set(hash, key, heap_string(key));
+  }
+
+  assert(hash->used == 10000);
+  assert((hash->cap & (hash->cap - 1)) == 0);
+
+  for (int i = 0; i < 10000; i++) {
+    sprintf(key, i % 2 == 0 ? "k%d" : "a-key-longer-than-the-inline-buffer-%d", i);
+    char *value = hash_table_get(hash, key);
+    assert(value != NULL);
+    assert(strcmp(value, key) == 0);
+  }
+
+  assert(hash_table_get(hash, "k1") == NULL);
+  assert(hash_table_get(hash, "") == NULL);
+}
+
+// reference implementation for the benchmark: separate chaining with a malloc per entry
+typedef struct ChainEntry {
+  struct ChainEntry *next;
+  char *key;
+  void *value;
+} ChainEntry;
+
+typedef struct ChainTable {
+  unsigned int cap;
+  unsigned int used;
+  ChainEntry **entries;
+} ChainTable;
+
+unsigned int chain_key_hash(const char *key) {
+  unsigned int value = 0;
+  for (const char *c = key; *c != '\0'; c++) {
+    value = (value * 31 + *c);
+  }
+  return value;
+}
+
+ChainTable* chain_table_new() {
+  ChainTable *table = malloc(sizeof(ChainTable));
+  table->cap = 10;
+  table->used = 0;
+  table->entries = calloc(table->cap, sizeof(ChainEntry*));
+  return table;
+}
+
+void* chain_table_get(ChainTable *table, const char *key) {
+  for (ChainEntry *entry = table->entries[chain_key_hash(key) % table->cap]; entry != NULL; entry = entry->next) {
+    if (strcmp(entry->key, key) == 0) return entry->value;
+  }
+  return NULL;
+}
+
+void chain_table_insert(ChainEntry **entries, unsigned int cap, ChainEntry *new_entry) {
+  ChainEntry **slot = &entries[chain_key_hash(new_entry->key) % cap];
+  while (*slot != NULL) slot = &(*slot)->next;
+  *slot = new_entry;
+}
+
+void chain_table_set(ChainTable *table, const char *key, void *value) {
+  for (ChainEntry *entry = table->entries[chain_key_hash(key) % table->cap]; entry != NULL; entry = entry->next) {
+    if (strcmp(entry->key, key) == 0) {
+      entry->value = value;
+      return;
+    }
+  }
+
+  if (table->cap * 0.5 <= table->used) {
+    unsigned int new_cap = table->cap * 2;
+    ChainEntry **new_entries = calloc(new_cap, sizeof(ChainEntry*));
+    for (unsigned int i = 0; i < table->cap; i++) {
+      ChainEntry *entry = table->entries[i];
+      while (entry != NULL) {
+        ChainEntry *next = entry->next;
+        entry->next = NULL;
+        chain_table_insert(new_entries, new_cap, entry);
+        entry = next;
+      }
+    }
+    free(table->entries);
+    table->entries = new_entries;
+    table->cap = new_cap;
+  }
+
+  ChainEntry *entry = malloc(sizeof(ChainEntry));
+  entry->next = NULL;
+  entry->key = strdup(key);
+  entry->value = value;
+  chain_table_insert(table->entries, table->cap, entry);
+  table->used++;
+}
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void bench_report(const char *label, int n, double seconds) {
+  printf("  %-22s %8.2f Mops/s\n", label, n / seconds / 1e6);
+}
+
+void bench_hash(int n, const char *format) {
+  char **keys = malloc(n * sizeof(char*));
+  char **lookups = malloc(n * sizeof(char*));
+  char **missing = malloc(n * sizeof(char*));
+  char key[64];
+  for (int i = 0; i < n; i++) {
+    sprintf(key, format, i);
+    keys[i] = strdup(key);
+    lookups[i] = keys[i];
+    sprintf(key, format, i + n);
+    missing[i] = strdup(key);
+  }
+
+  // look keys up in a different order than they were inserted
+  srand(n);
+  for (int i = n - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    char *tmp = lookups[i];
+    lookups[i] = lookups[j];
+    lookups[j] = tmp;
+
+    j = rand() % (i + 1);
+    tmp = missing[i];
+    missing[i] = missing[j];
+    missing[j] = tmp;
+  }
+  void *value = heap_string("value");
+
+  printf("%d keys (%s)\n", n, format);
+
+  double start = bench_now();
+  HashTable *hash = hash_table_new();
+  for (int i = 0; i < n; i++) hash_table_set(hash, keys[i], value);
+  bench_report("swiss insert", n, bench_now() - start);
+
+  start = bench_now();
+  ChainTable *chain = chain_table_new();
+  for (int i = 0; i < n; i++) chain_table_set(chain, keys[i], value);
+  bench_report("chaining insert", n, bench_now() - start);
+
+  start = bench_now();
+  for (int i = 0; i < n; i++) assert(hash_table_get(hash, lookups[i]) == value);
+  bench_report("swiss lookup hit", n, bench_now() - start);
+
+  start = bench_now();
+  for (int i = 0; i < n; i++) assert(chain_table_get(chain, lookups[i]) == value);
+  bench_report("chaining lookup hit", n, bench_now() - start);
+
+  // the interpreter looks up atoms from the AST, so there is no string hashing at all
+  Atom **atoms = malloc(n * sizeof(Atom*));
+  for (int i = 0; i < n; i++) atoms[i] = atom_intern(lookups[i]);
+
+  start = bench_now();
+  for (int i = 0; i < n; i++) assert(hash_table_get_atom(hash, atoms[i]) == value);
+  bench_report("swiss atom lookup hit", n, bench_now() - start);
+
+  // a key that was never interned is turned away by atom_find before the table is
+  // probed, so the misses are atoms of names the table does not have
+  Atom **missing_atoms = malloc(n * sizeof(Atom*));
+  for (int i = 0; i < n; i++) missing_atoms[i] = atom_intern(missing[i]);
+
+  start = bench_now();
+  for (int i = 0; i < n; i++) assert(hash_table_get_atom(hash, missing_atoms[i]) == NULL);
+  bench_report("swiss atom lookup miss", n, bench_now() - start);
+
+  start = bench_now();
+  for (int i = 0; i < n; i++) assert(chain_table_get(chain, missing[i]) == NULL);
+  bench_report("chaining lookup miss", n, bench_now() - start);
+}
+
+void bench() {
+  // warm up the heap and the hash seed
+  bench_hash(1000, "warmup-%d");
+  printf("\n");
+
+  int sizes[] = { 1000, 100000, 1000000 };
+  for (int i = 0; i < 3; i++) {
+    bench_hash(sizes[i], "k%d");
+    bench_hash(sizes[i], "property-name-number-%d");
+  }
+}
+
 int main(int argc, char const **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+    return 0;
+  }
+
   test_hash();
+  test_hash_many_keys();
   return 0;
 }
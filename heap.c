@@ -0,0 +1,218 @@
+#include "heap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// counted per thread, so threads don't contend on one counter, and added to
+// heap_used_exited when the thread exits. a thread can free blocks another one
+// allocated (a transferred array, say), so its own count may go below zero
+_Thread_local ptrdiff_t heap_used = 0;
+_Thread_local int heap_used_registered = 0;
+ptrdiff_t heap_used_exited = 0;
+pthread_key_t heap_used_key;
+pthread_once_t heap_used_key_once = PTHREAD_ONCE_INIT;
+
+void heap_used_exit(void *data) {
+  (void)data;
+  __atomic_fetch_add(&heap_used_exited, heap_used, __ATOMIC_RELAXED);
+  heap_used = 0;
+}
+
+void heap_used_key_create() {
+  pthread_key_create(&heap_used_key, heap_used_exit);
+}
+
+// the key's destructor only runs for threads that set a value for it
+static inline void heap_count(ptrdiff_t size) {
+  if (!heap_used_registered) {
+    pthread_once(&heap_used_key_once, heap_used_key_create);
+    pthread_setspecific(heap_used_key, &heap_used_registered);
+    heap_used_registered = 1;
+  }
+  heap_used += size;
+}
+
+size_t heap_used_bytes() {
+  return __atomic_load_n(&heap_used_exited, __ATOMIC_RELAXED) + heap_used;
+}
+
+// ranges mapped by heap_map_file. entries are written before the count is raised, so
+// heap_free reads them without taking the lock
+#define HEAP_MAPPED_MAX 64
+
+char *heap_mapped_start[HEAP_MAPPED_MAX];
+char *heap_mapped_end[HEAP_MAPPED_MAX];
+int heap_mapped_count = 0;
+pthread_mutex_t heap_mapped_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int heap_is_mapped(void *p) {
+  int count = __atomic_load_n(&heap_mapped_count, __ATOMIC_ACQUIRE);
+  for (int i = 0; i < count; i++) {
+    if ((char*)p >= heap_mapped_start[i] && (char*)p < heap_mapped_end[i]) return 1;
+  }
+
+  return 0;
+}
+
+void* heap_map_at(void *address, int fd, size_t size) {
+  int flags = MAP_PRIVATE | (address == NULL ? 0 : MAP_FIXED);
+  char *p = mmap(address, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+  if (p == MAP_FAILED) return NULL;
+
+  pthread_mutex_lock(&heap_mapped_lock);
+  int i = heap_mapped_count;
+  if (i == HEAP_MAPPED_MAX) {
+    fprintf(stderr, "heap: more than %d files mapped\n", HEAP_MAPPED_MAX);
+    abort();
+  }
+  heap_mapped_start[i] = p;
+  heap_mapped_end[i] = p + size;
+  __atomic_store_n(&heap_mapped_count, i + 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&heap_mapped_lock);
+  return p;
+}
+
+#ifdef MJS_COMPRESSED_REFS
+
+// 2^32 refs * 8 bytes. the reservation is halved until mmap accepts it.
+#define HEAP_RESERVE_SIZE ((size_t)1 << 35)
+#define HEAP_RESERVE_MIN_SIZE ((size_t)1 << 28)
+
+// blocks up to HEAP_SMALL_MAX bytes are rounded to HEAP_ALIGNMENT,
+// larger ones to a power of two. each size class keeps its own free list.
+#define HEAP_SMALL_MAX 256
+#define HEAP_SMALL_CLASSES (HEAP_SMALL_MAX / HEAP_ALIGNMENT)
+#define HEAP_SIZE_CLASSES (HEAP_SMALL_CLASSES + 40)
+
+// each thread allocates from chunks it claims from the region and keeps its own free
+// lists, so threads only synchronize when they claim a chunk. larger blocks are claimed
+// on their own
+#define HEAP_CHUNK_SIZE ((size_t)1 << 20)
+#define HEAP_CHUNK_BLOCK_MAX (HEAP_CHUNK_SIZE / 4)
+
+char *heap_base = NULL;
+// the end of the claimed part of the region, advanced atomically
+size_t heap_top = 0;
+size_t heap_reserved = 0;
+pthread_once_t heap_reserve_once = PTHREAD_ONCE_INIT;
+
+_Thread_local size_t heap_chunk_top = 0;
+_Thread_local size_t heap_chunk_end = 0;
+_Thread_local HeapRef heap_free_lists[HEAP_SIZE_CLASSES];
+
+void heap_reserve() {
+  for (size_t size = HEAP_RESERVE_SIZE; size >= HEAP_RESERVE_MIN_SIZE; size /= 2) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p != MAP_FAILED) {
+      heap_reserved = size;
+      // offset 0 is reserved for NULL
+      heap_top = HEAP_ALIGNMENT;
+      __atomic_store_n(&heap_base, p, __ATOMIC_RELEASE);
+      return;
+    }
+  }
+
+  perror("heap reservation failed");
+  abort();
+}
+
+int heap_size_class(size_t size, size_t *rounded) {
+  if (size <= HEAP_SMALL_MAX) {
+    size_t units = size == 0 ? 1 : (size + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT;
+    *rounded = units * HEAP_ALIGNMENT;
+    return units - 1;
+  }
+
+  int i = 0;
+  size_t n = HEAP_SMALL_MAX * 2;
+  while (n < size) {
+    n *= 2;
+    i++;
+  }
+
+  *rounded = n;
+  return HEAP_SMALL_CLASSES + i;
+}
+
+// claims size bytes of the region, returning their offset
+size_t heap_claim(size_t size) {
+  size_t offset = __atomic_fetch_add(&heap_top, size, __ATOMIC_RELAXED);
+  if (offset + size > heap_reserved) {
+    fprintf(stderr, "heap exhausted: %zu bytes reserved\n", heap_reserved);
+    abort();
+  }
+
+  return offset;
+}
+
+void* heap_alloc(size_t size) {
+  if (__atomic_load_n(&heap_base, __ATOMIC_ACQUIRE) == NULL) pthread_once(&heap_reserve_once, heap_reserve);
+
+  size_t rounded;
+  int size_class = heap_size_class(size, &rounded);
+
+  HeapRef head = heap_free_lists[size_class];
+  if (head != 0) {
+    HeapRef *block = heap_decode(head);
+    heap_free_lists[size_class] = *block;
+    heap_count(rounded);
+    return block;
+  }
+
+  heap_count(rounded);
+  if (rounded > HEAP_CHUNK_BLOCK_MAX) return heap_base + heap_claim(rounded);
+
+  // the rest of a full chunk is left unused
+  if (heap_chunk_top + rounded > heap_chunk_end) {
+    heap_chunk_top = heap_claim(HEAP_CHUNK_SIZE);
+    heap_chunk_end = heap_chunk_top + HEAP_CHUNK_SIZE;
+  }
+
+  void *p = heap_base + heap_chunk_top;
+  heap_chunk_top += rounded;
+  return p;
+}
+
+void heap_free(void *p, size_t size) {
+  if (p == NULL || heap_is_mapped(p)) return;
+
+  size_t rounded;
+  int size_class = heap_size_class(size, &rounded);
+
+  HeapRef *block = p;
+  *block = heap_free_lists[size_class];
+  heap_free_lists[size_class] = heap_encode(p);
+  heap_count(-(ptrdiff_t)rounded);
+}
+
+void* heap_map_file(int fd, size_t size) {
+  if (__atomic_load_n(&heap_base, __ATOMIC_ACQUIRE) == NULL) pthread_once(&heap_reserve_once, heap_reserve);
+
+  // the region starts on a page, so a page-aligned offset in it is a page-aligned address
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t offset = heap_claim(size + page);
+  offset = (offset + page - 1) / page * page;
+  return heap_map_at(heap_base + offset, fd, size);
+}
+
+#else
+
+void* heap_alloc(size_t size) {
+  heap_count(size);
+  return malloc(size);
+}
+
+void heap_free(void *p, size_t size) {
+  if (p == NULL || heap_is_mapped(p)) return;
+
+  heap_count(-(ptrdiff_t)size);
+  free(p);
+}
+
+void* heap_map_file(int fd, size_t size) {
+  return heap_map_at(NULL, fd, size);
+}
+
+#endif
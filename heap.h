@@ -0,0 +1,53 @@
+#ifndef MJS_HEAP_H
+#define MJS_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Runtime objects (values, primitives, hash tables) are allocated with heap_alloc.
+//
+// When built with MJS_COMPRESSED_REFS, the heap is a single reserved virtual region
+// and references between runtime objects are stored as 32-bit offsets from its base,
+// scaled by HEAP_ALIGNMENT. Otherwise references are plain pointers and heap_alloc is malloc.
+//
+// Fields that point into the heap are declared with HEAP_REF(T) and read with HEAP_GET.
+//
+// heap_alloc and heap_free may be called from several threads at once.
+#define HEAP_ALIGNMENT 8
+
+#ifdef MJS_COMPRESSED_REFS
+
+typedef uint32_t HeapRef;
+#define HEAP_REF(T) HeapRef
+
+extern char *heap_base;
+
+static inline void* heap_decode(HeapRef ref) {
+  return ref == 0 ? NULL : heap_base + ((uintptr_t)ref * HEAP_ALIGNMENT);
+}
+
+static inline HeapRef heap_encode(const void *p) {
+  return p == NULL ? 0 : (HeapRef)(((const char*)p - heap_base) / HEAP_ALIGNMENT);
+}
+
+#else
+
+#define HEAP_REF(T) T*
+#define heap_decode(ref) ((void*)(ref))
+#define heap_encode(p) (p)
+
+#endif
+
+#define HEAP_GET(T, ref) ((T*)heap_decode(ref))
+
+void* heap_alloc(size_t size);
+void heap_free(void *p, size_t size);
+// bytes allocated and not freed, by the calling thread and by threads that have exited
+size_t heap_used_bytes();
+// maps the first size bytes of a file copy-on-write, for runtime objects that were not
+// made by heap_alloc, e.g. a snapshot. with compressed refs the mapping is placed in the
+// heap region, so refs can point into it. heap_free leaves blocks in it alone.
+// NULL if the file can't be mapped
+void* heap_map_file(int fd, size_t size);
+
+#endif
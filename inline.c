@@ -0,0 +1,200 @@
+#include "inline.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct InlineCandidate {
+  Atom *name;
+  // NULL when the name is declared with more than one function
+  Node *function;
+} InlineCandidate;
+
+typedef struct InlineState {
+  InlineCandidate *candidates;
+  int size;
+  int cap;
+} InlineState;
+
+int inline_param_count(Node *function) {
+  int size = 0;
+  while (function->args[size] != NULL) size++;
+  return size;
+}
+
+int inline_param_index(Node *function, Atom *name) {
+  for (int i = 0; function->args[i] != NULL; i++) {
+    if (function->args[i]->atom == name) return i;
+  }
+
+  return -1;
+}
+
+// the number of nodes in expression, or -1 when it cannot be inlined
+int inline_expression_size(Node *node) {
+  int size = 1;
+  switch (node->type) {
+    case NODE_PRIMITIVE_NUMBER:
+    case NODE_PRIMITIVE_STRING:
+    case NODE_PRIMITIVE_BOOLEAN:
+    case NODE_PRIMITIVE_NULL:
+    case NODE_PRIMITIVE_UNDEFINED:
+      return size;
+
+    case NODE_IDENTIFIER:
+      // this is bound by the call
+      return strcmp(node->value, "this") == 0 ? -1 : size;
+
+    case NODE_BINARY_OPERATOR:
+    case NODE_OBJECT_MEMBER_ACCESS:
+    case NODE_ARRAY:
+    case NODE_OBJECT:
+    case NODE_OBJECT_ENTRY:
+      break;
+
+    default:
+      return -1;
+  }
+
+  for (int i = 0; node->children[i] != NULL; i++) {
+    // the key of an object entry is a name, not a variable
+    if (node->type == NODE_OBJECT_ENTRY && i == 0) continue;
+
+    int child_size = inline_expression_size(node->children[i]);
+    if (child_size < 0) return -1;
+    size += child_size;
+  }
+
+  return size;
+}
+
+// the returned expression of function, or NULL when it is not small enough to inline
+Node* inline_function_body(Node *function) {
+  // calling a function* returns a generator, not the expression
+  if (function->generator) return NULL;
+
+  Node *statement = function->children[0];
+  if (statement == NULL || function->children[1] != NULL) return NULL;
+  if (statement->type != NODE_STATEMENT_RETURN) return NULL;
+  if (inline_param_count(function) > INLINE_MAX_ARGS) return NULL;
+
+  Node *expression = statement->children[0];
+  int size = inline_expression_size(expression);
+  if (size < 0 || size > INLINE_MAX_SIZE) return NULL;
+  return expression;
+}
+
+Node** inline_copy_list(Node **list, Node *function);
+
+// a copy of the expression with the parameters of function read from the inline frame.
+// a constant literal keeps its slot, sharing the template with the original
+Node* inline_copy(Node *node, Node *function) {
+  if (node->type == NODE_IDENTIFIER) {
+    int i = inline_param_index(function, node->atom);
+    if (i >= 0) {
+      Node *argument = malloc(sizeof(Node));
+      memcpy(argument, node, sizeof(Node));
+      argument->type = NODE_INLINE_ARGUMENT;
+      argument->slot = i;
+      return argument;
+    }
+  }
+
+  Node *copy = malloc(sizeof(Node));
+  memcpy(copy, node, sizeof(Node));
+  copy->args = inline_copy_list(node->args, function);
+
+  if (node->type == NODE_OBJECT_ENTRY) {
+    copy->children = malloc(3 * sizeof(Node*));
+    copy->children[0] = node->children[0];
+    copy->children[1] = inline_copy(node->children[1], function);
+    copy->children[2] = NULL;
+  } else {
+    copy->children = inline_copy_list(node->children, function);
+  }
+
+  return copy;
+}
+
+Node** inline_copy_list(Node **list, Node *function) {
+  int size = 0;
+  while (list[size] != NULL) size++;
+
+  Node **copy = malloc((size + 1) * sizeof(Node*));
+  for (int i = 0; i < size; i++) copy[i] = inline_copy(list[i], function);
+  copy[size] = NULL;
+  return copy;
+}
+
+void inline_add_candidate(InlineState *state, Atom *name, Node *function) {
+  for (int i = 0; i < state->size; i++) {
+    if (state->candidates[i].name == name) {
+      if (state->candidates[i].function != function) state->candidates[i].function = NULL;
+      return;
+    }
+  }
+
+  if (state->size == state->cap) {
+    state->cap = state->cap == 0 ? 8 : state->cap * 2;
+    state->candidates = realloc(state->candidates, state->cap * sizeof(InlineCandidate));
+  }
+
+  state->candidates[state->size].name = name;
+  state->candidates[state->size].function = function;
+  state->size++;
+}
+
+Node* inline_find_candidate(InlineState *state, Atom *name) {
+  for (int i = 0; i < state->size; i++) {
+    if (state->candidates[i].name == name) return state->candidates[i].function;
+  }
+
+  return NULL;
+}
+
+// function declarations become `var name = function` in transform
+void inline_collect(InlineState *state, Node *node) {
+  if (node->type == NODE_VAR_DECLARATION && node->children[1] != NULL && node->children[1]->type == NODE_FUNCTION) {
+    inline_add_candidate(state, node->children[0]->atom, node->children[1]);
+  }
+
+  for (int i = 0; node->args[i] != NULL; i++) inline_collect(state, node->args[i]);
+  for (int i = 0; node->children[i] != NULL; i++) inline_collect(state, node->children[i]);
+}
+
+int inline_call_sites(InlineState *state, Node *node) {
+  int inlined = 0;
+  for (int i = 0; node->args[i] != NULL; i++) inlined += inline_call_sites(state, node->args[i]);
+  for (int i = 0; node->children[i] != NULL; i++) inlined += inline_call_sites(state, node->children[i]);
+
+  if (node->type != NODE_FUNCTION_CALL) return inlined;
+
+  Node *callee = node->children[0];
+  if (callee->type != NODE_IDENTIFIER) return inlined;
+
+  Node *function = inline_find_candidate(state, callee->atom);
+  if (function == NULL) return inlined;
+
+  Node *body = inline_function_body(function);
+  if (body == NULL) return inlined;
+
+  // missing arguments would be looked up in the caller, so only exact calls are inlined
+  int size = 0;
+  while (node->children[size + 1] != NULL) size++;
+  if (size != inline_param_count(function)) return inlined;
+
+  InlineCall *call = malloc(sizeof(InlineCall));
+  call->function = function;
+  call->body = inline_copy(body, function);
+  node->type = NODE_INLINE_CALL;
+  node->inline_call = call;
+
+  return inlined + 1;
+}
+
+int inline_functions(Node *program) {
+  InlineState state = { NULL, 0, 0 };
+  inline_collect(&state, program);
+
+  int inlined = inline_call_sites(&state, program);
+  free(state.candidates);
+  return inlined;
+}
@@ -0,0 +1,32 @@
+#ifndef MJS_INLINE_H
+#define MJS_INLINE_H
+
+#include "parse.h"
+
+// inlines calls to small functions, run on the program after parsing.
+//
+// a function is inlined when its body is a single `return expression;` of at most
+// INLINE_MAX_SIZE nodes, built from literals, variables, operators and member access.
+// calls are not allowed in the body: callees see the caller's variables (scopes are
+// dynamic), so a callee of an inlined body would miss the parameters. this also keeps
+// inlined bodies non-recursive.
+//
+// a call site `f(a, b)` naming a function declared (or assigned with var) under that
+// name becomes NODE_INLINE_CALL, evaluating a copy of the body whose parameters are
+// NODE_INLINE_ARGUMENT nodes reading the isolate's inline frame. the callee is still
+// looked up on every call and compared with the inlined function, so calling anything
+// else under that name falls back to a real call.
+#define INLINE_MAX_SIZE 16
+#define INLINE_MAX_ARGS 4
+
+// only read while evaluating, so a program can run in several isolates at once
+typedef struct InlineCall {
+  // the NODE_FUNCTION that was inlined
+  Node *function;
+  Node *body;
+} InlineCall;
+
+// returns the number of call sites inlined
+int inline_functions(Node *program);
+
+#endif
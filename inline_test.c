@@ -0,0 +1,39 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "inline.h"
+#include <assert.h>
+#include <stdio.h>
+
+int inline_source(char *source) {
+  return inline_functions(parse(tokenize(source)));
+}
+
+void test_inline_small_functions() {
+  assert(inline_source("function add(a, b) { return a + b; } add(1, 2); add(add(1, 2), 3);") == 3);
+  assert(inline_source("function get(o) { return o.x; } get({ x: 1 });") == 1);
+  assert(inline_source("var point = function (x) { return { x: x, y: [x, 1] }; }; point(1);") == 1);
+}
+
+void test_inline_rejects() {
+  // calls, statements besides the return, and this
+  assert(inline_source("function f(n) { return f(n); } f(1);") == 0);
+  assert(inline_source("function g(a) { return a; } function f(a) { return g(a); } f(1);") == 1);
+  assert(inline_source("function f(a) { var b = a; return b; } f(1);") == 0);
+  assert(inline_source("function f() { return this.x; } f();") == 0);
+  assert(inline_source("function f(a) { return a++; } f(1);") == 0);
+
+  // argument count has to match
+  assert(inline_source("function f(a, b) { return a; } f(1); f(1, 2, 3);") == 0);
+
+  // two functions under one name
+  assert(inline_source("function f() { return 1; } function f() { return 2; } f();") == 0);
+
+  // over the size budget
+  assert(inline_source("function f(a) { return a + a + a + a + a + a + a + a + a; } f(1);") == 0);
+}
+
+int main(int argc, char const **argv) {
+  test_inline_small_functions();
+  test_inline_rejects();
+  return 0;
+}
@@ -2,13 +2,48 @@
 #include "object.h"
 #include "number.h"
 #include "array.h"
+#include "typed_array.h"
+#include "dict.h"
+#include "string.h"
+#include "inspect.h"
+#include "promise.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+typedef struct InspectBuffer {
+  char *data;
+  size_t size;
+  size_t cap;
+} InspectBuffer;
+
+void inspect_append(InspectBuffer *buf, const char *s) {
+  size_t length = strlen(s);
+  if (buf->size + length + 1 > buf->cap) {
+    while (buf->size + length + 1 > buf->cap) buf->cap *= 2;
+    buf->data = realloc(buf->data, buf->cap);
+  }
+
+  memcpy(buf->data + buf->size, s, length + 1);
+  buf->size += length;
+}
+
+// strings nested in arrays and objects are quoted
+void inspect_append_element(InspectBuffer *buf, Value *v) {
+  const char *s = value_inspect(v);
+  if (s == NULL) s = "undefined";
+
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  int quoted = primitive != NULL && primitive->type == PRIMITIVE_STRING;
+  if (quoted) inspect_append(buf, "'");
+  inspect_append(buf, s);
+  if (quoted) inspect_append(buf, "'");
+}
+
 char* value_inspect(Value *v) {
   char *buf = malloc(100 * sizeof(char));
-  if (v->primitive == NULL) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL) {
     switch (v->kind) {
       case VALUE_KIND_NULL: {
         return "null";
@@ -19,11 +54,27 @@ char* value_inspect(Value *v) {
       }
 
       default: {
-        return NULL;
+        InspectBuffer out = { buf, 0, 100 };
+        buf[0] = '\0';
+
+        DictIterator it;
+        dict_iterator_init(&it, VALUE_TABLE(v));
+        Atom *key;
+        void *value;
+        int i = 0;
+        for (; dict_iterator_next(&it, &key, &value); i++) {
+          inspect_append(&out, i == 0 ? "{ " : ", ");
+          inspect_append(&out, key->string);
+          inspect_append(&out, ": ");
+          inspect_append_element(&out, value);
+        }
+
+        inspect_append(&out, i == 0 ? "{}" : " }");
+        return out.data;
       }
     }
   } else {
-    switch (v->primitive->type) {
+    switch (primitive->type) {
       case PRIMITIVE_NUMBER: {
         double n = value_number_unwrap(v);
         sprintf(buf, "%.0f", n);
@@ -40,28 +91,82 @@ char* value_inspect(Value *v) {
       }
 
       case PRIMITIVE_STRING: {
-        PrimitiveString *vs = (PrimitiveString*)v->primitive;
-        return vs->string;
+        return (char*)value_string_unwrap(v);
       }
 
       case PRIMITIVE_ARRAY: {
-        strcat(buf, "[");
+        InspectBuffer out = { buf, 0, 100 };
+        buf[0] = '\0';
+
+        inspect_append(&out, "[");
         for (int i = 0; i < value_number_unwrap(value_array_length(v)); i++) {
           if (i > 0) {
-            strcat(buf, ", ");
+            inspect_append(&out, ", ");
           }
-          const char *s = value_inspect(value_array_get(v, value_number_new(i)));
-          strcat(buf, s);
+
+          Value *element = value_array_get(v, value_number_new(i));
+          if (element == NULL) continue;
+          inspect_append_element(&out, element);
         }
 
-        strcat(buf, "]");
-        return buf;
+        inspect_append(&out, "]");
+        return out.data;
       }
 
       case PRIMITIVE_FUNCTION: {
         return "function";
       }
 
+      case PRIMITIVE_TYPED_ARRAY: {
+        InspectBuffer out = { buf, 0, 100 };
+        buf[0] = '\0';
+
+        inspect_append(&out, value_typed_array_name(value_typed_array_kind(v)));
+        inspect_append(&out, " [");
+        uint32_t length = value_typed_array_length(v);
+        for (uint32_t i = 0; i < length; i++) {
+          if (i > 0) inspect_append(&out, ", ");
+          inspect_append_element(&out, value_typed_array_get(v, value_number_new(i)));
+        }
+
+        inspect_append(&out, "]");
+        return out.data;
+      }
+
+      case PRIMITIVE_ARRAY_BUFFER: {
+        sprintf(buf, "ArrayBuffer { byteLength: %u }", value_array_buffer_byte_length(v));
+        return buf;
+      }
+
+      case PRIMITIVE_WORKER: {
+        return "Worker {}";
+      }
+
+      case PRIMITIVE_GENERATOR: {
+        return "Generator {}";
+      }
+
+      case PRIMITIVE_LINE_ITERATOR: {
+        return "LineIterator {}";
+      }
+
+      case PRIMITIVE_PROMISE: {
+        InspectBuffer out = { buf, 0, 100 };
+        buf[0] = '\0';
+
+        PromiseState state = value_promise_state(v);
+        inspect_append(&out, "Promise { ");
+        if (state == PROMISE_PENDING) {
+          inspect_append(&out, "<pending>");
+        } else {
+          if (state == PROMISE_REJECTED) inspect_append(&out, "<rejected> ");
+          inspect_append_element(&out, value_promise_value(v));
+        }
+
+        inspect_append(&out, " }");
+        return out.data;
+      }
+
       default: {
         return NULL;
       }
@@ -0,0 +1,160 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "inline.h"
+#include "heap.h"
+#include "atom.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 8
+
+// a program using every kind of node state: call caches, literal templates, inlined calls
+char *source =
+  "function add(a, b) { return a + b; }"
+  "var sum = 0;"
+  "for (var i = 0; i < 2000; i++) {"
+  "  var point = { x: i, y: 1 };"
+  "  var pair = [1, 2];"
+  "  pair.push(point.y);"
+  "  sum = add(sum, pair.length + point.x);"
+  "}"
+  "console.log(sum, Math.max(sum, 1), [1, 2].concat([3]));";
+
+char* run(Node *program) {
+  char *output;
+  size_t size;
+  FILE *out = open_memstream(&output, &size);
+  evaluate(isolate_new(out), program);
+  fclose(out);
+  return output;
+}
+
+void* run_thread(void *program) {
+  return run(program);
+}
+
+void test_isolates_share_program() {
+  Node *program = parse(tokenize(source));
+  assert(inline_functions(program) == 1);
+
+  char *expected = run(program);
+  assert(strcmp(expected, "2005000\n2005000\n[1, 2, 3]\n") == 0);
+
+  // the program keeps no state of its own, so it runs again the same way
+  char *again = run(program);
+  assert(strcmp(again, expected) == 0);
+
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) pthread_create(&threads[i], NULL, run_thread, program);
+  for (int i = 0; i < THREADS; i++) {
+    char *output;
+    pthread_join(threads[i], (void**)&output);
+    assert(strcmp(output, expected) == 0);
+    free(output);
+  }
+}
+
+void test_isolates_have_own_globals() {
+  Node *define = parse(tokenize("Array.prototype.first = function () { return this[0]; }; console.log([5].first());"));
+  Node *read = parse(tokenize("console.log([5].first);"));
+
+  char *output = run(define);
+  assert(strcmp(output, "5\n") == 0);
+  free(output);
+
+  // the other isolate's Array.prototype is untouched
+  output = run(read);
+  assert(strcmp(output, "undefined\n") == 0);
+  free(output);
+}
+
+// reading a property by a computed or numeric name does not intern it, nor does
+// storing one under an integer name
+void test_property_lookup_does_not_intern() {
+  Node *program = parse(tokenize(
+    "var o = {};"
+    "for (var i = 0; i < 100; i++) { o[i + 700000] = o[i + 800000]; o['lookup-' + i]; }"
+    "console.log(o[i + 699999], o['lookup-' + 5], Object.keys(o).length);"));
+
+  char *output = run(program);
+  assert(strcmp(output, "undefined\nundefined\n100\n") == 0);
+  free(output);
+
+  assert(atom_find("700099") == NULL);
+  assert(atom_find("800099") == NULL);
+  assert(atom_find("lookup-5") == NULL);
+}
+
+#define ATOMS_PER_THREAD 20000
+
+// every thread interns the same strings, so that they race to add each one, while
+// looking them up without the lock
+void* intern_thread(void *data) {
+  Atom **atoms = malloc(ATOMS_PER_THREAD * sizeof(Atom*));
+  for (int i = 0; i < ATOMS_PER_THREAD; i++) {
+    char name[32];
+    sprintf(name, "shared-%d", i);
+    atoms[i] = atom_intern(name);
+    assert(atom_find(name) == atoms[i] && strcmp(atoms[i]->string, name) == 0);
+  }
+
+  return atoms;
+}
+
+void test_atoms_interned_across_threads() {
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) pthread_create(&threads[i], NULL, intern_thread, NULL);
+
+  Atom **first = NULL;
+  for (int i = 0; i < THREADS; i++) {
+    Atom **atoms;
+    pthread_join(threads[i], (void**)&atoms);
+    if (first == NULL) {
+      first = atoms;
+      continue;
+    }
+
+    // one atom per string, whichever thread added it
+    assert(memcmp(atoms, first, ATOMS_PER_THREAD * sizeof(Atom*)) == 0);
+    free(atoms);
+  }
+
+  free(first);
+}
+
+void* alloc_thread(void *data) {
+  return heap_alloc(4096);
+}
+
+void* free_thread(void *block) {
+  heap_free(block, 4096);
+  return NULL;
+}
+
+// a block freed by another thread than the one that allocated it is counted once
+void test_heap_used_across_threads() {
+  size_t before = heap_used_bytes();
+
+  pthread_t thread;
+  void *block;
+  pthread_create(&thread, NULL, alloc_thread, NULL);
+  pthread_join(thread, &block);
+  assert(heap_used_bytes() - before == 4096);
+
+  pthread_create(&thread, NULL, free_thread, block);
+  pthread_join(thread, NULL);
+  assert(heap_used_bytes() == before);
+}
+
+int main(int argc, char const **argv) {
+  test_isolates_share_program();
+  test_isolates_have_own_globals();
+  test_property_lookup_does_not_intern();
+  test_atoms_interned_across_threads();
+  test_heap_used_across_threads();
+  return 0;
+}
@@ -0,0 +1,913 @@
+#include "json.h"
+#include "value.h"
+#include "object.h"
+#include "array.h"
+#include "typed_array.h"
+#include "number.h"
+#include "boolean.h"
+#include "string.h"
+#include "atom.h"
+#include "dict.h"
+#include "heap.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
+#define RUNTIME_ERROR(...) \
+  fprintf(stderr, "runtime error: "); \
+  fprintf(stderr, __VA_ARGS__); \
+  fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
+  abort();
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+
+// nesting deeper than this is refused rather than run off the end of the stack
+#define JSON_MAX_DEPTH 1024
+
+// bit i of each mask stands for byte i of a 64-byte block
+typedef struct JsonBlock {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t whitespace;
+  uint64_t op;
+  uint64_t control;
+} JsonBlock;
+
+#if defined(__AVX2__)
+void json_classify(const uint8_t *p, JsonBlock *block) {
+  memset(block, 0, sizeof(JsonBlock));
+  for (int half = 0; half < 2; half++) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(p + half * 32));
+    // [ and ] are { and } with a bit cleared
+    __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+    __m256i op = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(','))));
+    __m256i whitespace = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r'))));
+    __m256i limit = _mm256_set1_epi8(0x1f);
+    __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(x, limit), limit);
+
+    int shift = half * 32;
+    block->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'))) << shift;
+    block->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))) << shift;
+    block->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(whitespace) << shift;
+    block->op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << shift;
+    block->control |= (uint64_t)(uint32_t)_mm256_movemask_epi8(control) << shift;
+  }
+}
+#elif defined(__SSE2__)
+void json_classify(const uint8_t *p, JsonBlock *block) {
+  memset(block, 0, sizeof(JsonBlock));
+  for (int quarter = 0; quarter < 4; quarter++) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(p + quarter * 16));
+    // [ and ] are { and } with a bit cleared
+    __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+    __m128i op = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')), _mm_cmpeq_epi8(x, _mm_set1_epi8(','))));
+    __m128i whitespace = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+    __m128i limit = _mm_set1_epi8(0x1f);
+    __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(x, limit), limit);
+
+    int shift = quarter * 16;
+    block->quote |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"'))) << shift;
+    block->backslash |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))) << shift;
+    block->whitespace |= (uint64_t)_mm_movemask_epi8(whitespace) << shift;
+    block->op |= (uint64_t)_mm_movemask_epi8(op) << shift;
+    block->control |= (uint64_t)_mm_movemask_epi8(control) << shift;
+  }
+}
+#else
+void json_classify(const uint8_t *p, JsonBlock *block) {
+  memset(block, 0, sizeof(JsonBlock));
+  for (int i = 0; i < 64; i++) {
+    uint64_t bit = 1ULL << i;
+    switch (p[i]) {
+      case '"': block->quote |= bit; break;
+      case '\\': block->backslash |= bit; break;
+      case ' ': block->whitespace |= bit; break;
+      case '\t': case '\n': case '\r': block->whitespace |= bit; block->control |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',': block->op |= bit; break;
+      default: if (p[i] < 0x20) block->control |= bit;
+    }
+  }
+}
+#endif
+
+// bit i is the parity of the bits up to and including i: with quotes, whether byte i is
+// in a string
+static inline uint64_t json_prefix_xor(uint64_t x) {
+#if defined(__PCLMUL__)
+  __m128i product = _mm_clmulepi64_si128(_mm_set_epi64x(0, x), _mm_set1_epi8((char)0xff), 0);
+  return (uint64_t)_mm_cvtsi128_si64(product);
+#else
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+#endif
+}
+
+// the bytes escaped by a backslash: those after an odd run of backslashes. *carry is
+// whether the first byte of the next block is escaped
+static inline uint64_t json_escaped(uint64_t backslash, uint64_t *carry) {
+  if (backslash == 0) {
+    uint64_t escaped = *carry;
+    *carry = 0;
+    return escaped;
+  }
+
+  backslash &= ~*carry;
+  uint64_t follows_escape = backslash << 1 | *carry;
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+  uint64_t even_sequences;
+  *carry = __builtin_add_overflow(odd_starts, backslash, &even_sequences);
+  uint64_t invert_mask = even_sequences << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+static inline void json_flatten(JsonIndex *index, uint32_t base, uint64_t bits) {
+  uint32_t *out = index->positions + index->count;
+  index->count += __builtin_popcountll(bits);
+  while (bits != 0) {
+    *out++ = base + __builtin_ctzll(bits);
+    bits &= bits - 1;
+  }
+}
+
+int json_index(const char *json, size_t length, JsonIndex *index) {
+  if (length > UINT32_MAX - 64) {
+    RUNTIME_ERROR("JSON.parse: the input is too long");
+  }
+
+  if (index->positions == NULL) {
+    index->cap = length / 8 + 128;
+    index->positions = malloc(index->cap * sizeof(uint32_t));
+  }
+  index->count = 0;
+
+  uint64_t escape_carry = 0;
+  uint64_t in_string_carry = 0;
+  uint64_t scalar_carry = 0;
+  uint64_t control = 0;
+
+  for (size_t base = 0; base < length; base += 64) {
+    const uint8_t *p = (const uint8_t*)json + base;
+    uint8_t tail[64];
+    if (length - base < 64) {
+      memset(tail, ' ', 64);
+      memcpy(tail, p, length - base);
+      p = tail;
+    }
+
+    // a block adds at most one position per byte, and the end one more
+    if (index->count + 65 > index->cap) {
+      index->cap *= 2;
+      index->positions = realloc(index->positions, index->cap * sizeof(uint32_t));
+    }
+
+    JsonBlock block;
+    json_classify(p, &block);
+
+    uint64_t quote = block.quote & ~json_escaped(block.backslash, &escape_carry);
+    // from an opening quote up to its closing quote, which is not included
+    uint64_t in_string = json_prefix_xor(quote) ^ in_string_carry;
+    in_string_carry = (uint64_t)((int64_t)in_string >> 63);
+    control |= block.control & in_string;
+
+    uint64_t scalar = ~(block.op | block.whitespace | quote);
+    uint64_t scalar_start = scalar & ~(scalar << 1 | scalar_carry);
+    scalar_carry = scalar >> 63;
+
+    json_flatten(index, base, ((block.op | scalar_start) & ~in_string) | quote);
+  }
+
+  if (index->count + 1 > index->cap) {
+    index->cap += 1;
+    index->positions = realloc(index->positions, index->cap * sizeof(uint32_t));
+  }
+  // the end, so that the parser can always look at the next position
+  index->positions[index->count] = length;
+
+  return in_string_carry == 0 && control == 0;
+}
+
+void json_index_free(JsonIndex *index) {
+  free(index->positions);
+  index->positions = NULL;
+  index->count = 0;
+  index->cap = 0;
+}
+
+// a parsed value waiting to be stored into its object or array. numbers stay unboxed,
+// with value NULL, so that an array of numbers can take the doubles as they are
+typedef struct JsonSlot {
+  // NULL for an integer key, which is in index
+  Atom *key;
+  uint32_t index;
+  Value *value;
+  double number;
+} JsonSlot;
+
+typedef struct JsonParser {
+  Binding *binding;
+  const char *json;
+  size_t length;
+  JsonIndex index;
+  size_t next;
+  int depth;
+  // the members and elements of the objects and arrays being parsed, innermost last
+  JsonSlot *slots;
+  size_t slot_size;
+  size_t slot_cap;
+  // unescaped strings
+  char *buffer;
+  size_t buffer_cap;
+} JsonParser;
+
+static inline char json_char(JsonParser *p, uint32_t pos) {
+  return pos < p->length ? p->json[pos] : '\0';
+}
+
+// the next structural position, which is consumed
+static inline uint32_t json_take(JsonParser *p) {
+  uint32_t pos = p->index.positions[p->next];
+  if (p->next < p->index.count) p->next++;
+  return pos;
+}
+
+static inline char json_peek(JsonParser *p) {
+  return json_char(p, p->index.positions[p->next]);
+}
+
+void json_unexpected(JsonParser *p, uint32_t pos) {
+  if (pos >= p->length) {
+    RUNTIME_ERROR("JSON.parse: unexpected end of input");
+  }
+  RUNTIME_ERROR("JSON.parse: unexpected `%c` at position %u", p->json[pos], pos);
+}
+
+static inline int json_is_delimiter(char c) {
+  switch (c) {
+    case ' ': case '\t': case '\n': case '\r':
+    case ',': case ':': case '[': case ']': case '{': case '}':
+    case '\0':
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+void json_push(JsonParser *p, Atom *key, JsonSlot *slot) {
+  if (p->slot_size == p->slot_cap) {
+    p->slot_cap = p->slot_cap == 0 ? 64 : p->slot_cap * 2;
+    p->slots = realloc(p->slots, p->slot_cap * sizeof(JsonSlot));
+  }
+  p->slots[p->slot_size] = *slot;
+  p->slots[p->slot_size].key = key;
+  p->slot_size++;
+}
+
+static inline Value* json_box(JsonSlot *slot) {
+  return slot->value != NULL ? slot->value : value_number_new(slot->number);
+}
+
+static const double json_powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+double json_parse_number(JsonParser *p, uint32_t pos) {
+  const char *start = p->json + pos;
+  const char *end = p->json + p->length;
+  const char *c = start;
+
+  int negative = *c == '-';
+  if (negative) c++;
+  if (c == end || *c < '0' || *c > '9') json_unexpected(p, c - p->json);
+
+  // the digits as an integer, and the power of ten it is multiplied by
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  if (*c == '0') {
+    c++;
+  } else {
+    for (; c < end && *c >= '0' && *c <= '9'; c++, digits++) mantissa = mantissa * 10 + (*c - '0');
+  }
+
+  if (c < end && *c == '.') {
+    c++;
+    if (c == end || *c < '0' || *c > '9') json_unexpected(p, c - p->json);
+    for (; c < end && *c >= '0' && *c <= '9'; c++, digits++, exponent--) mantissa = mantissa * 10 + (*c - '0');
+  }
+
+  if (c < end && (*c == 'e' || *c == 'E')) {
+    c++;
+    int exponent_negative = 0;
+    if (c < end && (*c == '+' || *c == '-')) exponent_negative = *c++ == '-';
+    if (c == end || *c < '0' || *c > '9') json_unexpected(p, c - p->json);
+
+    int e = 0;
+    for (; c < end && *c >= '0' && *c <= '9'; c++) {
+      if (e < 100000) e = e * 10 + (*c - '0');
+    }
+    exponent += exponent_negative ? -e : e;
+  }
+
+  if (c < end && !json_is_delimiter(*c)) json_unexpected(p, c - p->json);
+
+  // both the mantissa and the power of ten are exact, so one rounding gives the double
+  // nearest to the number
+  if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+    double n = (double)mantissa;
+    n = exponent < 0 ? n / json_powers_of_ten[-exponent] : n * json_powers_of_ten[exponent];
+    return negative ? -n : n;
+  }
+
+  size_t length = c - start;
+  char small[64];
+  char *copy = length < sizeof(small) ? small : malloc(length + 1);
+  memcpy(copy, start, length);
+  copy[length] = '\0';
+  double n = strtod(copy, NULL);
+  if (copy != small) free(copy);
+  return n;
+}
+
+static inline int json_hex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+int json_parse_hex4(JsonParser *p, const char *s, const char *end) {
+  if (end - s < 4) json_unexpected(p, s - p->json);
+
+  int code = 0;
+  for (int i = 0; i < 4; i++) {
+    int digit = json_hex(s[i]);
+    if (digit < 0) json_unexpected(p, s + i - p->json);
+    code = code * 16 + digit;
+  }
+  return code;
+}
+
+char* json_utf8(char *out, uint32_t code) {
+  if (code < 0x80) {
+    *out++ = code;
+  } else if (code < 0x800) {
+    *out++ = 0xc0 | (code >> 6);
+    *out++ = 0x80 | (code & 0x3f);
+  } else if (code < 0x10000) {
+    *out++ = 0xe0 | (code >> 12);
+    *out++ = 0x80 | ((code >> 6) & 0x3f);
+    *out++ = 0x80 | (code & 0x3f);
+  } else {
+    *out++ = 0xf0 | (code >> 18);
+    *out++ = 0x80 | ((code >> 12) & 0x3f);
+    *out++ = 0x80 | ((code >> 6) & 0x3f);
+    *out++ = 0x80 | (code & 0x3f);
+  }
+  return out;
+}
+
+// the bytes between the quotes at start and end with the escapes replaced, in the
+// parser's buffer. an escape is never shorter than what it stands for
+const char* json_unescape(JsonParser *p, const char *s, const char *end, size_t *length) {
+  if ((size_t)(end - s) > p->buffer_cap) {
+    p->buffer_cap = end - s;
+    p->buffer = realloc(p->buffer, p->buffer_cap);
+  }
+
+  char *out = p->buffer;
+  while (s < end) {
+    const char *backslash = memchr(s, '\\', end - s);
+    if (backslash == NULL) backslash = end;
+    memcpy(out, s, backslash - s);
+    out += backslash - s;
+    s = backslash;
+    if (s == end) break;
+
+    // the quotes were found unescaped, so there is a character after the backslash
+    char c = s[1];
+    s += 2;
+    switch (c) {
+      case '"': *out++ = '"'; break;
+      case '\\': *out++ = '\\'; break;
+      case '/': *out++ = '/'; break;
+      case 'b': *out++ = '\b'; break;
+      case 'f': *out++ = '\f'; break;
+      case 'n': *out++ = '\n'; break;
+      case 'r': *out++ = '\r'; break;
+      case 't': *out++ = '\t'; break;
+      case 'u': {
+        uint32_t code = json_parse_hex4(p, s, end);
+        s += 4;
+        // a surrogate pair is one code point
+        if (code >= 0xd800 && code < 0xdc00 && end - s >= 6 && s[0] == '\\' && s[1] == 'u') {
+          uint32_t low = json_parse_hex4(p, s + 2, end);
+          if (low >= 0xdc00 && low < 0xe000) {
+            code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            s += 6;
+          }
+        }
+        out = json_utf8(out, code);
+        break;
+      }
+      default:
+        json_unexpected(p, s - 1 - p->json);
+    }
+  }
+
+  *length = out - p->buffer;
+  return p->buffer;
+}
+
+// the string of the quote at pos, whose closing quote is the next position
+const char* json_parse_chars(JsonParser *p, uint32_t pos, size_t *length) {
+  uint32_t close = json_take(p);
+  const char *s = p->json + pos + 1;
+  const char *end = p->json + close;
+
+  if (memchr(s, '\\', end - s) == NULL) {
+    *length = end - s;
+    return s;
+  }
+
+  return json_unescape(p, s, end, length);
+}
+
+void json_parse_value(JsonParser *p, JsonSlot *slot);
+
+Value* json_parse_object(JsonParser *p) {
+  size_t base = p->slot_size;
+  if (json_peek(p) == '}') {
+    json_take(p);
+  } else {
+    while (1) {
+      uint32_t pos = json_take(p);
+      if (json_char(p, pos) != '"') json_unexpected(p, pos);
+      size_t length;
+      const char *chars = json_parse_chars(p, pos, &length);
+      // integer keys are not interned (see value_object_set_index)
+      uint32_t index = atom_array_index(chars, length);
+      Atom *key = index == ATOM_NOT_INDEX ? atom_intern_length(chars, length) : NULL;
+
+      pos = json_take(p);
+      if (json_char(p, pos) != ':') json_unexpected(p, pos);
+
+      JsonSlot slot;
+      json_parse_value(p, &slot);
+      json_push(p, key, &slot);
+      p->slots[p->slot_size - 1].index = index;
+
+      pos = json_take(p);
+      char c = json_char(p, pos);
+      if (c == '}') break;
+      if (c != ',') json_unexpected(p, pos);
+    }
+  }
+
+  Value *object = value_object_new(p->binding);
+  value_object_reserve(object, p->slot_size - base);
+  for (size_t i = base; i < p->slot_size; i++) {
+    if (p->slots[i].key == NULL) {
+      value_object_set_index(object, p->slots[i].index, json_box(&p->slots[i]));
+    } else {
+      value_object_set_atom(object, p->slots[i].key, json_box(&p->slots[i]));
+    }
+  }
+
+  p->slot_size = base;
+  return object;
+}
+
+Value* json_parse_array(JsonParser *p) {
+  size_t base = p->slot_size;
+  int numbers = 1;
+  if (json_peek(p) == ']') {
+    json_take(p);
+  } else {
+    while (1) {
+      JsonSlot slot;
+      json_parse_value(p, &slot);
+      if (slot.value != NULL) numbers = 0;
+      json_push(p, NULL, &slot);
+
+      uint32_t pos = json_take(p);
+      char c = json_char(p, pos);
+      if (c == ']') break;
+      if (c != ',') json_unexpected(p, pos);
+    }
+  }
+
+  size_t size = p->slot_size - base;
+  Value *array;
+  if (numbers && size > 0) {
+    unsigned int cap = 8;
+    while (cap < size) cap *= 2;
+    double *elements = heap_alloc(cap * sizeof(double));
+    for (size_t i = 0; i < size; i++) elements[i] = p->slots[base + i].number;
+    array = value_array_adopt_doubles(p->binding, elements, cap, size);
+  } else {
+    array = value_array_new(p->binding);
+    for (size_t i = base; i < p->slot_size; i++) value_array_push(array, json_box(&p->slots[i]));
+  }
+
+  p->slot_size = base;
+  return array;
+}
+
+// a literal at pos, which has to end there
+void json_expect_literal(JsonParser *p, uint32_t pos, const char *literal, size_t length) {
+  if (p->length - pos < length || memcmp(p->json + pos, literal, length) != 0 || !json_is_delimiter(json_char(p, pos + length))) {
+    json_unexpected(p, pos);
+  }
+}
+
+void json_parse_value(JsonParser *p, JsonSlot *slot) {
+  uint32_t pos = json_take(p);
+  slot->key = NULL;
+  slot->value = NULL;
+  slot->number = 0;
+
+  switch (json_char(p, pos)) {
+    case '{':
+    case '[': {
+      if (++p->depth > JSON_MAX_DEPTH) {
+        RUNTIME_ERROR("JSON.parse: nested deeper than %d at position %u", JSON_MAX_DEPTH, pos);
+      }
+      slot->value = json_char(p, pos) == '{' ? json_parse_object(p) : json_parse_array(p);
+      p->depth--;
+      return;
+    }
+
+    case '"': {
+      size_t length;
+      const char *chars = json_parse_chars(p, pos, &length);
+      slot->value = value_string_new_length(chars, length);
+      return;
+    }
+
+    case 't': {
+      json_expect_literal(p, pos, "true", 4);
+      slot->value = value_true_new();
+      return;
+    }
+
+    case 'f': {
+      json_expect_literal(p, pos, "false", 5);
+      slot->value = value_false_new();
+      return;
+    }
+
+    case 'n': {
+      json_expect_literal(p, pos, "null", 4);
+      slot->value = value_null_new();
+      return;
+    }
+
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9': {
+      slot->number = json_parse_number(p, pos);
+      return;
+    }
+
+    default:
+      json_unexpected(p, pos);
+  }
+}
+
+Value* json_parse(Binding *binding, const char *json, size_t length) {
+  JsonParser p;
+  memset(&p, 0, sizeof(JsonParser));
+  p.binding = binding;
+  p.json = json;
+  p.length = length;
+
+  if (!json_index(json, length, &p.index)) {
+    RUNTIME_ERROR("JSON.parse: unterminated string or control character in a string");
+  }
+
+  JsonSlot slot;
+  json_parse_value(&p, &slot);
+  uint32_t pos = json_take(&p);
+  if (pos < length) json_unexpected(&p, pos);
+
+  json_index_free(&p.index);
+  free(p.slots);
+  free(p.buffer);
+  return json_box(&slot);
+}
+
+typedef struct JsonWriter {
+  StringBuilder out;
+  int indent;
+  int depth;
+  // the objects and arrays being written, to refuse a cycle
+  Value **stack;
+  int stack_size;
+  int stack_cap;
+} JsonWriter;
+
+// the first byte from i on that has to be escaped in a string: a quote, a backslash or
+// a control character. length if there is none
+size_t json_escape_next(const char *s, size_t i, size_t length) {
+#if defined(__AVX2__)
+  for (; i + 32 <= length; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+    __m256i limit = _mm256_set1_epi8(0x1f);
+    __m256i special = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+      _mm256_cmpeq_epi8(_mm256_max_epu8(x, limit), limit));
+    uint32_t mask = _mm256_movemask_epi8(special);
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#elif defined(__SSE2__)
+  for (; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+    __m128i limit = _mm_set1_epi8(0x1f);
+    __m128i special = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))),
+      _mm_cmpeq_epi8(_mm_max_epu8(x, limit), limit));
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#endif
+
+  for (; i < length; i++) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\' || c < 0x20) return i;
+  }
+  return length;
+}
+
+void json_write_string(JsonWriter *w, const char *s, size_t length) {
+  string_builder_reserve(&w->out, length + 2);
+  w->out.data[w->out.length++] = '"';
+
+  size_t i = 0;
+  while (i < length) {
+    size_t j = json_escape_next(s, i, length);
+    string_builder_append(&w->out, s + i, j - i);
+    if (j == length) break;
+
+    char escape[8];
+    unsigned char c = s[j];
+    switch (c) {
+      case '"': strcpy(escape, "\\\""); break;
+      case '\\': strcpy(escape, "\\\\"); break;
+      case '\b': strcpy(escape, "\\b"); break;
+      case '\f': strcpy(escape, "\\f"); break;
+      case '\n': strcpy(escape, "\\n"); break;
+      case '\r': strcpy(escape, "\\r"); break;
+      case '\t': strcpy(escape, "\\t"); break;
+      default: sprintf(escape, "\\u%04x", c);
+    }
+    string_builder_append(&w->out, escape, strlen(escape));
+    i = j + 1;
+  }
+
+  string_builder_append(&w->out, "\"", 1);
+}
+
+void json_write_number(JsonWriter *w, double n) {
+  if (isnan(n) || isinf(n)) {
+    string_builder_append(&w->out, "null", 4);
+    return;
+  }
+
+  char buf[32];
+  // integers, the common case, without going through printf
+  if (n == (double)(int64_t)n && fabs(n) < 1e15 && n != 0) {
+    char *end = buf + sizeof(buf);
+    char *c = end;
+    int64_t i = (int64_t)n;
+    uint64_t u = i < 0 ? -(uint64_t)i : (uint64_t)i;
+    do {
+      *--c = '0' + u % 10;
+      u /= 10;
+    } while (u != 0);
+    if (i < 0) *--c = '-';
+    string_builder_append(&w->out, c, end - c);
+    return;
+  }
+
+  value_number_format(n, buf);
+  string_builder_append(&w->out, buf, strlen(buf));
+}
+
+void json_write_newline(JsonWriter *w) {
+  if (w->indent == 0) return;
+
+  size_t spaces = (size_t)w->indent * w->depth;
+  string_builder_reserve(&w->out, spaces + 1);
+  w->out.data[w->out.length++] = '\n';
+  memset(w->out.data + w->out.length, ' ', spaces);
+  w->out.length += spaces;
+}
+
+void json_enter(JsonWriter *w, Value *v) {
+  for (int i = 0; i < w->stack_size; i++) {
+    if (w->stack[i] == v) {
+      RUNTIME_ERROR("JSON.stringify: cyclic structure");
+    }
+  }
+
+  if (w->stack_size == w->stack_cap) {
+    w->stack_cap = w->stack_cap == 0 ? 16 : w->stack_cap * 2;
+    w->stack = realloc(w->stack, w->stack_cap * sizeof(Value*));
+  }
+  w->stack[w->stack_size++] = v;
+  w->depth++;
+}
+
+void json_leave(JsonWriter *w) {
+  w->stack_size--;
+  w->depth--;
+}
+
+// undefined and functions are left out of objects, and are null in arrays
+int json_is_skipped(Value *v) {
+  return v == NULL || v->kind == VALUE_KIND_UNDEFINED || PRIMITIVE_TYPE_IS(v, PRIMITIVE_FUNCTION);
+}
+
+void json_write_value(JsonWriter *w, Value *v);
+
+void json_write_element(JsonWriter *w, Value *element, int first) {
+  if (!first) string_builder_append(&w->out, ",", 1);
+  json_write_newline(w);
+  if (json_is_skipped(element)) {
+    string_builder_append(&w->out, "null", 4);
+  } else {
+    json_write_value(w, element);
+  }
+}
+
+void json_write_array(JsonWriter *w, Value *v) {
+  PrimitiveArray *array = (PrimitiveArray*)VALUE_PRIMITIVE(v);
+  if (array->size == 0) {
+    string_builder_append(&w->out, "[]", 2);
+    return;
+  }
+
+  json_enter(w, v);
+  string_builder_append(&w->out, "[", 1);
+
+  double *doubles = value_array_doubles(v);
+  for (unsigned int i = 0; i < array->size; i++) {
+    if (doubles != NULL) {
+      if (i > 0) string_builder_append(&w->out, ",", 1);
+      json_write_newline(w);
+      json_write_number(w, doubles[i]);
+    } else if (array->kind == ARRAY_KIND_PACKED || array->kind == ARRAY_KIND_HOLEY) {
+      HEAP_REF(Value) *elements = heap_decode(array->elements);
+      json_write_element(w, HEAP_GET(Value, elements[i]), i == 0);
+    } else {
+      json_write_element(w, value_array_get(v, value_number_new(i)), i == 0);
+    }
+  }
+
+  json_leave(w);
+  json_write_newline(w);
+  string_builder_append(&w->out, "]", 1);
+}
+
+void json_write_key(JsonWriter *w, const char *key, size_t length, int first) {
+  if (!first) string_builder_append(&w->out, ",", 1);
+  json_write_newline(w);
+  json_write_string(w, key, length);
+  string_builder_append(&w->out, ": ", w->indent > 0 ? 2 : 1);
+}
+
+void json_write_object(JsonWriter *w, Value *v) {
+  json_enter(w, v);
+  string_builder_append(&w->out, "{", 1);
+  int first = 1;
+
+  // the elements of a typed array are its keys
+  if (PRIMITIVE_TYPE_IS(v, PRIMITIVE_TYPED_ARRAY)) {
+    uint32_t length = value_typed_array_length(v);
+    for (uint32_t i = 0; i < length; i++) {
+      char key[16];
+      json_write_key(w, key, sprintf(key, "%u", i), first);
+      json_write_number(w, value_typed_array_load(v, i));
+      first = 0;
+    }
+  }
+
+  DictIterator it;
+  dict_iterator_init(&it, VALUE_TABLE(v));
+  Atom *key;
+  void *value;
+  while (dict_iterator_next(&it, &key, &value)) {
+    if (json_is_skipped(value)) continue;
+    json_write_key(w, key->string, key->length, first);
+    json_write_value(w, value);
+    first = 0;
+  }
+
+  json_leave(w);
+  if (!first) json_write_newline(w);
+  string_builder_append(&w->out, "}", 1);
+}
+
+void json_write_value(JsonWriter *w, Value *v) {
+  if (v->kind == VALUE_KIND_NULL) {
+    string_builder_append(&w->out, "null", 4);
+    return;
+  }
+
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL) {
+    json_write_object(w, v);
+    return;
+  }
+
+  switch (primitive->type) {
+    case PRIMITIVE_NUMBER: {
+      json_write_number(w, primitive->value);
+      return;
+    }
+
+    case PRIMITIVE_BOOLEAN: {
+      if (primitive->value != 0) {
+        string_builder_append(&w->out, "true", 4);
+      } else {
+        string_builder_append(&w->out, "false", 5);
+      }
+      return;
+    }
+
+    case PRIMITIVE_STRING: {
+      json_write_string(w, value_string_unwrap(v), value_string_length(v));
+      return;
+    }
+
+    case PRIMITIVE_ARRAY: {
+      json_write_array(w, v);
+      return;
+    }
+
+    default: {
+      json_write_object(w, v);
+      return;
+    }
+  }
+}
+
+Value* json_stringify(Value *value, int indent) {
+  if (json_is_skipped(value)) return NULL;
+
+  JsonWriter w;
+  memset(&w, 0, sizeof(JsonWriter));
+  string_builder_init(&w.out);
+  w.indent = indent;
+
+  json_write_value(&w, value);
+  free(w.stack);
+  return string_builder_finish(&w.out);
+}
+
+Value* native_json_parse(Isolate *isolate, Value *this, int size, Value **args) {
+  const char *json = size > 0 ? value_string_unwrap(args[0]) : NULL;
+  if (json == NULL) {
+    RUNTIME_ERROR("JSON.parse takes a string");
+  }
+
+  return json_parse(&isolate->binding, json, value_string_length(args[0]));
+}
+
+// JSON.stringify(value, replacer, space). space is a number of spaces, up to 10
+Value* native_json_stringify(Isolate *isolate, Value *this, int size, Value **args) {
+  int indent = 0;
+  if (size > 2 && PRIMITIVE_TYPE_IS(args[2], PRIMITIVE_NUMBER)) {
+    double space = value_number_unwrap(args[2]);
+    indent = space < 0 ? 0 : space > 10 ? 10 : (int)space;
+  }
+
+  Value *json = json_stringify(size > 0 ? args[0] : value_undefined_new(), indent);
+  return json == NULL ? value_undefined_new() : json;
+}
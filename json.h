@@ -0,0 +1,41 @@
+#ifndef MJS_JSON_H
+#define MJS_JSON_H
+
+#include "value.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// JSON.parse and JSON.stringify.
+//
+// parsing takes two passes, as in simdjson. the first finds the structural characters
+// 64 bytes at a time: each block is turned into bitmasks of quotes, backslashes,
+// whitespace and operators with SIMD compares, and the masks of what is inside strings
+// and where each token starts are worked out with bit arithmetic, without a branch per
+// byte. the second walks the positions found and builds the objects and arrays
+// directly. arrays of numbers get their doubles without boxing each one.
+//
+// the compares have an AVX2 path (make NATIVE=1), an SSE2 path and a scalar fallback,
+// picked at compile time.
+
+// the positions of the structural characters of a document
+typedef struct JsonIndex {
+  uint32_t *positions;
+  size_t count;
+  size_t cap;
+} JsonIndex;
+
+// indexes the length bytes of json: {}[]:, outside of strings, every quote that is not
+// escaped, and the first byte of every other token (numbers, literals and anything
+// invalid). returns 0 for an unterminated string or a control character in a string
+int json_index(const char *json, size_t length, JsonIndex *index);
+void json_index_free(JsonIndex *index);
+
+Value* json_parse(Binding *binding, const char *json, size_t length);
+// spaces per level of indentation, 0 for none. NULL for a value that has no JSON, such
+// as undefined or a function
+Value* json_stringify(Value *value, int indent);
+
+Value* native_json_parse(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_json_stringify(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
@@ -0,0 +1,165 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "string.h"
+#include "number.h"
+#include "json.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+char* run(const char *source) {
+  char *output;
+  size_t size;
+  FILE *out = open_memstream(&output, &size);
+  evaluate(isolate_new(out), parse(tokenize((char*)source)));
+  fclose(out);
+  return output;
+}
+
+// the indexed bytes of json, in order
+char* structurals(const char *json) {
+  JsonIndex index = { NULL, 0, 0 };
+  assert(json_index(json, strlen(json), &index));
+
+  char *found = malloc(index.count + 1);
+  for (size_t i = 0; i < index.count; i++) found[i] = json[index.positions[i]];
+  found[index.count] = '\0';
+  assert(index.positions[index.count] == strlen(json));
+  json_index_free(&index);
+  return found;
+}
+
+void test_index() {
+  assert(strcmp(structurals("{\"a\": [1, true, null], \"b\":-2.5}"), "{\"\":[1,t,n],\"\":-}") == 0);
+  // operators in strings and escaped quotes are not structural
+  assert(strcmp(structurals("[\"{,}\", \"\\\"]\", \"\\\\\"]"), "[\"\",\"\",\"\"]") == 0);
+
+  JsonIndex index = { NULL, 0, 0 };
+  assert(!json_index("[\"open", 6, &index));
+  assert(!json_index("[\"a\tb\"]", 7, &index));
+  json_index_free(&index);
+}
+
+// strings and runs of backslashes across the ends of 64-byte blocks
+void test_index_blocks() {
+  for (int pad = 0; pad < 70; pad++) {
+    for (int backslashes = 0; backslashes <= 5; backslashes++) {
+      char json[256];
+      int n = sprintf(json, "[%*s\"", pad, "");
+      for (int i = 0; i < backslashes; i++) json[n++] = '\\';
+      // an odd run escapes the quote, which then needs another one to end the string
+      n += sprintf(json + n, backslashes % 2 == 0 ? "\", 1]" : "\"x\", 1]");
+
+      assert(strcmp(structurals(json), "[\"\",1]") == 0);
+    }
+  }
+}
+
+void test_parse() {
+  char *output = run(
+    "var doc = JSON.parse('{\"name\": \"mjs\", \"tags\": [\"a\", \"b\"], \"n\": [1, -2.5, 3e2],"
+    " \"nested\": {\"ok\": true, \"none\": null}, \"empty\": [{}, []]}');"
+    "console.log(doc.name, doc.tags[1], JSON.stringify(doc.n[0] + doc.n[1] + doc.n[2]), doc.nested.ok);"
+    "console.log(doc.nested.none, doc.empty.length, Object.keys(doc));");
+  assert(strcmp(output, "mjs\nb\n298.5\ntrue\nnull\n2\n['name', 'tags', 'n', 'nested', 'empty']\n") == 0);
+}
+
+void test_parse_strings() {
+  Binding *binding = &isolate_new(stdout)->binding;
+  const char *json = "\"tab\\there \\\"q\\\" \\u00e9 \\ud83d\\ude00 \\/\"";
+  Value *s = json_parse(binding, json, strlen(json));
+  assert(strcmp(value_string_unwrap(s), "tab\there \"q\" \xc3\xa9 \xf0\x9f\x98\x80 /") == 0);
+}
+
+void test_parse_numbers() {
+  Binding *binding = &isolate_new(stdout)->binding;
+  const char *numbers[] = { "0", "-0", "12", "1.5", "-0.125", "1e3", "2E-2", "123456789012345678", "0.1", "1.7976931348623157e308", "5e-324" };
+  for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+    Value *n = json_parse(binding, numbers[i], strlen(numbers[i]));
+    assert(value_number_unwrap(n) == strtod(numbers[i], NULL));
+  }
+}
+
+void test_stringify() {
+  char *output = run(
+    "var doc = { a: [1, 'two', true, null], b: { c: 'say \"hi\"\\n' }, f: function() { return 1; } };"
+    "console.log(JSON.stringify(doc));"
+    "console.log(JSON.stringify([undefined, JSON.parse('0.5'), 0 - 3]));"
+    "console.log(JSON.stringify({ x: [1, { y: 2 }], z: {} }, null, 2));"
+    "console.log(JSON.stringify(JSON.parse(JSON.stringify(doc))) === JSON.stringify(doc));");
+  assert(strcmp(output,
+    "{\"a\":[1,\"two\",true,null],\"b\":{\"c\":\"say \\\"hi\\\"\\n\"}}\n"
+    "[null,0.5,-3]\n"
+    "{\n  \"x\": [\n    1,\n    {\n      \"y\": 2\n    }\n  ],\n  \"z\": {}\n}\n"
+    "true\n") == 0);
+}
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// records like those of a log or an API response: strings, integers, decimals, nested
+// arrays and objects
+char* bench_corpus(size_t records, size_t *length) {
+  size_t cap = records * 256 + 16;
+  char *json = malloc(cap);
+  size_t n = sprintf(json, "[");
+  for (size_t i = 0; i < records; i++) {
+    n += sprintf(json + n,
+      "%s\n  {\"id\": %zu, \"name\": \"user %zu\", \"email\": \"user%zu@example.com\", \"active\": %s,"
+      " \"score\": %zu.%02zu, \"tags\": [\"alpha\", \"beta\", \"gamma\"],"
+      " \"location\": {\"lat\": 52.%04zu, \"lon\": -1.%04zu}, \"bio\": \"line one\\nline \\\"two\\\"\"}",
+      i == 0 ? "" : ",", i, i, i, i % 3 == 0 ? "true" : "false", i % 1000, i % 100, i % 10000, (i * 7) % 10000);
+  }
+  n += sprintf(json + n, "\n]");
+  *length = n;
+  return json;
+}
+
+void bench() {
+  size_t length;
+  char *json = bench_corpus(200000, &length);
+  Binding *binding = &isolate_new(stdout)->binding;
+  int rounds = 5;
+
+  JsonIndex index = { NULL, 0, 0 };
+  double start = bench_now();
+  for (int i = 0; i < rounds; i++) json_index(json, length, &index);
+  double seconds = bench_now() - start;
+  printf("  %-22s %8.2f GB/s  (%zu MB, %zu positions)\n", "index", length * rounds / seconds / 1e9, length >> 20, index.count);
+  json_index_free(&index);
+
+  Value *doc = NULL;
+  start = bench_now();
+  for (int i = 0; i < rounds; i++) doc = json_parse(binding, json, length);
+  seconds = bench_now() - start;
+  printf("  %-22s %8.2f GB/s\n", "JSON.parse", length * rounds / seconds / 1e9);
+
+  Value *out = NULL;
+  start = bench_now();
+  for (int i = 0; i < rounds; i++) out = json_stringify(doc, 0);
+  seconds = bench_now() - start;
+  size_t out_length = value_string_length(out);
+  printf("  %-22s %8.2f GB/s\n", "JSON.stringify", out_length * rounds / seconds / 1e9);
+  free(json);
+}
+
+int main(int argc, char const **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+    return 0;
+  }
+
+  test_index();
+  test_index_blocks();
+  test_parse();
+  test_parse_strings();
+  test_parse_numbers();
+  test_stringify();
+  return 0;
+}
@@ -0,0 +1,495 @@
+#include "loop.h"
+#include "promise.h"
+#include "worker.h"
+#include "value.h"
+#include "object.h"
+#include "number.h"
+#include "string.h"
+#include "inspect.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+
+#define RUNTIME_ERROR(...) \
+  fprintf(stderr, "runtime error: "); \
+  fprintf(stderr, __VA_ARGS__); \
+  fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
+  abort();
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+#define IS_FUNCTION(X) ((X) != NULL && PRIMITIVE_TYPE_IS(X, PRIMITIVE_FUNCTION))
+#define IS_STRING(X) ((X) != NULL && PRIMITIVE_TYPE_IS(X, PRIMITIVE_STRING))
+
+typedef enum IoKind {
+  IO_READ,
+  IO_WRITE
+} IoKind;
+
+typedef struct IoRequest {
+  IoKind kind;
+  char *path;
+  // what was read, or what to write
+  char *data;
+  size_t size;
+  // errno of the call that failed, or 0
+  int error;
+  Isolate *isolate;
+  Value *promise;
+  struct IoRequest *next;
+} IoRequest;
+
+// requests waiting for an I/O thread, first in first out
+typedef struct IoPool {
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  IoRequest *head;
+  IoRequest **tail;
+  int started;
+} IoPool;
+
+IoPool loop_io = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, &loop_io.head, 0 };
+
+double loop_now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+void loop_open(Loop *loop) {
+  loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+  loop->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (loop->epoll < 0 || loop->wake < 0) {
+    perror("event loop");
+    abort();
+  }
+
+  struct epoll_event event = { .events = EPOLLIN, .data.fd = loop->wake };
+  if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->wake, &event) != 0) {
+    perror("event loop");
+    abort();
+  }
+  loop->pid = getpid();
+}
+
+Loop* loop_get(Isolate *isolate) {
+  if (isolate->loop != NULL) return isolate->loop;
+
+  Loop *loop = calloc(1, sizeof(Loop));
+  loop->microtask_last = &loop->microtasks;
+  loop_open(loop);
+  isolate->loop = loop;
+  return loop;
+}
+
+void loop_queue_microtask(Isolate *isolate, LoopTask *task, void *data) {
+  Loop *loop = loop_get(isolate);
+  Microtask *microtask = malloc(sizeof(Microtask));
+  microtask->task = task;
+  microtask->data = data;
+  microtask->next = NULL;
+  *loop->microtask_last = microtask;
+  loop->microtask_last = &microtask->next;
+}
+
+// including those the microtasks queue
+void loop_run_microtasks(Env *env) {
+  Loop *loop = env->isolate->loop;
+  if (loop == NULL) return;
+
+  Microtask *microtask;
+  while ((microtask = loop->microtasks) != NULL) {
+    loop->microtasks = microtask->next;
+    if (loop->microtasks == NULL) loop->microtask_last = &loop->microtasks;
+    microtask->task(env, microtask->data);
+    free(microtask);
+  }
+}
+
+// the loop is made before sleeping is set, so a thread that sees sleeping sees the loop
+void loop_wake(Isolate *isolate) {
+  __atomic_fetch_add(&isolate->wakeups, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&isolate->sleeping, __ATOMIC_SEQ_CST)) {
+    uint64_t one = 1;
+    ssize_t written = write(isolate->loop->wake, &one, sizeof(one));
+    (void)written;
+  }
+}
+
+void loop_wait(Isolate *isolate, uint32_t wakeups, int timeout) {
+  Loop *loop = loop_get(isolate);
+  if (loop->pid != getpid()) {
+    close(loop->epoll);
+    close(loop->wake);
+    loop_open(loop);
+  }
+
+  __atomic_store_n(&isolate->sleeping, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&isolate->wakeups, __ATOMIC_SEQ_CST) == wakeups) {
+    struct epoll_event event;
+    epoll_wait(loop->epoll, &event, 1, timeout);
+  }
+  __atomic_store_n(&isolate->sleeping, 0, __ATOMIC_SEQ_CST);
+
+  uint64_t count;
+  ssize_t read_size = read(loop->wake, &count, sizeof(count));
+  (void)read_size;
+}
+
+int timer_before(Timer *a, Timer *b) {
+  return a->deadline < b->deadline || (a->deadline == b->deadline && a->order < b->order);
+}
+
+void timer_swap(Loop *loop, int i, int j) {
+  Timer t = loop->timers[i];
+  loop->timers[i] = loop->timers[j];
+  loop->timers[j] = t;
+}
+
+void timer_sift_up(Loop *loop, int i) {
+  while (i > 0 && timer_before(&loop->timers[i], &loop->timers[(i - 1) / 2])) {
+    timer_swap(loop, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+void timer_sift_down(Loop *loop, int i) {
+  while (1) {
+    int first = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+    if (left < loop->timer_size && timer_before(&loop->timers[left], &loop->timers[first])) first = left;
+    if (right < loop->timer_size && timer_before(&loop->timers[right], &loop->timers[first])) first = right;
+    if (first == i) return;
+
+    timer_swap(loop, i, first);
+    i = first;
+  }
+}
+
+Timer timer_remove(Loop *loop, int i) {
+  Timer timer = loop->timers[i];
+  loop->timer_size--;
+  if (i < loop->timer_size) {
+    loop->timers[i] = loop->timers[loop->timer_size];
+    timer_sift_up(loop, i);
+    timer_sift_down(loop, i);
+  }
+  return timer;
+}
+
+// setTimeout(f, ms, ...args) calls f with args once ms have passed, and returns an id
+// for clearTimeout
+Value* native_set_timeout(Isolate *isolate, Value *this, int size, Value **args) {
+  if (size < 1 || !IS_FUNCTION(args[0])) {
+    RUNTIME_ERROR("setTimeout expects a function");
+  }
+
+  double delay = size > 1 ? value_to_number(args[1]) : 0;
+  if (isnan(delay) || delay < 0) delay = 0;
+
+  Loop *loop = loop_get(isolate);
+  if (loop->timer_size == loop->timer_cap) {
+    loop->timer_cap = loop->timer_cap == 0 ? 16 : loop->timer_cap * 2;
+    loop->timers = realloc(loop->timers, loop->timer_cap * sizeof(Timer));
+  }
+
+  Timer *timer = &loop->timers[loop->timer_size];
+  timer->deadline = loop_now() + delay;
+  timer->order = loop->timer_order++;
+  timer->id = ++loop->timer_id;
+  timer->f = args[0];
+  timer->size = size > 2 ? size - 2 : 0;
+  timer->args = malloc((timer->size + 1) * sizeof(Value*));
+  for (int i = 0; i < timer->size; i++) timer->args[i] = args[i + 2];
+
+  uint32_t id = timer->id;
+  timer_sift_up(loop, loop->timer_size++);
+  return value_number_new(id);
+}
+
+// ids of timers that ran or were cleared are ignored
+Value* native_clear_timeout(Isolate *isolate, Value *this, int size, Value **args) {
+  Loop *loop = isolate->loop;
+  if (loop == NULL || size < 1) return value_undefined_new();
+
+  double id = value_to_number(args[0]);
+  for (int i = 0; i < loop->timer_size; i++) {
+    if (loop->timers[i].id != id) continue;
+
+    Timer timer = timer_remove(loop, i);
+    free(timer.args);
+    break;
+  }
+
+  return value_undefined_new();
+}
+
+// runs the timers that were due when it started, and not those they set
+int loop_run_timers(Env *env, Loop *loop) {
+  double now = loop_now();
+  uint64_t last = loop->timer_order;
+  int handled = 0;
+  while (loop->timer_size > 0 && loop->timers[0].deadline <= now && loop->timers[0].order < last) {
+    Timer timer = timer_remove(loop, 0);
+    evaluate_function_call(timer.f, value_undefined_new(), timer.args, timer.size, env);
+    free(timer.args);
+    loop_run_microtasks(env);
+    handled++;
+  }
+
+  return handled;
+}
+
+// ms until the first timer is due, -1 without timers
+int loop_timeout(Loop *loop) {
+  if (loop == NULL || loop->timer_size == 0) return -1;
+
+  double wait = ceil(loop->timers[0].deadline - loop_now());
+  return wait < 0 ? 0 : wait > INT32_MAX ? INT32_MAX : (int)wait;
+}
+
+void io_read(IoRequest *request) {
+  int fd = open(request->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    request->error = errno;
+    return;
+  }
+
+  // the size is a hint: files in /proc say 0, and others may change while read
+  struct stat st;
+  size_t cap = fstat(fd, &st) == 0 && st.st_size > 0 ? (size_t)st.st_size + 1 : 4096;
+  char *data = malloc(cap);
+  size_t size = 0;
+  while (1) {
+    if (size == cap) {
+      cap *= 2;
+      data = realloc(data, cap);
+    }
+
+    ssize_t n = read(fd, data + size, cap - size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      request->error = errno;
+      free(data);
+      close(fd);
+      return;
+    }
+    if (n == 0) break;
+    size += n;
+  }
+
+  close(fd);
+  request->data = data;
+  request->size = size;
+}
+
+void io_write(IoRequest *request) {
+  int fd = open(request->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd < 0) {
+    request->error = errno;
+    return;
+  }
+
+  size_t written = 0;
+  while (written < request->size) {
+    ssize_t n = write(fd, request->data + written, request->size - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      request->error = errno;
+      break;
+    }
+    written += n;
+  }
+
+  if (close(fd) != 0 && request->error == 0) request->error = errno;
+}
+
+// pushes the request to its isolate's loop, which the isolate's thread made before it
+// handed the request over
+void io_finish(IoRequest *request) {
+  Loop *loop = request->isolate->loop;
+  IoRequest *head = __atomic_load_n(&loop->finished, __ATOMIC_RELAXED);
+  do {
+    request->next = head;
+  } while (!__atomic_compare_exchange_n(&loop->finished, &head, request, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  loop_wake(request->isolate);
+}
+
+void* io_thread(void *data) {
+  while (1) {
+    pthread_mutex_lock(&loop_io.lock);
+    while (loop_io.head == NULL) pthread_cond_wait(&loop_io.ready, &loop_io.lock);
+    IoRequest *request = loop_io.head;
+    loop_io.head = request->next;
+    if (loop_io.head == NULL) loop_io.tail = &loop_io.head;
+    pthread_mutex_unlock(&loop_io.lock);
+
+    if (request->kind == IO_READ) {
+      io_read(request);
+    } else {
+      io_write(request);
+    }
+    io_finish(request);
+  }
+
+  return NULL;
+}
+
+// a process forked by --serve has none of the threads, nor the requests of its parent
+void io_after_fork() {
+  pthread_mutex_t unlocked = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t ready = PTHREAD_COND_INITIALIZER;
+  loop_io.lock = unlocked;
+  loop_io.ready = ready;
+  loop_io.head = NULL;
+  loop_io.tail = &loop_io.head;
+  loop_io.started = 0;
+}
+
+void io_register_fork() {
+  pthread_atfork(NULL, NULL, io_after_fork);
+}
+
+// called with the lock held
+void io_start() {
+  static pthread_once_t registered = PTHREAD_ONCE_INIT;
+  pthread_once(&registered, io_register_fork);
+
+  for (int i = 0; i < LOOP_IO_THREADS; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, io_thread, NULL) != 0) {
+      fprintf(stderr, "could not start an I/O thread\n");
+      abort();
+    }
+    pthread_detach(thread);
+  }
+  loop_io.started = 1;
+}
+
+Value* io_submit(Isolate *isolate, IoKind kind, const char *path, const char *data, size_t size) {
+  IoRequest *request = calloc(1, sizeof(IoRequest));
+  request->kind = kind;
+  request->path = strdup(path);
+  if (data != NULL) {
+    request->data = malloc(size + 1);
+    memcpy(request->data, data, size);
+    request->size = size;
+  }
+  request->isolate = isolate;
+  request->promise = value_promise_new(isolate);
+  loop_get(isolate)->pending++;
+
+  pthread_mutex_lock(&loop_io.lock);
+  if (!loop_io.started) io_start();
+  *loop_io.tail = request;
+  loop_io.tail = &request->next;
+  request->next = NULL;
+  pthread_cond_signal(&loop_io.ready);
+  pthread_mutex_unlock(&loop_io.lock);
+
+  return request->promise;
+}
+
+// settles the promises of the requests that are done, in the order they finished
+int loop_run_finished(Env *env, Loop *loop) {
+  IoRequest *request = __atomic_exchange_n(&loop->finished, NULL, __ATOMIC_ACQUIRE);
+  IoRequest *ordered = NULL;
+  while (request != NULL) {
+    IoRequest *next = request->next;
+    request->next = ordered;
+    ordered = request;
+    request = next;
+  }
+
+  int handled = 0;
+  while (ordered != NULL) {
+    request = ordered;
+    ordered = request->next;
+    loop->pending--;
+
+    if (request->error != 0) {
+      char message[1024];
+      snprintf(message, sizeof(message), "%s: %s", request->path, strerror(request->error));
+      promise_reject(request->promise, value_string_new(message));
+    } else if (request->kind == IO_READ) {
+      promise_resolve(request->promise, value_string_new_length(request->data, request->size));
+    } else {
+      promise_resolve(request->promise, value_undefined_new());
+    }
+
+    free(request->path);
+    free(request->data);
+    free(request);
+    loop_run_microtasks(env);
+    handled++;
+  }
+
+  return handled;
+}
+
+// fs.readFile(path) fulfills with the file's contents as a string
+Value* native_fs_read_file(Isolate *isolate, Value *this, int size, Value **args) {
+  if (size < 1 || !IS_STRING(args[0])) {
+    RUNTIME_ERROR("readFile expects a file name");
+  }
+
+  return io_submit(isolate, IO_READ, value_string_unwrap(args[0]), NULL, 0);
+}
+
+// fs.writeFile(path, data) replaces the file with data, or makes it
+Value* native_fs_write_file(Isolate *isolate, Value *this, int size, Value **args) {
+  if (size < 1 || !IS_STRING(args[0])) {
+    RUNTIME_ERROR("writeFile expects a file name");
+  }
+
+  Value *data = size > 1 ? args[1] : value_undefined_new();
+  const char *text = IS_STRING(data) ? value_string_unwrap(data) : value_inspect(data);
+  size_t length = IS_STRING(data) ? value_string_length(data) : strlen(text);
+  return io_submit(isolate, IO_WRITE, value_string_unwrap(args[0]), text, length);
+}
+
+void loop_run(Env *env) {
+  Isolate *isolate = env->isolate;
+  Worker *self = isolate->worker;
+  if (isolate->loop == NULL && self == NULL && isolate->workers == NULL) return;
+
+  loop_run_microtasks(env);
+  while (1) {
+    uint32_t wakeups = __atomic_load_n(&isolate->wakeups, __ATOMIC_SEQ_CST);
+    if (self != NULL) __atomic_store_n(&self->idle, 0, __ATOMIC_SEQ_CST);
+
+    int handled = worker_handle_messages(env);
+    Loop *loop = isolate->loop;
+    if (loop != NULL) handled += loop_run_finished(env, loop) + loop_run_timers(env, loop);
+    if (handled) continue;
+
+    // timers and requests will call back without a message
+    int waiting = loop != NULL && (loop->timer_size > 0 || loop->pending > 0);
+    int quiet = worker_children_quiet(isolate) && !waiting;
+    if (self == NULL) {
+      if (quiet) break;
+    } else if (__atomic_load_n(&self->closing, __ATOMIC_SEQ_CST)) {
+      break;
+    } else if (quiet) {
+      // without onmessage nothing the parent sends would be handled
+      if (!IS_FUNCTION(env_get(env, "onmessage"))) break;
+
+      __atomic_store_n(&self->idle, 1, __ATOMIC_SEQ_CST);
+      loop_wake(self->parent);
+    }
+
+    loop_wait(isolate, wakeups, loop_timeout(loop));
+  }
+
+  worker_terminate_all(isolate);
+}
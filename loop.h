@@ -0,0 +1,85 @@
+#ifndef MJS_LOOP_H
+#define MJS_LOOP_H
+
+#include "value.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+// the event loop of an isolate. evaluate() runs it once the program has, and returns
+// when nothing is left that could call back into the program:
+//
+//   - microtasks, the reactions of settled promises (see promise.h), after the program
+//     and after each of the tasks below, until there are none
+//   - timers of setTimeout, once they are due, in the order they were set
+//   - fs.readFile and fs.writeFile requests, whose promises settle once they are done
+//   - messages from and to workers (see worker.h)
+//
+//   setTimeout(function (name) { console.log(name); }, 100, 'later');
+//   fs.readFile('a.txt').then(function (text) { return fs.writeFile('b.txt', text); });
+//
+// callbacks are called in the scope the program ran in. the loop sleeps in epoll_wait
+// until the next timer is due or its eventfd is written by another thread. regular files
+// can't be polled, so fs requests run on a pool of LOOP_IO_THREADS threads shared by the
+// isolates of the process, which hand them back to the isolate's loop when done. a
+// script that reads many files has that many reads in flight at once.
+#define LOOP_IO_THREADS 4
+
+typedef void (LoopTask)(Env *env, void *data);
+
+typedef struct Microtask {
+  LoopTask *task;
+  void *data;
+  struct Microtask *next;
+} Microtask;
+
+typedef struct Timer {
+  // ms of CLOCK_MONOTONIC
+  double deadline;
+  // timers due at once run in the order they were set
+  uint64_t order;
+  uint32_t id;
+  Value *f;
+  Value **args;
+  int size;
+} Timer;
+
+struct IoRequest;
+
+typedef struct Loop {
+  int epoll;
+  // written by other threads to wake the loop (see loop_wake)
+  int wake;
+  // the process that made epoll and wake. a process forked by --serve makes its own
+  pid_t pid;
+  // a binary heap on deadline, then order
+  Timer *timers;
+  int timer_size;
+  int timer_cap;
+  uint64_t timer_order;
+  uint32_t timer_id;
+  Microtask *microtasks;
+  Microtask **microtask_last;
+  // requests on the I/O threads that did not come back yet
+  int pending;
+  // requests the I/O threads are done with, pushed with compare-and-swap, newest first
+  struct IoRequest *finished;
+} Loop;
+
+// the isolate's loop, made on first use. only called on the isolate's thread
+Loop* loop_get(Isolate *isolate);
+void loop_queue_microtask(Isolate *isolate, LoopTask *task, void *data);
+void loop_run_microtasks(Env *env);
+// wakes the isolate if it sleeps in its loop. called from any thread
+void loop_wake(Isolate *isolate);
+// sleeps unless the isolate was woken since wakeups was read, for at most timeout ms, or
+// without a limit for -1
+void loop_wait(Isolate *isolate, uint32_t wakeups, int timeout);
+// runs the loop of env's isolate until it is done. env is the scope the program ran in
+void loop_run(Env *env);
+
+Value* native_set_timeout(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_clear_timeout(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_fs_read_file(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_fs_write_file(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
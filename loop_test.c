@@ -0,0 +1,97 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "loop.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+char* run(const char *source) {
+  char *output;
+  size_t size;
+  FILE *out = open_memstream(&output, &size);
+  evaluate(isolate_new(out), parse(tokenize((char*)source)));
+  fclose(out);
+  return output;
+}
+
+double now_ms() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+void test_timers_in_deadline_order() {
+  double start = now_ms();
+  char *output = run(
+    "setTimeout(function () { console.log(3); }, 30);"
+    "setTimeout(function () { console.log(1); }, 0);"
+    "setTimeout(function () { console.log(2); }, 0);"
+    "var id = setTimeout(function () { console.log(4); }, 10);"
+    "clearTimeout(id);"
+    "console.log(0);");
+  assert(strcmp(output, "0\n1\n2\n3\n") == 0);
+  // evaluate waits for the last timer
+  assert(now_ms() - start >= 30);
+}
+
+void test_microtasks_before_timers() {
+  char *output = run(
+    "setTimeout(function () { console.log('timer'); }, 0);"
+    "Promise.resolve(1).then(function (x) { console.log(x); return Promise.resolve(2); })"
+    "  .then(function (x) { console.log(x); });"
+    "console.log(0);");
+  assert(strcmp(output, "0\n1\n2\ntimer\n") == 0);
+}
+
+#define FIFOS 4
+
+char fifo_paths[FIFOS][64];
+
+// opening a fifo to write waits for a reader. opened from the last one back, so this only
+// gets through if the script has all of the reads in flight at once
+void* write_fifos(void *data) {
+  for (int i = FIFOS - 1; i >= 0; i--) {
+    int fd = open(fifo_paths[i], O_WRONLY);
+    assert(fd >= 0);
+    char c = '0' + i;
+    assert(write(fd, &c, 1) == 1);
+    close(fd);
+  }
+  return NULL;
+}
+
+void test_reads_in_flight_at_once() {
+  char source[1024] = "Promise.all([";
+  for (int i = 0; i < FIFOS; i++) {
+    sprintf(fifo_paths[i], "/tmp/mjs-loop-test.%d.%d", getpid(), i);
+    unlink(fifo_paths[i]);
+    assert(mkfifo(fifo_paths[i], 0600) == 0);
+    sprintf(source + strlen(source), "%sfs.readFile('%s')", i == 0 ? "" : ", ", fifo_paths[i]);
+  }
+  strcat(source, "]).then(function (texts) { console.log(texts.join('')); });");
+
+  pthread_t writer;
+  pthread_create(&writer, NULL, write_fifos, NULL);
+  // fails the test instead of hanging if the reads were made one at a time
+  alarm(10);
+  char *output = run(source);
+  alarm(0);
+  pthread_join(writer, NULL);
+
+  assert(strcmp(output, "0123\n") == 0);
+  for (int i = 0; i < FIFOS; i++) unlink(fifo_paths[i]);
+}
+
+int main(int argc, char const **argv) {
+  test_timers_in_deadline_order();
+  test_microtasks_before_timers();
+  test_reads_in_flight_at_once();
+  return 0;
+}
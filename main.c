@@ -1,10 +1,18 @@
 #include "tokenize.h"
 #include "parse.h"
 #include "value.h"
+#include "heap.h"
+#include "inline.h"
+#include "serve.h"
+#include "snapshot.h"
+#include "parallel.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <unistd.h>
 
 char* read_source(FILE *fp) {
   int cap = 1024;
@@ -24,26 +32,252 @@ char* read_source(FILE *fp) {
   return buf;
 }
 
+void print_stats(size_t heap_used) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+#ifdef MJS_COMPRESSED_REFS
+  const char *refs = "compressed";
+#else
+  const char *refs = "pointer";
+#endif
+
+  fprintf(stderr, "refs: %s\n", refs);
+  fprintf(stderr, "heap used: %zu KiB\n", heap_used / 1024);
+  fprintf(stderr, "max rss: %ld KiB\n", usage.ru_maxrss);
+}
+
+// reads a file, or stdin without a file name. NULL if it can't be opened
+char* load_source(const char *file_name) {
+  if (file_name == NULL) return read_source(stdin);
+
+  FILE *fp = fopen(file_name, "r");
+  if(!fp) {
+    perror("File opening failed");
+    return NULL;
+  }
+  char *source = read_source(fp);
+  fclose(fp);
+  return source;
+}
+
+// slots are numbered from *slots, e.g. after those of a snapshot's prelude
+Node* load_program(const char *file_name, int *slots, int inline_calls) {
+  char *source = load_source(file_name);
+  if (source == NULL) return NULL;
+
+  Token *token = tokenize(source);
+  Node *node = parse_slots(token, slots);
+  if (inline_calls) inline_functions(node);
+  return node;
+}
+
+// --jobs runs each script in its own isolate on a pool of threads. the output of a
+// script is kept until it is done and printed in the order the scripts were given
+typedef struct Job {
+  const char *file_name;
+  char *output;
+  size_t output_size;
+  int failed;
+  int done;
+} Job;
+
+typedef struct JobQueue {
+  Job *jobs;
+  int size;
+  // the next job to start, taken atomically
+  int next;
+  int inline_calls;
+  pthread_mutex_t lock;
+  pthread_cond_t done;
+} JobQueue;
+
+// scripts recurse on the C stack, so workers get more than the default
+#define JOB_STACK_SIZE ((size_t)64 << 20)
+
+void* job_worker(void *data) {
+  JobQueue *queue = data;
+
+  while (1) {
+    int i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+    if (i >= queue->size) break;
+
+    Job *job = &queue->jobs[i];
+    int slots = 0;
+    Node *node = load_program(job->file_name, &slots, queue->inline_calls);
+    if (node == NULL) {
+      job->failed = 1;
+    } else {
+      FILE *out = open_memstream(&job->output, &job->output_size);
+      evaluate(isolate_new(out), node);
+      fclose(out);
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    job->done = 1;
+    pthread_cond_broadcast(&queue->done);
+    pthread_mutex_unlock(&queue->lock);
+  }
+
+  return NULL;
+}
+
+int run_jobs(const char **file_names, int size, int threads, int inline_calls, int stats) {
+  JobQueue queue;
+  queue.jobs = calloc(size, sizeof(Job));
+  queue.size = size;
+  queue.next = 0;
+  queue.inline_calls = inline_calls;
+  pthread_mutex_init(&queue.lock, NULL);
+  pthread_cond_init(&queue.done, NULL);
+  for (int i = 0; i < size; i++) queue.jobs[i].file_name = file_names[i];
+
+  if (threads > size) threads = size;
+  pthread_t *workers = malloc(threads * sizeof(pthread_t));
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, JOB_STACK_SIZE);
+  for (int i = 0; i < threads; i++) {
+    pthread_create(&workers[i], &attr, job_worker, &queue);
+  }
+  pthread_attr_destroy(&attr);
+
+  int status = EXIT_SUCCESS;
+  for (int i = 0; i < size; i++) {
+    Job *job = &queue.jobs[i];
+    pthread_mutex_lock(&queue.lock);
+    while (!job->done) pthread_cond_wait(&queue.done, &queue.lock);
+    pthread_mutex_unlock(&queue.lock);
+
+    if (job->failed) status = EXIT_FAILURE;
+    fwrite(job->output, 1, job->output_size, stdout);
+    free(job->output);
+  }
+  fflush(stdout);
+
+  // the workers have exited, so their counts are in heap_used_bytes
+  for (int i = 0; i < threads; i++) pthread_join(workers[i], NULL);
+  if (stats) print_stats(heap_used_bytes());
+
+  free(workers);
+  free(queue.jobs);
+  return status;
+}
+
 int main(int argc, char const **argv) {
-  char *source;
-  if (argc < 2) {
-    source = read_source(stdin);
-  } else {
-    const char *file_name = argv[1];
-    FILE *fp = fopen(file_name, "r");
-    if(!fp) {
-      perror("File opening failed");
+  const char **file_names = malloc(argc * sizeof(char*));
+  int size = 0;
+  int stats = 0;
+  int inline_calls = 1;
+  int jobs = 0;
+  const char *serve_path = NULL;
+  int workers = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *connect_path = NULL;
+  const char *function = NULL;
+  const char *snapshot_prelude = NULL;
+  const char *output = NULL;
+  const char *snapshot_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--stats") == 0) {
+      stats = 1;
+    } else if (strcmp(argv[i], "--no-inline") == 0) {
+      inline_calls = 0;
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      jobs = atoi(argv[++i]);
+      if (jobs < 1) {
+        fprintf(stderr, "--jobs requires a positive number\n");
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+      serve_path = argv[++i];
+    } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+      workers = atoi(argv[++i]);
+      if (workers < 1) {
+        fprintf(stderr, "--workers requires a positive number\n");
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      // counting the thread calling parallelMap
+      int threads = atoi(argv[++i]);
+      if (threads < 1) {
+        fprintf(stderr, "--threads requires a positive number\n");
+        return EXIT_FAILURE;
+      }
+      parallel_set_threads(threads - 1);
+    } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+      connect_path = argv[++i];
+    } else if (strcmp(argv[i], "--call") == 0 && i + 1 < argc) {
+      function = argv[++i];
+    } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+      snapshot_prelude = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--load-snapshot") == 0 && i + 1 < argc) {
+      snapshot_path = argv[++i];
+    } else {
+      file_names[size++] = argv[i];
+    }
+  }
+
+  const char *file_name = size == 0 ? NULL : file_names[size - 1];
+
+  // runs the prelude and saves the heap it leaves
+  if (snapshot_prelude != NULL) {
+    if (output == NULL) {
+      fprintf(stderr, "--snapshot requires -o FILE\n");
       return EXIT_FAILURE;
     }
-    source = read_source(fp);
-    fclose(fp);
+
+    int slots = 0;
+    Node *node = load_program(snapshot_prelude, &slots, inline_calls);
+    if (node == NULL) return EXIT_FAILURE;
+
+    Isolate *isolate = isolate_new(stdout);
+    evaluate(isolate, node);
+    fflush(stdout);
+    return snapshot_write(isolate, slots, output) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
   }
 
-  Token *token = tokenize(source);
-  Node *node = parse(token);
+  // the file is the prelude, run once before the workers are forked
+  if (serve_path != NULL) {
+    char *prelude = NULL;
+    if (file_name != NULL && (prelude = load_source(file_name)) == NULL) return EXIT_FAILURE;
+    return serve(serve_path, workers, prelude, inline_calls);
+  }
+
+  // the file is the script, or the input of --call
+  if (connect_path != NULL) {
+    char *body = load_source(file_name);
+    if (body == NULL) return EXIT_FAILURE;
+    return serve_request(connect_path, function, body, strlen(body));
+  }
+
+  if (jobs > 0) {
+    if (snapshot_path != NULL) {
+      fprintf(stderr, "--load-snapshot runs a single script\n");
+      return EXIT_FAILURE;
+    }
+    if (size == 0) {
+      fprintf(stderr, "--jobs requires script files\n");
+      return EXIT_FAILURE;
+    }
+    return run_jobs(file_names, size, jobs, inline_calls, stats);
+  }
+
+  // the snapshot is loaded before the script is parsed, which hashes with the seed it has
+  int slots = 0;
+  Isolate *isolate = NULL;
+  if (snapshot_path != NULL && (isolate = snapshot_load(snapshot_path, stdout, &slots)) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  Node *node = load_program(file_name, &slots, inline_calls);
+  if (node == NULL) return EXIT_FAILURE;
 
   // node_pp(node); printf("\n");
-  evaluate(node);
+  evaluate(isolate == NULL ? isolate_new(stdout) : isolate, node);
+
+  if (stats) print_stats(heap_used_bytes());
 
   return 0;
 }
@@ -1,19 +1,70 @@
 #include "value.h"
 #include "object.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 double value_number_unwrap(Value* v) {
-  return v->primitive->value;
+  return VALUE_PRIMITIVE(v)->value;
 }
 
 Value* value_number_new(double n) {
-  Value *v = value_object_create(NULL);
-
-  Primitive *primitive = malloc(sizeof(Primitive));
+  Primitive *primitive = heap_alloc(sizeof(Primitive));
   primitive->type = PRIMITIVE_NUMBER;
+  primitive->flags = 0;
   primitive->value = n;
-  v->primitive = primitive;
 
-  return v;
+  return value_primitive_new(primitive);
+}
+
+// formats n the way String(n) does: integers without a fraction, and other numbers
+// with the fewest digits that read back as the same double, in decimal notation when
+// the exponent is from -7 to 20 and in exponent notation otherwise. buf needs 32 bytes.
+void value_number_format(double n, char *buf) {
+  if (isnan(n)) {
+    sprintf(buf, "NaN");
+  } else if (isinf(n)) {
+    sprintf(buf, n > 0 ? "Infinity" : "-Infinity");
+  } else if (n == 0) {
+    sprintf(buf, "0");
+  } else if (n == floor(n) && fabs(n) < 1e21) {
+    sprintf(buf, "%.0f", n);
+  } else {
+    // the fewest digits that read back as the same number, as d.ddde[+-]x
+    char shortest[32];
+    for (int precision = 0; precision <= 16; precision++) {
+      sprintf(shortest, "%.*e", precision, fabs(n));
+      if (strtod(shortest, NULL) == fabs(n)) break;
+    }
+
+    char digits[20];
+    int k = 0;
+    char *c = shortest;
+    for (; *c != 'e'; c++) {
+      if (*c != '.') digits[k++] = *c;
+    }
+    digits[k] = '\0';
+    // the number is 0.digits times 10 to the point
+    int point = atoi(c + 1) + 1;
+
+    char *out = buf;
+    if (n < 0) *out++ = '-';
+    if (0 < point && point <= 21) {
+      // the digits before the point, padded with zeros up to it, then the rest
+      for (int i = 0; i < point; i++) *out++ = i < k ? digits[i] : '0';
+      *out = '\0';
+      if (k > point) sprintf(out, ".%s", digits + point);
+    } else if (-6 < point && point <= 0) {
+      out += sprintf(out, "0.");
+      for (int i = 0; i < -point; i++) *out++ = '0';
+      sprintf(out, "%s", digits);
+    } else if (k == 1) {
+      sprintf(out, "%se%+d", digits, point - 1);
+    } else {
+      sprintf(out, "%c.%se%+d", digits[0], digits + 1, point - 1);
+    }
+  }
 }
 
 Value* value_number_subtract(int size, Value **args) {
@@ -1,5 +1,6 @@
 double value_number_unwrap(Value *value);
 Value* value_number_new(double n);
+void value_number_format(double n, char *buf);
 Value* value_number_subtract(int size, Value **args);
 Value* value_number_add(int size, Value **args);
 Value* value_number_multiply(int size, Value **args);
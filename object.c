@@ -1,40 +1,90 @@
-#include "hash.h"
+#include "dict.h"
 #include "value.h"
 #include "object.h"
 #include "string.h"
 #include "array.h"
+#include "typed_array.h"
+#include "number.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 Value* value_null_new() {
-  Value *v = malloc(sizeof(Value));
+  Value *v = heap_alloc(sizeof(Value));
   v->kind = VALUE_KIND_NULL;
-  v->table = NULL;
-  v->proto = NULL;
-  v->primitive = NULL;
+  v->table = heap_encode(NULL);
+  v->proto = heap_encode(NULL);
+  v->primitive = heap_encode(NULL);
   return v;
 }
 
 Value* value_undefined_new() {
-  Value *v = malloc(sizeof(Value));
+  Value *v = heap_alloc(sizeof(Value));
   v->kind = VALUE_KIND_UNDEFINED;
-  v->table = NULL;
-  v->proto = NULL;
-  v->primitive = NULL;
+  v->table = heap_encode(NULL);
+  v->proto = heap_encode(NULL);
+  v->primitive = heap_encode(NULL);
   return v;
 }
 
 Value* value_object_init() {
-  Value *v = malloc(sizeof(Value));
+  Value *v = heap_alloc(sizeof(Value));
   v->kind = VALUE_KIND_OBJECT;
-  v->table = hash_table_new();
-  v->primitive = NULL;
-  v->proto = NULL;
+  v->table = heap_encode(dict_new());
+  v->primitive = heap_encode(NULL);
+  v->proto = heap_encode(NULL);
+  return v;
+}
+
+// numbers, strings and booleans rarely get properties, so their table is
+// only allocated by the first write
+Value* value_primitive_new(Primitive *primitive) {
+  Value *v = heap_alloc(sizeof(Value));
+  v->kind = VALUE_KIND_OBJECT;
+  v->table = heap_encode(NULL);
+  v->primitive = heap_encode(primitive);
+  v->proto = heap_encode(NULL);
+  return v;
+}
+
+// the table to write to. a table shared with a literal template is copied first
+Dict* value_object_table(Value *object) {
+  Dict *table = VALUE_TABLE(object);
+  if (table == NULL) {
+    table = dict_new();
+    object->table = heap_encode(table);
+  } else if (table->shared) {
+    table = dict_copy(table);
+    object->table = heap_encode(table);
+  }
+
+  return table;
+}
+
+// presizes the table for a known number of properties
+void value_object_reserve(Value *object, unsigned int size) {
+  dict_reserve(value_object_table(object), size);
+}
+
+// turns a fully built object into a template: its table is never written again
+void value_object_freeze_template(Value *template) {
+  Dict *table = VALUE_TABLE(template);
+  if (table != NULL) table->shared = 1;
+}
+
+// a new object reading the template's properties until its first write
+Value* value_object_from_template(Value *proto, Value *template) {
+  Value *v = heap_alloc(sizeof(Value));
+  v->kind = VALUE_KIND_OBJECT;
+  v->table = template->table;
+  v->primitive = heap_encode(NULL);
+  v->proto = heap_encode(proto);
   return v;
 }
 
 Value* value_object_create(Value *proto) {
   Value *v = value_object_init();
-  v->proto = proto;
+  v->proto = heap_encode(proto);
   return v;
 }
 
@@ -42,29 +92,242 @@ Value* value_object_new(Binding *binding) {
   return value_object_create(binding->object_prototype);
 }
 
+#define IS_ARRAY(X) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_ARRAY)
+#define IS_TYPED_ARRAY(X) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_TYPED_ARRAY)
+
+// property names are atoms. number keys are converted, e.g. o[1] is o['1']. with intern
+// unset, returns NULL for a name that was never interned, which no object has
+Atom* value_object_key(Value *key, int intern) {
+  Atom *atom = intern ? value_string_atom(key) : value_string_find_atom(key);
+  if (atom != NULL) return atom;
+
+  Primitive *primitive = VALUE_PRIMITIVE(key);
+  if (primitive != NULL && primitive->type == PRIMITIVE_NUMBER) {
+    char buf[32];
+    value_number_format(primitive->value, buf);
+    return intern ? atom_intern(buf) : atom_find(buf);
+  }
+
+  return NULL;
+}
+
+// integer names are stored under an atom of the object's own rather than an interned
+// one, so that objects used as sparse arrays or counters don't grow the atom table,
+// which is never freed
+void value_object_set_index(Value *object, uint32_t index, Value *value) {
+  if (IS_ARRAY(object)) {
+    value_array_set(object, value_number_new(index), value);
+    return;
+  }
+
+  if (IS_TYPED_ARRAY(object)) {
+    value_typed_array_set(object, value_number_new(index), value);
+    return;
+  }
+
+  AtomIndex *key = heap_alloc(sizeof(AtomIndex));
+  if (!dict_set(value_object_table(object), atom_index_init(key, index), value)) {
+    heap_free(key, sizeof(AtomIndex));
+  }
+}
+
+void value_object_set_atom(Value *object, Atom *key, Value *value) {
+  if (IS_ARRAY(object) && key->index != ATOM_NOT_INDEX) {
+    value_array_set(object, value_number_new(key->index), value);
+    return;
+  }
+
+  // integer keys of a typed array never become properties, even out of range
+  if (IS_TYPED_ARRAY(object) && key->index != ATOM_NOT_INDEX) {
+    value_typed_array_set(object, value_number_new(key->index), value);
+    return;
+  }
+
+  dict_set(value_object_table(object), key, value);
+}
+
+// the atom to look up an integer key ('12' or 12) by, or NULL for other keys
+Atom* value_object_index_atom(Value *key, AtomIndex *probe) {
+  Primitive *primitive = VALUE_PRIMITIVE(key);
+  if (primitive == NULL) return NULL;
+  if (primitive->type == PRIMITIVE_STRING) return value_string_index_atom(key, probe);
+  if (primitive->type != PRIMITIVE_NUMBER) return NULL;
+
+  double n = primitive->value;
+  return n >= 0 && n < ATOM_NOT_INDEX && n == (unsigned int)n ? atom_index_init(probe, (uint32_t)n) : NULL;
+}
+
 void value_object_set(Value *object, Value *key, Value *value) {
-  if (object->primitive != NULL && object->primitive->type == PRIMITIVE_ARRAY) {
-    value_array_set(object, key, value);
+  if (IS_ARRAY(object)) {
+    Value *index = value_array_index_key(key);
+    if (index != NULL) {
+      value_array_set(object, index, value);
+      return;
+    }
+  }
+
+  if (IS_TYPED_ARRAY(object)) {
+    Value *index = value_array_index_key(key);
+    if (index != NULL) {
+      value_typed_array_set(object, index, value);
+      return;
+    }
+  }
+
+  AtomIndex probe;
+  Atom *index = value_object_index_atom(key, &probe);
+  if (index != NULL) {
+    value_object_set_index(object, index->index, value);
     return;
   }
-  hash_table_set(object->table, value_string_unwrap(key), value);
+
+  Atom *atom = value_object_key(key, 1);
+  if (atom == NULL) {
+    fprintf(stderr, "runtime error: invalid property key\n");
+    abort();
+  }
+
+  dict_set(value_object_table(object), atom, value);
 }
 
-Value* value_object_get(Value *object, Value *key) {
-  if (object->primitive != NULL && object->primitive->type == PRIMITIVE_ARRAY && key->primitive != NULL && key->primitive->type == PRIMITIVE_NUMBER) {
-    Value *v = value_array_get(object, key);
+// the property on the object or its prototypes, or NULL
+Value* value_object_lookup(Value *object, Atom *key) {
+  for (Value *o = object; o != NULL && o->kind == VALUE_KIND_OBJECT; o = VALUE_PROTO(o)) {
+    Dict *table = VALUE_TABLE(o);
+    Value *v = table == NULL ? NULL : dict_get(table, key);
+    if (v != NULL) return v;
+  }
+
+  return NULL;
+}
+
+Value* value_object_get_atom(Value *object, Atom *key) {
+  if (IS_ARRAY(object) && key->index != ATOM_NOT_INDEX) {
+    Value *v = value_array_get(object, value_number_new(key->index));
     if (v != NULL) return v;
   }
 
-  const char *s = value_string_unwrap(key);
-  if (s == NULL) return value_undefined_new();
+  if (IS_TYPED_ARRAY(object) && key->index != ATOM_NOT_INDEX) {
+    Value *v = value_typed_array_get(object, value_number_new(key->index));
+    return v == NULL ? value_undefined_new() : v;
+  }
+
+  Value *v = value_object_lookup(object, key);
+  return v == NULL ? value_undefined_new() : v;
+}
+
+Value* value_object_get(Value *object, Value *key) {
+  if (IS_ARRAY(object)) {
+    Value *index = value_array_index_key(key);
+    if (index != NULL) {
+      Value *v = value_array_get(object, index);
+      if (v != NULL) return v;
+    }
+  }
+
+  if (IS_TYPED_ARRAY(object)) {
+    Value *index = value_array_index_key(key);
+    if (index != NULL) {
+      Value *v = value_typed_array_get(object, index);
+      return v == NULL ? value_undefined_new() : v;
+    }
+  }
+
+  AtomIndex probe;
+  Atom *atom = value_object_index_atom(key, &probe);
+  if (atom == NULL) atom = value_object_key(key, 0);
+  if (atom == NULL) return value_undefined_new();
+
+  Value *v = value_object_lookup(object, atom);
+  return v == NULL ? value_undefined_new() : v;
+}
 
-  Value *v = hash_table_get(object->table, s);
-  if (v != NULL) return v;
+int value_object_delete(Value *object, Value *key) {
+  if (IS_ARRAY(object)) {
+    Value *index = value_array_index_key(key);
+    if (index != NULL) {
+      value_array_delete(object, index);
+      return 1;
+    }
+  }
+
+  if (VALUE_TABLE(object) == NULL) return 0;
+
+  AtomIndex probe;
+  Atom *atom = value_object_index_atom(key, &probe);
+  if (atom == NULL) atom = value_object_key(key, 0);
+  if (atom == NULL) return 0;
+
+  return dict_delete(value_object_table(object), atom);
+}
+
+// ===: numbers and booleans by value, strings by content, everything else by identity.
+// with same_value_zero, NaN equals NaN as in includes()
+int value_equal_values(Value *a, Value *b, int same_value_zero) {
+  if (a->kind != b->kind) return 0;
+  if (a->kind != VALUE_KIND_OBJECT) return 1;
+
+  Primitive *x = VALUE_PRIMITIVE(a);
+  Primitive *y = VALUE_PRIMITIVE(b);
+  if (x == NULL || y == NULL) return a == b;
+  if (x->type != y->type) return 0;
+
+  switch (x->type) {
+    case PRIMITIVE_NUMBER:
+    case PRIMITIVE_BOOLEAN: {
+      if (same_value_zero && x->value != x->value) return y->value != y->value;
+      return x->value == y->value;
+    }
+
+    case PRIMITIVE_STRING: {
+      return value_string_equal(a, b);
+    }
+
+    default: {
+      return a == b;
+    }
+  }
+}
+
+int value_strict_equal(Value *a, Value *b) {
+  return value_equal_values(a, b, 0);
+}
+
+int value_same_value_zero(Value *a, Value *b) {
+  return value_equal_values(a, b, 1);
+}
+
+// own enumerable property names in order: array indices first, then insertion order
+Value* value_object_keys(Binding *binding, Value *object) {
+  Value *keys = value_array_new(binding);
+  int size = 0;
+
+  if (IS_ARRAY(object)) {
+    unsigned int count;
+    uint32_t *indices = value_array_indices(object, &count);
+    for (unsigned int i = 0; i < count; i++) {
+      char buf[32];
+      sprintf(buf, "%u", indices[i]);
+      value_array_set(keys, value_number_new(size++), value_string_new(buf));
+    }
+    free(indices);
+  }
+
+  if (IS_TYPED_ARRAY(object)) {
+    uint32_t length = value_typed_array_length(object);
+    for (uint32_t i = 0; i < length; i++) {
+      char buf[32];
+      sprintf(buf, "%u", i);
+      value_array_set(keys, value_number_new(size++), value_string_new(buf));
+    }
+  }
 
-  if (object->proto != NULL && object->proto->kind == VALUE_KIND_OBJECT) {
-    return value_object_get(object->proto, key);
+  DictIterator it;
+  dict_iterator_init(&it, VALUE_TABLE(object));
+  Atom *key;
+  while (dict_iterator_next(&it, &key, NULL)) {
+    value_array_set(keys, value_number_new(size++), value_string_new_atom(key));
   }
 
-  return value_undefined_new();
+  return keys;
 }
@@ -1,6 +1,17 @@
 Value* value_null_new();
 Value* value_undefined_new();
 Value* value_object_create(Value *proto);
+Value* value_primitive_new(Primitive *primitive);
 Value* value_object_new(Binding *binding);
+void value_object_reserve(Value *object, unsigned int size);
+void value_object_freeze_template(Value *template);
+Value* value_object_from_template(Value *proto, Value *template);
 void value_object_set(Value *object, Value *key, Value *value);
 Value* value_object_get(Value *object, Value *key);
+void value_object_set_atom(Value *object, Atom *key, Value *value);
+void value_object_set_index(Value *object, uint32_t index, Value *value);
+Value* value_object_get_atom(Value *object, Atom *key);
+int value_object_delete(Value *object, Value *key);
+int value_strict_equal(Value *a, Value *b);
+int value_same_value_zero(Value *a, Value *b);
+Value* value_object_keys(Binding *binding, Value *object);
@@ -0,0 +1,388 @@
+#include "parallel.h"
+#include "value.h"
+#include "object.h"
+#include "number.h"
+#include "array.h"
+#include "inspect.h"
+#include "builtin.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define RUNTIME_ERROR(...) \
+  fprintf(stderr, "runtime error: "); \
+  fprintf(stderr, __VA_ARGS__); \
+  fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
+  abort();
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+#define IS_FUNCTION(X) ((X) != NULL && PRIMITIVE_TYPE_IS(X, PRIMITIVE_FUNCTION))
+#define IS_ARRAY(X) ((X) != NULL && PRIMITIVE_TYPE_IS(X, PRIMITIVE_ARRAY))
+
+// the chunks a participant has left: end << 32 | next, changed with compare-and-swap by
+// the owner taking from next and by thieves moving end down. one cache line each
+typedef struct __attribute__((aligned(64))) ParallelRange {
+  uint64_t range;
+} ParallelRange;
+
+#define PARALLEL_RANGE(NEXT, END) (((uint64_t)(END) << 32) | (NEXT))
+
+typedef struct ParallelJob {
+  ParallelTask *task;
+  void *data;
+  int participants;
+  // pool threads still in the run
+  int active;
+  ParallelRange ranges[PARALLEL_MAX_THREADS];
+} ParallelJob;
+
+typedef struct ParallelPool {
+  // -1 until set or started
+  int threads;
+  // held by the run using the pool
+  pthread_mutex_t lock;
+  // whether the threads are running, only changed with the lock held
+  int started;
+  ParallelJob *job;
+  // bumped for each run, from 0 when the threads start. they sleep on it in between
+  uint32_t generation;
+} ParallelPool;
+
+ParallelPool parallel_pool = { -1, PTHREAD_MUTEX_INITIALIZER, 0, NULL, 0 };
+
+void parallel_futex_wait(void *address, uint32_t value) {
+  syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+void parallel_futex_wake(void *address) {
+  syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+void parallel_set_threads(int threads) {
+  if (threads > PARALLEL_MAX_THREADS - 1) threads = PARALLEL_MAX_THREADS - 1;
+  parallel_pool.threads = threads < 0 ? 0 : threads;
+}
+
+int parallel_threads() {
+  if (parallel_pool.threads < 0) parallel_set_threads(sysconf(_SC_NPROCESSORS_ONLN) - 1);
+  return parallel_pool.threads;
+}
+
+int parallel_take(ParallelRange *own, uint32_t *chunk) {
+  uint64_t range = __atomic_load_n(&own->range, __ATOMIC_ACQUIRE);
+  while (1) {
+    uint32_t next = (uint32_t)range;
+    uint32_t end = range >> 32;
+    if (next >= end) return 0;
+
+    if (__atomic_compare_exchange_n(&own->range, &range, PARALLEL_RANGE(next + 1, end), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      *chunk = next;
+      return 1;
+    }
+  }
+}
+
+// takes the back half of another participant's chunks: runs the first and keeps the rest
+// as its own range. ranges only shrink or move to disjoint chunks, so a stale
+// compare-and-swap can't succeed
+int parallel_steal(ParallelJob *job, int thief, uint32_t *chunk) {
+  for (int i = 1; i < job->participants; i++) {
+    ParallelRange *victim = &job->ranges[(thief + i) % job->participants];
+    uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+    while (1) {
+      uint32_t next = (uint32_t)range;
+      uint32_t end = range >> 32;
+      if (next >= end) break;
+
+      uint32_t middle = next + (end - next) / 2;
+      if (__atomic_compare_exchange_n(&victim->range, &range, PARALLEL_RANGE(next, middle), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        *chunk = middle;
+        __atomic_store_n(&job->ranges[thief].range, PARALLEL_RANGE(middle + 1, end), __ATOMIC_RELEASE);
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+void parallel_participate(ParallelJob *job, int participant) {
+  uint32_t chunk;
+  while (parallel_take(&job->ranges[participant], &chunk) || parallel_steal(job, participant, &chunk)) {
+    job->task(job->data, participant, chunk);
+  }
+}
+
+// each pool thread takes part in every run, so the caller can wait for all of them
+void* parallel_thread(void *data) {
+  int participant = (int)(intptr_t)data;
+  uint32_t seen = 0;
+  while (1) {
+    uint32_t generation;
+    while ((generation = __atomic_load_n(&parallel_pool.generation, __ATOMIC_SEQ_CST)) == seen) {
+      parallel_futex_wait(&parallel_pool.generation, seen);
+    }
+    seen = generation;
+
+    ParallelJob *job = __atomic_load_n(&parallel_pool.job, __ATOMIC_SEQ_CST);
+    parallel_participate(job, participant);
+    if (__atomic_sub_fetch(&job->active, 1, __ATOMIC_SEQ_CST) == 0) parallel_futex_wake(&job->active);
+  }
+
+  return NULL;
+}
+
+// a process forked by --serve has none of the threads, and starts them again on its first run
+void parallel_after_fork() {
+  pthread_mutex_t unlocked = PTHREAD_MUTEX_INITIALIZER;
+  parallel_pool.lock = unlocked;
+  parallel_pool.started = 0;
+  parallel_pool.job = NULL;
+  parallel_pool.generation = 0;
+}
+
+void parallel_register_fork() {
+  pthread_atfork(NULL, NULL, parallel_after_fork);
+}
+
+void parallel_start() {
+  static pthread_once_t registered = PTHREAD_ONCE_INIT;
+  pthread_once(&registered, parallel_register_fork);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, PARALLEL_STACK_SIZE);
+  for (int i = 1; i <= parallel_pool.threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, parallel_thread, (void*)(intptr_t)i) != 0) {
+      fprintf(stderr, "could not start a thread for parallel runs\n");
+      abort();
+    }
+    pthread_detach(thread);
+  }
+  pthread_attr_destroy(&attr);
+  parallel_pool.started = 1;
+}
+
+void parallel_run(uint32_t begin, uint32_t end, ParallelTask *task, void *data) {
+  int threads = parallel_threads();
+  if (threads == 0 || end - begin <= 1 || pthread_mutex_trylock(&parallel_pool.lock) != 0) {
+    for (uint32_t chunk = begin; chunk < end; chunk++) task(data, 0, chunk);
+    return;
+  }
+
+  if (!parallel_pool.started) parallel_start();
+
+  ParallelJob job;
+  job.task = task;
+  job.data = data;
+  job.participants = threads + 1;
+  job.active = threads;
+  uint32_t count = end - begin;
+  for (int i = 0; i < job.participants; i++) {
+    uint32_t next = begin + (uint64_t)count * i / job.participants;
+    uint32_t last = begin + (uint64_t)count * (i + 1) / job.participants;
+    job.ranges[i].range = PARALLEL_RANGE(next, last);
+  }
+
+  __atomic_store_n(&parallel_pool.job, &job, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&parallel_pool.generation, 1, __ATOMIC_SEQ_CST);
+  parallel_futex_wake(&parallel_pool.generation);
+
+  parallel_participate(&job, 0);
+
+  int active;
+  while ((active = __atomic_load_n(&job.active, __ATOMIC_SEQ_CST)) != 0) parallel_futex_wait(&job.active, active);
+
+  parallel_pool.job = NULL;
+  pthread_mutex_unlock(&parallel_pool.lock);
+}
+
+typedef struct ParallelCall {
+  Isolate *isolate;
+  // the caller's scope
+  Env *env;
+  Value *array;
+  Value *f;
+  uint32_t length;
+  int reduce;
+  // parallelReduce with a combiner: what each chunk's fold starts from, NULL for its
+  // first element
+  Value *initial;
+  // parallelMap: the result for each element. parallelReduce: for each chunk, NULL for
+  // a chunk of holes
+  Value **results;
+  // the scope each participant calls f in, made on its first chunk
+  Env *frames[PARALLEL_MAX_THREADS];
+} ParallelCall;
+
+// a scope on top of the caller's with an isolate of its own, so that the evaluator's
+// state for the nodes of f is not shared between threads
+Env* parallel_frame(ParallelCall *call, int participant) {
+  if (participant == 0) return call->env;
+  if (call->frames[participant] != NULL) return call->frames[participant];
+
+  Isolate *isolate = malloc(sizeof(Isolate));
+  memset(isolate, 0, sizeof(Isolate));
+  isolate->binding = call->isolate->binding;
+  isolate->out = call->isolate->out;
+
+  Env *frame = env_new(call->env);
+  frame->isolate = isolate;
+  call->frames[participant] = frame;
+  return frame;
+}
+
+// holes are passed as undefined
+Value* parallel_element(ParallelCall *call, uint32_t i) {
+  Value *element = value_array_get(call->array, value_number_new(i));
+  return element == NULL ? value_undefined_new() : element;
+}
+
+Value* parallel_call_f(ParallelCall *call, Env *env, Value **args, int size) {
+  Value *result = evaluate_function_call(call->f, value_undefined_new(), args, size, env);
+  return result == NULL ? value_undefined_new() : result;
+}
+
+// f folded over the elements [begin, end) in order, from accumulator or, when that is
+// NULL, from the first element. holes are skipped, as reduce does
+Value* parallel_fold(ParallelCall *call, Env *env, Value *accumulator, uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; i++) {
+    Value *element = value_array_get(call->array, value_number_new(i));
+    if (element == NULL) continue;
+
+    if (accumulator == NULL) {
+      accumulator = element;
+      continue;
+    }
+
+    Value *args[] = { accumulator, element, value_number_new(i), call->array };
+    accumulator = parallel_call_f(call, env, args, 4);
+  }
+
+  return accumulator;
+}
+
+void parallel_call_chunk(void *data, int participant, uint32_t chunk) {
+  ParallelCall *call = data;
+  Env *frame = parallel_frame(call, participant);
+  uint32_t begin = chunk * PARALLEL_CHUNK;
+  uint32_t end = call->length - begin < PARALLEL_CHUNK ? call->length : begin + PARALLEL_CHUNK;
+
+  if (call->reduce) {
+    call->results[chunk] = parallel_fold(call, frame, call->initial, begin, end);
+    return;
+  }
+
+  for (uint32_t i = begin; i < end; i++) {
+    Value *args[] = { parallel_element(call, i), value_number_new(i), call->array };
+    call->results[i] = parallel_call_f(call, frame, args, 3);
+  }
+}
+
+// whether f may run on the pool: a function the parser proved pure while Math still has
+// its builtins, or one of those builtins
+int parallel_is_pure(Env *env, Value *f) {
+  PrimitiveFunction *function = (PrimitiveFunction*)VALUE_PRIMITIVE(f);
+  if (function->node != NULL) {
+    return function->node->pure && builtin_owner_intact(env_get(env, "Math"), BUILTIN_OWNER_MATH);
+  }
+
+  return function->intrinsic != BUILTIN_NONE && builtin_owner(function->intrinsic) == BUILTIN_OWNER_MATH;
+}
+
+// the first chunk always runs on the caller, so whatever the first reads of a variable
+// change, such as its number being owned, is done before other threads read it
+void parallel_call_run(ParallelCall *call, uint32_t chunks) {
+  if (chunks == 0) return;
+
+  parallel_call_chunk(call, 0, 0);
+  if (parallel_is_pure(call->env, call->f)) {
+    parallel_run(1, chunks, parallel_call_chunk, call);
+  } else {
+    for (uint32_t chunk = 1; chunk < chunks; chunk++) parallel_call_chunk(call, 0, chunk);
+  }
+
+  for (int i = 1; i < PARALLEL_MAX_THREADS; i++) {
+    if (call->frames[i] == NULL) continue;
+    free(call->frames[i]->isolate->slots);
+    free(call->frames[i]->isolate);
+  }
+}
+
+void parallel_call_init(ParallelCall *call, Isolate *isolate, Value *this, const char *name, int size, Value **args) {
+  if (!IS_ARRAY(this)) {
+    RUNTIME_ERROR("%s called on %s", name, value_inspect(this));
+  }
+  if (size < 1 || !IS_FUNCTION(args[0])) {
+    RUNTIME_ERROR("%s expects a function, but got %s", name, size < 1 ? "nothing" : value_inspect(args[0]));
+  }
+
+  memset(call, 0, sizeof(ParallelCall));
+  call->isolate = isolate;
+  call->env = isolate->env;
+  call->array = this;
+  call->f = args[0];
+  call->length = ((PrimitiveArray*)VALUE_PRIMITIVE(this))->size;
+}
+
+Value* native_value_array_parallel_map(Isolate *isolate, Value *this, int size, Value **args) {
+  ParallelCall call;
+  parallel_call_init(&call, isolate, this, "parallelMap", size, args);
+  call.results = malloc((call.length + 1) * sizeof(Value*));
+  parallel_call_run(&call, (call.length + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK);
+
+  Value *result = value_array_new(&isolate->binding);
+  for (uint32_t i = 0; i < call.length; i++) value_array_push(result, call.results[i]);
+  free(call.results);
+  return result;
+}
+
+// without a combiner this is reduce, a left fold on the calling thread: the chunks could
+// only be folded together with f if f were associative and its accumulator an element.
+// with one, each chunk is folded from the initial value, which must leave combine's
+// other argument unchanged (0 for a sum), and the chunks' results are combined in order
+Value* native_value_array_parallel_reduce(Isolate *isolate, Value *this, int size, Value **args) {
+  ParallelCall call;
+  parallel_call_init(&call, isolate, this, "parallelReduce", size, args);
+  call.reduce = 1;
+  Value *initial = size > 1 ? args[1] : NULL;
+  Value *combine = size > 2 ? args[2] : NULL;
+  if (combine != NULL && !IS_FUNCTION(combine)) {
+    RUNTIME_ERROR("parallelReduce expects a function to combine chunks, but got %s", value_inspect(combine));
+  }
+
+  Value *accumulator = NULL;
+  if (combine == NULL) {
+    accumulator = parallel_fold(&call, call.env, initial, 0, call.length);
+  } else {
+    uint32_t chunks = (call.length + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+    call.initial = initial;
+    call.results = malloc((chunks + 1) * sizeof(Value*));
+    parallel_call_run(&call, chunks);
+
+    for (uint32_t chunk = 0; chunk < chunks; chunk++) {
+      if (call.results[chunk] == NULL) continue;
+      if (accumulator == NULL) {
+        accumulator = call.results[chunk];
+        continue;
+      }
+
+      Value *combine_args[] = { accumulator, call.results[chunk] };
+      accumulator = evaluate_function_call(combine, value_undefined_new(), combine_args, 2, call.env);
+      if (accumulator == NULL) accumulator = value_undefined_new();
+    }
+    free(call.results);
+    if (accumulator == NULL) accumulator = initial;
+  }
+
+  if (accumulator == NULL) {
+    RUNTIME_ERROR("reduce of empty array with no initial value");
+  }
+  return accumulator;
+}
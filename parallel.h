@@ -0,0 +1,47 @@
+#ifndef MJS_PARALLEL_H
+#define MJS_PARALLEL_H
+
+#include "value.h"
+#include <stdint.h>
+
+// parallelMap and parallelReduce split an array into chunks of PARALLEL_CHUNK elements
+// and run the callback over them on a pool of threads shared by the process.
+//
+//   [1, 2, 3].parallelMap(function (x, i, array) { return x * x; })
+//   [1, 2, 3].parallelReduce(function (sum, x, i, array) { return sum + x; }, 0)
+//
+// only callbacks the parser proved pure (see node_is_pure_function) and the pure Math
+// natives run on the pool. each thread calls them with a frame of its own: an isolate
+// sharing the caller's globals, which are only read, with its own evaluator state. other
+// callbacks run the same chunks on the calling thread, so the result does not depend on
+// where they ran.
+//
+// parallelReduce(f, initial) is reduce, on the calling thread. given a third function,
+// parallelReduce(f, initial, combine) folds each chunk with f from initial on the pool,
+// then combines the results of the chunks in order on the calling thread:
+//
+//   data.parallelReduce(function (sum, x) { return sum + x * x; }, 0, function (a, b) { return a + b; })
+//
+// the chunks of a run are handed out as one range per thread. a thread takes chunks from
+// the front of its own range, and once it is empty steals the back half of another's.
+#define PARALLEL_CHUNK 1024
+#define PARALLEL_MAX_THREADS 64
+
+// scripts recurse on the C stack, so pool threads get more than the default
+#define PARALLEL_STACK_SIZE ((size_t)64 << 20)
+
+// runs a chunk. participant is 0 on the calling thread, 1 .. parallel_threads() on the pool
+typedef void (ParallelTask)(void *data, int participant, uint32_t chunk);
+
+// the pool threads besides the caller, one per core after the first by default. takes
+// effect if called before the first run
+void parallel_set_threads(int threads);
+int parallel_threads();
+// runs task once for each chunk in [begin, end). while another run has the pool, all of
+// them run on the caller
+void parallel_run(uint32_t begin, uint32_t end, ParallelTask *task, void *data);
+
+Value* native_value_array_parallel_map(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_value_array_parallel_reduce(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
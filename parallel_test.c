@@ -0,0 +1,97 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "parallel.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHUNKS 10007
+
+typedef struct Counts {
+  int runs[CHUNKS];
+  int participants[PARALLEL_MAX_THREADS];
+} Counts;
+
+void count_chunk(void *data, int participant, uint32_t chunk) {
+  Counts *counts = data;
+  __atomic_add_fetch(&counts->runs[chunk], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&counts->participants[participant], 1, __ATOMIC_RELAXED);
+}
+
+void test_run_each_chunk_once() {
+  static Counts counts;
+  for (int round = 0; round < 20; round++) {
+    memset(&counts, 0, sizeof(Counts));
+    parallel_run(3, CHUNKS, count_chunk, &counts);
+
+    for (int i = 0; i < CHUNKS; i++) assert(counts.runs[i] == (i < 3 ? 0 : 1));
+    int total = 0;
+    for (int i = 0; i < PARALLEL_MAX_THREADS; i++) {
+      assert(i <= parallel_threads() || counts.participants[i] == 0);
+      total += counts.participants[i];
+    }
+    assert(total == CHUNKS - 3);
+  }
+
+  memset(&counts, 0, sizeof(Counts));
+  parallel_run(5, 5, count_chunk, &counts);
+  parallel_run(5, 6, count_chunk, &counts);
+  assert(counts.runs[5] == 1 && counts.participants[0] == 1);
+}
+
+// a run started by a chunk of another finds the pool busy and runs on its thread
+void nested_chunk(void *data, int participant, uint32_t chunk) {
+  Counts *counts = data;
+  parallel_run(chunk * 10, chunk * 10 + 10, count_chunk, counts);
+}
+
+void test_nested_run() {
+  static Counts counts;
+  memset(&counts, 0, sizeof(Counts));
+  parallel_run(0, 100, nested_chunk, &counts);
+  for (int i = 0; i < 1000; i++) assert(counts.runs[i] == 1);
+}
+
+int pure_source(char *source) {
+  Node *program = parse(tokenize(source));
+  // var f = function ...
+  Node *function = program->children[0]->children[1];
+  assert(function->type == NODE_FUNCTION);
+  return function->pure;
+}
+
+void test_pure_functions() {
+  assert(pure_source("var f = function (x) { return x * x; };"));
+  assert(pure_source("var f = function (x, i) { var y = Math.sqrt(x) + i; y += 1; return Math.max(y, 0); };"));
+  assert(pure_source("var f = function (x) { var sum = 0; for (var i = 0; i < x; i++) { sum = sum + i; } return sum; };"));
+  assert(pure_source("var f = function (point) { return point.x + scale; };"));
+  assert(pure_source("function f(x) { return x; }"));
+}
+
+void test_impure_functions() {
+  // writes outside the function
+  assert(!pure_source("var f = function (x) { total = total + x; return x; };"));
+  assert(!pure_source("var f = function (x) { count++; return x; };"));
+  assert(!pure_source("var f = function (point) { point.x = 1; return point; };"));
+  assert(!pure_source("var f = function (x) { return [x, delete x.y]; };"));
+
+  // calls other than pure Math functions
+  assert(!pure_source("var f = function (x) { return g(x); };"));
+  assert(!pure_source("var f = function (x) { console.log(x); return x; };"));
+  assert(!pure_source("var f = function (x) { return Math.random(x); };"));
+  assert(!pure_source("var f = function (x) { var Math = x; return Math.abs(x); };"));
+  assert(!pure_source("var f = function (list) { return list.push(1); };"));
+
+  // objects made inside are left to the sequential path too
+  assert(!pure_source("var f = function (x) { return new Point(x); };"));
+  assert(!pure_source("var f = function (x) { return function () { return x; }; };"));
+}
+
+int main(int argc, char const **argv) {
+  parallel_set_threads(7);
+  test_run_each_chunk_once();
+  test_nested_run();
+  test_pure_functions();
+  test_impure_functions();
+  return 0;
+}
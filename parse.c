@@ -38,6 +38,10 @@ int token_matches_any(Token *token, TokenType type, const char *values[]) {
 
 typedef struct ParseState {
   struct Token *token;
+  // slots numbered so far
+  int slots;
+  // in the body of a function*, where yield may be used
+  int generator;
 } ParseState;
 
 Node* parse_statement_list(ParseState *state);
@@ -46,7 +50,14 @@ Node* parse_statement(ParseState *state);
 Node* node_alloc(NodeType type, int children_size) {
   Node *node = malloc(sizeof(Node));
   node->value = "";
+  node->atom = NULL;
   node->type = type;
+  node->constant = 0;
+  node->pure = 0;
+  node->generator = 0;
+  node->slot = -1;
+  node->switch_table = NULL;
+  node->inline_call = NULL;
 
   int arg_size = 0;
   node->args = malloc((arg_size + 1) * sizeof(Node*));
@@ -62,7 +73,7 @@ void parse_state_next(ParseState *state) {
 }
 
 void parse_state_expect(ParseState *state, char *str) {
-  if (strcmp(state->token->value, str) != 0) {
+  if (state->token->type == TOKEN_STRING || strcmp(state->token->value, str) != 0) {
     fprintf(stderr, "parse error: expect `%s`, but got `%s` (%d:%d)\n", str, state->token->value, state->token->line, state->token->column);
     abort();
     return;
@@ -78,6 +89,7 @@ Node* parse_identifier(ParseState *state) {
   if (state->token->type == TOKEN_IDENTIFIER) {
     Node *node = node_alloc(NODE_IDENTIFIER, 0);
     node->value = state->token->value;
+    node->atom = state->token->atom;
 
     parse_state_next(state);
     return node;
@@ -121,16 +133,12 @@ Node* parse_primary(ParseState *state) {
     return node;
   }
 
-  if (token_matches(state->token, TOKEN_SYMBOL, "'")) {
-    parse_state_next(state);
-
-    EXPECT_TOKEN_TYPE(state->token, TOKEN_IDENTIFIER);
+  if (state->token->type == TOKEN_STRING) {
     Node *node = node_alloc(NODE_PRIMITIVE_STRING, 0);
     node->value = state->token->value;
+    node->atom = state->token->atom;
 
     parse_state_next(state);
-
-    parse_state_expect(state, "'");
     return node;
   }
 
@@ -150,16 +158,26 @@ Node* parse_function(ParseState *state, NodeType node_type) {
   if (token_matches(head, TOKEN_KEYWORD, "function")) {
     parse_state_next(state);
 
+    int generator = 0;
+    if (token_matches(state->token, TOKEN_SYMBOL, "*")) {
+      parse_state_next(state);
+      generator = 1;
+    }
+
     Node *identifier = parse_identifier(state);
     char *function_name = "";
+    Atom *function_atom = NULL;
     if (identifier != NULL) {
       function_name = identifier->value;
+      function_atom = identifier->atom;
     }
 
     parse_state_expect(state, "(");
 
     Node *node = node_alloc(node_type, 0);
     node->value = function_name;
+    node->atom = function_atom;
+    node->generator = generator;
     int size = 0;
     while (state->token->type == TOKEN_IDENTIFIER) {
       size++;
@@ -169,6 +187,7 @@ Node* parse_function(ParseState *state, NodeType node_type) {
       Node *argument = node_alloc(NODE_IDENTIFIER, 0);
       Token *token = state->token;
       argument->value = token->value;
+      argument->atom = token->atom;
       node->args[size - 1] = argument;
 
       parse_state_next(state);
@@ -181,7 +200,11 @@ Node* parse_function(ParseState *state, NodeType node_type) {
 
     parse_state_expect(state, "{");
 
+    // a function nested in a function* can't yield
+    int enclosing = state->generator;
+    state->generator = generator;
     Node *statement_list = parse_statement_list(state);
+    state->generator = enclosing;
 
     node->children = statement_list->children;
     free(statement_list);
@@ -201,6 +224,7 @@ Node* parse_function_call(ParseState *state, Node *callee) {
 
   Node *node = node_alloc(NODE_FUNCTION_CALL, 1);
   node->children[0] = callee;
+  node->slot = state->slots++;
 
   int i = 1;
   while (1) {
@@ -234,6 +258,31 @@ void node_children_push(Node *node, Node *element) {
   node->children[new_size] = NULL;
 }
 
+int node_is_literal(Node *node) {
+  switch (node->type) {
+    case NODE_PRIMITIVE_NUMBER:
+    case NODE_PRIMITIVE_STRING:
+    case NODE_PRIMITIVE_BOOLEAN:
+    case NODE_PRIMITIVE_NULL:
+    case NODE_PRIMITIVE_UNDEFINED:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// [1, 'a'] and { a: 1 } evaluate to the same contents every time, so the
+// evaluator builds them once and hands out copy-on-write clones
+int node_is_constant(Node *node) {
+  for (int i = 0; node->children[i] != NULL; i++) {
+    Node *child = node->children[i];
+    if (child->type == NODE_OBJECT_ENTRY) child = child->children[1];
+    if (!node_is_literal(child)) return 0;
+  }
+
+  return 1;
+}
+
 Node* parse_array(ParseState *state) {
   if (token_matches(state->token, TOKEN_SYMBOL, "[")) {
     parse_state_next(state);
@@ -250,6 +299,8 @@ Node* parse_array(ParseState *state) {
     }
 
     parse_state_expect(state, "]");
+    node->constant = node_is_constant(node);
+    if (node->constant) node->slot = state->slots++;
     return node;
   }
 
@@ -287,13 +338,29 @@ Node* parse_object(ParseState *state) {
     }
 
     parse_state_expect(state, "}");
+    node->constant = node_is_constant(node);
+    if (node->constant) node->slot = state->slots++;
     return node;
   }
 
   return NULL;
 }
 
+const char *compound_assignment_symbols[] = { "+=", "-=", "*=", NULL };
+
 Node* parse_variable_assignment(ParseState *state, Node *left) {
+  // a += b keeps the operator without the "=" in value
+  if (state->token != NULL && token_matches_any(state->token, TOKEN_SYMBOL, compound_assignment_symbols)) {
+    Node *node = node_alloc(NODE_COMPOUND_ASSIGNMENT, 2);
+    node->value = strndup(state->token->value, 1);
+    parse_state_next(state);
+
+    node->children[0] = left;
+    node->children[1] = parse_expression(state);
+
+    return node;
+  }
+
   if (token_matches(state->token, TOKEN_SYMBOL, "=")) {
     parse_state_next(state);
 
@@ -335,23 +402,6 @@ Node* parse_reference(ParseState *state) {
   PARSE_BINARY_OPERATION(dot_symbols, parse_term, parse_identifier)
 }
 
-Node* parse_term_reference(ParseState *state) {
-  PARSE_BINARY_OPERATION(dot_symbols, parse_term, parse_identifier)
-}
-
-Node* parse_term_function_call(ParseState *state) {
-  Node *node = parse_term_reference(state);
-
-  Node *function_call;
-  while (1) {
-    function_call = parse_function_call(state, node);
-    if (function_call == NULL) break;
-    node = function_call;
-  }
-
-  return node;
-}
-
 Node* parse_member_access(ParseState *state, Node *callee) {
   if (token_matches(state->token, TOKEN_SYMBOL, "[")) {
     parse_state_next(state);
@@ -370,21 +420,50 @@ Node* parse_member_access(ParseState *state, Node *callee) {
   return NULL;
 }
 
+// a term and the .name, [expression] and (arguments) after it, in any order, so that
+// a.b(1)[0].c() and p.then(f).then(g) chain
 Node* parse_term_member_access(ParseState *state) {
-  Node *node = parse_term_function_call(state);
+  Node *node = parse_term(state);
 
-  Node *member_access;
-  while (1) {
-    member_access = parse_member_access(state, node);
-    if (member_access == NULL) return node;
-    node = member_access;
+  while (state->token != NULL) {
+    if (token_matches(state->token, TOKEN_SYMBOL, ".")) {
+      char *symbol = state->token->value;
+      parse_state_next(state);
+
+      Node *left = node;
+      node = node_alloc(NODE_BINARY_OPERATOR, 2);
+      node->value = symbol;
+      node->children[0] = left;
+      node->children[1] = parse_identifier(state);
+      continue;
+    }
+
+    Node *next = parse_function_call(state, node);
+    if (next == NULL) next = parse_member_access(state, node);
+    if (next == NULL) break;
+    node = next;
   }
 
   return node;
 }
 
+const char *update_symbols[] = { "++", "--", NULL };
+
+// value is "+" or "-"
+Node* parse_update(ParseState *state, NodeType type, Node *target) {
+  Node *node = node_alloc(type, 1);
+  node->value = strndup(state->token->value, 1);
+  node->children[0] = target;
+  parse_state_next(state);
+  return node;
+}
+
 Node* parse_variable_assignment_operation(ParseState *state) {
   Node *node = parse_term_member_access(state);
+  if (node != NULL && state->token != NULL && token_matches_any(state->token, TOKEN_SYMBOL, update_symbols)) {
+    return parse_update(state, NODE_POSTFIX_UPDATE, node);
+  }
+
   Node *assignment;
   while (1) {
     assignment = parse_variable_assignment(state, node);
@@ -395,9 +474,51 @@ Node* parse_variable_assignment_operation(ParseState *state) {
   return node;
 }
 
+Node* parse_unary_operation(ParseState *state) {
+  if (state->token != NULL && token_matches(state->token, TOKEN_KEYWORD, "delete")) {
+    parse_state_next(state);
+
+    Node *node = node_alloc(NODE_UNARY_OPERATOR, 1);
+    node->value = "delete";
+    node->children[0] = parse_unary_operation(state);
+    return node;
+  }
+
+  // new F(args) wraps the call. `new F` without arguments calls F with none
+  if (state->token != NULL && token_matches(state->token, TOKEN_KEYWORD, "new")) {
+    parse_state_next(state);
+
+    Node *node = node_alloc(NODE_UNARY_OPERATOR, 1);
+    node->value = "new";
+    Node *call = parse_unary_operation(state);
+    if (call != NULL && call->type != NODE_FUNCTION_CALL) {
+      Node *callee = call;
+      call = node_alloc(NODE_FUNCTION_CALL, 1);
+      call->children[0] = callee;
+    }
+
+    node->children[0] = call;
+    return node;
+  }
+
+  if (state->token != NULL && token_matches_any(state->token, TOKEN_SYMBOL, update_symbols)) {
+    Node *node = parse_update(state, NODE_PREFIX_UPDATE, NULL);
+    node->children[0] = parse_term_member_access(state);
+    return node;
+  }
+
+  return parse_variable_assignment_operation(state);
+}
+
+// x++ whose old value is not used is evaluated as ++x, which skips keeping the old value
+Node* parse_discard_value(Node *node) {
+  if (node != NULL && node->type == NODE_POSTFIX_UPDATE) node->type = NODE_PREFIX_UPDATE;
+  return node;
+}
+
 const char *multiplicative_symbols[] =  { "*", "/", NULL };
 Node* parse_multiplicative_operation(ParseState *state) {
-  PARSE_BINARY_OPERATION(multiplicative_symbols, parse_variable_assignment_operation, parse_variable_assignment_operation)
+  PARSE_BINARY_OPERATION(multiplicative_symbols, parse_unary_operation, parse_unary_operation)
 }
 
 const char *additive_symbols[] =  { "+", "-", NULL };
@@ -410,7 +531,21 @@ Node* parse_equality_operation(ParseState *state) {
   PARSE_BINARY_OPERATION(equality_symbols, parse_additive_operation, parse_additive_operation)
 }
 
+// yield, or yield expression, at the lowest precedence: var x = yield a + b; yields a + b
+Node* parse_yield(ParseState *state) {
+  if (!state->generator) {
+    fprintf(stderr, "parse error: yield outside of a function* (%d:%d)\n", state->token->line, state->token->column);
+    abort();
+  }
+  parse_state_next(state);
+
+  Node *node = node_alloc(NODE_YIELD, 1);
+  node->children[0] = parse_expression(state);
+  return node;
+}
+
 Node* parse_expression(ParseState *state) {
+  if (state->token != NULL && token_matches(state->token, TOKEN_KEYWORD, "yield")) return parse_yield(state);
   return parse_equality_operation(state);
 }
 
@@ -446,6 +581,7 @@ Node* parse_variable_declaration_statement(ParseState *state) {
 
     Node *identifier = node_alloc(NODE_IDENTIFIER, 0);
     identifier->value = state->token->value;
+    identifier->atom = state->token->atom;
 
     node->children[0] = identifier;
 
@@ -494,7 +630,7 @@ Node* parse_for_statement(ParseState *state) {
     parse_state_expect(state, ";");
 
     // next
-    node->args[2] = parse_expression(state);
+    node->args[2] = parse_discard_value(parse_expression(state));
 
     parse_state_expect(state, ")");
     parse_state_expect(state, "{");
@@ -511,6 +647,227 @@ Node* parse_for_statement(ParseState *state) {
   return NULL;
 }
 
+// for (var key in object) { ... }
+Node* parse_for_in_statement(ParseState *state) {
+  Token *token = state->token;
+  if (!token_matches(token, TOKEN_KEYWORD, "for")) return NULL;
+
+  // look ahead for `in` before committing, so that ordinary for loops are left to parse_for_statement
+  token = token->next;
+  if (token == NULL || !token_matches(token, TOKEN_SYMBOL, "(")) return NULL;
+  token = token->next;
+  if (token != NULL && token_matches(token, TOKEN_KEYWORD, "var")) token = token->next;
+  if (token == NULL || token->type != TOKEN_IDENTIFIER) return NULL;
+  token = token->next;
+  if (token == NULL || !token_matches(token, TOKEN_KEYWORD, "in")) return NULL;
+
+  parse_state_next(state);
+  parse_state_expect(state, "(");
+  if (token_matches(state->token, TOKEN_KEYWORD, "var")) parse_state_next(state);
+
+  Node *node = node_alloc(NODE_STATEMENT_FOR_IN, 0);
+
+  int arg_size = 2;
+  node->args = malloc((arg_size + 1) * sizeof(Node*));
+  node->args[arg_size] = NULL;
+
+  node->args[0] = parse_identifier(state);
+  parse_state_expect(state, "in");
+  node->args[1] = parse_expression(state);
+
+  parse_state_expect(state, ")");
+  parse_state_expect(state, "{");
+
+  Node *statement_list = parse_statement_list(state);
+  node->children = statement_list->children;
+  free(statement_list);
+
+  parse_state_expect(state, "}");
+
+  return node;
+}
+
+// for (var x of iterable) { ... }. of is not a keyword, so it is only looked for here
+Node* parse_for_of_statement(ParseState *state) {
+  Token *token = state->token;
+  if (!token_matches(token, TOKEN_KEYWORD, "for")) return NULL;
+
+  token = token->next;
+  if (token == NULL || !token_matches(token, TOKEN_SYMBOL, "(")) return NULL;
+  token = token->next;
+  if (token != NULL && token_matches(token, TOKEN_KEYWORD, "var")) token = token->next;
+  if (token == NULL || token->type != TOKEN_IDENTIFIER) return NULL;
+  token = token->next;
+  if (token == NULL || !token_matches(token, TOKEN_IDENTIFIER, "of")) return NULL;
+
+  parse_state_next(state);
+  parse_state_expect(state, "(");
+  if (token_matches(state->token, TOKEN_KEYWORD, "var")) parse_state_next(state);
+
+  Node *node = node_alloc(NODE_STATEMENT_FOR_OF, 0);
+
+  int arg_size = 2;
+  node->args = malloc((arg_size + 1) * sizeof(Node*));
+  node->args[arg_size] = NULL;
+
+  node->args[0] = parse_identifier(state);
+  parse_state_next(state);
+  node->args[1] = parse_expression(state);
+
+  parse_state_expect(state, ")");
+  parse_state_expect(state, "{");
+
+  Node *statement_list = parse_statement_list(state);
+  node->children = statement_list->children;
+  free(statement_list);
+
+  parse_state_expect(state, "}");
+
+  return node;
+}
+
+// a dense table is used while at least a quarter of its slots hold a case
+#define SWITCH_DENSE_MAX_SIZE 4096
+#define SWITCH_DENSE_LOAD(LABELS, SIZE) ((SIZE) <= 4 * (LABELS))
+
+uint32_t switch_entry_hash(struct Atom *atom, int number) {
+  return atom != NULL ? atom->hash : (uint32_t)number * 2654435761u;
+}
+
+// the slot holding the label, or the empty slot it would go into
+SwitchEntry* switch_table_find(SwitchTable *table, struct Atom *atom, int number) {
+  unsigned int mask = table->size - 1;
+  for (unsigned int i = switch_entry_hash(atom, number) & mask; ; i = (i + 1) & mask) {
+    SwitchEntry *entry = &table->entries[i];
+    if (entry->case_index < 0) return entry;
+    if (entry->atom == atom && (atom != NULL || entry->number == number)) return entry;
+  }
+}
+
+// picks the dispatch from the labels. duplicate labels keep the first case, which is the
+// one comparing in order would find
+SwitchTable* switch_table_build(Node *node) {
+  SwitchTable *table = malloc(sizeof(SwitchTable));
+  table->dispatch = SWITCH_DISPATCH_SEQUENTIAL;
+  table->default_case = -1;
+  table->min = 0;
+  table->size = 0;
+  table->cases = NULL;
+  table->entries = NULL;
+
+  int labels = 0;
+  int integers = 1;
+  int constants = 1;
+  long min = 0, max = 0;
+  for (int i = 0; node->children[i] != NULL; i++) {
+    Node *label = node->children[i]->args[0];
+    if (label == NULL) {
+      if (table->default_case < 0) table->default_case = i;
+      continue;
+    }
+
+    if (label->type == NODE_PRIMITIVE_NUMBER) {
+      long n = atoi(label->value);
+      if (labels == 0 || n < min) min = n;
+      if (labels == 0 || n > max) max = n;
+    } else {
+      integers = 0;
+      if (label->type != NODE_PRIMITIVE_STRING) constants = 0;
+    }
+    labels++;
+  }
+
+  if (labels == 0 || !constants) return table;
+
+  long span = max - min + 1;
+  if (integers && span <= SWITCH_DENSE_MAX_SIZE && SWITCH_DENSE_LOAD(labels, span)) {
+    table->dispatch = SWITCH_DISPATCH_DENSE;
+    table->min = min;
+    table->size = span;
+    table->cases = malloc(span * sizeof(int));
+    for (long i = 0; i < span; i++) table->cases[i] = -1;
+
+    for (int i = 0; node->children[i] != NULL; i++) {
+      Node *label = node->children[i]->args[0];
+      if (label == NULL) continue;
+
+      int *slot = &table->cases[atoi(label->value) - min];
+      if (*slot < 0) *slot = i;
+    }
+
+    return table;
+  }
+
+  table->dispatch = SWITCH_DISPATCH_HASH;
+  table->size = 8;
+  while (table->size < 2 * (unsigned int)labels) table->size *= 2;
+  table->entries = malloc(table->size * sizeof(SwitchEntry));
+  for (unsigned int i = 0; i < table->size; i++) table->entries[i].case_index = -1;
+
+  for (int i = 0; node->children[i] != NULL; i++) {
+    Node *label = node->children[i]->args[0];
+    if (label == NULL) continue;
+
+    struct Atom *atom = label->type == NODE_PRIMITIVE_STRING ? label->atom : NULL;
+    int number = atom == NULL ? atoi(label->value) : 0;
+    SwitchEntry *entry = switch_table_find(table, atom, number);
+    if (entry->case_index >= 0) continue;
+
+    entry->atom = atom;
+    entry->number = number;
+    entry->case_index = i;
+  }
+
+  return table;
+}
+
+// switch (x) { case 1: ... break; default: ... }
+//
+// each case is a SWITCH_CASE node with the label in args[0] (NULL for default) and
+// its statements as children. control falls through into the following cases
+Node* parse_switch_statement(ParseState *state) {
+  if (!token_matches(state->token, TOKEN_KEYWORD, "switch")) return NULL;
+  parse_state_next(state);
+
+  Node *node = node_alloc(NODE_STATEMENT_SWITCH, 0);
+  node->args = realloc(node->args, 2 * sizeof(Node*));
+  node->args[1] = NULL;
+
+  parse_state_expect(state, "(");
+  node->args[0] = parse_expression(state);
+  parse_state_expect(state, ")");
+  parse_state_expect(state, "{");
+
+  while (state->token != NULL && !token_matches(state->token, TOKEN_SYMBOL, "}")) {
+    Node *label = NULL;
+    if (token_matches(state->token, TOKEN_KEYWORD, "case")) {
+      parse_state_next(state);
+      label = parse_expression(state);
+    } else {
+      parse_state_expect(state, "default");
+    }
+    parse_state_expect(state, ":");
+
+    Node *switch_case = parse_statement_list(state);
+    switch_case->type = NODE_SWITCH_CASE;
+    switch_case->args = realloc(switch_case->args, 2 * sizeof(Node*));
+    switch_case->args[0] = label;
+    switch_case->args[1] = NULL;
+    node_children_push(node, switch_case);
+  }
+
+  parse_state_expect(state, "}");
+  node->switch_table = switch_table_build(node);
+  return node;
+}
+
+Node* parse_break_statement(ParseState *state) {
+  if (!token_matches(state->token, TOKEN_KEYWORD, "break")) return NULL;
+  parse_state_next(state);
+  parse_state_expect(state, ";");
+  return node_alloc(NODE_STATEMENT_BREAK, 0);
+}
+
 Node* parse_while_statement(ParseState *state) {
   if (token_matches(state->token, TOKEN_KEYWORD, "while")) {
     parse_state_next(state);
@@ -585,13 +942,25 @@ Node* parse_statement(ParseState *state) {
   Node *while_statement = parse_while_statement(state);
   if (while_statement != NULL) return while_statement;
 
+  Node *for_in_statement = parse_for_in_statement(state);
+  if (for_in_statement != NULL) return for_in_statement;
+
+  Node *for_of_statement = parse_for_of_statement(state);
+  if (for_of_statement != NULL) return for_of_statement;
+
   Node *for_statement = parse_for_statement(state);
   if (for_statement != NULL) return for_statement;
 
+  Node *switch_statement = parse_switch_statement(state);
+  if (switch_statement != NULL) return switch_statement;
+
+  Node *break_statement = parse_break_statement(state);
+  if (break_statement != NULL) return break_statement;
+
   Node *return_statement = parse_return_statement(state);
   if (return_statement != NULL) return return_statement;
 
-  Node *expression = parse_expression(state);
+  Node *expression = parse_discard_value(parse_expression(state));
   if (expression == NULL) return NULL;
   parse_state_expect(state, ";");
   return expression;
@@ -619,6 +988,98 @@ Node* parse_program(ParseState *state) {
   return node;
 }
 
+// whether node declares a variable called name, without looking into nested functions
+int node_declares(Node *node, Atom *name) {
+  if (node->type == NODE_VAR_DECLARATION && node->children[0]->atom == name) return 1;
+  if (node->type == NODE_FUNCTION) return 0;
+
+  for (int i = 0; node->children[i] != NULL; i++) {
+    if (node_declares(node->children[i], name)) return 1;
+  }
+  for (int i = 0; node->args[i] != NULL; i++) {
+    if (node_declares(node->args[i], name)) return 1;
+  }
+
+  return 0;
+}
+
+int function_has_local(Node *function, Atom *name) {
+  for (int i = 0; function->args[i] != NULL; i++) {
+    if (function->args[i]->atom == name) return 1;
+  }
+  for (int i = 0; function->children[i] != NULL; i++) {
+    if (node_declares(function->children[i], name)) return 1;
+  }
+
+  return 0;
+}
+
+const char *pure_math_functions[] = { "abs", "floor", "ceil", "trunc", "sqrt", "min", "max", NULL };
+
+// Math.abs(x) and the like. whether Math is still the builtin one is up to the caller
+int node_is_pure_call(Node *function, Node *callee) {
+  if (callee->type != NODE_OBJECT_MEMBER_ACCESS) return 0;
+
+  Node *object = callee->children[0];
+  Node *property = callee->children[1];
+  if (object->type != NODE_IDENTIFIER || strcmp(object->value, "Math") != 0) return 0;
+  if (function_has_local(function, object->atom)) return 0;
+  if (property->type != NODE_PRIMITIVE_STRING) return 0;
+
+  for (int i = 0; pure_math_functions[i] != NULL; i++) {
+    if (strcmp(property->value, pure_math_functions[i]) == 0) return 1;
+  }
+  return 0;
+}
+
+int node_is_pure(Node *function, Node *node) {
+  switch (node->type) {
+    // new, delete, for-in, for-of, yield and nested functions are left to the sequential path
+    case NODE_FUNCTION:
+    case NODE_UNARY_OPERATOR:
+    case NODE_STATEMENT_FOR_IN:
+    case NODE_STATEMENT_FOR_OF:
+    case NODE_YIELD:
+      return 0;
+
+    case NODE_VAR_ASSIGNMENT:
+    case NODE_COMPOUND_ASSIGNMENT:
+    case NODE_PREFIX_UPDATE:
+    case NODE_POSTFIX_UPDATE: {
+      Node *target = node->children[0];
+      if (target->type != NODE_IDENTIFIER || !function_has_local(function, target->atom)) return 0;
+      break;
+    }
+
+    case NODE_FUNCTION_CALL: {
+      if (!node_is_pure_call(function, node->children[0])) return 0;
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  for (int i = 0; node->children[i] != NULL; i++) {
+    if (!node_is_pure(function, node->children[i])) return 0;
+  }
+  for (int i = 0; node->args[i] != NULL; i++) {
+    if (!node_is_pure(function, node->args[i])) return 0;
+  }
+
+  return 1;
+}
+
+// a function that writes nothing but its own variables: anything outside it, variables
+// or objects, is only read. run on a transformed body, before inlining
+int node_is_pure_function(Node *function) {
+  for (int i = 0; function->children[i] != NULL; i++) {
+    if (!node_is_pure(function, function->children[i])) return 0;
+  }
+
+  return 1;
+}
+
 // makes the number of node patterns less in order to help implementation of evaluator
 //
 // obj.foo => obj['foo']
@@ -633,6 +1094,10 @@ Node* transform(Node *node) {
     node->args[i] = transform(arg);
   }
 
+  if (node->type == NODE_FUNCTION || node->type == NODE_FUNCTION_DECLARATION) {
+    node->pure = !node->generator && node_is_pure_function(node);
+  }
+
   switch (node->type) {
     case NODE_STATEMENT_FOR: {
       Node *init = node->args[0];
@@ -666,10 +1131,11 @@ Node* transform(Node *node) {
 
         Node *str = node_alloc(NODE_PRIMITIVE_STRING, 0);
         str->value = right->value;
+        str->atom = right->atom;
         free(right);
 
         node->type = NODE_OBJECT_MEMBER_ACCESS;
-        node->value = right->value;
+        node->value = str->value;
         node->children[1] = str;
 
         return node;
@@ -683,6 +1149,7 @@ Node* transform(Node *node) {
 
       Node *identifier = node_alloc(NODE_IDENTIFIER, 0);
       identifier->value = node->value;
+      identifier->atom = node->atom;
       new_node->value = node->value;
 
       new_node->children[0] = identifier;
@@ -698,9 +1165,11 @@ Node* transform(Node *node) {
   }
 }
 
-Node* parse(Token *token) {
+Node* parse_slots(Token *token, int *slots) {
   ParseState state;
   state.token = token;
+  state.slots = *slots;
+  state.generator = 0;
 
   Node *node = transform(parse_program(&state));
   if (state.token != NULL) {
@@ -708,9 +1177,15 @@ Node* parse(Token *token) {
     abort();
   }
 
+  *slots = state.slots;
   return node;
 }
 
+Node* parse(Token *token) {
+  int slots = 0;
+  return parse_slots(token, &slots);
+}
+
 
 void node_pp(Node *node) {
   int size = 0;
@@ -2,6 +2,7 @@
 #define MJS_PARSE_H
 
 #include "tokenize.h"
+#include "atom.h"
 
 #define NODE_ENUM(M) \
   M(PRIMITIVE_NUMBER) \
@@ -20,11 +21,22 @@
   M(STATEMENT_IF) \
   M(STATEMENT_WHILE) \
   M(STATEMENT_FOR) \
+  M(STATEMENT_FOR_IN) \
+  M(STATEMENT_FOR_OF) \
   M(VAR_DECLARATION) \
   M(VAR_ASSIGNMENT) \
   M(FUNCTION) \
   M(FUNCTION_CALL) \
   M(FUNCTION_DECLARATION) \
+  M(YIELD) \
+  M(PREFIX_UPDATE) \
+  M(POSTFIX_UPDATE) \
+  M(COMPOUND_ASSIGNMENT) \
+  M(STATEMENT_SWITCH) \
+  M(SWITCH_CASE) \
+  M(STATEMENT_BREAK) \
+  M(INLINE_CALL) \
+  M(INLINE_ARGUMENT) \
   M(STATEMENT_LIST)
 #define TO_ENUM(X) NODE_##X,
 #define TO_STRING(X) #X,
@@ -37,14 +49,64 @@ static const char *NodeTypeString[] = {
   NODE_ENUM(TO_STRING)
 };
 
+// how a switch statement finds the case it starts at, chosen from the labels when it is
+// parsed: small integer labels index a dense table, other integer and string labels are
+// hashed, and anything else is compared in order
+typedef enum SwitchDispatch {
+  SWITCH_DISPATCH_SEQUENTIAL,
+  SWITCH_DISPATCH_DENSE,
+  SWITCH_DISPATCH_HASH,
+} SwitchDispatch;
+
+typedef struct SwitchEntry {
+  // the atom of a string label, NULL for an integer label
+  struct Atom *atom;
+  int number;
+  // the first case with this label, -1 for an empty slot
+  int case_index;
+} SwitchEntry;
+
+typedef struct SwitchTable {
+  SwitchDispatch dispatch;
+  // the default case, or -1 when there is none
+  int default_case;
+  // SWITCH_DISPATCH_DENSE: cases[n - min] for labels min .. min + size - 1, -1 for no case.
+  // SWITCH_DISPATCH_HASH: entries, size is a power of two
+  int min;
+  unsigned int size;
+  int *cases;
+  SwitchEntry *entries;
+} SwitchTable;
+
 typedef struct Node {
   NodeType type;
   char *value;
+  // interned name of identifiers and string literals
+  struct Atom *atom;
   struct Node **args;
   struct Node **children;
+  // array or object literal whose elements are all literals (see node_is_constant)
+  int constant;
+  // function whose body only assigns its own variables and only calls pure Math
+  // functions (see node_is_pure_function), so calls to it may run on other threads
+  int pure;
+  // function* whose calls return a generator (see generator.h)
+  int generator;
+  // where an isolate keeps the evaluator's state for this node, e.g. the template a
+  // constant literal is copied from. numbered per program, -1 for nodes without state.
+  // the parameter index for NODE_INLINE_ARGUMENT
+  int slot;
+  // built by the parser for NODE_STATEMENT_SWITCH
+  SwitchTable *switch_table;
+  // built by inline_functions for NODE_INLINE_CALL
+  struct InlineCall *inline_call;
 } Node;
 
 Node* parse(Token *token);
+// like parse, numbering slots from *slots on. *slots is set to the next free slot, so
+// programs run by one isolate can be parsed one after another
+Node* parse_slots(Token *token, int *slots);
+SwitchEntry* switch_table_find(SwitchTable *table, struct Atom *atom, int number);
 void node_pp(Node *node);
 
 #endif
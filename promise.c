@@ -0,0 +1,287 @@
+#include "promise.h"
+#include "loop.h"
+#include "value.h"
+#include "object.h"
+#include "number.h"
+#include "string.h"
+#include "array.h"
+#include "function.h"
+#include "heap.h"
+#include "inspect.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RUNTIME_ERROR(...) \
+  fprintf(stderr, "runtime error: "); \
+  fprintf(stderr, __VA_ARGS__); \
+  fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
+  abort();
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+#define IS_FUNCTION(X) ((X) != NULL && PRIMITIVE_TYPE_IS(X, PRIMITIVE_FUNCTION))
+
+// Promise.all's promise and the values of its elements, filled in as they fulfill
+typedef struct PromiseAll {
+  Value *promise;
+  Value *values;
+  uint32_t remaining;
+} PromiseAll;
+
+// a reaction to run now that its promise settled
+typedef struct PromiseJob {
+  PromiseReaction *reaction;
+  PromiseState state;
+  Value *value;
+} PromiseJob;
+
+Value* value_promise_new(Isolate *isolate) {
+  Value *klass = env_get(isolate->binding.global, "Promise");
+  Value *object = value_object_create(value_object_get(klass, value_string_new("prototype")));
+
+  Promise *promise = calloc(1, sizeof(Promise));
+  promise->isolate = isolate;
+  promise->state = PROMISE_PENDING;
+  promise->last = &promise->reactions;
+
+  PrimitivePromise *primitive = heap_alloc(sizeof(PrimitivePromise));
+  primitive->type = PRIMITIVE_PROMISE;
+  primitive->flags = 0;
+  primitive->value = 0;
+  primitive->promise = promise;
+  object->primitive = heap_encode((Primitive*)primitive);
+  return object;
+}
+
+Promise* value_promise_unwrap(Value *v) {
+  if (v == NULL || !PRIMITIVE_TYPE_IS(v, PRIMITIVE_PROMISE)) return NULL;
+  return ((PrimitivePromise*)VALUE_PRIMITIVE(v))->promise;
+}
+
+Promise* promise_require(Value *v, const char *name) {
+  Promise *promise = value_promise_unwrap(v);
+  if (promise == NULL) {
+    RUNTIME_ERROR("%s called on %s, which is not a Promise", name, value_inspect(v));
+  }
+  return promise;
+}
+
+PromiseState value_promise_state(Value *v) {
+  return value_promise_unwrap(v)->state;
+}
+
+Value* value_promise_value(Value *v) {
+  return value_promise_unwrap(v)->value;
+}
+
+void promise_settle(Promise *promise, PromiseState state, Value *value);
+void promise_resolve_state(Value *object, Value *v);
+
+void promise_run_job(Env *env, void *data) {
+  PromiseJob *job = data;
+  PromiseReaction *reaction = job->reaction;
+  PromiseState state = job->state;
+  Value *value = job->value;
+  free(job);
+
+  if (reaction->all != NULL) {
+    PromiseAll *all = reaction->all;
+    if (state == PROMISE_REJECTED) {
+      promise_reject(all->promise, value);
+    } else {
+      value_array_set(all->values, value_number_new(reaction->index), value);
+      if (--all->remaining == 0) promise_resolve(all->promise, all->values);
+    }
+    free(reaction);
+    return;
+  }
+
+  Value *handler = state == PROMISE_FULFILLED ? reaction->on_fulfilled : reaction->on_rejected;
+  Value *derived = reaction->derived;
+  free(reaction);
+
+  // derived may already follow this promise, so it is settled without checking resolved
+  if (!IS_FUNCTION(handler)) {
+    if (state == PROMISE_FULFILLED) {
+      promise_resolve_state(derived, value);
+    } else {
+      promise_settle(value_promise_unwrap(derived), PROMISE_REJECTED, value);
+    }
+    return;
+  }
+
+  Value *result = evaluate_function_call(handler, value_undefined_new(), &value, 1, env);
+  promise_resolve_state(derived, result == NULL ? value_undefined_new() : result);
+}
+
+void promise_queue_job(Promise *promise, PromiseReaction *reaction) {
+  PromiseJob *job = malloc(sizeof(PromiseJob));
+  job->reaction = reaction;
+  job->state = promise->state;
+  job->value = promise->value;
+  loop_queue_microtask(promise->isolate, promise_run_job, job);
+}
+
+// runs reaction once the promise settles, or soon if it has
+void promise_react(Promise *promise, PromiseReaction *reaction) {
+  reaction->next = NULL;
+  if (promise->state != PROMISE_PENDING) {
+    promise_queue_job(promise, reaction);
+    return;
+  }
+
+  *promise->last = reaction;
+  promise->last = &reaction->next;
+}
+
+void promise_settle(Promise *promise, PromiseState state, Value *value) {
+  promise->resolved = 1;
+  promise->state = state;
+  promise->value = value;
+
+  PromiseReaction *reaction = promise->reactions;
+  promise->reactions = NULL;
+  promise->last = &promise->reactions;
+  while (reaction != NULL) {
+    PromiseReaction *next = reaction->next;
+    promise_queue_job(promise, reaction);
+    reaction = next;
+  }
+}
+
+// a promise resolved with another Promise follows it: it stays pending, but is resolved,
+// so a later resolve or reject does nothing
+void promise_resolve_state(Value *object, Value *v) {
+  Promise *promise = value_promise_unwrap(object);
+  Promise *other = value_promise_unwrap(v);
+  promise->resolved = 1;
+  if (other == NULL) {
+    promise_settle(promise, PROMISE_FULFILLED, v);
+    return;
+  }
+
+  if (other == promise) {
+    promise_settle(promise, PROMISE_REJECTED, value_string_new("a promise can't be resolved with itself"));
+    return;
+  }
+
+  PromiseReaction *reaction = calloc(1, sizeof(PromiseReaction));
+  reaction->derived = object;
+  promise_react(other, reaction);
+}
+
+void promise_resolve(Value *object, Value *v) {
+  Promise *promise = value_promise_unwrap(object);
+  if (promise->resolved) return;
+
+  promise_resolve_state(object, v);
+}
+
+void promise_reject(Value *object, Value *reason) {
+  Promise *promise = value_promise_unwrap(object);
+  if (promise->resolved) return;
+
+  promise_settle(promise, PROMISE_REJECTED, reason);
+}
+
+Value* promise_resolving_function_new(NativeFunction *fn, Value *promise) {
+  Value *f = value_function_native_new(fn);
+  ((PrimitiveFunction*)VALUE_PRIMITIVE(f))->bound = promise;
+  return f;
+}
+
+// the executor's resolve and reject only count the first time either is called
+Value* native_promise_resolve_function(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *promise = ((PrimitiveFunction*)VALUE_PRIMITIVE(isolate->callee))->bound;
+  promise_resolve(promise, size > 0 ? args[0] : value_undefined_new());
+  return value_undefined_new();
+}
+
+Value* native_promise_reject_function(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *promise = ((PrimitiveFunction*)VALUE_PRIMITIVE(isolate->callee))->bound;
+  promise_reject(promise, size > 0 ? args[0] : value_undefined_new());
+  return value_undefined_new();
+}
+
+// the executor runs right away, in the scope new Promise was called from
+Value* native_promise(Isolate *isolate, Value *this, int size, Value **args) {
+  if (size < 1 || !IS_FUNCTION(args[0])) {
+    RUNTIME_ERROR("Promise expects an executor function");
+  }
+
+  Env *env = isolate->env;
+  Value *promise = value_promise_new(isolate);
+  Value *resolving[] = {
+    promise_resolving_function_new(native_promise_resolve_function, promise),
+    promise_resolving_function_new(native_promise_reject_function, promise),
+  };
+  evaluate_function_call(args[0], value_undefined_new(), resolving, 2, env);
+  return promise;
+}
+
+Value* promise_then(Isolate *isolate, Value *this, Value *on_fulfilled, Value *on_rejected) {
+  Promise *promise = promise_require(this, "then");
+  PromiseReaction *reaction = calloc(1, sizeof(PromiseReaction));
+  reaction->on_fulfilled = on_fulfilled;
+  reaction->on_rejected = on_rejected;
+  reaction->derived = value_promise_new(isolate);
+  promise_react(promise, reaction);
+  return reaction->derived;
+}
+
+Value* native_promise_then(Isolate *isolate, Value *this, int size, Value **args) {
+  return promise_then(isolate, this, size > 0 ? args[0] : NULL, size > 1 ? args[1] : NULL);
+}
+
+Value* native_promise_catch(Isolate *isolate, Value *this, int size, Value **args) {
+  return promise_then(isolate, this, NULL, size > 0 ? args[0] : NULL);
+}
+
+// a Promise is returned as it is
+Value* promise_from(Isolate *isolate, Value *v) {
+  if (value_promise_unwrap(v) != NULL) return v;
+
+  Value *promise = value_promise_new(isolate);
+  promise_resolve(promise, v);
+  return promise;
+}
+
+Value* native_promise_resolve(Isolate *isolate, Value *this, int size, Value **args) {
+  return promise_from(isolate, size > 0 ? args[0] : value_undefined_new());
+}
+
+Value* native_promise_reject(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *promise = value_promise_new(isolate);
+  promise_reject(promise, size > 0 ? args[0] : value_undefined_new());
+  return promise;
+}
+
+// fulfills with the values of the elements in order once all have, or rejects with the
+// first rejection
+Value* native_promise_all(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *elements = size > 0 ? args[0] : NULL;
+  if (elements == NULL || !PRIMITIVE_TYPE_IS(elements, PRIMITIVE_ARRAY)) {
+    RUNTIME_ERROR("Promise.all expects an array");
+  }
+
+  uint32_t length = ((PrimitiveArray*)VALUE_PRIMITIVE(elements))->size;
+  PromiseAll *all = malloc(sizeof(PromiseAll));
+  all->promise = value_promise_new(isolate);
+  all->values = value_array_new(&isolate->binding);
+  all->remaining = length;
+  if (length == 0) {
+    promise_resolve(all->promise, all->values);
+    return all->promise;
+  }
+
+  for (uint32_t i = 0; i < length; i++) {
+    Value *element = value_array_get(elements, value_number_new(i));
+    Value *promise = promise_from(isolate, element == NULL ? value_undefined_new() : element);
+
+    PromiseReaction *reaction = calloc(1, sizeof(PromiseReaction));
+    reaction->all = all;
+    reaction->index = i;
+    promise_react(value_promise_unwrap(promise), reaction);
+  }
+
+  return all->promise;
+}
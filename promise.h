@@ -0,0 +1,68 @@
+#ifndef MJS_PROMISE_H
+#define MJS_PROMISE_H
+
+#include "value.h"
+
+// Promise: a value that is settled later, whose reactions run as microtasks of the loop
+// of the isolate that made it (see loop.h).
+//
+//   var p = new Promise(function (resolve, reject) { setTimeout(resolve, 10); });
+//   p.then(function (x) { return x + 1; }).then(function (y) { console.log(y); });
+//   Promise.all([fs.readFile('a'), fs.readFile('b')]).then(...);
+//
+// there is no throw, so a promise is only rejected by reject() or Promise.reject, and a
+// handler's result always fulfills the promise then() returned. resolving with another
+// Promise waits for it to settle, other objects are values like any.
+typedef enum PromiseState {
+  PROMISE_PENDING,
+  PROMISE_FULFILLED,
+  PROMISE_REJECTED
+} PromiseState;
+
+struct PromiseAll;
+
+typedef struct PromiseReaction {
+  // called with the value, or NULL to pass it on to derived as it is
+  Value *on_fulfilled;
+  Value *on_rejected;
+  // the Promise settled with what the handler returns
+  Value *derived;
+  // set for an element of Promise.all, whose value goes to index of its array instead
+  struct PromiseAll *all;
+  uint32_t index;
+  struct PromiseReaction *next;
+} PromiseReaction;
+
+typedef struct Promise {
+  Isolate *isolate;
+  PromiseState state;
+  // set once it settled, or follows another promise and waits for it to settle. a
+  // resolved promise ignores resolve and reject
+  int resolved;
+  Value *value;
+  // waiting for it to settle, in the order they were added
+  PromiseReaction *reactions;
+  PromiseReaction **last;
+} Promise;
+
+Value* value_promise_new(Isolate *isolate);
+// NULL unless v is a Promise
+Promise* value_promise_unwrap(Value *v);
+// do nothing to a promise that is resolved already
+void promise_resolve(Value *promise, Value *v);
+void promise_reject(Value *promise, Value *reason);
+// the promise's state and value, for inspect
+PromiseState value_promise_state(Value *v);
+Value* value_promise_value(Value *v);
+
+Value* native_promise(Isolate *isolate, Value *this, int size, Value **args);
+// the resolve and reject functions a Promise passes to its executor
+Value* native_promise_resolve_function(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_promise_reject_function(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_promise_then(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_promise_catch(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_promise_resolve(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_promise_reject(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_promise_all(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
@@ -0,0 +1,178 @@
+#include "reader.h"
+#include "value.h"
+#include "object.h"
+#include "string.h"
+#include "heap.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+
+LineReader* line_reader_new(int fd) {
+  LineReader *reader = calloc(1, sizeof(LineReader));
+  reader->fd = fd;
+  return reader;
+}
+
+void line_reader_add_view(LineReader *reader, Value *view) {
+  if (reader->view_size == reader->view_cap) {
+    reader->view_cap = reader->view_cap == 0 ? 16 : reader->view_cap * 2;
+    reader->views = realloc(reader->views, reader->view_cap * sizeof(Value*));
+  }
+  reader->views[reader->view_size++] = view;
+}
+
+void line_reader_remove_view(LineReader *reader, Value *view) {
+  // the view being replaced is the last one handed out, unless loops over the lines nest
+  for (int i = reader->view_size - 1; i >= 0; i--) {
+    if (reader->views[i] == view) {
+      reader->views[i] = reader->views[--reader->view_size];
+      return;
+    }
+  }
+}
+
+// reads more after the bytes of the current line, which are moved to the start of the
+// block, growing it when the line takes all of it
+void line_reader_fill(LineReader *reader) {
+  // the bytes of the views are about to be moved or read over
+  for (int i = 0; i < reader->view_size; i++) {
+    primitive_string_materialize((PrimitiveString*)VALUE_PRIMITIVE(reader->views[i]));
+  }
+  reader->view_size = 0;
+
+  if (reader->block == NULL) {
+    reader->cap = READER_BLOCK_SIZE;
+    reader->block = heap_alloc(reader->cap);
+  }
+
+  if (reader->start > 0) {
+    memmove(reader->block, reader->block + reader->start, reader->end - reader->start);
+    reader->scan -= reader->start;
+    reader->end -= reader->start;
+    reader->start = 0;
+  }
+
+  // a byte is kept for the NUL after a last line without a newline
+  if (reader->end + 1 == reader->cap) {
+    if (reader->cap > UINT32_MAX / 2) {
+      fprintf(stderr, "runtime error: line too long\n");
+      abort();
+    }
+
+    char *block = heap_alloc(reader->cap * 2);
+    memcpy(block, reader->block, reader->end);
+    heap_free(reader->block, reader->cap);
+    reader->block = block;
+    reader->cap *= 2;
+  }
+
+  ssize_t n;
+  do {
+    n = read(reader->fd, reader->block + reader->end, reader->cap - 1 - reader->end);
+  } while (n < 0 && errno == EINTR);
+
+  if (n < 0) perror("stdin");
+  if (n <= 0) {
+    reader->eof = 1;
+    return;
+  }
+  reader->end += n;
+}
+
+// finds the next line and ends it with a NUL in place of the newline, and of a \r
+// before it. 0 at the end
+int line_reader_find(LineReader *reader, uint32_t *start, uint32_t *length) {
+  while (1) {
+    char *newline = reader->block == NULL ? NULL : memchr(reader->block + reader->scan, '\n', reader->end - reader->scan);
+    uint32_t end;
+    if (newline != NULL) {
+      end = newline - reader->block;
+      *start = reader->start;
+      reader->start = reader->scan = end + 1;
+    } else if (reader->eof) {
+      if (reader->start == reader->end) return 0;
+      end = reader->end;
+      *start = reader->start;
+      reader->start = reader->scan = reader->end;
+    } else {
+      reader->scan = reader->end;
+      line_reader_fill(reader);
+      continue;
+    }
+
+    if (end > *start && reader->block[end - 1] == '\r') end--;
+    reader->block[end] = '\0';
+    *length = end - *start;
+    return 1;
+  }
+}
+
+Value* line_reader_read_line(LineReader *reader) {
+  uint32_t start, length;
+  if (!line_reader_find(reader, &start, &length)) return NULL;
+  return value_string_new_length(reader->block + start, length);
+}
+
+Value* line_reader_next_view(LineReader *reader, Value *previous) {
+  PrimitiveString *reused = NULL;
+  if (previous != NULL) {
+    PrimitiveString *s = (PrimitiveString*)VALUE_PRIMITIVE(previous);
+    int flags = PRIMITIVE_FLAG_VIEW | PRIMITIVE_FLAG_OWNED;
+    if ((s->flags & flags) == flags) {
+      line_reader_remove_view(reader, previous);
+      reused = s;
+    }
+  }
+
+  uint32_t start, length;
+  if (!line_reader_find(reader, &start, &length)) {
+    // still the value of the loop's variable
+    if (reused != NULL) line_reader_add_view(reader, previous);
+    return NULL;
+  }
+
+  Value *view = previous;
+  if (reused != NULL) {
+    reused->length = length;
+    reused->offset = start;
+    reused->chars = heap_encode(reader->block);
+    reused->atom = heap_encode(NULL);
+  } else {
+    view = value_string_new_view(reader->block, start, length);
+  }
+
+  line_reader_add_view(reader, view);
+  return view;
+}
+
+LineReader* value_line_iterator_unwrap(Value *v) {
+  if (v == NULL || !PRIMITIVE_TYPE_IS(v, PRIMITIVE_LINE_ITERATOR)) return NULL;
+  return ((PrimitiveLineIterator*)VALUE_PRIMITIVE(v))->reader;
+}
+
+LineReader* isolate_input(Isolate *isolate) {
+  if (isolate->input == NULL) isolate->input = line_reader_new(STDIN_FILENO);
+  return isolate->input;
+}
+
+Value* native_stdin_read_line(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *line = line_reader_read_line(isolate_input(isolate));
+  return line == NULL ? value_null_new() : line;
+}
+
+// an iterator for for...of, which reads the lines as it goes
+Value* native_stdin_lines(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *object = value_object_create(NULL);
+
+  PrimitiveLineIterator *primitive = heap_alloc(sizeof(PrimitiveLineIterator));
+  primitive->type = PRIMITIVE_LINE_ITERATOR;
+  primitive->flags = 0;
+  primitive->value = 0;
+  primitive->reader = isolate_input(isolate);
+  object->primitive = heap_encode((Primitive*)primitive);
+  return object;
+}
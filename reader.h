@@ -0,0 +1,57 @@
+#ifndef MJS_READER_H
+#define MJS_READER_H
+
+#include "value.h"
+#include <stdint.h>
+
+// reads lines from a file descriptor in blocks of at least READER_BLOCK_SIZE bytes,
+// found with memchr. stdin is read by the global stdin object of an isolate:
+//
+//   for (var line of stdin.lines()) { if (line === 'ok') { count++; } }
+//   var line = stdin.readLine();  // null at the end
+//
+// a line of stdin.lines() is a view: a string whose bytes are in the block, where the
+// newline was overwritten with the NUL that ends it (see PRIMITIVE_FLAG_VIEW). like a
+// number in a variable (PRIMITIVE_FLAG_OWNED), the view is owned by the loop's
+// variable until something else may hold on to it. an owned view is pointed at the next
+// line, so the loop allocates nothing for lines that are only compared or used as keys.
+// those that escaped are copied into strings of their own before the block is read
+// into again. readLine's lines are stored anywhere, so they are copies.
+//
+// the block grows for a line longer than it, and is otherwise read into over and over,
+// so the memory a loop over the lines takes does not depend on the size of the input.
+// a script read from stdin leaves nothing for it, so a script using stdin is given as
+// a file.
+#define READER_BLOCK_SIZE (256 * 1024)
+
+typedef struct LineReader {
+  int fd;
+  // heap_alloc'd, so that views can refer to it with compressed refs
+  char *block;
+  uint32_t cap;
+  // the next line starts at start, bytes up to end are read. scan is where the search
+  // for its newline goes on
+  uint32_t start;
+  uint32_t scan;
+  uint32_t end;
+  int eof;
+  // views into the block handed out since it was last read into
+  Value **views;
+  int view_size;
+  int view_cap;
+} LineReader;
+
+LineReader* line_reader_new(int fd);
+// the next line copied into a string, NULL at the end
+Value* line_reader_read_line(LineReader *reader);
+// the next line as a view, NULL at the end. previous is the view the caller got last,
+// which is pointed at the line if nothing else holds it
+Value* line_reader_next_view(LineReader *reader, Value *previous);
+
+// the LineReader of the iterator stdin.lines() returns, NULL for anything else
+LineReader* value_line_iterator_unwrap(Value *v);
+
+Value* native_stdin_read_line(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_stdin_lines(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
@@ -0,0 +1,114 @@
+#include "value.h"
+#include "string.h"
+#include "reader.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// a reader of the bytes written to a pipe, which is closed after them
+LineReader* reader_of(const char *input, size_t size) {
+  int fds[2];
+  assert(pipe(fds) == 0);
+  assert(write(fds[1], input, size) == (ssize_t)size);
+  close(fds[1]);
+  return line_reader_new(fds[0]);
+}
+
+// what reading a variable does to its value when the value may be kept
+void escape(Value *v) {
+  VALUE_PRIMITIVE(v)->flags &= ~PRIMITIVE_FLAG_OWNED;
+}
+
+int is_view(Value *v) {
+  return (VALUE_PRIMITIVE(v)->flags & PRIMITIVE_FLAG_VIEW) != 0;
+}
+
+void test_read_lines() {
+  const char *input = "one\r\ntwo\n\nlast";
+  LineReader *reader = reader_of(input, strlen(input));
+  const char *expected[] = { "one", "two", "", "last" };
+  for (int i = 0; i < 4; i++) {
+    Value *line = line_reader_read_line(reader);
+    assert(line != NULL && !is_view(line));
+    assert(strcmp(value_string_unwrap(line), expected[i]) == 0);
+  }
+  assert(line_reader_read_line(reader) == NULL);
+}
+
+// the loop's variable is pointed at each line in turn, until it escapes
+void test_views_are_reused() {
+  const char *input = "a\nbb\nccc\n";
+  LineReader *reader = reader_of(input, strlen(input));
+
+  Value *first = line_reader_next_view(reader, NULL);
+  assert(is_view(first) && strcmp(value_string_unwrap(first), "a") == 0);
+  Value *second = line_reader_next_view(reader, first);
+  assert(second == first && strcmp(value_string_unwrap(second), "bb") == 0);
+
+  escape(second);
+  Value *third = line_reader_next_view(reader, second);
+  assert(third != second && strcmp(value_string_unwrap(third), "ccc") == 0);
+  assert(strcmp(value_string_unwrap(second), "bb") == 0);
+  assert(line_reader_next_view(reader, third) == NULL);
+}
+
+// an escaped view is copied before the block is read into again
+void test_escaped_views_survive_refills() {
+  size_t size = 3 * READER_BLOCK_SIZE / 10 * 10;
+  char *input = malloc(size);
+  for (size_t i = 0; i < size; i++) input[i] = i % 10 == 9 ? '\n' : 'a' + i % 10;
+
+  // write from another process, since the pipe holds less than the input
+  int fds[2];
+  assert(pipe(fds) == 0);
+  if (fork() == 0) {
+    close(fds[0]);
+    assert(write(fds[1], input, size) == (ssize_t)size);
+    _exit(0);
+  }
+  close(fds[1]);
+  LineReader *reader = line_reader_new(fds[0]);
+
+  Value *kept = line_reader_next_view(reader, NULL);
+  escape(kept);
+  int count = 1;
+  Value *line = NULL;
+  while ((line = line_reader_next_view(reader, line)) != NULL) count++;
+
+  assert(count == (int)(size / 10));
+  assert(!is_view(kept) && strcmp(value_string_unwrap(kept), "abcdefghi") == 0);
+  free(input);
+}
+
+// the block grows for a line longer than it
+void test_long_line() {
+  size_t size = 2 * READER_BLOCK_SIZE + 1;
+  char *input = malloc(size + 1);
+  memset(input, 'x', size);
+  input[size] = '\n';
+
+  int fds[2];
+  assert(pipe(fds) == 0);
+  if (fork() == 0) {
+    close(fds[0]);
+    assert(write(fds[1], input, size + 1) == (ssize_t)(size + 1));
+    _exit(0);
+  }
+  close(fds[1]);
+  LineReader *reader = line_reader_new(fds[0]);
+
+  Value *line = line_reader_read_line(reader);
+  assert(line != NULL && strlen(value_string_unwrap(line)) == size);
+  assert(line_reader_read_line(reader) == NULL);
+  free(input);
+}
+
+int main() {
+  test_read_lines();
+  test_views_are_reused();
+  test_escaped_views_survive_refills();
+  test_long_line();
+  return 0;
+}
@@ -0,0 +1,346 @@
+#include "serve.h"
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "object.h"
+#include "string.h"
+#include "inspect.h"
+#include "inline.h"
+#include "heap.h"
+#include "loop.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define SERVE_HEADER_MAX 256
+#define SERVE_STATUS_ERROR 1
+// what a shell reports for a process killed by SIGABRT
+#define SERVE_STATUS_ABORTED (128 + SIGABRT)
+
+typedef struct ServeState {
+  Isolate *isolate;
+  // the first slot of request programs, after the prelude's
+  int slots;
+  int inline_calls;
+} ServeState;
+
+// the request a worker is running, for serve_abort
+typedef struct ServeRequest {
+  int fd;
+  FILE *out;
+  char *output;
+  size_t output_size;
+} ServeRequest;
+
+ServeRequest serve_current = { -1, NULL, NULL, 0 };
+volatile sig_atomic_t serve_stopping = 0;
+
+int serve_write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return -1;
+
+    data += n;
+    size -= n;
+  }
+
+  return 0;
+}
+
+int serve_read_all(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+
+    data += n;
+    size -= n;
+  }
+
+  return 0;
+}
+
+// reads a header line into header without the newline. -1 if the connection ends first
+// or the line is too long
+int serve_read_header(int fd, char *header) {
+  for (int i = 0; i < SERVE_HEADER_MAX - 1; i++) {
+    if (serve_read_all(fd, &header[i], 1) < 0) return -1;
+    if (header[i] == '\n') {
+      header[i] = '\0';
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+void serve_respond(int fd, int status, const char *output, size_t size) {
+  char header[SERVE_HEADER_MAX];
+  int length = snprintf(header, sizeof(header), "%d %zu\n", status, size);
+  if (serve_write_all(fd, header, length) == 0) serve_write_all(fd, output, size);
+}
+
+// a request failing with a runtime error aborts the worker. it answers with what the
+// request printed so far before it goes. errors abort from the evaluator, never from
+// inside stdio, so the output can be flushed here
+void serve_abort(int sig) {
+  if (serve_current.fd >= 0) {
+    fflush(serve_current.out);
+    serve_respond(serve_current.fd, SERVE_STATUS_ABORTED, serve_current.output, serve_current.output_size);
+  }
+
+  signal(SIGABRT, SIG_DFL);
+  raise(SIGABRT);
+}
+
+Node* serve_parse(char *source, int *slots, int inline_calls) {
+  Node *program = parse_slots(tokenize(source), slots);
+  if (inline_calls) inline_functions(program);
+  return program;
+}
+
+// runs the request in a scope of its own, writing what it prints to out. returns the status
+int serve_run(ServeState *state, const char *function, char *body, size_t length, FILE *out) {
+  Isolate *isolate = state->isolate;
+  isolate->out = out;
+  Env *env = env_new(isolate->binding.global);
+
+  int status = 0;
+  if (function != NULL) {
+    Value *f = env_get(env, function);
+    Primitive *primitive = f == NULL ? NULL : VALUE_PRIMITIVE(f);
+    if (primitive == NULL || primitive->type != PRIMITIVE_FUNCTION) {
+      fprintf(stderr, "serve: `%s` is not a function\n", function);
+      status = SERVE_STATUS_ERROR;
+    } else {
+      Value *args[] = { value_string_new_length(body, length) };
+      Value *result = evaluate_function_call(f, value_undefined_new(), args, 1, env);
+      if (result != NULL && result->kind != VALUE_KIND_UNDEFINED) fprintf(out, "%s\n", value_inspect(result));
+      loop_run(env);
+    }
+  } else {
+    int slots = state->slots;
+    evaluate_node(serve_parse(body, &slots, state->inline_calls), env);
+    loop_run(env);
+    isolate_clear_slots(isolate, state->slots);
+  }
+
+  // a return at the top of the request
+  isolate->returned = 0;
+  isolate->out = stdout;
+  return status;
+}
+
+void serve_connection(ServeState *state, int fd) {
+  char header[SERVE_HEADER_MAX];
+  if (serve_read_header(fd, header) < 0) return;
+
+  char function[SERVE_HEADER_MAX];
+  size_t length;
+  int is_call = 0;
+  if (sscanf(header, "call %255s %zu", function, &length) == 2) {
+    is_call = 1;
+  } else if (sscanf(header, "script %zu", &length) != 1) {
+    serve_respond(fd, SERVE_STATUS_ERROR, "", 0);
+    return;
+  }
+
+  char *body = malloc(length + 1);
+  if (serve_read_all(fd, body, length) < 0) {
+    free(body);
+    return;
+  }
+  body[length] = '\0';
+
+  serve_current.fd = fd;
+  serve_current.out = open_memstream(&serve_current.output, &serve_current.output_size);
+
+  int status = serve_run(state, is_call ? function : NULL, body, length, serve_current.out);
+
+  fclose(serve_current.out);
+  serve_respond(fd, status, serve_current.output, serve_current.output_size);
+  free(serve_current.output);
+  serve_current.fd = -1;
+  serve_current.out = NULL;
+  serve_current.output = NULL;
+  serve_current.output_size = 0;
+  free(body);
+}
+
+// answers requests until the worker has allocated SERVE_WORKER_HEAP_MAX, then exits
+void serve_worker(ServeState *state, int listener) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = serve_abort;
+  sigaction(SIGABRT, &action, NULL);
+
+  size_t heap_start = heap_used_bytes();
+  while (heap_used_bytes() - heap_start < SERVE_WORKER_HEAP_MAX) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0 && errno == EINTR) continue;
+    if (fd < 0) {
+      perror("serve: accept");
+      exit(EXIT_FAILURE);
+    }
+
+    serve_connection(state, fd);
+    close(fd);
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+pid_t serve_fork_worker(ServeState *state, int listener, sigset_t *worker_mask) {
+  // or the workers would print what the prelude left in the buffer again
+  fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid < 0) perror("serve: fork");
+  if (pid != 0) return pid;
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGCHLD, SIG_DFL);
+  sigprocmask(SIG_SETMASK, worker_mask, NULL);
+  serve_worker(state, listener);
+  return 0;
+}
+
+void serve_stop(int sig) {
+  serve_stopping = 1;
+}
+
+// interrupts sigsuspend when a worker exits
+void serve_child(int sig) {
+}
+
+int serve_listen(const char *socket_path) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "serve: socket path is too long: %s\n", socket_path);
+    return -1;
+  }
+  strcpy(address.sun_path, socket_path);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    perror("serve: socket");
+    return -1;
+  }
+
+  unlink(socket_path);
+  if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+    perror("serve: bind");
+    close(listener);
+    return -1;
+  }
+
+  return listener;
+}
+
+int serve(const char *socket_path, int workers, char *prelude, int inline_calls) {
+  ServeState state;
+  state.isolate = isolate_new(stdout);
+  state.slots = 0;
+  state.inline_calls = inline_calls;
+  if (prelude != NULL) evaluate(state.isolate, serve_parse(prelude, &state.slots, inline_calls));
+
+  int listener = serve_listen(socket_path);
+  if (listener < 0) return EXIT_FAILURE;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = serve_stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  action.sa_handler = serve_child;
+  sigaction(SIGCHLD, &action, NULL);
+
+  // the signals are only taken in sigsuspend, so none is missed between the checks
+  sigset_t mask, worker_mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, &worker_mask);
+
+  pid_t *pids = malloc(workers * sizeof(pid_t));
+  for (int i = 0; i < workers; i++) pids[i] = serve_fork_worker(&state, listener, &worker_mask);
+
+  while (!serve_stopping) {
+    // workers that exited are replaced by fresh forks of the initialized server
+    pid_t pid;
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+      for (int i = 0; i < workers; i++) {
+        if (pids[i] == pid) pids[i] = serve_fork_worker(&state, listener, &worker_mask);
+      }
+    }
+
+    if (!serve_stopping) sigsuspend(&worker_mask);
+  }
+
+  for (int i = 0; i < workers; i++) {
+    if (pids[i] > 0) kill(pids[i], SIGTERM);
+  }
+  for (int i = 0; i < workers; i++) {
+    if (pids[i] > 0) waitpid(pids[i], NULL, 0);
+  }
+
+  close(listener);
+  unlink(socket_path);
+  free(pids);
+  return EXIT_SUCCESS;
+}
+
+int serve_request(const char *socket_path, const char *function, const char *body, size_t length) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    perror("connect");
+    return EXIT_FAILURE;
+  }
+
+  char header[SERVE_HEADER_MAX];
+  int header_length = function == NULL ?
+    snprintf(header, sizeof(header), "script %zu\n", length) :
+    snprintf(header, sizeof(header), "call %s %zu\n", function, length);
+  if (header_length >= SERVE_HEADER_MAX || (function != NULL && strpbrk(function, " \n") != NULL)) {
+    fprintf(stderr, "connect: invalid function name: %s\n", function);
+    close(fd);
+    return EXIT_FAILURE;
+  }
+
+  int status;
+  size_t size;
+  if (serve_write_all(fd, header, header_length) < 0 || serve_write_all(fd, body, length) < 0 ||
+      serve_read_header(fd, header) < 0 || sscanf(header, "%d %zu", &status, &size) != 2) {
+    fprintf(stderr, "connect: no response from %s\n", socket_path);
+    close(fd);
+    return EXIT_FAILURE;
+  }
+
+  char *output = malloc(size);
+  if (serve_read_all(fd, output, size) < 0) {
+    fprintf(stderr, "connect: response from %s ended early\n", socket_path);
+    status = EXIT_FAILURE;
+  } else {
+    fwrite(output, 1, size, stdout);
+  }
+
+  free(output);
+  close(fd);
+  return status;
+}
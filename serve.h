@@ -0,0 +1,35 @@
+#ifndef MJS_SERVE_H
+#define MJS_SERVE_H
+
+#include <stddef.h>
+
+// --serve: a pool of worker processes answering requests on a Unix socket.
+//
+// the server parses and runs the prelude once, then forks the workers, which share the
+// initialized heap copy-on-write. a worker runs each request in a scope of its own on top
+// of the prelude's globals, so `var` in one request is not seen by the next. objects the
+// prelude made, such as the prototypes, are shared by the requests a worker runs.
+//
+// a request is a header line and a body of the given length:
+//
+//   script <length>\n<source>       runs the source
+//   call <name> <length>\n<input>   calls the global function name with the input string,
+//                                   printing what it returns unless that is undefined
+//
+// and the response is the exit status and what the request printed:
+//
+//   <status> <length>\n<stdout>
+//
+// the status is 0, 1 for a malformed request or a missing function, and 134 when the
+// request aborted with an error. a worker that aborted, or has allocated more than
+// SERVE_WORKER_HEAP_MAX, exits and the server forks a fresh one.
+#define SERVE_WORKER_HEAP_MAX ((size_t)256 << 20)
+
+// runs until SIGINT or SIGTERM. prelude may be NULL
+int serve(const char *socket_path, int workers, char *prelude, int inline_calls);
+
+// --connect: sends a script request, or a call request when function is not NULL,
+// writes what it printed to stdout and returns its status
+int serve_request(const char *socket_path, const char *function, const char *body, size_t length);
+
+#endif
@@ -0,0 +1,664 @@
+#include "snapshot.h"
+#include "hash.h"
+#include "dict.h"
+#include "array.h"
+#include "string.h"
+#include "builtin.h"
+#include "inline.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_MAGIC "mjssnap"
+#define SNAPSHOT_VERSION 2
+
+// refs hold offsets in HEAP_ALIGNMENT units when they are compressed
+#ifdef MJS_COMPRESSED_REFS
+#define SNAPSHOT_REF_UNIT HEAP_ALIGNMENT
+#else
+#define SNAPSHOT_REF_UNIT 1
+#endif
+
+// what a relocation entry patches, in its low SNAPSHOT_RELOC_BITS. the rest is the
+// offset of the field in the file
+typedef enum SnapshotReloc {
+  // a pointer holding an offset in the file
+  SNAPSHOT_RELOC_POINTER,
+  // a HEAP_REF holding an offset in the file, in SNAPSHOT_REF_UNIT
+  SNAPSHOT_RELOC_REF,
+  // an Atom* holding the number of an atom of the file
+  SNAPSHOT_RELOC_ATOM_POINTER,
+  // a HEAP_REF(Atom) holding the number of an atom of the file
+  SNAPSHOT_RELOC_ATOM_REF,
+  // a native function or entry point holding its builtin_native_index
+  SNAPSHOT_RELOC_NATIVE,
+} SnapshotReloc;
+
+#define SNAPSHOT_RELOC_BITS 3
+#define SNAPSHOT_RELOC_MASK ((1 << SNAPSHOT_RELOC_BITS) - 1)
+
+// at the start of the file, and mapped with the rest of it
+typedef struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  // a file only loads in a build with the same refs and natives
+  uint32_t ref_size;
+  uint32_t natives;
+  int32_t slots;
+  uint64_t hash_seed[2];
+  uint64_t size;
+  // offsets of an array of the atoms' offsets, and of the relocation entries
+  uint64_t atoms;
+  uint64_t atom_count;
+  uint64_t relocs;
+  uint64_t reloc_count;
+  // relocated like the references in the objects
+  Binding binding;
+} SnapshotHeader;
+
+typedef enum SnapshotKind {
+  SNAPSHOT_VALUE,
+  SNAPSHOT_PRIMITIVE,
+  SNAPSHOT_DICT,
+  SNAPSHOT_HASH_TABLE,
+  SNAPSHOT_ENV,
+  SNAPSHOT_NODE,
+  // a NULL-terminated Node*[]
+  SNAPSHOT_NODE_LIST,
+  SNAPSHOT_SWITCH_TABLE,
+  SNAPSHOT_INLINE_CALL,
+  // a NUL-terminated string
+  SNAPSHOT_CHARS,
+  SNAPSHOT_ATOM,
+} SnapshotKind;
+
+typedef struct SnapshotObject {
+  const void *p;
+  SnapshotKind kind;
+  // where it is in the file. the number of an atom
+  uint64_t offset;
+} SnapshotObject;
+
+typedef struct SnapshotWriter {
+  char *image;
+  size_t size;
+  size_t cap;
+  uint64_t *relocs;
+  size_t reloc_count;
+  size_t reloc_cap;
+  // offsets of the atoms by number
+  uint64_t *atoms;
+  size_t atom_count;
+  size_t atom_cap;
+  // objects in the file by address and kind. open addressing, at most half full
+  SnapshotObject *seen;
+  size_t seen_count;
+  size_t seen_cap;
+  // objects copied to the file whose references are not written yet
+  SnapshotObject *pending;
+  size_t pending_count;
+  size_t pending_cap;
+  int failed;
+} SnapshotWriter;
+
+void* snapshot_grow(void *items, size_t *cap, size_t count, size_t item_size) {
+  if (count < *cap) return items;
+
+  *cap = *cap == 0 ? 64 : *cap * 2;
+  return realloc(items, *cap * item_size);
+}
+
+// zeroed room for size bytes at the end of the file, returning its offset
+uint64_t snapshot_alloc(SnapshotWriter *w, size_t size) {
+  size_t rounded = (size + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+  if (w->size + rounded > w->cap) {
+    size_t cap = w->cap == 0 ? 4096 : w->cap;
+    while (cap < w->size + rounded) cap *= 2;
+    w->image = realloc(w->image, cap);
+    w->cap = cap;
+  }
+
+  uint64_t offset = w->size;
+  memset(w->image + offset, 0, rounded);
+  w->size += rounded;
+  return offset;
+}
+
+uint64_t snapshot_copy(SnapshotWriter *w, const void *p, size_t size) {
+  uint64_t offset = snapshot_alloc(w, size);
+  memcpy(w->image + offset, p, size);
+  return offset;
+}
+
+void snapshot_reloc(SnapshotWriter *w, uint64_t at, SnapshotReloc kind) {
+  w->relocs = snapshot_grow(w->relocs, &w->reloc_cap, w->reloc_count, sizeof(uint64_t));
+  w->relocs[w->reloc_count++] = at << SNAPSHOT_RELOC_BITS | kind;
+}
+
+void snapshot_write_pointer(SnapshotWriter *w, uint64_t at, uint64_t value) {
+  uintptr_t pointer = value;
+  memcpy(w->image + at, &pointer, sizeof(pointer));
+}
+
+void snapshot_write_ref(SnapshotWriter *w, uint64_t at, uint64_t value) {
+  HEAP_REF(void) ref = (HEAP_REF(void))(uintptr_t)value;
+  memcpy(w->image + at, &ref, sizeof(ref));
+}
+
+// the fields are overwritten whether or not they point anywhere, so that nothing of
+// the writing process is left in the file
+void snapshot_set_pointer(SnapshotWriter *w, uint64_t at, uint64_t target) {
+  snapshot_write_pointer(w, at, target);
+  if (target != 0) snapshot_reloc(w, at, SNAPSHOT_RELOC_POINTER);
+}
+
+void snapshot_set_ref(SnapshotWriter *w, uint64_t at, uint64_t target) {
+  snapshot_write_ref(w, at, target / SNAPSHOT_REF_UNIT);
+  if (target != 0) snapshot_reloc(w, at, SNAPSHOT_RELOC_REF);
+}
+
+size_t snapshot_object_size(const void *p, SnapshotKind kind) {
+  switch (kind) {
+    case SNAPSHOT_VALUE: return sizeof(Value);
+    case SNAPSHOT_DICT: return sizeof(Dict);
+    case SNAPSHOT_HASH_TABLE: return sizeof(HashTable);
+    case SNAPSHOT_ENV: return sizeof(Env);
+    case SNAPSHOT_NODE: return sizeof(Node);
+    case SNAPSHOT_SWITCH_TABLE: return sizeof(SwitchTable);
+    case SNAPSHOT_INLINE_CALL: return sizeof(InlineCall);
+    case SNAPSHOT_CHARS: return strlen(p) + 1;
+    case SNAPSHOT_ATOM: return sizeof(Atom) + ((const Atom*)p)->length + 1;
+
+    case SNAPSHOT_NODE_LIST: {
+      size_t size = 0;
+      while (((Node* const*)p)[size] != NULL) size++;
+      return (size + 1) * sizeof(Node*);
+    }
+
+    case SNAPSHOT_PRIMITIVE: {
+      switch (((const Primitive*)p)->type) {
+        case PRIMITIVE_STRING: return sizeof(PrimitiveString);
+        case PRIMITIVE_ARRAY: return sizeof(PrimitiveArray);
+        case PRIMITIVE_FUNCTION: return sizeof(PrimitiveFunction);
+        case PRIMITIVE_ARRAY_BUFFER: return sizeof(PrimitiveArrayBuffer);
+        case PRIMITIVE_TYPED_ARRAY: return sizeof(PrimitiveTypedArray);
+        case PRIMITIVE_WORKER: return sizeof(PrimitiveWorker);
+        case PRIMITIVE_PROMISE: return sizeof(PrimitivePromise);
+        case PRIMITIVE_GENERATOR: return sizeof(PrimitiveGenerator);
+        case PRIMITIVE_LINE_ITERATOR: return sizeof(PrimitiveLineIterator);
+        default: return sizeof(Primitive);
+      }
+    }
+  }
+
+  return 0;
+}
+
+SnapshotObject* snapshot_seen_slot(SnapshotWriter *w, const void *p, SnapshotKind kind) {
+  size_t mask = w->seen_cap - 1;
+  uint64_t h = ((uintptr_t)p >> 3) * 0x9e3779b97f4a7c15ULL + kind;
+  for (size_t i = (h ^ (h >> 32)) & mask; ; i = (i + 1) & mask) {
+    SnapshotObject *slot = &w->seen[i];
+    if (slot->p == NULL || (slot->p == p && slot->kind == kind)) return slot;
+  }
+}
+
+void snapshot_seen_resize(SnapshotWriter *w) {
+  SnapshotObject *old = w->seen;
+  size_t old_cap = w->seen_cap;
+
+  w->seen_cap = old_cap == 0 ? 1024 : old_cap * 2;
+  w->seen = calloc(w->seen_cap, sizeof(SnapshotObject));
+  for (size_t i = 0; i < old_cap; i++) {
+    if (old[i].p != NULL) *snapshot_seen_slot(w, old[i].p, old[i].kind) = old[i];
+  }
+
+  free(old);
+}
+
+// the offset of the object in the file. the first time, it is copied there and its
+// references are queued to be written, so that deep structures don't recurse
+uint64_t snapshot_object(SnapshotWriter *w, const void *p, SnapshotKind kind) {
+  if (p == NULL) return 0;
+
+  if ((w->seen_count + 1) * 2 > w->seen_cap) snapshot_seen_resize(w);
+  SnapshotObject *slot = snapshot_seen_slot(w, p, kind);
+  if (slot->p != NULL) return slot->offset;
+
+  // ropes are written flat, the file has no use for their halves
+  if (kind == SNAPSHOT_PRIMITIVE && ((const Primitive*)p)->type == PRIMITIVE_STRING) {
+    primitive_string_flatten((PrimitiveString*)p);
+  }
+
+  SnapshotObject object = { p, kind, snapshot_copy(w, p, snapshot_object_size(p, kind)) };
+  if (kind == SNAPSHOT_ATOM) {
+    w->atoms = snapshot_grow(w->atoms, &w->atom_cap, w->atom_count, sizeof(uint64_t));
+    w->atoms[w->atom_count] = object.offset;
+    object.offset = w->atom_count++;
+  } else {
+    w->pending = snapshot_grow(w->pending, &w->pending_cap, w->pending_count, sizeof(SnapshotObject));
+    w->pending[w->pending_count++] = object;
+  }
+
+  *slot = object;
+  w->seen_count++;
+  return object.offset;
+}
+
+void snapshot_set_atom_pointer(SnapshotWriter *w, uint64_t at, Atom *atom) {
+  snapshot_write_pointer(w, at, atom == NULL ? 0 : snapshot_object(w, atom, SNAPSHOT_ATOM));
+  if (atom != NULL) snapshot_reloc(w, at, SNAPSHOT_RELOC_ATOM_POINTER);
+}
+
+void snapshot_set_atom_ref(SnapshotWriter *w, uint64_t at, Atom *atom) {
+  snapshot_write_ref(w, at, atom == NULL ? 0 : snapshot_object(w, atom, SNAPSHOT_ATOM));
+  if (atom != NULL) snapshot_reloc(w, at, SNAPSHOT_RELOC_ATOM_REF);
+}
+
+void snapshot_set_native(SnapshotWriter *w, uint64_t at, void *native) {
+  int index = builtin_native_index(native);
+  if (native != NULL && index < 0) {
+    fprintf(stderr, "snapshot: a native function is not in the builtin table\n");
+    w->failed = 1;
+  }
+
+  snapshot_write_pointer(w, at, index < 0 ? 0 : index);
+  if (index >= 0) snapshot_reloc(w, at, SNAPSHOT_RELOC_NATIVE);
+}
+
+#define FIELD(TYPE, FIELD) (at + offsetof(TYPE, FIELD))
+
+void snapshot_fill_array(SnapshotWriter *w, uint64_t at, PrimitiveArray *array) {
+  size_t element_size = array->kind == ARRAY_KIND_PACKED_DOUBLE ? sizeof(double) :
+    array->kind == ARRAY_KIND_DICTIONARY ? sizeof(ArraySparseEntry) : sizeof(HEAP_REF(Value));
+
+  // elements shared with a literal template are given to the array in the file
+  unsigned int cap = array->cap;
+  if (cap == 0) {
+    cap = 8;
+    while (cap < array->size) cap *= 2;
+    memcpy(w->image + FIELD(PrimitiveArray, cap), &cap, sizeof(cap));
+  }
+
+  uint64_t elements = snapshot_alloc(w, cap * element_size);
+  switch (array->kind) {
+    case ARRAY_KIND_PACKED_DOUBLE: {
+      memcpy(w->image + elements, heap_decode(array->elements), array->size * sizeof(double));
+      break;
+    }
+
+    case ARRAY_KIND_PACKED:
+    case ARRAY_KIND_HOLEY: {
+      HEAP_REF(Value) *values = heap_decode(array->elements);
+      for (unsigned int i = 0; i < array->size; i++) {
+        snapshot_set_ref(w, elements + i * element_size, snapshot_object(w, HEAP_GET(Value, values[i]), SNAPSHOT_VALUE));
+      }
+      break;
+    }
+
+    case ARRAY_KIND_DICTIONARY: {
+      ArraySparseEntry *entries = heap_decode(array->elements);
+      for (unsigned int i = 0; i < array->cap; i++) {
+        Value *value = HEAP_GET(Value, entries[i].value);
+        if (value == NULL) continue;
+
+        uint64_t entry = elements + i * element_size;
+        memcpy(w->image + entry + offsetof(ArraySparseEntry, index), &entries[i].index, sizeof(uint32_t));
+        snapshot_set_ref(w, entry + offsetof(ArraySparseEntry, value), snapshot_object(w, value, SNAPSHOT_VALUE));
+      }
+      break;
+    }
+  }
+
+  snapshot_set_ref(w, FIELD(PrimitiveArray, elements), elements);
+}
+
+void snapshot_fill_primitive(SnapshotWriter *w, uint64_t at, Primitive *primitive) {
+  switch (primitive->type) {
+    case PRIMITIVE_STRING: {
+      PrimitiveString *s = (PrimitiveString*)primitive;
+      char *chars = HEAP_GET(char, s->chars);
+      snapshot_set_ref(w, FIELD(PrimitiveString, chars), chars == NULL ? 0 : snapshot_copy(w, chars, s->offset + s->length + 1));
+      snapshot_set_atom_ref(w, FIELD(PrimitiveString, atom), HEAP_GET(Atom, s->atom));
+      snapshot_set_ref(w, FIELD(PrimitiveString, left), snapshot_object(w, HEAP_GET(Primitive, s->left), SNAPSHOT_PRIMITIVE));
+      snapshot_set_ref(w, FIELD(PrimitiveString, right), snapshot_object(w, HEAP_GET(Primitive, s->right), SNAPSHOT_PRIMITIVE));
+      break;
+    }
+
+    case PRIMITIVE_ARRAY: {
+      snapshot_fill_array(w, at, (PrimitiveArray*)primitive);
+      break;
+    }
+
+    case PRIMITIVE_ARRAY_BUFFER: {
+      PrimitiveArrayBuffer *buffer = (PrimitiveArrayBuffer*)primitive;
+      size_t size = buffer->byte_length == 0 ? HEAP_ALIGNMENT : buffer->byte_length;
+      snapshot_set_ref(w, FIELD(PrimitiveArrayBuffer, data), snapshot_copy(w, HEAP_GET(char, buffer->data), size));
+      break;
+    }
+
+    case PRIMITIVE_TYPED_ARRAY: {
+      PrimitiveTypedArray *array = (PrimitiveTypedArray*)primitive;
+      snapshot_set_ref(w, FIELD(PrimitiveTypedArray, buffer), snapshot_object(w, HEAP_GET(Value, array->buffer), SNAPSHOT_VALUE));
+      break;
+    }
+
+    case PRIMITIVE_WORKER: {
+      // its thread is not part of the heap
+      fprintf(stderr, "snapshot: a Worker can't be saved\n");
+      w->failed = 1;
+      break;
+    }
+
+    case PRIMITIVE_PROMISE: {
+      // its reactions are jobs of the loop that made it
+      fprintf(stderr, "snapshot: a Promise can't be saved\n");
+      w->failed = 1;
+      break;
+    }
+
+    case PRIMITIVE_GENERATOR: {
+      // where its body stopped is on the stack of its coroutine
+      fprintf(stderr, "snapshot: a generator can't be saved\n");
+      w->failed = 1;
+      break;
+    }
+
+    case PRIMITIVE_LINE_ITERATOR: {
+      // the reader and the position in stdin are not part of the heap
+      fprintf(stderr, "snapshot: stdin.lines() can't be saved\n");
+      w->failed = 1;
+      break;
+    }
+
+    case PRIMITIVE_FUNCTION: {
+      PrimitiveFunction *function = (PrimitiveFunction*)primitive;
+      snapshot_set_pointer(w, FIELD(PrimitiveFunction, name), snapshot_object(w, function->name, SNAPSHOT_CHARS));
+      snapshot_set_pointer(w, FIELD(PrimitiveFunction, node), snapshot_object(w, function->node, SNAPSHOT_NODE));
+      snapshot_set_pointer(w, FIELD(PrimitiveFunction, bound), snapshot_object(w, function->bound, SNAPSHOT_VALUE));
+      snapshot_set_native(w, FIELD(PrimitiveFunction, fn), (void*)function->fn);
+      // the entry is only set for natives that have one
+      snapshot_set_native(w, FIELD(PrimitiveFunction, entry), function->arity < 0 ? NULL : (void*)function->entry.fn0);
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+}
+
+void snapshot_fill_dict(SnapshotWriter *w, uint64_t at, Dict *dict) {
+  uint8_t *storage = heap_decode(dict->storage);
+  if (storage == NULL) return;
+
+  size_t size = dict_storage_size(dict->cap);
+  uint64_t copy = snapshot_copy(w, storage, size);
+  DictEntry *entries = dict_entries(dict);
+  uint64_t entries_at = copy + ((uint8_t*)entries - storage);
+
+  // entries past used are not written yet
+  size_t usable = (copy + size - entries_at) / sizeof(DictEntry);
+  memset(w->image + entries_at + dict->used * sizeof(DictEntry), 0, (usable - dict->used) * sizeof(DictEntry));
+
+  for (unsigned int i = 0; i < dict->used; i++) {
+    uint64_t entry = entries_at + i * sizeof(DictEntry);
+    Atom *key = HEAP_GET(Atom, entries[i].key);
+    Value *value = key == NULL ? NULL : HEAP_GET(Value, entries[i].value);
+    snapshot_set_atom_ref(w, entry + offsetof(DictEntry, key), key);
+    snapshot_set_ref(w, entry + offsetof(DictEntry, value), snapshot_object(w, value, SNAPSHOT_VALUE));
+  }
+
+  snapshot_set_ref(w, FIELD(Dict, storage), copy);
+}
+
+void snapshot_fill_hash_table(SnapshotWriter *w, uint64_t at, HashTable *hash) {
+  uint8_t *ctrl = heap_decode(hash->ctrl);
+  if (ctrl == NULL) return;
+
+  uint64_t copy = snapshot_copy(w, ctrl, hash_table_storage_size(hash->cap));
+  // the entries follow cap + HASH_GROUP_WIDTH control bytes
+  HashTableEntry *entries = (HashTableEntry*)(ctrl + hash->cap + HASH_GROUP_WIDTH);
+  uint64_t entries_at = copy + hash->cap + HASH_GROUP_WIDTH;
+
+  for (unsigned int i = 0; i < hash->cap; i++) {
+    uint64_t entry = entries_at + i * sizeof(HashTableEntry);
+    int full = (ctrl[i] & HASH_CTRL_EMPTY) == 0;
+    snapshot_set_atom_ref(w, entry + offsetof(HashTableEntry, key), full ? HEAP_GET(Atom, entries[i].key) : NULL);
+    // values of scopes are values, or NULL for a `this` that was cleared
+    Value *value = full ? HEAP_GET(Value, entries[i].value) : NULL;
+    snapshot_set_ref(w, entry + offsetof(HashTableEntry, value), snapshot_object(w, value, SNAPSHOT_VALUE));
+  }
+
+  snapshot_set_ref(w, FIELD(HashTable, ctrl), copy);
+}
+
+void snapshot_fill_switch_table(SnapshotWriter *w, uint64_t at, SwitchTable *table) {
+  uint64_t cases = table->cases == NULL ? 0 : snapshot_copy(w, table->cases, table->size * sizeof(int));
+  snapshot_set_pointer(w, FIELD(SwitchTable, cases), cases);
+
+  uint64_t entries = 0;
+  if (table->entries != NULL) {
+    entries = snapshot_copy(w, table->entries, table->size * sizeof(SwitchEntry));
+    for (unsigned int i = 0; i < table->size; i++) {
+      SwitchEntry *entry = &table->entries[i];
+      snapshot_set_atom_pointer(w, entries + i * sizeof(SwitchEntry) + offsetof(SwitchEntry, atom),
+        entry->case_index < 0 ? NULL : entry->atom);
+    }
+  }
+  snapshot_set_pointer(w, FIELD(SwitchTable, entries), entries);
+}
+
+// writes the references of an object copied to the file
+void snapshot_fill(SnapshotWriter *w, SnapshotObject *object) {
+  uint64_t at = object->offset;
+
+  switch (object->kind) {
+    case SNAPSHOT_VALUE: {
+      const Value *v = object->p;
+      snapshot_set_ref(w, FIELD(Value, primitive), snapshot_object(w, VALUE_PRIMITIVE(v), SNAPSHOT_PRIMITIVE));
+      snapshot_set_ref(w, FIELD(Value, table), snapshot_object(w, VALUE_TABLE(v), SNAPSHOT_DICT));
+      snapshot_set_ref(w, FIELD(Value, proto), snapshot_object(w, VALUE_PROTO(v), SNAPSHOT_VALUE));
+      break;
+    }
+
+    case SNAPSHOT_PRIMITIVE: {
+      snapshot_fill_primitive(w, at, (Primitive*)object->p);
+      break;
+    }
+
+    case SNAPSHOT_DICT: {
+      snapshot_fill_dict(w, at, (Dict*)object->p);
+      break;
+    }
+
+    case SNAPSHOT_HASH_TABLE: {
+      snapshot_fill_hash_table(w, at, (HashTable*)object->p);
+      break;
+    }
+
+    case SNAPSHOT_ENV: {
+      const Env *env = object->p;
+      snapshot_set_pointer(w, FIELD(Env, table), snapshot_object(w, env->table, SNAPSHOT_HASH_TABLE));
+      snapshot_set_pointer(w, FIELD(Env, parent), snapshot_object(w, env->parent, SNAPSHOT_ENV));
+      // set by isolate_restore
+      snapshot_set_pointer(w, FIELD(Env, isolate), 0);
+      break;
+    }
+
+    case SNAPSHOT_NODE: {
+      const Node *node = object->p;
+      snapshot_set_pointer(w, FIELD(Node, value), snapshot_object(w, node->value, SNAPSHOT_CHARS));
+      snapshot_set_atom_pointer(w, FIELD(Node, atom), node->atom);
+      snapshot_set_pointer(w, FIELD(Node, args), snapshot_object(w, node->args, SNAPSHOT_NODE_LIST));
+      snapshot_set_pointer(w, FIELD(Node, children), snapshot_object(w, node->children, SNAPSHOT_NODE_LIST));
+      snapshot_set_pointer(w, FIELD(Node, switch_table), snapshot_object(w, node->switch_table, SNAPSHOT_SWITCH_TABLE));
+      snapshot_set_pointer(w, FIELD(Node, inline_call), snapshot_object(w, node->inline_call, SNAPSHOT_INLINE_CALL));
+      break;
+    }
+
+    case SNAPSHOT_NODE_LIST: {
+      Node* const *list = object->p;
+      for (size_t i = 0; list[i] != NULL; i++) {
+        snapshot_set_pointer(w, at + i * sizeof(Node*), snapshot_object(w, list[i], SNAPSHOT_NODE));
+      }
+      break;
+    }
+
+    case SNAPSHOT_SWITCH_TABLE: {
+      snapshot_fill_switch_table(w, at, (SwitchTable*)object->p);
+      break;
+    }
+
+    case SNAPSHOT_INLINE_CALL: {
+      const InlineCall *call = object->p;
+      snapshot_set_pointer(w, FIELD(InlineCall, function), snapshot_object(w, call->function, SNAPSHOT_NODE));
+      snapshot_set_pointer(w, FIELD(InlineCall, body), snapshot_object(w, call->body, SNAPSHOT_NODE));
+      break;
+    }
+
+    case SNAPSHOT_CHARS:
+    case SNAPSHOT_ATOM: {
+      break;
+    }
+  }
+}
+
+int snapshot_write(Isolate *isolate, int slots, const char *path) {
+  SnapshotWriter w;
+  memset(&w, 0, sizeof(w));
+
+  uint64_t at = snapshot_alloc(&w, sizeof(SnapshotHeader));
+  Binding *binding = &isolate->binding;
+  snapshot_set_pointer(&w, FIELD(SnapshotHeader, binding.global), snapshot_object(&w, binding->global, SNAPSHOT_ENV));
+  snapshot_set_pointer(&w, FIELD(SnapshotHeader, binding.object_prototype), snapshot_object(&w, binding->object_prototype, SNAPSHOT_VALUE));
+  snapshot_set_pointer(&w, FIELD(SnapshotHeader, binding.array_prototype), snapshot_object(&w, binding->array_prototype, SNAPSHOT_VALUE));
+  snapshot_set_pointer(&w, FIELD(SnapshotHeader, binding.generator_prototype), snapshot_object(&w, binding->generator_prototype, SNAPSHOT_VALUE));
+
+  while (w.pending_count > 0) {
+    SnapshotObject object = w.pending[--w.pending_count];
+    snapshot_fill(&w, &object);
+  }
+
+  uint64_t atoms = snapshot_copy(&w, w.atoms, w.atom_count * sizeof(uint64_t));
+  uint64_t relocs = snapshot_copy(&w, w.relocs, w.reloc_count * sizeof(uint64_t));
+
+  SnapshotHeader *header = (SnapshotHeader*)w.image;
+  memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+  header->version = SNAPSHOT_VERSION;
+  header->ref_size = sizeof(HEAP_REF(void));
+  header->natives = builtin_native_count();
+  header->slots = slots;
+  hash_seed_get(header->hash_seed);
+  header->size = w.size;
+  header->atoms = atoms;
+  header->atom_count = w.atom_count;
+  header->relocs = relocs;
+  header->reloc_count = w.reloc_count;
+
+  FILE *fp = w.failed ? NULL : fopen(path, "wb");
+  if (!w.failed && (fp == NULL || fwrite(w.image, 1, w.size, fp) != w.size)) {
+    perror(path);
+    w.failed = 1;
+  }
+  if (fp != NULL && fclose(fp) != 0 && !w.failed) {
+    perror(path);
+    w.failed = 1;
+  }
+
+  free(w.image);
+  free(w.relocs);
+  free(w.atoms);
+  free(w.seen);
+  free(w.pending);
+  return w.failed ? -1 : 0;
+}
+
+Isolate* snapshot_load(const char *path, FILE *out, int *slots) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return NULL;
+  }
+
+  SnapshotHeader header;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.size != (uint64_t)st.st_size) {
+    fprintf(stderr, "snapshot: %s is not a snapshot\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  if (header.version != SNAPSHOT_VERSION || header.ref_size != sizeof(HEAP_REF(void)) ||
+      header.natives != (uint32_t)builtin_native_count()) {
+    fprintf(stderr, "snapshot: %s was written by another build\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  if (hash_seed_adopt(header.hash_seed) < 0) {
+    fprintf(stderr, "snapshot: %s is loaded after strings were hashed with another seed\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  char *base = heap_map_file(fd, header.size);
+  close(fd);
+  if (base == NULL) {
+    perror(path);
+    return NULL;
+  }
+
+  // atoms equal to ones interned before are replaced by those
+  uint64_t *atoms = (uint64_t*)(base + header.atoms);
+  Atom **interned = malloc((header.atom_count + 1) * sizeof(Atom*));
+  for (uint64_t i = 0; i < header.atom_count; i++) {
+    interned[i] = atom_adopt((Atom*)(base + atoms[i]));
+  }
+
+  uintptr_t ref_base = (uintptr_t)heap_encode(base);
+  uint64_t *relocs = (uint64_t*)(base + header.relocs);
+  for (uint64_t i = 0; i < header.reloc_count; i++) {
+    char *field = base + (relocs[i] >> SNAPSHOT_RELOC_BITS);
+
+    switch (relocs[i] & SNAPSHOT_RELOC_MASK) {
+      case SNAPSHOT_RELOC_POINTER: {
+        *(uintptr_t*)field += (uintptr_t)base;
+        break;
+      }
+
+      case SNAPSHOT_RELOC_REF: {
+        HEAP_REF(void) *ref = (HEAP_REF(void)*)field;
+        *ref = (HEAP_REF(void))((uintptr_t)*ref + ref_base);
+        break;
+      }
+
+      case SNAPSHOT_RELOC_ATOM_POINTER: {
+        Atom **atom = (Atom**)field;
+        *atom = interned[(uintptr_t)*atom];
+        break;
+      }
+
+      case SNAPSHOT_RELOC_ATOM_REF: {
+        HEAP_REF(Atom) *ref = (HEAP_REF(Atom)*)field;
+        *ref = heap_encode(interned[(uintptr_t)*ref]);
+        break;
+      }
+
+      case SNAPSHOT_RELOC_NATIVE: {
+        void **native = (void**)field;
+        *native = builtin_native((uintptr_t)*native);
+        break;
+      }
+    }
+  }
+  free(interned);
+
+  SnapshotHeader *mapped = (SnapshotHeader*)base;
+  *slots = mapped->slots;
+  return isolate_restore(&mapped->binding, out);
+}
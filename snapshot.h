@@ -0,0 +1,29 @@
+#ifndef MJS_SNAPSHOT_H
+#define MJS_SNAPSHOT_H
+
+#include "value.h"
+#include <stdio.h>
+
+// --snapshot: the heap of an isolate that ran a prelude, saved to a file that
+// --load-snapshot maps back instead of running the prelude again.
+//
+// the file is an image of everything reachable from the isolate's globals: values with
+// their tables, elements and strings, the atoms, and the parsed functions. references in
+// it are offsets from the start of the file, and a relocation table lists where they are.
+// loading maps the file copy-on-write, in the heap region with compressed refs, adopts
+// its atoms into the atom table, and walks the relocation table once to add the address
+// the file was mapped at. natives are named by builtin_native_index.
+//
+// atom hashes depend on the seed, so the file keeps the seed it was written with and is
+// loaded before anything else is hashed. the file only fits the build that wrote it.
+//
+// the evaluator's state of nodes is not kept: programs run on a loaded snapshot are
+// parsed with parse_slots from the slot it returns.
+
+// returns 0, or -1 after printing why the file could not be written
+int snapshot_write(Isolate *isolate, int slots, const char *path);
+// NULL after printing why the file could not be loaded. *slots is set to the first
+// slot after the prelude's
+Isolate* snapshot_load(const char *path, FILE *out, int *slots);
+
+#endif
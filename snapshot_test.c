@@ -0,0 +1,104 @@
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "inline.h"
+#include "snapshot.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// a prelude leaving every kind of value in the globals
+char *prelude =
+  "function add(a, b) { return a + b; }"
+  "function name(n) {"
+  "  switch (n) { case 1: return 'one'; case 'two': return 'two'; default: return 'many'; }"
+  "}"
+  "var point = { x: 1, y: 2 };"
+  "var pair = [point, 'a'];"
+  "var doubles = [3, 4];"
+  "var sparse = [];"
+  "sparse[5000] = 7;"
+  "var bytes = new Uint8Array(4);"
+  "bytes[1] = 9;"
+  "var rope = 'abcdefghijklmnop';"
+  "for (var i = 0; i < 4; i++) { rope = rope + 'abcdefghijklmnop'; }"
+  "Array.prototype.first = function () { return this[0]; };";
+
+char *script =
+  "console.log(add(point.x, point.y), name(1), name('two'), name(3));"
+  "var head = pair[0];"
+  "console.log(head.y, pair.first(), doubles, sparse[5000], sparse.length);"
+  "console.log(bytes[1], bytes.length, rope.length, [4, 5].first());"
+  "pair.push(3);"
+  "point.z = 3;"
+  "console.log(pair.length, Object.keys(point), Math.max(add(1, 2), 2));";
+
+char* run(Isolate *isolate, Node *program) {
+  char *output;
+  size_t size;
+  FILE *out = open_memstream(&output, &size);
+  isolate->out = out;
+  evaluate(isolate, program);
+  fclose(out);
+  isolate->out = stdout;
+  return output;
+}
+
+Node* parse_source(char *source, int *slots) {
+  Node *program = parse_slots(tokenize(source), slots);
+  inline_functions(program);
+  return program;
+}
+
+void test_snapshot_runs_like_prelude() {
+  char path[] = "/tmp/mjs-snapshot-test.XXXXXX";
+  close(mkstemp(path));
+
+  int slots = 0;
+  Isolate *isolate = isolate_new(stdout);
+  free(run(isolate, parse_source(prelude, &slots)));
+  assert(snapshot_write(isolate, slots, path) == 0);
+
+  // the prelude and the script in one isolate
+  Node *program = parse_source(script, &slots);
+  char *expected = run(isolate, program);
+
+  // atoms of the file are the ones interned already, so this loads like a second
+  // snapshot in the same process would
+  int loaded_slots;
+  Isolate *loaded = snapshot_load(path, stdout, &loaded_slots);
+  assert(loaded != NULL);
+  assert(loaded_slots < slots);
+  char *output = run(loaded, parse_source(script, &loaded_slots));
+  assert(strcmp(output, expected) == 0);
+  free(output);
+
+  // each load is a copy of its own
+  loaded = snapshot_load(path, stdout, &loaded_slots);
+  output = run(loaded, parse_source(script, &loaded_slots));
+  assert(strcmp(output, expected) == 0);
+  free(output);
+
+  free(expected);
+  unlink(path);
+}
+
+void test_snapshot_rejects_other_files() {
+  char path[] = "/tmp/mjs-snapshot-test.XXXXXX";
+  int fd = mkstemp(path);
+  assert(write(fd, "var x = 1;", 10) == 10);
+  close(fd);
+
+  int slots;
+  assert(snapshot_load(path, stdout, &slots) == NULL);
+  assert(snapshot_load("/nonexistent/mjs.snap", stdout, &slots) == NULL);
+  unlink(path);
+}
+
+int main(int argc, char const **argv) {
+  test_snapshot_runs_like_prelude();
+  test_snapshot_rejects_other_files();
+  return 0;
+}
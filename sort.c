@@ -0,0 +1,497 @@
+#include "sort.h"
+#include <stdint.h>
+#include <string.h>
+
+#define SORT_INSERTION_THRESHOLD 24
+#define SORT_NINTHER_THRESHOLD 128
+#define SORT_PARTIAL_INSERTION_LIMIT 8
+#define SORT_BLOCK_SIZE 64
+
+int sort_log2(size_t n) {
+  int log = 0;
+  while (n >>= 1) log++;
+  return log;
+}
+
+// doubles
+
+void sort_swap_doubles(double *a, double *b) {
+  double tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+void sort2_doubles(double *a, double *b) {
+  double x = *a;
+  double y = *b;
+  *a = y < x ? y : x;
+  *b = y < x ? x : y;
+}
+
+void sort3_doubles(double *a, double *b, double *c) {
+  sort2_doubles(a, b);
+  sort2_doubles(b, c);
+  sort2_doubles(a, b);
+}
+
+void sort_insertion_doubles(double *begin, double *end) {
+  if (begin == end) return;
+
+  for (double *cur = begin + 1; cur != end; cur++) {
+    double tmp = *cur;
+    double *sift = cur;
+    while (sift != begin && tmp < sift[-1]) {
+      *sift = sift[-1];
+      sift--;
+    }
+    *sift = tmp;
+  }
+}
+
+// the element before begin is known to be no greater than any element in the range
+void sort_unguarded_insertion_doubles(double *begin, double *end) {
+  if (begin == end) return;
+
+  for (double *cur = begin + 1; cur != end; cur++) {
+    double tmp = *cur;
+    double *sift = cur;
+    while (tmp < sift[-1]) {
+      *sift = sift[-1];
+      sift--;
+    }
+    *sift = tmp;
+  }
+}
+
+// gives up after moving SORT_PARTIAL_INSERTION_LIMIT elements. returns 1 if the range got sorted
+int sort_partial_insertion_doubles(double *begin, double *end) {
+  if (begin == end) return 1;
+
+  size_t limit = 0;
+  for (double *cur = begin + 1; cur != end; cur++) {
+    double tmp = *cur;
+    double *sift = cur;
+    while (sift != begin && tmp < sift[-1]) {
+      *sift = sift[-1];
+      sift--;
+    }
+    *sift = tmp;
+
+    limit += cur - sift;
+    if (limit > SORT_PARTIAL_INSERTION_LIMIT) return 0;
+  }
+
+  return 1;
+}
+
+void sort_heap_sift_doubles(double *items, size_t root, size_t size) {
+  double tmp = items[root];
+  for (size_t child = root * 2 + 1; child < size; child = root * 2 + 1) {
+    if (child + 1 < size && items[child] < items[child + 1]) child++;
+    if (!(tmp < items[child])) break;
+
+    items[root] = items[child];
+    root = child;
+  }
+  items[root] = tmp;
+}
+
+void sort_heap_doubles(double *begin, double *end) {
+  size_t size = end - begin;
+  for (size_t i = size / 2; i-- > 0; ) sort_heap_sift_doubles(begin, i, size);
+  for (size_t i = size; i-- > 1; ) {
+    sort_swap_doubles(&begin[0], &begin[i]);
+    sort_heap_sift_doubles(begin, 0, i);
+  }
+}
+
+// moves the elements found at the given offsets from both sides across
+void sort_swap_offsets_doubles(double *first, double *last, unsigned char *offsets_l, unsigned char *offsets_r, size_t num, int use_swaps) {
+  if (use_swaps) {
+    // when the counts match, the cyclic permutation below would not be correct
+    for (size_t i = 0; i < num; i++) {
+      sort_swap_doubles(first + offsets_l[i], last - offsets_r[i]);
+    }
+  } else if (num > 0) {
+    double *l = first + offsets_l[0];
+    double *r = last - offsets_r[0];
+    double tmp = *l;
+    *l = *r;
+    for (size_t i = 1; i < num; i++) {
+      l = first + offsets_l[i];
+      *r = *l;
+      r = last - offsets_r[i];
+      *l = *r;
+    }
+    *r = tmp;
+  }
+}
+
+// partitions around *begin into [< pivot] pivot [>= pivot] and returns the pivot position.
+// the comparisons of a block are recorded as offsets first and the swaps done
+// afterwards, so there is no branch on the comparison result to mispredict.
+double* sort_partition_right_doubles(double *begin, double *end, int *already_partitioned) {
+  double pivot = *begin;
+  double *first = begin;
+  double *last = end;
+
+  // the median-of-3 guarantees an element >= pivot at the end
+  while (*++first < pivot) ;
+
+  if (first - 1 == begin) {
+    while (first < last && !(*--last < pivot)) ;
+  } else {
+    while (!(*--last < pivot)) ;
+  }
+
+  *already_partitioned = first >= last;
+  if (!*already_partitioned) {
+    sort_swap_doubles(first, last);
+    first++;
+
+    unsigned char offsets_l[SORT_BLOCK_SIZE];
+    unsigned char offsets_r[SORT_BLOCK_SIZE];
+    double *offsets_l_base = first;
+    double *offsets_r_base = last;
+    size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+    while (first < last) {
+      size_t num_unknown = last - first;
+      size_t left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+      size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+      if (left_split > SORT_BLOCK_SIZE) left_split = SORT_BLOCK_SIZE;
+      for (size_t i = 0; i < left_split; i++) {
+        offsets_l[num_l] = i;
+        num_l += !(*first < pivot);
+        first++;
+      }
+
+      if (right_split > SORT_BLOCK_SIZE) right_split = SORT_BLOCK_SIZE;
+      for (size_t i = 0; i < right_split; ) {
+        offsets_r[num_r] = ++i;
+        num_r += *--last < pivot;
+      }
+
+      size_t num = num_l < num_r ? num_l : num_r;
+      sort_swap_offsets_doubles(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+      num_l -= num;
+      num_r -= num;
+      start_l += num;
+      start_r += num;
+
+      if (num_l == 0) {
+        start_l = 0;
+        offsets_l_base = first;
+      }
+
+      if (num_r == 0) {
+        start_r = 0;
+        offsets_r_base = last;
+      }
+    }
+
+    // one side may have leftover elements that belong to the other side
+    if (num_l) {
+      while (num_l--) sort_swap_doubles(offsets_l_base + offsets_l[start_l + num_l], --last);
+      first = last;
+    }
+
+    if (num_r) {
+      while (num_r--) {
+        sort_swap_doubles(offsets_r_base - offsets_r[start_r + num_r], first);
+        first++;
+      }
+      last = first;
+    }
+  }
+
+  double *pivot_pos = first - 1;
+  *begin = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+// partitions into [== pivot] [> pivot]. used when the pivot equals the element before the
+// range, which means the range has many equal elements; they are then done in linear time.
+double* sort_partition_left_doubles(double *begin, double *end) {
+  double pivot = *begin;
+  double *first = begin;
+  double *last = end;
+
+  while (pivot < *--last) ;
+
+  if (last + 1 == end) {
+    while (first < last && !(pivot < *++first)) ;
+  } else {
+    while (!(pivot < *++first)) ;
+  }
+
+  while (first < last) {
+    sort_swap_doubles(first, last);
+    while (pivot < *--last) ;
+    while (!(pivot < *++first)) ;
+  }
+
+  double *pivot_pos = last;
+  *begin = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+// swaps a few elements around after an unbalanced partition, to break the pattern
+void sort_shuffle_doubles(double *begin, double *end, double *pivot_pos) {
+  size_t l_size = pivot_pos - begin;
+  size_t r_size = end - (pivot_pos + 1);
+
+  if (l_size >= SORT_INSERTION_THRESHOLD) {
+    sort_swap_doubles(begin, begin + l_size / 4);
+    sort_swap_doubles(pivot_pos - 1, pivot_pos - l_size / 4);
+    if (l_size > SORT_NINTHER_THRESHOLD) {
+      sort_swap_doubles(begin + 1, begin + (l_size / 4 + 1));
+      sort_swap_doubles(begin + 2, begin + (l_size / 4 + 2));
+      sort_swap_doubles(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+      sort_swap_doubles(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+    }
+  }
+
+  if (r_size >= SORT_INSERTION_THRESHOLD) {
+    sort_swap_doubles(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+    sort_swap_doubles(end - 1, end - r_size / 4);
+    if (r_size > SORT_NINTHER_THRESHOLD) {
+      sort_swap_doubles(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+      sort_swap_doubles(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+      sort_swap_doubles(end - 2, end - (1 + r_size / 4));
+      sort_swap_doubles(end - 3, end - (2 + r_size / 4));
+    }
+  }
+}
+
+void sort_loop_doubles(double *begin, double *end, int bad_allowed, int leftmost) {
+  while (1) {
+    size_t size = end - begin;
+    if (size < SORT_INSERTION_THRESHOLD) {
+      if (leftmost) {
+        sort_insertion_doubles(begin, end);
+      } else {
+        sort_unguarded_insertion_doubles(begin, end);
+      }
+      return;
+    }
+
+    size_t s2 = size / 2;
+    if (size > SORT_NINTHER_THRESHOLD) {
+      sort3_doubles(begin, begin + s2, end - 1);
+      sort3_doubles(begin + 1, begin + (s2 - 1), end - 2);
+      sort3_doubles(begin + 2, begin + (s2 + 1), end - 3);
+      sort3_doubles(begin + (s2 - 1), begin + s2, begin + (s2 + 1));
+      sort_swap_doubles(begin, begin + s2);
+    } else {
+      sort3_doubles(begin + s2, begin, end - 1);
+    }
+
+    if (!leftmost && !(begin[-1] < *begin)) {
+      begin = sort_partition_left_doubles(begin, end) + 1;
+      continue;
+    }
+
+    int already_partitioned;
+    double *pivot_pos = sort_partition_right_doubles(begin, end, &already_partitioned);
+
+    size_t l_size = pivot_pos - begin;
+    size_t r_size = end - (pivot_pos + 1);
+    if (l_size < size / 8 || r_size < size / 8) {
+      if (--bad_allowed == 0) {
+        sort_heap_doubles(begin, end);
+        return;
+      }
+
+      sort_shuffle_doubles(begin, end, pivot_pos);
+    } else if (already_partitioned &&
+               sort_partial_insertion_doubles(begin, pivot_pos) &&
+               sort_partial_insertion_doubles(pivot_pos + 1, end)) {
+      return;
+    }
+
+    sort_loop_doubles(begin, pivot_pos, bad_allowed, leftmost);
+    begin = pivot_pos + 1;
+    leftmost = 0;
+  }
+}
+
+void sort_doubles(double *items, size_t size) {
+  // NaN is unordered, so it is moved out of the way first
+  size_t n = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (items[i] == items[i]) sort_swap_doubles(&items[n++], &items[i]);
+  }
+
+  sort_loop_doubles(items, items + n, sort_log2(n) + 1, 1);
+}
+
+// pointers. the same algorithm, with bounds checks and without the block partition:
+// a compare that calls into a script costs far more than a mispredicted branch.
+
+#define SORT_LESS(A, B) (compare((A), (B), data) < 0)
+
+void sort_swap_pointers(void **a, void **b) {
+  void *tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+void sort3_pointers(void **a, void **b, void **c, SortCompare *compare, void *data) {
+  if (SORT_LESS(*b, *a)) sort_swap_pointers(a, b);
+  if (SORT_LESS(*c, *b)) sort_swap_pointers(b, c);
+  if (SORT_LESS(*b, *a)) sort_swap_pointers(a, b);
+}
+
+// returns 0 when limited and more than SORT_PARTIAL_INSERTION_LIMIT elements had to move
+int sort_insertion_pointers(void **begin, void **end, int limited, SortCompare *compare, void *data) {
+  if (begin == end) return 1;
+
+  size_t limit = 0;
+  for (void **cur = begin + 1; cur != end; cur++) {
+    void *tmp = *cur;
+    void **sift = cur;
+    while (sift != begin && SORT_LESS(tmp, sift[-1])) {
+      *sift = sift[-1];
+      sift--;
+    }
+    *sift = tmp;
+
+    limit += cur - sift;
+    if (limited && limit > SORT_PARTIAL_INSERTION_LIMIT) return 0;
+  }
+
+  return 1;
+}
+
+void sort_heap_sift_pointers(void **items, size_t root, size_t size, SortCompare *compare, void *data) {
+  void *tmp = items[root];
+  for (size_t child = root * 2 + 1; child < size; child = root * 2 + 1) {
+    if (child + 1 < size && SORT_LESS(items[child], items[child + 1])) child++;
+    if (!SORT_LESS(tmp, items[child])) break;
+
+    items[root] = items[child];
+    root = child;
+  }
+  items[root] = tmp;
+}
+
+void sort_heap_pointers(void **begin, void **end, SortCompare *compare, void *data) {
+  size_t size = end - begin;
+  for (size_t i = size / 2; i-- > 0; ) sort_heap_sift_pointers(begin, i, size, compare, data);
+  for (size_t i = size; i-- > 1; ) {
+    sort_swap_pointers(&begin[0], &begin[i]);
+    sort_heap_sift_pointers(begin, 0, i, compare, data);
+  }
+}
+
+void** sort_partition_right_pointers(void **begin, void **end, int *already_partitioned, SortCompare *compare, void *data) {
+  void *pivot = *begin;
+  void **first = begin;
+  void **last = end;
+
+  do first++; while (first < end && SORT_LESS(*first, pivot));
+  do last--; while (last > begin && last >= first && !SORT_LESS(*last, pivot));
+
+  *already_partitioned = first >= last;
+  while (first < last) {
+    sort_swap_pointers(first, last);
+    do first++; while (first < end && SORT_LESS(*first, pivot));
+    do last--; while (last > begin && !SORT_LESS(*last, pivot));
+  }
+
+  void **pivot_pos = first - 1;
+  *begin = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+void** sort_partition_left_pointers(void **begin, void **end, SortCompare *compare, void *data) {
+  void *pivot = *begin;
+  void **first = begin;
+  void **last = end;
+
+  do last--; while (last > begin && SORT_LESS(pivot, *last));
+  do first++; while (first < last && !SORT_LESS(pivot, *first));
+
+  while (first < last) {
+    sort_swap_pointers(first, last);
+    do last--; while (last > begin && SORT_LESS(pivot, *last));
+    do first++; while (first < end && !SORT_LESS(pivot, *first));
+  }
+
+  void **pivot_pos = last;
+  *begin = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+void sort_shuffle_pointers(void **begin, void **end, void **pivot_pos) {
+  size_t l_size = pivot_pos - begin;
+  size_t r_size = end - (pivot_pos + 1);
+
+  if (l_size >= SORT_INSERTION_THRESHOLD) {
+    sort_swap_pointers(begin, begin + l_size / 4);
+    sort_swap_pointers(pivot_pos - 1, pivot_pos - l_size / 4);
+  }
+
+  if (r_size >= SORT_INSERTION_THRESHOLD) {
+    sort_swap_pointers(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+    sort_swap_pointers(end - 1, end - r_size / 4);
+  }
+}
+
+void sort_loop_pointers(void **begin, void **end, int bad_allowed, int leftmost, SortCompare *compare, void *data) {
+  while (1) {
+    size_t size = end - begin;
+    if (size < SORT_INSERTION_THRESHOLD) {
+      sort_insertion_pointers(begin, end, 0, compare, data);
+      return;
+    }
+
+    size_t s2 = size / 2;
+    if (size > SORT_NINTHER_THRESHOLD) {
+      sort3_pointers(begin, begin + s2, end - 1, compare, data);
+      sort3_pointers(begin + 1, begin + (s2 - 1), end - 2, compare, data);
+      sort3_pointers(begin + 2, begin + (s2 + 1), end - 3, compare, data);
+      sort3_pointers(begin + (s2 - 1), begin + s2, begin + (s2 + 1), compare, data);
+      sort_swap_pointers(begin, begin + s2);
+    } else {
+      sort3_pointers(begin + s2, begin, end - 1, compare, data);
+    }
+
+    if (!leftmost && !SORT_LESS(begin[-1], *begin)) {
+      begin = sort_partition_left_pointers(begin, end, compare, data) + 1;
+      continue;
+    }
+
+    int already_partitioned;
+    void **pivot_pos = sort_partition_right_pointers(begin, end, &already_partitioned, compare, data);
+
+    size_t l_size = pivot_pos - begin;
+    size_t r_size = end - (pivot_pos + 1);
+    if (l_size < size / 8 || r_size < size / 8) {
+      if (--bad_allowed == 0) {
+        sort_heap_pointers(begin, end, compare, data);
+        return;
+      }
+
+      sort_shuffle_pointers(begin, end, pivot_pos);
+    } else if (already_partitioned &&
+               sort_insertion_pointers(begin, pivot_pos, 1, compare, data) &&
+               sort_insertion_pointers(pivot_pos + 1, end, 1, compare, data)) {
+      return;
+    }
+
+    sort_loop_pointers(begin, pivot_pos, bad_allowed, leftmost, compare, data);
+    begin = pivot_pos + 1;
+    leftmost = 0;
+  }
+}
+
+void sort_pointers(void **items, size_t size, SortCompare *compare, void *data) {
+  sort_loop_pointers(items, items + size, sort_log2(size) + 1, 1, compare, data);
+}
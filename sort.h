@@ -0,0 +1,24 @@
+#ifndef MJS_SORT_H
+#define MJS_SORT_H
+
+#include <stddef.h>
+
+// pattern-defeating quicksort (pdqsort).
+//
+// quicksort with a median-of-3 (ninther for large ranges) pivot, insertion sort for
+// short ranges, and heapsort once too many partitions came out unbalanced, so the
+// worst case is O(n log n). already sorted runs are detected and finished with a
+// bounded insertion sort. the sort is not stable.
+
+// returns < 0 when a sorts before b
+typedef int (SortCompare)(void *a, void *b, void *data);
+
+// ascending. partitions in blocks without branching on the comparison result.
+// NaN sorts last.
+void sort_doubles(double *items, size_t size);
+
+// every scan is bounds checked, so an inconsistent compare (a script comparator)
+// leaves the order unspecified but stays in range
+void sort_pointers(void **items, size_t size, SortCompare *compare, void *data);
+
+#endif
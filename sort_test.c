@@ -0,0 +1,156 @@
+#include "sort.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+int compare_ints(void *a, void *b, void *data) {
+  int x = *(int*)a;
+  int y = *(int*)b;
+  return (x > y) - (x < y);
+}
+
+// answers at random, like a broken script comparator
+int compare_random(void *a, void *b, void *data) {
+  return rand() % 3 - 1;
+}
+
+typedef enum Pattern {
+  PATTERN_RANDOM,
+  PATTERN_SORTED,
+  PATTERN_REVERSED,
+  PATTERN_FEW_VALUES,
+  PATTERN_ORGAN_PIPE,
+  PATTERN_SORTED_TAIL,
+  PATTERN_COUNT,
+} Pattern;
+
+double pattern_value(Pattern pattern, size_t i, size_t size) {
+  switch (pattern) {
+    case PATTERN_RANDOM: return rand() - RAND_MAX / 2;
+    case PATTERN_SORTED: return i;
+    case PATTERN_REVERSED: return size - i;
+    case PATTERN_FEW_VALUES: return rand() % 4;
+    case PATTERN_ORGAN_PIPE: return i < size / 2 ? i : size - i;
+    case PATTERN_SORTED_TAIL: return i < size - 8 ? i : rand();
+    default: return 0;
+  }
+}
+
+void test_sort_doubles() {
+  size_t sizes[] = { 0, 1, 2, 3, 23, 24, 25, 100, 129, 1000, 10000, 100000 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t size = sizes[s];
+    double *items = malloc((size + 1) * sizeof(double));
+    double *expected = malloc((size + 1) * sizeof(double));
+
+    for (Pattern pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+      srand(size * PATTERN_COUNT + pattern);
+      for (size_t i = 0; i < size; i++) items[i] = pattern_value(pattern, i, size);
+
+      memcpy(expected, items, size * sizeof(double));
+      qsort(expected, size, sizeof(double), compare_doubles);
+
+      sort_doubles(items, size);
+      assert(memcmp(items, expected, size * sizeof(double)) == 0);
+    }
+
+    free(items);
+    free(expected);
+  }
+}
+
+void test_sort_doubles_nan() {
+  double items[] = { 3, NAN, 1, -INFINITY, NAN, 2 };
+  sort_doubles(items, 6);
+  assert(items[0] == -INFINITY);
+  assert(items[1] == 1 && items[2] == 2 && items[3] == 3);
+  assert(isnan(items[4]) && isnan(items[5]));
+}
+
+void test_sort_pointers() {
+  size_t size = 10000;
+  int *values = malloc(size * sizeof(int));
+  void **items = malloc(size * sizeof(void*));
+
+  for (Pattern pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+    srand(pattern);
+    for (size_t i = 0; i < size; i++) {
+      values[i] = pattern_value(pattern, i, size);
+      items[i] = &values[i];
+    }
+
+    sort_pointers(items, size, compare_ints, NULL);
+    for (size_t i = 1; i < size; i++) {
+      assert(*(int*)items[i - 1] <= *(int*)items[i]);
+    }
+  }
+
+  // an inconsistent compare scrambles the order but must keep every element
+  for (size_t i = 0; i < size; i++) {
+    values[i] = i;
+    items[i] = &values[i];
+  }
+  sort_pointers(items, size, compare_random, NULL);
+
+  char *seen = calloc(size, 1);
+  for (size_t i = 0; i < size; i++) {
+    int v = *(int*)items[i];
+    assert(!seen[v]);
+    seen[v] = 1;
+  }
+
+  free(seen);
+  free(values);
+  free(items);
+}
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void bench() {
+  const char *names[] = { "random", "sorted", "reversed", "few values", "organ pipe", "sorted tail" };
+  size_t size = 1000000;
+  double *items = malloc(size * sizeof(double));
+  double *copy = malloc(size * sizeof(double));
+
+  printf("%zu doubles\n", size);
+  for (Pattern pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+    srand(pattern);
+    for (size_t i = 0; i < size; i++) items[i] = pattern_value(pattern, i, size);
+    memcpy(copy, items, size * sizeof(double));
+
+    double start = bench_now();
+    sort_doubles(items, size);
+    double pdq = bench_now() - start;
+
+    start = bench_now();
+    qsort(copy, size, sizeof(double), compare_doubles);
+    double libc = bench_now() - start;
+
+    printf("  %-12s sort_doubles %7.2f ms   qsort %7.2f ms\n", names[pattern], pdq * 1e3, libc * 1e3);
+  }
+}
+
+int main(int argc, char const **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+    return 0;
+  }
+
+  test_sort_doubles();
+  test_sort_doubles_nan();
+  test_sort_pointers();
+  return 0;
+}
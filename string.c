@@ -1,27 +1,354 @@
 #include "value.h"
 #include "object.h"
+#include "number.h"
+#include "array.h"
 #include "string.h"
+#include "typed_array.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-Value* value_string_new(const char *s) {
-  Value *v = value_object_create(NULL);
-  PrimitiveString *primitive = malloc(sizeof(PrimitiveString));
+// concatenations shorter than this are copied right away, a rope node would not pay off
+#define STRING_MIN_ROPE_LENGTH 13
+
+#define STRING_UNWRAP(X) ((PrimitiveString*)VALUE_PRIMITIVE(X))
+
+PrimitiveString* primitive_string_init(uint32_t length) {
+  PrimitiveString *primitive = heap_alloc(sizeof(PrimitiveString));
   primitive->type = PRIMITIVE_STRING;
+  primitive->flags = 0;
   primitive->value = 0;
+  primitive->length = length;
+  primitive->offset = 0;
+  primitive->chars = heap_encode(NULL);
+  primitive->atom = heap_encode(NULL);
+  primitive->left = heap_encode(NULL);
+  primitive->right = heap_encode(NULL);
+  return primitive;
+}
 
-  primitive->string = malloc(strlen(s) * sizeof(char));
-  strcpy(primitive->string, s);
+Value* value_string_wrap(PrimitiveString *primitive) {
+  return value_primitive_new((Primitive*)primitive);
+}
 
-  v->primitive = (Primitive*)primitive;
+Value* value_string_new_atom(Atom *atom) {
+  PrimitiveString *primitive = primitive_string_init(atom->length);
+  primitive->atom = heap_encode(atom);
+  return value_string_wrap(primitive);
+}
 
-  return v;
+Value* value_string_new_length(const char *s, size_t length) {
+  PrimitiveString *primitive = primitive_string_init(length);
+  char *chars = heap_alloc(length + 1);
+  memcpy(chars, s, length);
+  chars[length] = '\0';
+  primitive->chars = heap_encode(chars);
+  return value_string_wrap(primitive);
+}
+
+Value* value_string_new_view(char *block, uint32_t offset, uint32_t length) {
+  PrimitiveString *primitive = primitive_string_init(length);
+  primitive->flags = PRIMITIVE_FLAG_VIEW | PRIMITIVE_FLAG_OWNED;
+  primitive->chars = heap_encode(block);
+  primitive->offset = offset;
+  return value_string_wrap(primitive);
+}
+
+Value* value_string_new(const char *s) {
+  return value_string_new_length(s, strlen(s));
+}
+
+// bytes of a flat string, NULL for a rope
+const char* primitive_string_flat_chars(PrimitiveString *s) {
+  Atom *atom = HEAP_GET(Atom, s->atom);
+  if (atom != NULL) return atom->string;
+
+  char *chars = HEAP_GET(char, s->chars);
+  return chars == NULL ? NULL : chars + s->offset;
+}
+
+void primitive_string_materialize(PrimitiveString *s) {
+  if (!(s->flags & PRIMITIVE_FLAG_VIEW)) return;
+
+  char *chars = heap_alloc(s->length + 1);
+  memcpy(chars, HEAP_GET(char, s->chars) + s->offset, s->length);
+  chars[s->length] = '\0';
+  s->chars = heap_encode(chars);
+  s->offset = 0;
+  s->flags &= ~(PRIMITIVE_FLAG_VIEW | PRIMITIVE_FLAG_OWNED);
+}
+
+// writes the bytes of s to out. ropes are walked with an explicit stack from the
+// right, because a string built by `s = s + piece` is a rope as deep as it is long.
+void primitive_string_copy(PrimitiveString *s, char *out) {
+  size_t cap = 16;
+  size_t size = 0;
+  PrimitiveString **stack = malloc(cap * sizeof(PrimitiveString*));
+  stack[size++] = s;
+
+  size_t end = s->length;
+  while (size > 0) {
+    PrimitiveString *node = stack[--size];
+    const char *chars = primitive_string_flat_chars(node);
+    if (chars != NULL) {
+      end -= node->length;
+      memcpy(out + end, chars, node->length);
+      continue;
+    }
+
+    if (size + 2 > cap) {
+      cap *= 2;
+      stack = realloc(stack, cap * sizeof(PrimitiveString*));
+    }
+    stack[size++] = HEAP_GET(PrimitiveString, node->left);
+    stack[size++] = HEAP_GET(PrimitiveString, node->right);
+  }
+
+  free(stack);
+}
+
+const char* primitive_string_flatten(PrimitiveString *s) {
+  const char *flat = primitive_string_flat_chars(s);
+  if (flat != NULL) return flat;
+
+  char *chars = heap_alloc(s->length + 1);
+  primitive_string_copy(s, chars);
+  chars[s->length] = '\0';
+
+  s->chars = heap_encode(chars);
+  s->left = heap_encode(NULL);
+  s->right = heap_encode(NULL);
+  return chars;
+}
+
+Value* value_string_concat(Value *left, Value *right) {
+  PrimitiveString *l = STRING_UNWRAP(left);
+  PrimitiveString *r = STRING_UNWRAP(right);
+  // the result, a rope or one of the two, outlives the line a view is of
+  primitive_string_materialize(l);
+  primitive_string_materialize(r);
+  if (l->length == 0) return right;
+  if (r->length == 0) return left;
+
+  size_t length = (size_t)l->length + r->length;
+  if (length > UINT32_MAX) {
+    fprintf(stderr, "runtime error: invalid string length\n");
+    abort();
+  }
+
+  PrimitiveString *primitive = primitive_string_init(length);
+  if (length < STRING_MIN_ROPE_LENGTH) {
+    char *chars = heap_alloc(length + 1);
+    primitive_string_copy(l, chars);
+    primitive_string_copy(r, chars + l->length);
+    chars[length] = '\0';
+    primitive->chars = heap_encode(chars);
+  } else {
+    primitive->left = heap_encode(l);
+    primitive->right = heap_encode(r);
+  }
+
+  return value_string_wrap(primitive);
+}
+
+unsigned int value_string_length(Value *v) {
+  return STRING_UNWRAP(v)->length;
+}
+
+int value_string_equal(Value *left, Value *right) {
+  PrimitiveString *l = STRING_UNWRAP(left);
+  PrimitiveString *r = STRING_UNWRAP(right);
+  if (l == r) return 1;
+  if (l->length != r->length) return 0;
+  if (l->atom != heap_encode(NULL) && r->atom != heap_encode(NULL)) {
+    return atom_equal(HEAP_GET(Atom, l->atom), HEAP_GET(Atom, r->atom));
+  }
+
+  return memcmp(primitive_string_flatten(l), primitive_string_flatten(r), l->length) == 0;
+}
+
+// whether v is the string of atom, as === would tell, without a string for the atom
+int value_string_equal_atom(Value *v, Atom *atom) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL || primitive->type != PRIMITIVE_STRING) return 0;
+
+  PrimitiveString *s = (PrimitiveString*)primitive;
+  if (s->length != atom->length) return 0;
+  if (s->atom != heap_encode(NULL)) return atom_equal(HEAP_GET(Atom, s->atom), atom);
+
+  return memcmp(primitive_string_flatten(s), atom->string, s->length) == 0;
+}
+
+// the string is flattened and interned on first use, and the atom is kept. a string
+// of an integer name may have an atom that is not interned (see AtomIndex), which is
+// then replaced
+Atom* value_string_atom(Value *v) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL || primitive->type != PRIMITIVE_STRING) return NULL;
+
+  PrimitiveString *s = (PrimitiveString*)primitive;
+  Atom *atom = HEAP_GET(Atom, s->atom);
+  if (atom != NULL && atom->index == ATOM_NOT_INDEX) return atom;
+
+  atom = atom_intern_length(primitive_string_flatten(s), s->length);
+  s->atom = heap_encode(atom);
+  return atom;
+}
+
+// the atom if the string has been interned, without interning it. looking up a
+// property of a runtime string that no object has must not grow the atom table
+Atom* value_string_find_atom(Value *v) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL || primitive->type != PRIMITIVE_STRING) return NULL;
+
+  PrimitiveString *s = (PrimitiveString*)primitive;
+  Atom *atom = HEAP_GET(Atom, s->atom);
+  if (atom != NULL && atom->index == ATOM_NOT_INDEX) return atom;
+
+  atom = atom_find_length(primitive_string_flatten(s), s->length);
+  if (atom != NULL) s->atom = heap_encode(atom);
+  return atom;
+}
+
+// the atom of the integer name the string is, or NULL if it is not one: the string's
+// own atom if it has one, else probe
+Atom* value_string_index_atom(Value *v, AtomIndex *probe) {
+  PrimitiveString *s = (PrimitiveString*)VALUE_PRIMITIVE(v);
+  Atom *atom = HEAP_GET(Atom, s->atom);
+  if (atom != NULL) return atom->index == ATOM_NOT_INDEX ? NULL : atom;
+
+  uint32_t index = atom_array_index(primitive_string_flatten(s), s->length);
+  return index == ATOM_NOT_INDEX ? NULL : atom_index_init(probe, index);
 }
 
 const char* value_string_unwrap(Value *v) {
-  if (v->primitive != NULL && v->primitive->type == PRIMITIVE_STRING) {
-    PrimitiveString *s = (PrimitiveString*)v->primitive;
-    return s->string;
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL || primitive->type != PRIMITIVE_STRING) return NULL;
+
+  return primitive_string_flatten((PrimitiveString*)primitive);
+}
+
+Value* value_to_string(Value *v) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive != NULL && primitive->type == PRIMITIVE_STRING) return v;
+
+  StringBuilder builder;
+  string_builder_init(&builder);
+  string_builder_append_value(&builder, v);
+  return string_builder_finish(&builder);
+}
+
+void string_builder_init(StringBuilder *builder) {
+  builder->cap = 64;
+  builder->length = 0;
+  builder->data = malloc(builder->cap);
+}
+
+void string_builder_reserve(StringBuilder *builder, size_t length) {
+  if (builder->length + length <= builder->cap) return;
+
+  while (builder->length + length > builder->cap) builder->cap *= 2;
+  builder->data = realloc(builder->data, builder->cap);
+}
+
+void string_builder_append(StringBuilder *builder, const char *s, size_t length) {
+  string_builder_reserve(builder, length);
+  memcpy(builder->data + builder->length, s, length);
+  builder->length += length;
+}
+
+// appends v converted to a string. ropes are copied piece by piece without flattening them
+void string_builder_append_value(StringBuilder *builder, Value *v) {
+  if (v->kind == VALUE_KIND_NULL) {
+    string_builder_append(builder, "null", 4);
+    return;
   }
 
-  return NULL;
+  if (v->kind == VALUE_KIND_UNDEFINED) {
+    string_builder_append(builder, "undefined", 9);
+    return;
+  }
+
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL) {
+    string_builder_append(builder, "[object Object]", 15);
+    return;
+  }
+
+  switch (primitive->type) {
+    case PRIMITIVE_STRING: {
+      PrimitiveString *s = (PrimitiveString*)primitive;
+      string_builder_reserve(builder, s->length);
+      primitive_string_copy(s, builder->data + builder->length);
+      builder->length += s->length;
+      break;
+    }
+
+    case PRIMITIVE_NUMBER: {
+      char buf[32];
+      value_number_format(primitive->value, buf);
+      string_builder_append(builder, buf, strlen(buf));
+      break;
+    }
+
+    case PRIMITIVE_BOOLEAN: {
+      const char *s = primitive->value ? "true" : "false";
+      string_builder_append(builder, s, strlen(s));
+      break;
+    }
+
+    case PRIMITIVE_ARRAY: {
+      string_builder_append_value(builder, value_array_join(v, NULL));
+      break;
+    }
+
+    case PRIMITIVE_FUNCTION: {
+      string_builder_append(builder, "function", 8);
+      break;
+    }
+
+    // the elements joined with commas, as for an array
+    case PRIMITIVE_TYPED_ARRAY: {
+      uint32_t length = value_typed_array_length(v);
+      for (uint32_t i = 0; i < length; i++) {
+        char buf[32];
+        if (i > 0) string_builder_append(builder, ",", 1);
+        value_number_format(value_typed_array_load(v, i), buf);
+        string_builder_append(builder, buf, strlen(buf));
+      }
+      break;
+    }
+
+    case PRIMITIVE_ARRAY_BUFFER: {
+      string_builder_append(builder, "[object ArrayBuffer]", 20);
+      break;
+    }
+
+    case PRIMITIVE_WORKER: {
+      string_builder_append(builder, "[object Worker]", 15);
+      break;
+    }
+
+    case PRIMITIVE_PROMISE: {
+      string_builder_append(builder, "[object Promise]", 16);
+      break;
+    }
+
+    case PRIMITIVE_GENERATOR: {
+      string_builder_append(builder, "[object Generator]", 18);
+      break;
+    }
+
+    case PRIMITIVE_LINE_ITERATOR: {
+      string_builder_append(builder, "[object Object]", 15);
+      break;
+    }
+  }
+}
+
+Value* string_builder_finish(StringBuilder *builder) {
+  Value *v = value_string_new_length(builder->data, builder->length);
+  free(builder->data);
+  builder->data = NULL;
+  return v;
 }
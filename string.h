@@ -1,2 +1,34 @@
 Value* value_string_new(const char *s);
+Value* value_string_new_length(const char *s, size_t length);
+Value* value_string_new_atom(Atom *atom);
+// the length bytes at offset in block, which are followed by a NUL. owned by the
+// variable it is stored in, until it escapes (see reader.h)
+Value* value_string_new_view(char *block, uint32_t offset, uint32_t length);
+Value* value_string_concat(Value *left, Value *right);
+unsigned int value_string_length(Value *v);
+int value_string_equal(Value *left, Value *right);
+int value_string_equal_atom(Value *v, Atom *atom);
+Atom* value_string_atom(Value *v);
+Atom* value_string_find_atom(Value *v);
+Atom* value_string_index_atom(Value *v, AtomIndex *probe);
 const char* value_string_unwrap(Value *v);
+// writes out the bytes of a rope, which stops being one
+const char* primitive_string_flatten(PrimitiveString *s);
+// copies the bytes of a view (PRIMITIVE_FLAG_VIEW) into the string, which then no
+// longer depends on the block they were in. does nothing to other strings
+void primitive_string_materialize(PrimitiveString *s);
+Value* value_to_string(Value *v);
+
+// appends pieces into one growable buffer, so that building a string of n pieces is O(n)
+typedef struct StringBuilder {
+  char *data;
+  size_t length;
+  size_t cap;
+} StringBuilder;
+
+void string_builder_init(StringBuilder *builder);
+// makes room for length more bytes at data + length
+void string_builder_reserve(StringBuilder *builder, size_t length);
+void string_builder_append(StringBuilder *builder, const char *s, size_t length);
+void string_builder_append_value(StringBuilder *builder, Value *v);
+Value* string_builder_finish(StringBuilder *builder);
@@ -49,3 +49,138 @@ for path in $(ls test/input/*.js); do
     pass $path
   fi
 done
+
+echo
+echo "running tests with --jobs..."
+# every script in its own isolate on a pool of threads, printed in order
+expected=$(for path in $(ls test/input/*.js); do cat "test/output/$(basename "$path" .js).out"; done)
+actual=$($executable --jobs 4 $(ls test/input/*.js))
+exit_code=$?
+if [[ $exit_code -ne 0 ]]; then
+  fail "--jobs 4"
+  echo "  program exited with $exit_code"
+elif [ "$expected" != "$actual" ]; then
+  fail "--jobs 4"
+  diff <(echo "$expected") <(echo "$actual") | sed 's/^/  /'
+else
+  pass "--jobs 4"
+fi
+
+echo
+echo "running tests with --threads..."
+# parallelMap and parallelReduce give the same results on the calling thread alone
+for threads in 1 4; do
+  expected=$(cat test/output/20-parallel.out)
+  actual=$($executable --threads $threads test/input/20-parallel.js)
+  exit_code=$?
+  if [[ $exit_code -ne 0 ]]; then
+    fail "--threads $threads"
+    echo "  program exited with $exit_code"
+  elif [ "$expected" != "$actual" ]; then
+    fail "--threads $threads"
+    diff <(echo "$expected") <(echo "$actual") | sed 's/^/  /'
+  else
+    pass "--threads $threads"
+  fi
+done
+
+echo
+echo "running tests with --load-snapshot..."
+# every script on the heap a prelude left, mapped from a file instead of run again
+snapshot=$(mktemp /tmp/mjs-test.XXXXXX)
+$executable --snapshot test/snapshot/prelude.js -o $snapshot >/dev/null
+for path in test/snapshot/script.js $(ls test/input/*.js); do
+  if [ "$path" = test/snapshot/script.js ]; then
+    expected=$(cat test/snapshot/script.out)
+  else
+    expected=$(cat "test/output/$(basename "$path" .js).out")
+  fi
+
+  actual=$($executable --load-snapshot $snapshot $path)
+  exit_code=$?
+  if [[ $exit_code -ne 0 ]]; then
+    fail "--load-snapshot $path"
+    echo "  program exited with $exit_code"
+  elif [ "$expected" != "$actual" ]; then
+    fail "--load-snapshot $path"
+    echo "  expect: $expected"
+    echo "  actual: $actual"
+  else
+    pass "--load-snapshot $path"
+  fi
+done
+rm -f $snapshot
+
+echo
+echo "running tests with stdin..."
+# lines read from a pipe, kept past their iteration or only looked at
+expected=$(cat test/stdin/lines.out)
+actual=$(cat test/stdin/input.txt | $executable test/stdin/lines.js)
+exit_code=$?
+if [[ $exit_code -ne 0 ]]; then
+  fail "stdin.lines()"
+  echo "  program exited with $exit_code"
+elif [ "$expected" != "$actual" ]; then
+  fail "stdin.lines()"
+  diff <(echo "$expected") <(echo "$actual") | sed 's/^/  /'
+else
+  pass "stdin.lines()"
+fi
+
+echo
+echo "running tests with --serve..."
+# every script as a request to a pool of workers forked after the prelude ran
+socket=$(mktemp -u /tmp/mjs-test.XXXXXX)
+$executable --serve $socket --workers 2 test/serve/prelude.js >/dev/null &
+server=$!
+while [ ! -S $socket ]; do sleep 0.1; done
+
+for path in $(ls test/input/*.js); do
+  name=$(basename "$path" .js)
+  actual=$($executable --connect $socket $path)
+  exit_code=$?
+  expected=$(cat "test/output/${name}.out")
+  if [[ $exit_code -ne 0 ]]; then
+    fail "--connect $path"
+    echo "  request exited with $exit_code"
+  elif [ "$expected" != "$actual" ]; then
+    fail "--connect $path"
+    echo "  expect: $expected"
+    echo "  actual: $actual"
+  else
+    pass "--connect $path"
+  fi
+done
+
+# the prelude's function, called with the request body
+actual=$(echo -n world | $executable --connect $socket --call greet)
+if [ "$actual" != "hello world" ]; then
+  fail "--call greet"
+  echo "  actual: $actual"
+else
+  pass "--call greet"
+fi
+
+# a request's vars are its own and leave the prelude's globals as they were
+$executable --connect $socket test/serve/define.js >/dev/null
+actual=$(echo -n world | $executable --connect $socket --call greet)
+if [ "$actual" != "hello world" ]; then
+  fail "--serve scope"
+  echo "  actual: $actual"
+else
+  pass "--serve scope"
+fi
+
+# an error aborts the worker, which answers with what was printed first
+actual=$($executable --connect $socket test/serve/abort.js 2>/dev/null)
+exit_code=$?
+if [[ $exit_code -ne 134 ]] || [ "$actual" != "before" ]; then
+  fail "--serve abort"
+  echo "  request exited with $exit_code"
+  echo "  actual: $actual"
+else
+  pass "--serve abort"
+fi
+
+kill $server
+wait $server
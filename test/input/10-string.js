@@ -0,0 +1,20 @@
+var greeting = 'hello' + ', ' + "world";
+console.log(greeting);
+console.log('n = ' + 1 + 2);
+console.log(1 + 2 + ' apples');
+console.log('it\'s' === "it's");
+console.log('ab' + 'cd' === 'abcd');
+
+var s = '';
+for (var i = 0; i < 20; i = i + 1) {
+  s = s + '[' + i + ']';
+}
+console.log(s);
+
+var words = ['a', 'b', 'c'];
+console.log(words.join(' - '));
+console.log([1, null, undefined, [2, 3]].join());
+
+var o = {};
+o['k' + 'ey'] = 'value';
+console.log(o.key);
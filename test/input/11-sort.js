@@ -0,0 +1,12 @@
+console.log([10, 9, 1, 100].sort());
+console.log([10, 9, 1, 100].sort(function (a, b) { return a - b; }));
+console.log([10, 9, 1, 100].sort(function (x, y) { return y - x; }));
+console.log(['pear', 'apple', 'fig'].sort());
+var people = [{ name: 'b', age: 30 }, { name: 'a', age: 20 }, { name: 'c', age: 25 }];
+var byAge = function (p, q) { return p.age - q.age; };
+people.sort(byAge);
+console.log(people);
+var a = [3, undefined, 1];
+a[5] = 2;
+console.log(a.sort());
+console.log(a.length);
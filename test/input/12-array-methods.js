@@ -0,0 +1,33 @@
+var a = [1, 2, 3, 2, 1];
+console.log(a.indexOf(2), a.indexOf(2, 2), a.indexOf(9), a.indexOf(1, 0 - 1));
+console.log(a.includes(3), a.includes(9), a.includes(0 / 0));
+var n = [1, 0 / 0, 3];
+console.log(n.indexOf(0 / 0), n.includes(0 / 0));
+var s = ['x', 'y', 'z'];
+console.log(s.indexOf('y'), s.includes('q'));
+var h = [1];
+h[3] = 4;
+console.log(h.includes(undefined), h.indexOf(undefined));
+console.log([0, 0, 0, 0, 0].fill(7, 1, 0 - 1));
+console.log(a.slice(1, 3), a.slice(0 - 2), a.slice());
+console.log([1, 2].concat([3, 4], 5, ['six']));
+var p = [];
+console.log(p.push(1, 2, 3), p);
+console.log(p.pop(), p.pop(), p, p.length);
+console.log([].pop());
+var sum = function (acc, x) { return acc + x; };
+console.log(a.reduce(sum), a.reduce(sum, 10));
+console.log(['a', 'b', 'c'].reduce(sum, ''));
+console.log([1, 2, 3].reduce(function (acc, x, i) { return acc + x * i; }, 0));
+var big = [];
+for (var i = 0; i < 1000; i = i + 1) { big[i] = i; }
+console.log(big.reduce(function (a, b) { return a + b; }), big.indexOf(999), big.slice(998));
+var frac = [1 / 10, 2 / 10, 3 / 10];
+console.log(frac.reduce(function (a, b) { return a + b; }, 0) === 1 / 10 + 2 / 10 + 3 / 10);
+var sparse = [];
+sparse[5000000] = 'far';
+sparse[3] = 'near';
+console.log(sparse.indexOf('far'), sparse.includes('near'), sparse.includes(undefined), sparse.length);
+console.log(sparse.pop(), sparse.length, sparse.slice(2, 5));
+var words = ['a', 'b', 'c', 'd'];
+console.log(words.fill('z', 2), words.concat(sparse.slice(3, 4)));
@@ -0,0 +1,28 @@
+var f = new Float64Array(4);
+f[0] = 10;
+f[3] = 7 / 2;
+console.log(f, f.length, f.byteLength, f[1], f[4]);
+var buffer = new ArrayBuffer(8);
+console.log(buffer, buffer.byteLength);
+var bytes = new Uint8Array(buffer);
+var ints = new Int32Array(buffer, 4, 1);
+ints[0] = 258;
+console.log(bytes, ints.byteOffset, ints.buffer === buffer);
+bytes[0] = 300;
+bytes[1] = 0 - 1;
+console.log(bytes[0], bytes[1]);
+var view = bytes.subarray(4, 6);
+view[0] = 9;
+console.log(view, ints[0], view.buffer === buffer, view.byteOffset);
+var copy = new Int32Array([1, 2, 3]);
+var wide = new Float64Array(copy);
+console.log(copy, wide.fill(5, 1));
+var big = new Uint8Array(1000);
+big.fill(3);
+var sum = 0;
+for (var i = 0; i < big.length; i = i + 1) { sum = sum + big[i]; }
+console.log(sum, Object.keys(new Uint8Array(2)));
+function Point(x) { this.x = x; }
+var p = new Point(4);
+console.log(p.x);
+console.log('bytes: ' + new Uint8Array([1, 2, 3]), [new ArrayBuffer(2)].join());
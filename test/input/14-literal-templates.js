@@ -0,0 +1,40 @@
+function make() { return [1, 2, 3]; }
+var a = make();
+var b = make();
+a[0] = 9;
+a.push(4);
+console.log(a, b, make());
+var c = make();
+c.sort(function (x, y) { return y - x; });
+console.log(c, make());
+var d = make();
+d.fill(0);
+var e2 = make();
+console.log(d, e2.reduce(function (x, y) { return x + y; }));
+function words() { return ['b', 'a', 'c']; }
+var w = words();
+w.sort();
+delete w[1];
+var w2 = words();
+console.log(w, words(), w2.pop(), words());
+function point() { return { x: 1, y: 2 }; }
+var p = point();
+var q = point();
+p.x = 5;
+p.z = 3;
+delete q.y;
+console.log(p, q, point());
+var e = [];
+e[0] = 1;
+for (var i = 0; i < 3; i = i + 1) {
+  var fresh = [];
+  fresh.push(i);
+  console.log(fresh);
+}
+var s = make();
+s[5000] = 1;
+var s2 = make();
+console.log(s.length, s2.length);
+var m = [1, 'x'];
+m[1] = 2;
+console.log(m, Object.keys(point()));
@@ -0,0 +1,47 @@
+var i = 0;
+i++;
+++i;
+var b = i;
+i++;
+console.log(i, b);
+var j = i++;
+var k = ++i;
+console.log(i, j, k);
+i--;
+--i;
+i += 10;
+i -= 2;
+i *= 3;
+console.log(i, i + ++i, i);
+var n = 0;
+for (var x = 0; x < 5; x++) {
+  n += x;
+}
+console.log(n);
+var a = [1, 2, 3];
+a[0]++;
+a[1] += 10;
+a[2] *= a[2];
+console.log(a, a[0]--, a[0]);
+var o = { count: 1 };
+o.count++;
+o.count += 5;
+console.log(o);
+var bytes = new Uint8Array(2);
+bytes[0]--;
+bytes[1] += 300;
+var ints = new Int32Array(1);
+ints[0] -= 5;
+console.log(bytes, ints, ++bytes[1]);
+var s = 'a';
+s += 'b';
+s += 1;
+var t = 1;
+t += 'x';
+console.log(s, t);
+var words = ['x'];
+words[0] += 'y';
+console.log(words);
+var flag = true;
+flag++;
+console.log(flag);
@@ -0,0 +1,51 @@
+function name(op) {
+  switch (op) {
+    case 0: return 'zero';
+    case 1:
+    case 2: return 'small';
+    case 3: return 'three';
+    default: return 'other';
+  }
+}
+console.log(name(0), name(2), name(3), name(7), name('1'));
+function sparse(code) {
+  var out = '';
+  switch (code) {
+    case 100: out += 'a';
+    case 20000: out += 'b'; break;
+    case 'x': out += 'c'; break;
+    case '100': out += 'd';
+  }
+  return out;
+}
+console.log(sparse(100), sparse(20000), sparse('x'), sparse('100'), sparse(5));
+var key = 'k';
+function dynamic(v) {
+  var hits = 0;
+  switch (v) {
+    default: hits += 100;
+    case key: hits += 1; break;
+    case key + key: hits += 10;
+  }
+  return hits;
+}
+console.log(dynamic('k'), dynamic('kk'), dynamic('z'));
+var total = 0;
+for (var i = 0; i < 10; i++) {
+  switch (i) {
+    case 1: total += 1; break;
+    case 2: total += 2;
+    case 3: total += 3; break;
+    case 1: total += 1000;
+  }
+  if (i === 5) {
+    break;
+  }
+}
+console.log(total, i);
+var n = 0;
+while (1) {
+  n++;
+  if (n > 3) { break; }
+}
+console.log(n);
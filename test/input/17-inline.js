@@ -0,0 +1,17 @@
+function add(a, b) { return a + b; }
+function x(p) { return p.x; }
+function pair(a, b) { return [a, b, { a: a }]; }
+var total = 0;
+for (var i = 0; i < 5; i++) {
+  total = add(total, i);
+}
+console.log(total, add('a', 1), add(add(1, 2), add(3, 4)));
+console.log(x({ x: 7 }), pair(1, 'b'));
+var scale = 10;
+function scaled(n) { return n * scale; }
+console.log(scaled(3));
+add = function (a, b) { return a * b; };
+console.log(add(3, 4));
+var m = 5;
+function both(m) { return m + m; }
+console.log(both(2), m);
@@ -0,0 +1,11 @@
+console.log(Math.floor(7 / 2), Math.ceil(7 / 2), Math.trunc(0 - 7 / 2), Math.abs(0 - 5), Math.sqrt(16));
+console.log(Math.min(3, 1), Math.max(3, 1), Math.min(4, 2, 8), Math.max(4, 9, 8), Math.max(true, 0));
+var fs = [Math.floor, Math.ceil, function (x) { return x * 2; }, Math.max];
+for (var i = 0; i < 4; i++) {
+  var f = fs[i];
+  console.log(f(7 / 2) * 2);
+}
+var a = [];
+a.push(1);
+a.push(2, 3);
+console.log(a.pop(), a, a.push(4));
@@ -0,0 +1,54 @@
+var received = [];
+var echo = new Worker('test/worker/echo.js');
+echo.onmessage = function (event) {
+  received.push(event.data);
+  if (event.data === 'bye') {
+    console.log(received.length);
+    var first = received[0];
+    var second = received[1];
+    var third = received[2];
+    var shared = third.got;
+    console.log(first.got, second.got, shared.a.length, shared.a === shared.b);
+    console.log(Object.keys(shared), shared.nested, shared.sparse[3000]);
+    console.log(shared.trimmed.length, shared.holey.length, shared.holey);
+    startSum();
+  }
+};
+console.log(echo);
+
+var a = [1, 2, 3];
+var sparse = [];
+sparse[3000] = 'far';
+var trimmed = [];
+trimmed[3000] = 1;
+delete trimmed[3000];
+var holey = [1, 'x', 2];
+delete holey[2];
+echo.postMessage(42);
+echo.postMessage({ x: 1, y: 'two' });
+echo.postMessage({ a: a, b: a, nested: [true, null, 'x'], sparse: sparse, trimmed: trimmed, holey: holey });
+echo.postMessage('done');
+
+function startSum() {
+  var data = [];
+  for (var i = 0; i < 1000; i++) {
+    data.push(i);
+  }
+  var half = data.slice(500, 1000);
+  var summer = new Worker('test/worker/sum.js');
+  summer.onmessage = function (event) {
+    var result = event.data;
+    console.log(result[0], result[1]);
+    this.terminate();
+    startHello();
+  };
+  summer.postMessage(half, [half]);
+  console.log(half.length, data.length);
+}
+
+function startHello() {
+  var hello = new Worker('test/worker/hello.js');
+  hello.onmessage = function (event) {
+    console.log(event.data);
+  };
+}
@@ -0,0 +1,46 @@
+var numbers = [];
+for (var i = 0; i < 5000; i++) {
+  numbers.push(i);
+}
+
+var squares = numbers.parallelMap(function (x) { return x * x; });
+console.log(squares.length, squares[0], squares[3], squares[4999]);
+
+var matches = 0;
+for (var j = 0; j < 5000; j++) {
+  if (squares[j] === j * j) {
+    matches++;
+  }
+}
+console.log(matches);
+
+var sum = numbers.parallelReduce(function (a, b) { return a + b; }, 0);
+console.log(sum, numbers.reduce(function (a, b) { return a + b; }, 0));
+
+var largest = numbers.parallelReduce(function (a, b) { return Math.max(a, b); });
+console.log(largest);
+
+var doubled = numbers.parallelReduce(function (acc, x) { return acc + x * 2; }, 0);
+console.log([1, 2, 3].parallelReduce(function (acc, x) { return acc + x * 2; }, 0), doubled);
+
+var combined = numbers.parallelReduce(function (acc, x) { return acc + x * 2; }, 0, function (a, b) { return a + b; });
+console.log(combined);
+
+var limit = 3;
+var clamped = numbers.parallelMap(function (x, i) {
+  var y = Math.min(x, limit);
+  return y + i;
+});
+console.log(clamped[0], clamped[1], clamped[4000]);
+
+var roots = numbers.parallelMap(Math.sqrt);
+console.log(roots[0], roots[1], roots[4], roots[4900]);
+
+var seen = { count: 0 };
+var counted = numbers.parallelMap(function (x) {
+  seen.count = seen.count + 1;
+  return x;
+});
+console.log(seen.count, counted[4999]);
+
+console.log([].parallelMap(function (x) { return x; }), [].parallelReduce(function (a, b) { return a + b; }, 7));
@@ -0,0 +1,39 @@
+console.log('start');
+
+var ready = Promise.resolve(1);
+ready.then(function (x) { return x + 1; }).then(function (x) { console.log('then', x); });
+console.log(ready);
+Promise.reject('no').catch(function (reason) { console.log('caught', reason); });
+
+var files = [fs.readFile('test/loop/a.txt'), fs.readFile('test/loop/b.txt')];
+Promise.all(files).then(function (texts) {
+  console.log(texts.length, texts[0], texts[1]);
+  return fs.readFile('test/loop/missing.txt');
+}).then(function (text) {
+  console.log('read', text);
+}, function (reason) {
+  console.log('failed', reason);
+  return fs.writeFile('/tmp/mjs-21-event-loop.txt', 'written');
+}).then(function () {
+  return fs.readFile('/tmp/mjs-21-event-loop.txt');
+}).then(function (text) {
+  console.log('wrote', text);
+  startTimers();
+});
+
+function startTimers() {
+  setTimeout(function (name) { console.log('timeout', name); }, 20, 'late');
+  setTimeout(function () { console.log('timeout', 'early'); }, 0);
+  var cleared = setTimeout(function () { console.log('never'); }, 10);
+  clearTimeout(cleared);
+
+  var waiting = new Promise(function (resolve, reject) {
+    setTimeout(resolve, 5, 'waited');
+  });
+  waiting.then(function (value) { console.log(value); });
+  var follow = new Promise(function (resolve) { resolve(waiting); });
+  follow.then(function (value) { console.log('followed', value); });
+  console.log(follow);
+}
+
+console.log('end');
@@ -0,0 +1,74 @@
+function* range(start, end) {
+  for (var i = start; i < end; i++) {
+    yield i;
+  }
+  return 'done';
+}
+
+function* map(f, source) {
+  for (var x of source) {
+    yield f(x);
+  }
+}
+
+function* take(n, source) {
+  var taken = 0;
+  for (var x of source) {
+    if (taken === n) {
+      return taken;
+    }
+    yield x;
+    taken++;
+  }
+}
+
+function* naturals() {
+  var n = 0;
+  while (true) {
+    yield n;
+    n++;
+  }
+}
+
+function double(x) {
+  return x * 2;
+}
+
+var g = range(0, 2);
+console.log(g);
+console.log(g.next());
+console.log(g.next());
+console.log(g.next());
+console.log(g.next());
+
+for (var x of take(4, map(double, naturals()))) {
+  console.log(x);
+}
+
+function* running() {
+  var total = 0;
+  while (true) {
+    var x = yield total;
+    total = total + x;
+  }
+}
+
+var sums = running();
+sums.next();
+console.log(sums.next(5).value);
+console.log(sums.next(7).value);
+
+var evens = [];
+for (var n of range(0, 10)) {
+  if (n > 6) {
+    break;
+  }
+  if (Math.floor(n / 2) * 2 === n) {
+    evens.push(n);
+  }
+}
+console.log(evens);
+
+for (var c of ['a', 'b']) {
+  console.log(c);
+}
@@ -0,0 +1,16 @@
+var text = '{"users": [{"name": "ada", "langs": ["en", "fr"], "score": 9.5}, {"name": "bob", "langs": [], "score": -2e1}], "ok": true, "next": null}';
+var doc = JSON.parse(text);
+console.log(doc.users.length, doc.users[0].name, doc.users[0].langs, doc.ok, doc.next);
+console.log(JSON.stringify(doc.users[1].score), JSON.stringify(doc.users[0].score));
+console.log(JSON.stringify(JSON.parse(JSON.stringify(doc))) === JSON.stringify(doc));
+console.log(JSON.stringify(doc));
+
+var escaped = JSON.parse('"tab\\t quote\\" \\u0041\\u00e9"');
+console.log(escaped);
+console.log(JSON.stringify(escaped));
+
+var point = { x: 1, y: [2, 3], label: 'p', skip: undefined, f: function() { return 1; } };
+console.log(JSON.stringify(point, null, 2));
+console.log(JSON.stringify([undefined, function() {}, 'a']), JSON.stringify(undefined));
+console.log(JSON.stringify(new Uint8Array([1, 2])), JSON.stringify({}), JSON.stringify([]));
+console.log(JSON.stringify(JSON.parse('[1e-7, 5e-324, 0.1, 1e21, 1.5e300, 123.456, 1e-5, 1e-6, 0.000001234, 1.5e-7]')));
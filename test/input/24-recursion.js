@@ -0,0 +1,19 @@
+function depth(n) {
+  if (n === 0) {
+    return 0;
+  }
+  return depth(n - 1) + 1;
+}
+console.log(depth(6000));
+
+function sum(list, i) {
+  if (i === list.length) {
+    return 0;
+  }
+  return list[i] + sum(list, i + 1);
+}
+var list = [];
+for (var i = 0; i < 5000; i++) {
+  list.push(i);
+}
+console.log(sum(list, 0));
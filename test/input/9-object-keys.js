@@ -0,0 +1,27 @@
+var o = { a: 1, b: 2, c: 3 };
+console.log(o);
+
+delete o.b;
+o.d = 4;
+console.log(Object.keys(o));
+
+for (var key in o) {
+  console.log(o[key]);
+}
+
+var a = [5, 6];
+for (var i in a) {
+  console.log(a[i]);
+}
+
+console.log({});
+
+var mixed = { b: 1 };
+mixed[2] = 2;
+mixed.a = 3;
+mixed[0] = 4;
+console.log(Object.keys(mixed));
+for (var name in mixed) {
+  console.log(name);
+}
+console.log(JSON.stringify(JSON.parse('{"1":1,"a":2,"0":3}')));
@@ -0,0 +1 @@
+var greeting = "bye ";
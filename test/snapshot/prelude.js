@@ -0,0 +1,31 @@
+function add(a, b) {
+  return a + b;
+}
+
+function name(n) {
+  switch (n) {
+    case 1:
+      return 'one';
+    case 'two':
+      return 'two';
+    default:
+      return 'many';
+  }
+}
+
+var point = { x: 1, y: 2 };
+var pair = [point, 'a'];
+var sparse = [];
+sparse[5000] = 7;
+var bytes = new Uint8Array(4);
+bytes[1] = 9;
+var rope = 'abcdefghijklmnop';
+for (var i = 0; i < 4; i++) {
+  rope = rope + 'abcdefghijklmnop';
+}
+
+Array.prototype.first = function () {
+  return this[0];
+};
+
+console.log('prelude');
@@ -0,0 +1,7 @@
+console.log(add(point.x, point.y), name(1), name('two'), name(3));
+var head = pair[0];
+console.log(head.y, pair.first(), sparse[5000], sparse.length);
+console.log(bytes[1], bytes.length, rope.length, [4, 5].first());
+pair.push(3);
+point.z = 3;
+console.log(pair.length, Object.keys(point), Math.max(add(1, 2), 2));
@@ -0,0 +1,13 @@
+var header = stdin.readLine();
+var hits = 0;
+var errors = [];
+var counts = {};
+for (var line of stdin.lines()) {
+  if (line === 'GET /index.html 200') { hits++; }
+  if (line === 'POST /api 500') { errors.push(line); }
+  if (counts[line] === undefined) { counts[line] = 0; }
+  counts[line] = counts[line] + 1;
+  var last = line;
+}
+console.log(header, hits, errors, counts);
+console.log(last, stdin.readLine());
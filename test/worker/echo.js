@@ -0,0 +1,11 @@
+function onmessage(event) {
+  var data = event.data;
+  switch (data) {
+    case 'done':
+      postMessage('bye');
+      close();
+      break;
+    default:
+      postMessage({ got: data });
+  }
+}
@@ -0,0 +1 @@
+postMessage('hello from a worker');
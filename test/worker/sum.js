@@ -0,0 +1,8 @@
+function onmessage(event) {
+  var part = event.data;
+  var sum = 0;
+  for (var i = 0; i < part.length; i++) {
+    sum = sum + part[i];
+  }
+  postMessage([part.length, sum], [part]);
+}
@@ -10,11 +10,49 @@ Token* token_alloc() {
   token->line = 0;
   token->column = 0;
   token->type = TOKEN_ANY;
+  token->atom = NULL;
   token->next = NULL;
 
   return token;
 }
 
+// reads a string literal quoted with ' or " starting at s.
+// returns the length of the literal in the source, and stores the content in token
+int tokenize_string(Token *token, const char *s) {
+  char quote = s[0];
+  int size = 1;
+  int length = 0;
+  char *buf = malloc(strlen(s) + 1);
+
+  for (; s[size] != quote; size++) {
+    char c = s[size];
+    if (c == '\0' || c == '\n') {
+      fprintf(stderr, "tokenize error: unterminated string (%d:%d)\n", token->line, token->column);
+      abort();
+    }
+
+    if (c == '\\') {
+      size++;
+      switch (s[size]) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        // a backslash right before the end is reported as unterminated above
+        case '\0': size--; continue;
+        default: c = s[size]; break;
+      }
+    }
+
+    buf[length++] = c;
+  }
+
+  token->type = TOKEN_STRING;
+  token->atom = atom_intern_length(buf, length);
+  free(buf);
+
+  return size + 1;
+}
+
 Token* tokenize(char *source) {
   char *current = source;
   Token *head = token_alloc();
@@ -40,7 +78,9 @@ Token* tokenize(char *source) {
     token->column = column_number;
 
     int size = 1;
-    if (isalpha(*current)) {
+    if (*current == '\'' || *current == '"') {
+      size = tokenize_string(token, current);
+    } else if (isalpha(*current)) {
       for (; current[size] != '\0' && isalnum(current[size]); size++) ;
 
       char *buf = calloc(size + 1, sizeof(char));
@@ -74,9 +114,11 @@ Token* tokenize(char *source) {
       }
     }
 
-    token->value = calloc(size + 1, sizeof(char));
-    strncpy(token->value, current, size);
-    assert(strlen(token->value) > 0);
+    if (token->type != TOKEN_STRING) {
+      token->atom = atom_intern_length(current, size);
+      assert(size > 0);
+    }
+    token->value = token->atom->string;
 
     prev_token->next = token;
     prev_token = token;
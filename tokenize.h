@@ -2,17 +2,22 @@
 #define MJS_TOKENIZE_H
 
 #include <stdlib.h>
+#include "atom.h"
 typedef enum TokenType {
   TOKEN_ANY,
   TOKEN_NUMBER,
   TOKEN_IDENTIFIER,
   TOKEN_SYMBOL,
   TOKEN_KEYWORD,
+  TOKEN_STRING,
 } TokenType;
 
 typedef struct Token {
   TokenType type;
+  // token text, interned. value is atom->string.
+  // for strings, this is the content between the quotes with escapes resolved
   char *value;
+  struct Atom *atom;
   struct Token *next;
   unsigned int line;
   unsigned int column;
@@ -21,7 +26,13 @@ typedef struct Token {
 Token* tokenize(char *source);
 void token_pp(Token* token);
 
+// longer symbols come first, so that "++" is not read as two "+"
 static char *token_symbols[] = {
+  "++",
+  "--",
+  "+=",
+  "-=",
+  "*=",
   "+",
   "-",
   "*",
@@ -32,7 +43,6 @@ static char *token_symbols[] = {
   "=",
   "(",
   ")",
-  "'",
   "{",
   "}",
   ".",
@@ -52,6 +62,14 @@ static char *token_keywords[] = {
   "if",
   "while",
   "for",
+  "in",
+  "delete",
+  "new",
+  "switch",
+  "case",
+  "default",
+  "break",
+  "yield",
   NULL,
 };
 
@@ -0,0 +1,201 @@
+#include "value.h"
+#include "object.h"
+#include "number.h"
+#include "string.h"
+#include "vector.h"
+#include "typed_array.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_UNWRAP(X) ((PrimitiveArrayBuffer*)VALUE_PRIMITIVE(X))
+#define TYPED_ARRAY_UNWRAP(X) ((PrimitiveTypedArray*)VALUE_PRIMITIVE(X))
+#define IS_NUMBER(X) ((X) != NULL && VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_NUMBER)
+
+#define TYPED_ARRAY_ENUM_TO_NAME(KIND, NAME, TYPE) #NAME,
+#define TYPED_ARRAY_ENUM_TO_SIZE(KIND, NAME, TYPE) sizeof(TYPE),
+
+static const char *typed_array_names[] = {
+  TYPED_ARRAY_ENUM(TYPED_ARRAY_ENUM_TO_NAME)
+};
+
+static const size_t typed_array_element_sizes[] = {
+  TYPED_ARRAY_ENUM(TYPED_ARRAY_ENUM_TO_SIZE)
+};
+
+Value* value_array_buffer_create(Value *proto, uint32_t byte_length) {
+  Value *v = value_object_create(proto);
+
+  PrimitiveArrayBuffer *buffer = heap_alloc(sizeof(PrimitiveArrayBuffer));
+  buffer->type = PRIMITIVE_ARRAY_BUFFER;
+  buffer->flags = 0;
+  buffer->value = 0;
+  buffer->byte_length = byte_length;
+  // heap blocks are 8-byte aligned, so a Float64Array can view the data from offset 0
+  size_t size = byte_length == 0 ? HEAP_ALIGNMENT : byte_length;
+  char *data = heap_alloc(size);
+  memset(data, 0, size);
+  buffer->data = heap_encode(data);
+  v->primitive = heap_encode((Primitive*)buffer);
+
+  return v;
+}
+
+Value* value_array_buffer_new(Binding *binding, uint32_t byte_length) {
+  Value *klass = env_get(binding->global, "ArrayBuffer");
+  Value *proto = value_object_get(klass, value_string_new("prototype"));
+  return value_array_buffer_create(proto, byte_length);
+}
+
+uint32_t value_array_buffer_byte_length(Value *buffer) {
+  return BUFFER_UNWRAP(buffer)->byte_length;
+}
+
+void* value_array_buffer_data(Value *buffer) {
+  return heap_decode(BUFFER_UNWRAP(buffer)->data);
+}
+
+const char* value_typed_array_name(TypedArrayKind kind) {
+  return typed_array_names[kind];
+}
+
+size_t value_typed_array_element_size(TypedArrayKind kind) {
+  return typed_array_element_sizes[kind];
+}
+
+// the caller checks that the view lies within the buffer and is aligned
+Value* value_typed_array_create(Value *proto, TypedArrayKind kind, Value *buffer, uint32_t byte_offset, uint32_t length) {
+  Value *v = value_object_create(proto);
+
+  PrimitiveTypedArray *array = heap_alloc(sizeof(PrimitiveTypedArray));
+  array->type = PRIMITIVE_TYPED_ARRAY;
+  array->flags = 0;
+  array->value = 0;
+  array->kind = kind;
+  array->byte_offset = byte_offset;
+  array->length = length;
+  array->buffer = heap_encode(buffer);
+  v->primitive = heap_encode((Primitive*)array);
+
+  return v;
+}
+
+Value* value_typed_array_new(Binding *binding, TypedArrayKind kind, Value *buffer, uint32_t byte_offset, uint32_t length) {
+  Value *klass = env_get(binding->global, value_typed_array_name(kind));
+  Value *proto = value_object_get(klass, value_string_new("prototype"));
+  return value_typed_array_create(proto, kind, buffer, byte_offset, length);
+}
+
+TypedArrayKind value_typed_array_kind(Value *v) {
+  return TYPED_ARRAY_UNWRAP(v)->kind;
+}
+
+uint32_t value_typed_array_length(Value *v) {
+  return TYPED_ARRAY_UNWRAP(v)->length;
+}
+
+uint32_t value_typed_array_byte_offset(Value *v) {
+  return TYPED_ARRAY_UNWRAP(v)->byte_offset;
+}
+
+Value* value_typed_array_buffer(Value *v) {
+  return HEAP_GET(Value, TYPED_ARRAY_UNWRAP(v)->buffer);
+}
+
+void* value_typed_array_data(Value *v) {
+  PrimitiveTypedArray *array = TYPED_ARRAY_UNWRAP(v);
+  return (char*)value_array_buffer_data(heap_decode(array->buffer)) + array->byte_offset;
+}
+
+// the element index a key denotes, or -1 when it is not an integer within the view
+long value_typed_array_index(PrimitiveTypedArray *array, Value *index) {
+  if (!IS_NUMBER(index)) return -1;
+
+  double n = value_number_unwrap(index);
+  if (!(n >= 0 && n < array->length) || n != (uint32_t)n) return -1;
+  return (long)n;
+}
+
+// ToInt32 and ToUint8: wraps around modulo 2^32 or 2^8. NaN and infinities become 0
+double value_typed_array_wrap(double n, double modulo) {
+  if (!isfinite(n)) return 0;
+
+  n = fmod(trunc(n), modulo);
+  return n < 0 ? n + modulo : n;
+}
+
+// element i, which the caller has checked to be in range
+double value_typed_array_load(Value *v, uint32_t i) {
+  void *data = value_typed_array_data(v);
+  switch (TYPED_ARRAY_UNWRAP(v)->kind) {
+    case TYPED_ARRAY_FLOAT64: return ((double*)data)[i];
+    case TYPED_ARRAY_INT32: return ((int32_t*)data)[i];
+    case TYPED_ARRAY_UINT8: return ((uint8_t*)data)[i];
+  }
+
+  return NAN;
+}
+
+// stores n converted to the element type. i must be in range
+void value_typed_array_store(Value *v, uint32_t i, double n) {
+  void *data = value_typed_array_data(v);
+  switch (TYPED_ARRAY_UNWRAP(v)->kind) {
+    case TYPED_ARRAY_FLOAT64: ((double*)data)[i] = n; break;
+    case TYPED_ARRAY_INT32: ((int32_t*)data)[i] = (int32_t)(uint32_t)value_typed_array_wrap(n, 4294967296.0); break;
+    case TYPED_ARRAY_UINT8: ((uint8_t*)data)[i] = (uint8_t)value_typed_array_wrap(n, 256); break;
+  }
+}
+
+// NULL when the index is out of range
+Value* value_typed_array_get(Value *v, Value *index) {
+  long i = value_typed_array_index(TYPED_ARRAY_UNWRAP(v), index);
+  if (i < 0) return NULL;
+
+  return value_number_new(value_typed_array_load(v, i));
+}
+
+// numbers and booleans are stored converted to the element type, anything else as NaN.
+// stores out of range are dropped
+void value_typed_array_set(Value *v, Value *index, Value *value) {
+  long i = value_typed_array_index(TYPED_ARRAY_UNWRAP(v), index);
+  if (i < 0) return;
+
+  Primitive *primitive = value == NULL ? NULL : VALUE_PRIMITIVE(value);
+  int numeric = primitive != NULL && (primitive->type == PRIMITIVE_NUMBER || primitive->type == PRIMITIVE_BOOLEAN);
+  value_typed_array_store(v, i, numeric ? primitive->value : NAN);
+}
+
+// a view of the elements [begin, end) sharing the buffer
+Value* value_typed_array_subarray(Binding *binding, Value *v, uint32_t begin, uint32_t end) {
+  PrimitiveTypedArray *array = TYPED_ARRAY_UNWRAP(v);
+  if (end > array->length) end = array->length;
+  if (begin > end) begin = end;
+
+  uint32_t byte_offset = array->byte_offset + begin * value_typed_array_element_size(array->kind);
+  Value *buffer = heap_decode(array->buffer);
+  return value_typed_array_create(VALUE_PROTO(v), array->kind, buffer, byte_offset, end - begin);
+}
+
+void value_typed_array_fill(Value *v, Value *x, uint32_t start, uint32_t end) {
+  PrimitiveTypedArray *array = TYPED_ARRAY_UNWRAP(v);
+  if (end > array->length) end = array->length;
+  if (start >= end) return;
+
+  if (array->kind == TYPED_ARRAY_FLOAT64 && IS_NUMBER(x)) {
+    vector_fill((double*)value_typed_array_data(v) + start, end - start, value_number_unwrap(x));
+    return;
+  }
+
+  // convert once, then copy the bytes of the first element
+  value_typed_array_set(v, value_number_new(start), x);
+  size_t element_size = value_typed_array_element_size(array->kind);
+  char *data = value_typed_array_data(v);
+  if (element_size == 1) {
+    memset(data + start + 1, data[start], end - start - 1);
+    return;
+  }
+
+  for (uint32_t i = start + 1; i < end; i++) {
+    memcpy(data + i * element_size, data + start * element_size, element_size);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef MJS_TYPED_ARRAY_H
+#define MJS_TYPED_ARRAY_H
+
+#include "value.h"
+
+Value* value_array_buffer_new(Binding *binding, uint32_t byte_length);
+Value* value_array_buffer_create(Value *proto, uint32_t byte_length);
+uint32_t value_array_buffer_byte_length(Value *buffer);
+void* value_array_buffer_data(Value *buffer);
+
+const char* value_typed_array_name(TypedArrayKind kind);
+size_t value_typed_array_element_size(TypedArrayKind kind);
+
+Value* value_typed_array_new(Binding *binding, TypedArrayKind kind, Value *buffer, uint32_t byte_offset, uint32_t length);
+Value* value_typed_array_create(Value *proto, TypedArrayKind kind, Value *buffer, uint32_t byte_offset, uint32_t length);
+TypedArrayKind value_typed_array_kind(Value *array);
+uint32_t value_typed_array_length(Value *array);
+uint32_t value_typed_array_byte_offset(Value *array);
+Value* value_typed_array_buffer(Value *array);
+// the elements in place, for natives that work on the raw data
+void* value_typed_array_data(Value *array);
+
+double value_typed_array_load(Value *array, uint32_t i);
+void value_typed_array_store(Value *array, uint32_t i, double n);
+Value* value_typed_array_get(Value *array, Value *index);
+void value_typed_array_set(Value *array, Value *index, Value *value);
+Value* value_typed_array_subarray(Binding *binding, Value *array, uint32_t begin, uint32_t end);
+void value_typed_array_fill(Value *array, Value *x, uint32_t start, uint32_t end);
+
+#endif
@@ -0,0 +1,114 @@
+#include "value.h"
+#include "object.h"
+#include "number.h"
+#include "typed_array.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Value* get(Value *array, double i) {
+  return value_typed_array_get(array, value_number_new(i));
+}
+
+void set(Value *array, double i, double n) {
+  value_typed_array_set(array, value_number_new(i), value_number_new(n));
+}
+
+Value* create(TypedArrayKind kind, Value *buffer, uint32_t byte_offset, uint32_t length) {
+  return value_typed_array_create(NULL, kind, buffer, byte_offset, length);
+}
+
+void test_array_buffer_zeroed() {
+  Value *buffer = value_array_buffer_create(NULL, 13);
+  assert(value_array_buffer_byte_length(buffer) == 13);
+
+  unsigned char *data = value_array_buffer_data(buffer);
+  for (int i = 0; i < 13; i++) assert(data[i] == 0);
+}
+
+void test_typed_array_float64() {
+  Value *array = create(TYPED_ARRAY_FLOAT64, value_array_buffer_create(NULL, 8 * 4), 0, 4);
+  set(array, 0, 1.5);
+  set(array, 3, -0.25);
+
+  assert(value_number_unwrap(get(array, 0)) == 1.5);
+  assert(value_number_unwrap(get(array, 1)) == 0);
+  assert(value_number_unwrap(get(array, 3)) == -0.25);
+
+  // out of range and non-integer indices are neither read nor written
+  assert(get(array, 4) == NULL);
+  assert(get(array, -1) == NULL);
+  assert(get(array, 0.5) == NULL);
+  set(array, 4, 1);
+  set(array, 1.5, 1);
+  assert(value_number_unwrap(get(array, 1)) == 0);
+
+  double *data = value_typed_array_data(array);
+  assert(data[0] == 1.5 && data[3] == -0.25);
+}
+
+void test_typed_array_conversions() {
+  Value *buffer = value_array_buffer_create(NULL, 16);
+  Value *ints = create(TYPED_ARRAY_INT32, buffer, 0, 4);
+  set(ints, 0, 2147483648.0);
+  set(ints, 1, -1.9);
+  set(ints, 2, 4294967297.0);
+  set(ints, 3, NAN);
+  assert(value_number_unwrap(get(ints, 0)) == -2147483648.0);
+  assert(value_number_unwrap(get(ints, 1)) == -1);
+  assert(value_number_unwrap(get(ints, 2)) == 1);
+  assert(value_number_unwrap(get(ints, 3)) == 0);
+
+  Value *bytes = create(TYPED_ARRAY_UINT8, value_array_buffer_create(NULL, 4), 0, 4);
+  set(bytes, 0, 256);
+  set(bytes, 1, -1);
+  set(bytes, 2, 300.7);
+  set(bytes, 3, INFINITY);
+  assert(value_number_unwrap(get(bytes, 0)) == 0);
+  assert(value_number_unwrap(get(bytes, 1)) == 255);
+  assert(value_number_unwrap(get(bytes, 2)) == 44);
+  assert(value_number_unwrap(get(bytes, 3)) == 0);
+}
+
+void test_typed_array_views_share_buffer() {
+  Value *buffer = value_array_buffer_create(NULL, 8);
+  Value *bytes = create(TYPED_ARRAY_UINT8, buffer, 0, 8);
+  Value *ints = create(TYPED_ARRAY_INT32, buffer, 4, 1);
+
+  set(ints, 0, 0x01020304);
+  assert(value_typed_array_buffer(ints) == buffer);
+  assert((char*)value_typed_array_data(ints) == (char*)value_typed_array_data(bytes) + 4);
+
+  // little endian
+  assert(value_number_unwrap(get(bytes, 4)) == 4);
+  assert(value_number_unwrap(get(bytes, 7)) == 1);
+}
+
+void test_typed_array_fill() {
+  Value *ints = create(TYPED_ARRAY_INT32, value_array_buffer_create(NULL, 4 * 10), 0, 10);
+  value_typed_array_fill(ints, value_number_new(-7), 2, 8);
+  assert(value_number_unwrap(get(ints, 1)) == 0);
+  assert(value_number_unwrap(get(ints, 2)) == -7);
+  assert(value_number_unwrap(get(ints, 7)) == -7);
+  assert(value_number_unwrap(get(ints, 8)) == 0);
+
+  Value *bytes = create(TYPED_ARRAY_UINT8, value_array_buffer_create(NULL, 5), 0, 5);
+  value_typed_array_fill(bytes, value_number_new(257), 0, 5);
+  for (int i = 0; i < 5; i++) assert(value_number_unwrap(get(bytes, i)) == 1);
+
+  Value *doubles = create(TYPED_ARRAY_FLOAT64, value_array_buffer_create(NULL, 8 * 9), 0, 9);
+  value_typed_array_fill(doubles, value_number_new(2.5), 1, 100);
+  assert(value_number_unwrap(get(doubles, 0)) == 0);
+  assert(value_number_unwrap(get(doubles, 8)) == 2.5);
+}
+
+int main(int argc, char const **argv) {
+  test_array_buffer_zeroed();
+  test_typed_array_float64();
+  test_typed_array_conversions();
+  test_typed_array_views_share_buffer();
+  test_typed_array_fill();
+  return 0;
+}
@@ -6,13 +6,25 @@
 #include "boolean.h"
 #include "number.h"
 #include "array.h"
+#include "typed_array.h"
 #include "function.h"
 #include "string.h"
 #include "inspect.h"
+#include "inline.h"
+#include "builtin.h"
+#include "worker.h"
+#include "parallel.h"
+#include "promise.h"
+#include "generator.h"
+#include "reader.h"
+#include "json.h"
+#include "loop.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <pthread.h>
 
 #define RUNTIME_ERROR(...) \
   fprintf(stderr, "runtime error: "); \
@@ -20,36 +32,54 @@
   fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
   abort();
 
-#define FUNCTION_UNWRAP(X) (((X)->primitive != NULL && (X)->primitive->type == PRIMITIVE_FUNCTION) ? (PrimitiveFunction*)((X)->primitive) : NULL)
+#define IS_FUNCTION(X) ((X) != NULL && VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_FUNCTION)
+#define FUNCTION_UNWRAP(X) ((VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_FUNCTION) ? (PrimitiveFunction*)VALUE_PRIMITIVE(X) : NULL)
+#define IS_ARRAY(X) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_ARRAY)
+#define ARRAY_UNWRAP(X) ((PrimitiveArray*)VALUE_PRIMITIVE(X))
+#define IS_NUMBER(X) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_NUMBER)
+#define IS_TYPED_ARRAY(X) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_TYPED_ARRAY)
+#define IS_ARRAY_BUFFER(X) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == PRIMITIVE_ARRAY_BUFFER)
 
 Env* env_new(Env *parent) {
   Env *env = malloc(sizeof(Env));
   env->table = hash_table_new();
   env->parent = parent;
+  env->isolate = parent == NULL ? NULL : parent->isolate;
   return env;
 }
 
-typedef struct CallContext {
-  int returned;
-} CallContext;
+// atoms the evaluator looks up, interned once for all isolates
+Atom *this_atom = NULL;
+pthread_once_t value_atoms_once = PTHREAD_ONCE_INIT;
 
-CallContext context;
-CallContext *ctx = &context;
+void value_atoms_init() {
+  this_atom = atom_intern("this");
+}
+
+void require_builtins(BuiltinOwner owner, Value *object);
+
+Value* env_get_atom(Env *env, Atom *key) {
+  for (; env != NULL; env = env->parent) {
+    Value* value = hash_table_get_atom(env->table, key);
+    if (value != NULL) return value;
+  }
 
-Binding binding_data;
-Binding *binding = &binding_data;
+  return NULL;
+}
 
 Value* env_get(Env *env, const char *key)  {
-  if (env == NULL) return NULL;
+  Atom *atom = atom_find(key);
+  if (atom == NULL) return NULL;
 
-  Value* value = hash_table_get(env->table, key);
-  if (value != NULL) return value;
+  return env_get_atom(env, atom);
+}
 
-  return env_get(env->parent, key);
+void env_set_atom(Env *env, Atom *key, Value *value) {
+  hash_table_set_atom(env->table, key, value);
 }
 
 void env_set(Env *env, const char *key, Value *value) {
-  hash_table_set(env->table, key, value);
+  env_set_atom(env, atom_intern(key), value);
 }
 
 Value* require_object_prototype(Binding *binding) {
@@ -58,7 +88,7 @@ Value* require_object_prototype(Binding *binding) {
   return binding->object_prototype;
 }
 
-void load_prelude() {
+void load_prelude(Binding *binding) {
   require_object_prototype(binding);
 }
 
@@ -72,8 +102,9 @@ const char* value_typeof(Value *v) {
     }
   }
 
-  if (v->primitive != NULL) {
-    switch (v->primitive->type) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive != NULL) {
+    switch (primitive->type) {
       case PRIMITIVE_FUNCTION: {
         return "function";
       }
@@ -92,15 +123,20 @@ const char* value_typeof(Value *v) {
   return "object";
 }
 int value_is_truthy(Value *v) {
-  if (v->primitive == NULL) return 0;
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL) return 0;
 
-  switch (v->primitive->type) {
+  switch (primitive->type) {
     case PRIMITIVE_BOOLEAN:
     case PRIMITIVE_NUMBER: {
       double n = value_number_unwrap(v);
       return n != 0;
     }
 
+    case PRIMITIVE_STRING: {
+      return value_string_length(v) != 0;
+    }
+
     default: {
       fprintf(stderr, "unexpected value type %d for value_is_truthy\n", v->kind);
       abort();
@@ -116,20 +152,24 @@ void value_pp(Value *v) {
   printf("%s\n", s);
 }
 
-Value* native_console_log(Value *this, int size, Value **args) {
-  for (int i = 0; i < size; i++) {
-    Value *v = args[i];
-    if (v == NULL) {
-      fprintf(stderr, "log error: unexpected null\n");
-      abort();
-    }
+Value* native_console_log1(Isolate *isolate, Value *this, Value *v) {
+  if (v == NULL) {
+    fprintf(stderr, "log error: unexpected null\n");
+    abort();
+  }
 
-    const char *str = value_inspect(v);
-    if (str == NULL) {
-      fprintf(stderr, "log error: type %s cannot be inspect\n", PrimitiveTypeString[v->kind]);
-      abort();
-    }
-    printf("%s\n", str);
+  const char *str = value_inspect(v);
+  if (str == NULL) {
+    fprintf(stderr, "log error: type %s cannot be inspect\n", PrimitiveTypeString[v->kind]);
+    abort();
+  }
+  fprintf(isolate->out, "%s\n", str);
+  return NULL;
+}
+
+Value* native_console_log(Isolate *isolate, Value *this, int size, Value **args) {
+  for (int i = 0; i < size; i++) {
+    native_console_log1(isolate, this, args[i]);
   }
   return NULL;
 }
@@ -141,12 +181,30 @@ void assert_args_size(int size, int expected) {
   }
 }
 
+int value_is_string(Value *v) {
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  return primitive != NULL && primitive->type == PRIMITIVE_STRING;
+}
+
+// string + anything concatenates, which makes a rope instead of copying both sides
+Value* value_add(int size, Value **args) {
+  assert_args_size(size, 2);
+  Value *left = args[0];
+  Value *right = args[1];
+
+  if (value_is_string(left) || value_is_string(right)) {
+    return value_string_concat(value_to_string(left), value_to_string(right));
+  }
+
+  return value_number_add(size, args);
+}
+
 Value* value_equal(int size, Value **args) {
   assert_args_size(size, 2);
   Value *left = args[0];
   Value *right = args[1];
 
-  if (value_number_unwrap(left) == value_number_unwrap(right)) {
+  if (value_strict_equal(left, right)) {
     return value_true_new();
   } else  {
     return value_false_new();
@@ -179,18 +237,54 @@ Value* value_less_than(int size, Value **args) {
 
 Value* evaluate_node(Node *node, Env *env);
 Value* evaluate_node_children(Node *node, Env *env);
-Value* evaluate_node_from_source(char* source, Env *env);
+
+Value* evaluate_update(Node *node, Env *env, int used);
+Value* evaluate_operand(Node *node, Env *env);
+void value_escape(Value *v);
+int node_is_leaf(Node *node);
+
+// whether a condition holds. a comparison is decided without the boolean it would
+// evaluate to, so loops over many values don't allocate one per test
+int evaluate_condition(Node *node, Env *env) {
+  if (node->type != NODE_BINARY_OPERATOR) return value_is_truthy(evaluate_node(node, env));
+
+  char *identifier = node->value;
+  int equal = strcmp(identifier, "===") == 0;
+  int greater = strcmp(identifier, ">") == 0;
+  int less = strcmp(identifier, "<") == 0;
+  if (!equal && !greater && !less) return value_is_truthy(evaluate_node(node, env));
+
+  // nor is a string for a literal it is compared with
+  Node *literal = node->children[1];
+  if (equal && literal->type == NODE_PRIMITIVE_STRING) {
+    return value_string_equal_atom(evaluate_operand(node->children[0], env), literal->atom);
+  }
+
+  Value *left = evaluate_operand(node->children[0], env);
+  if (!node_is_leaf(node->children[1])) value_escape(left);
+  Value *right = evaluate_operand(node->children[1], env);
+
+  if (equal) return value_strict_equal(left, right);
+  if (greater) return value_number_unwrap(left) > value_number_unwrap(right);
+  return value_number_unwrap(left) < value_number_unwrap(right);
+}
+
+int node_is_update(Node *node) {
+  return node->type == NODE_PREFIX_UPDATE || node->type == NODE_POSTFIX_UPDATE || node->type == NODE_COMPOUND_ASSIGNMENT;
+}
 
 Value* evaluate_node_children(Node *node, Env *env) {
   Value *result = NULL;
   for (int i = 0; node->children[i] != NULL; i++) {
     Node *child = node->children[i];
 
-    Value *value = evaluate_node(child, env);
-    if (ctx->returned) {
+    Value *value = node_is_update(child) ? evaluate_update(child, env, 0) : evaluate_node(child, env);
+    if (env->isolate->returned) {
       result = value;
       break;
     }
+
+    if (env->isolate->breaking) break;
   }
 
   return result;
@@ -205,318 +299,1479 @@ Value* evaluate_function_call(Value *f, Value *this, Value **args, int size, Env
   if (this == NULL) this = value_undefined_new();
 
   if (value->fn != NULL) {
-    return (*(value->fn))(this, size, args);
+    env->isolate->env = env;
+    env->isolate->callee = f;
+    return (*(value->fn))(env->isolate, this, size, args);
   }
 
   Node *node = value->node;
-  ctx->returned = 0;
+  env->isolate->returned = 0;
 
   Env *function_env = env_new(env);
 
-  for (int i = 0; i < size; i++) {
+  // arguments past the declared parameters are dropped
+  for (int i = 0; i < size && value->node->args[i] != NULL; i++) {
     Node *arg = value->node->args[i];
-    hash_table_set(function_env->table, arg->value, args[i]);
+    env_set_atom(function_env, arg->atom, args[i]);
   }
 
-  env_set(function_env, "this", this);
+  env_set_atom(function_env, this_atom, this);
+  // the body of a function* runs when the generator is asked for values
+  if (node->generator) return value_generator_new(function_env, node);
+
   Value *result = evaluate_node_children(node, function_env);
+  env->isolate->returned = 0;
+  env->isolate->breaking = 0;
   return result;
 }
 
-Value* evaluate_node(Node *node, Env *env) {
-  switch (node->type) {
-    // primitive nodes
-    case NODE_PRIMITIVE_NUMBER: {
-      char *str = node->value;
-      Value *v = value_number_new((double)atoi(str));
-      return v;
-    }
+// properties are added in source order to a table sized for all of them
+Value* evaluate_object_literal(Node *node, Env *env, Value *object) {
+  int size = 0;
+  while (node->children[size] != NULL) size++;
+  if (size > 0) value_object_reserve(object, size);
 
-    case NODE_PRIMITIVE_UNDEFINED: {
-      return value_undefined_new();
-    }
+  for (int i = 0; i < size; i++) {
+    Node *entry = node->children[i];
+    Node *identifier_node = entry->children[0];
+    Node *value_node = entry->children[1];
 
-    case NODE_PRIMITIVE_NULL: {
-      return value_null_new();
-    }
+    Value *v = evaluate_node(value_node, env);
 
-    case NODE_PRIMITIVE_BOOLEAN: {
-      if (strcmp(node->value, "true") == 0) {
-        return value_true_new();
-      } else if (strcmp(node->value, "false") == 0) {
-        return value_false_new();
-      } else {
-        fprintf(stderr, "runtime error: unexpected value for boolean: %s\n", node->value);
-        abort();
-      }
-    }
+    value_object_set_atom(object, identifier_node->atom, v);
+  }
 
-    case NODE_PRIMITIVE_STRING: {
-      return value_string_new(node->value);
-    }
+  return object;
+}
 
-    case NODE_STATEMENT_LIST: {
-      for (int i = 0; node->children[i] != NULL; i++) {
-        Node *child = node->children[i];
-        evaluate_node(child, env);
-      }
+Value* evaluate_array_literal(Node *node, Env *env, Value *array) {
+  for (int i = 0; node->children[i] != NULL; i++) {
+    Node *child = node->children[i];
+    Value *el = evaluate_node(child, env);
+    value_array_set(array, value_number_new(i), el);
+  }
 
-      break;
-    }
+  return array;
+}
+
+// a variable's number stops being owned once something else may hold on to it
+void value_escape(Value *v) {
+  // only written when set: parallelMap's threads escape the same shared values
+  if (v != NULL && VALUE_PRIMITIVE(v) != NULL && (VALUE_PRIMITIVE(v)->flags & PRIMITIVE_FLAG_OWNED)) {
+    VALUE_PRIMITIVE(v)->flags &= ~PRIMITIVE_FLAG_OWNED;
+  }
+}
+
+// nodes that neither run code nor change variables when evaluated
+int node_is_leaf(Node *node) {
+  switch (node->type) {
+    case NODE_IDENTIFIER:
+    case NODE_PRIMITIVE_NUMBER:
+    case NODE_PRIMITIVE_STRING:
+    case NODE_PRIMITIVE_BOOLEAN:
+    case NODE_PRIMITIVE_NULL:
+    case NODE_PRIMITIVE_UNDEFINED:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// like evaluate_node, for a value that is used up before anything else runs,
+// such as an operand or a key. a variable's number keeps being owned
+Value* evaluate_operand(Node *node, Env *env) {
+  if (node->type == NODE_IDENTIFIER) return env_get_atom(env, node->atom);
+  if (node_is_update(node)) return evaluate_update(node, env, 1);
+  return evaluate_node(node, env);
+}
+
+// ToNumber for update operators and Math. booleans and null convert, anything
+// else is NaN
+double value_to_number(Value *v) {
+  if (v == NULL) return NAN;
+  if (v->kind == VALUE_KIND_NULL) return 0;
+
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive != NULL && (primitive->type == PRIMITIVE_NUMBER || primitive->type == PRIMITIVE_BOOLEAN)) {
+    return primitive->value;
+  }
+
+  return NAN;
+}
+
+double value_update_apply(char op, double x, double y) {
+  switch (op) {
+    case '+': return x + y;
+    case '-': return x - y;
+    default: return x * y;
+  }
+}
 
+// ++x, x++, --x, x--, x += y, x -= y and x *= y. a variable holding an owned number
+// and the elements of double and typed arrays are changed in place, without
+// allocating. returns the new value, or the old one for x++. with used 0 the result
+// is discarded and may be NULL
+Value* evaluate_update(Node *node, Env *env, int used) {
+  Node *target = node->children[0];
+  Node *right_node = node->type == NODE_COMPOUND_ASSIGNMENT ? node->children[1] : NULL;
+  char op = node->value[0];
+  int postfix = node->type == NODE_POSTFIX_UPDATE;
+
+  switch (target->type) {
     case NODE_IDENTIFIER: {
-      Value *value = env_get(env, node->value);
-      return value;
-    }
+      Value *old = env_get_atom(env, target->atom);
+      if (old == NULL) {
+        RUNTIME_ERROR("`%s` is not defined", target->value);
+      }
 
-    case NODE_VAR_DECLARATION: {
-      Node *identifier = node->children[0];
-      Node *right = node->children[1];
+      double x = value_to_number(old);
+      Value *right = right_node == NULL ? NULL : evaluate_operand(right_node, env);
 
-      Value *value = right == NULL ? value_undefined_new() : evaluate_node(right, env);
+      Value *result;
+      if (op == '+' && right != NULL && (value_is_string(old) || value_is_string(right))) {
+        Value *args[] = { old, right };
+        result = value_add(2, args);
+      } else {
+        double n = value_update_apply(op, x, right == NULL ? 1 : value_to_number(right));
+
+        // the right side may have assigned the variable, so it is looked up again
+        Value *current = hash_table_get_atom(env->table, target->atom);
+        Primitive *primitive = current == NULL ? NULL : VALUE_PRIMITIVE(current);
+        if (primitive != NULL && (primitive->flags & PRIMITIVE_FLAG_OWNED) && primitive->type == PRIMITIVE_NUMBER) {
+          primitive->value = n;
+          if (!used) return NULL;
+          return postfix ? value_number_new(x) : current;
+        }
 
-      env_set(env, identifier->value, value);
-      break;
+        result = value_number_new(n);
+        VALUE_PRIMITIVE(result)->flags |= PRIMITIVE_FLAG_OWNED;
+      }
+
+      env_set_atom(env, target->atom, result);
+      if (!used) return NULL;
+      return postfix ? value_number_new(x) : result;
     }
 
-    case NODE_VAR_ASSIGNMENT: {
-      Node *left = node->children[0];
-      Node *right = node->children[1];
-      Value *right_value = evaluate_node(right, env);
+    case NODE_OBJECT_MEMBER_ACCESS: {
+      Value *object = evaluate_node(target->children[0], env);
+      Node *property = target->children[1];
+      Value *key = property->type == NODE_PRIMITIVE_STRING ? value_string_new_atom(property->atom) : evaluate_operand(property, env);
+      if (object->kind != VALUE_KIND_OBJECT) {
+        RUNTIME_ERROR("cannot update property of %s", value_inspect(object));
+      }
 
-      switch (left->type) {
-        case NODE_IDENTIFIER: {
-          env_set(env, left->value, right_value);
-          break;
+      // the key is used again after the right side ran
+      if (right_node != NULL && !node_is_leaf(right_node)) value_escape(key);
+      Value *right = right_node == NULL ? NULL : evaluate_operand(right_node, env);
+      double y = right == NULL ? 1 : value_to_number(right);
+
+      if (IS_NUMBER(key) && (right == NULL || IS_NUMBER(right))) {
+        double index = value_number_unwrap(key);
+        double *slot = IS_ARRAY(object) ? value_array_double_slot(object, index) : NULL;
+        if (slot != NULL) {
+          double x = *slot;
+          *slot = value_update_apply(op, x, y);
+          if (!used) return NULL;
+          return value_number_new(postfix ? x : *slot);
         }
 
-        case NODE_OBJECT_MEMBER_ACCESS: {
-          Value *v = evaluate_node(left->children[0], env);
-          Value *property = evaluate_node(left->children[1], env);
-          value_object_set(v, property, right_value);
-          break;
+        if (IS_TYPED_ARRAY(object) && index >= 0 && index < value_typed_array_length(object) && index == (uint32_t)index) {
+          double x = value_typed_array_load(object, index);
+          value_typed_array_store(object, index, value_update_apply(op, x, y));
+          if (!used) return NULL;
+          // the stored value, after conversion to the element type
+          return value_number_new(postfix ? x : value_typed_array_load(object, index));
         }
+      }
 
-        default: {
-          fprintf(stderr, "runtime error: unexpected node type for left of assignment: %s\n", NodeTypeString[left->type]);
-          abort();
-        }
+      Value *old = value_object_get(object, key);
+      Value *result;
+      if (op == '+' && right != NULL && (value_is_string(old) || value_is_string(right))) {
+        Value *args[] = { old, right };
+        result = value_add(2, args);
+      } else {
+        result = value_number_new(value_update_apply(op, value_to_number(old), y));
       }
 
-      return right_value;
+      value_object_set(object, key, result);
+      if (!used) return NULL;
+      return postfix ? value_number_new(value_to_number(old)) : result;
     }
 
-    case NODE_FUNCTION: {
-      Value *v = value_function_new(node);
-      return v;
+    default: {
+      RUNTIME_ERROR("unexpected node type for target of update: %s", NodeTypeString[target->type]);
     }
+  }
 
-    case NODE_STATEMENT_RETURN: {
-      Value *value = evaluate_node(node->children[0], env);
-      ctx->returned = 1;
-      return value;
-    }
+  return NULL;
+}
 
-    case NODE_STATEMENT_IF: {
-      Value *condition = evaluate_node(node->args[0], env);
-      if (value_is_truthy(condition)) {
-        Value *result = evaluate_node_children(node, env);
-        return result;
-      }
+// looks up the function a call calls. member access leaves the object in `this`
+Value* evaluate_callee(Node *callee_node, Env *env) {
+  env_set_atom(env, this_atom, NULL);
+  Value *callee = evaluate_node(callee_node, env);
+  if (callee == NULL) {
+    RUNTIME_ERROR("function `%s` is not defined", callee_node->value);
+  }
 
-      return NULL;
+  if (strcmp(value_typeof(callee), "function") != 0) {
+    RUNTIME_ERROR("`%s` is not function, but %s", callee_node->value, value_typeof(callee));
+  }
+
+  return callee;
+}
+
+Value* evaluate_native_entry(Isolate *isolate, PrimitiveFunction *function, Value *this, Value **args) {
+  switch (function->arity) {
+    case 0: return function->entry.fn0(isolate, this);
+    case 1: return function->entry.fn1(isolate, this, args[0]);
+    case 2: return function->entry.fn2(isolate, this, args[0], args[1]);
+    default: return function->entry.fn3(isolate, this, args[0], args[1], args[2]);
+  }
+}
+
+// where the isolate keeps the state of a node with a slot, NULL until it is set
+void** isolate_slot(Isolate *isolate, Node *node) {
+  if (node->slot >= isolate->slot_cap) {
+    int cap = isolate->slot_cap == 0 ? 64 : isolate->slot_cap;
+    while (cap <= node->slot) cap *= 2;
+
+    isolate->slots = realloc(isolate->slots, cap * sizeof(void*));
+    memset(isolate->slots + isolate->slot_cap, 0, (cap - isolate->slot_cap) * sizeof(void*));
+    isolate->slot_cap = cap;
+  }
+
+  return &isolate->slots[node->slot];
+}
+
+#define CALL_STACK_ARGS 8
+
+// the callee a call site called last. while it calls the same one again, the callee is
+// not checked again, and a native with an entry point for this many arguments is called
+// through it directly
+typedef struct CallCache {
+  Value *callee;
+  PrimitiveFunction *function;
+  int use_entry;
+} CallCache;
+
+// calls the callee of a NODE_FUNCTION_CALL with the evaluated arguments
+Value* evaluate_call_site(Node *node, Env *env, Value **args, int size) {
+  Node *callee_node = node->children[0];
+  env_set_atom(env, this_atom, NULL);
+  Value *callee = evaluate_node(callee_node, env);
+
+  void **slot = isolate_slot(env->isolate, node);
+  CallCache *cache = *slot;
+  if (cache == NULL || cache->callee != callee) {
+    if (callee == NULL) {
+      RUNTIME_ERROR("function `%s` is not defined", callee_node->value);
     }
 
-    case NODE_STATEMENT_WHILE: {
-      while (value_is_truthy(evaluate_node(node->args[0], env))) {
-        evaluate_node_children(node, env);
-      }
+    PrimitiveFunction *function = FUNCTION_UNWRAP(callee);
+    if (function == NULL) {
+      RUNTIME_ERROR("`%s` is not function, but %s", callee_node->value, value_typeof(callee));
+    }
 
-      return NULL;
+    if (cache == NULL) {
+      cache = malloc(sizeof(CallCache));
+      *slot = cache;
     }
+    cache->callee = callee;
+    cache->function = function;
+    cache->use_entry = function->fn != NULL && function->arity == size;
+  }
 
-    case NODE_BINARY_OPERATOR: {
-      char *identifier = node->value;
-      Node **children = node->children;
+  Value *this = env_get_atom(env, this_atom);
+  if (!cache->use_entry) return evaluate_function_call(callee, this, args, size, env);
 
-      int size = 0;
-      while(children[size] != NULL) size++;
+  env->isolate->env = env;
+  return evaluate_native_entry(env->isolate, cache->function, this == NULL ? value_undefined_new() : this, args);
+}
 
-      Value **args = malloc(size * sizeof(Value));
-      for (int i = 0; children[i] != NULL; i++) {
-        args[i] = evaluate_node(children[i], env);
-      }
+// the integer a number is, for looking it up among integer labels
+int value_switch_integer(Value *v, int *n) {
+  if (!IS_NUMBER(v)) return 0;
 
-      if (strcmp(identifier, "+") == 0) {
-        return value_number_add(size, args);
-      }
+  double x = value_number_unwrap(v);
+  if (!(x >= INT32_MIN && x <= INT32_MAX) || x != (int)x) return 0;
+  *n = (int)x;
+  return 1;
+}
 
-      if (strcmp(identifier, "-") == 0) {
-        return value_number_subtract(size, args);
-      }
+// the index of the case a switch starts at, or -1 when no case matches and there is
+// no default
+int evaluate_switch_case(Node *node, Env *env, Value *discriminant) {
+  SwitchTable *table = node->switch_table;
 
-      if (strcmp(identifier, "*") == 0) {
-        return value_number_multiply(size, args);
-      }
+  switch (table->dispatch) {
+    case SWITCH_DISPATCH_DENSE: {
+      int n;
+      if (!value_switch_integer(discriminant, &n)) break;
 
-      if (strcmp(identifier, "/") == 0) {
-        return value_number_divide(size, args);
-      }
+      long i = (long)n - table->min;
+      if (i >= 0 && i < table->size && table->cases[i] >= 0) return table->cases[i];
+      break;
+    }
 
-      if (strcmp(identifier, "===") == 0) {
-        return value_equal(size, args);
+    case SWITCH_DISPATCH_HASH: {
+      Atom *atom = NULL;
+      int n = 0;
+      if (value_is_string(discriminant)) {
+        // the labels are interned, so a string that was not equals none of them
+        atom = value_string_find_atom(discriminant);
+        if (atom == NULL) break;
+      } else if (!value_switch_integer(discriminant, &n)) {
+        break;
       }
 
-      if (strcmp(identifier, ">") == 0) {
-        return value_greater_than(size, args);
-      }
+      int i = switch_table_find(table, atom, n)->case_index;
+      if (i >= 0) return i;
+      break;
+    }
 
-      if (strcmp(identifier, "<") == 0) {
-        return value_less_than(size, args);
+    case SWITCH_DISPATCH_SEQUENTIAL: {
+      for (int i = 0; node->children[i] != NULL; i++) {
+        Node *label = node->children[i]->args[0];
+        if (label != NULL && value_strict_equal(discriminant, evaluate_node(label, env))) return i;
       }
-
-      fprintf(stderr, "runtime error: operator `%s` is not defined\n", identifier);
-      abort();
+      break;
     }
+  }
 
-    case NODE_FUNCTION_CALL: {
-      Node **children = (node->children) + 1;
+  return table->default_case;
+}
 
-      int size = 0;
-      while(children[size] != NULL) size++;
+// runs the body of a loop once. 1 when the loop stops, with *result set by a return
+int evaluate_loop_body(Node *node, Env *env, Value **result) {
+  Value *value = evaluate_node_children(node, env);
+  if (env->isolate->returned) {
+    *result = value;
+    return 1;
+  }
+  if (env->isolate->breaking) {
+    env->isolate->breaking = 0;
+    return 1;
+  }
 
-      Value **args = malloc(size * sizeof(Value));
-      for (int i = 0; children[i] != NULL; i++) {
-        args[i] = evaluate_node(children[i], env);
-      }
+  return 0;
+}
 
-      Node *callee_node = node->children[0];
-      env_set(env, "this", NULL);
-      Value *callee = evaluate_node(callee_node, env);
-      if (callee == NULL) {
-        RUNTIME_ERROR("function `%s` is not defined", callee_node->value);
-      }
+// for (var x of iterable) over the values of a generator, which is closed when the loop
+// is left early, the lines of stdin.lines(), or the elements of an array or typed array
+Value* evaluate_for_of(Node *node, Env *env) {
+  Atom *name = node->args[0]->atom;
+  Value *iterable = evaluate_node(node->args[1], env);
+  Value *result = NULL;
 
-      if (strcmp(value_typeof(callee), "function") != 0) {
-        RUNTIME_ERROR("`%s` is not function, but %s", callee_node->value, value_typeof(callee));
+  Generator *generator = value_generator_unwrap(iterable);
+  if (generator != NULL) {
+    Value *value;
+    while ((value = generator_next(generator, NULL)) != NULL) {
+      env_set_atom(env, name, value);
+      if (evaluate_loop_body(node, env, &result)) {
+        generator_close(generator);
+        break;
       }
-
-      Value *this = env_get(env, "this");
-      Value *return_value = evaluate_function_call(callee, this, args, size, env);
-      return return_value;
     }
 
+    return result;
+  }
 
-    case NODE_OBJECT: {
-      Value *object = value_object_new(binding);
-      for (int i = 0; node->children[i] != NULL; i++) {
-        Node *entry = node->children[i];
-        Node *identifier_node = entry->children[0];
-        Node *value_node = entry->children[1];
+  // each line is a view owned by the variable, and the next one reuses it unless it
+  // escaped (see reader.h)
+  LineReader *reader = value_line_iterator_unwrap(iterable);
+  if (reader != NULL) {
+    Value *line = NULL;
+    while ((line = line_reader_next_view(reader, line)) != NULL) {
+      env_set_atom(env, name, line);
+      if (evaluate_loop_body(node, env, &result)) break;
+    }
 
-        Value *vs = value_string_new(identifier_node->value);
-        Value *v = evaluate_node(value_node, env);
+    return result;
+  }
 
-        value_object_set(object, vs, v);
-      }
+  if (!IS_ARRAY(iterable) && !IS_TYPED_ARRAY(iterable)) {
+    RUNTIME_ERROR("%s is not iterable", value_inspect(iterable));
+  }
 
-      return object;
+  // the length is read again after each element, so the body may push or pop
+  for (unsigned int i = 0; ; i++) {
+    Value *index = value_number_new(i);
+    if (IS_ARRAY(iterable)) {
+      if (i >= value_number_unwrap(value_array_length(iterable))) break;
+      env_set_atom(env, name, value_array_get(iterable, index));
+    } else {
+      if (i >= value_typed_array_length(iterable)) break;
+      env_set_atom(env, name, value_typed_array_get(iterable, index));
     }
 
-    case NODE_OBJECT_MEMBER_ACCESS: {
-      Value *v = evaluate_node(node->children[0], env);
-      Value *name = evaluate_node(node->children[1], env);
-      if (v->kind != VALUE_KIND_OBJECT) {
-        fprintf(stderr, "runtime error: unexpected member access: %s\n", value_inspect(v));
-        abort();
-      }
+    if (evaluate_loop_body(node, env, &result)) break;
+  }
 
+  return result;
+}
 
-      env_set(env, "this", v);
-      Value *member_value = value_object_get(v, name);
+// runs the cases of a switch from the one that matches, until a break
+Value* evaluate_switch(Node *node, Env *env) {
+  Value *discriminant = evaluate_node(node->args[0], env);
+  int start = evaluate_switch_case(node, env, discriminant);
+  if (start < 0) return NULL;
+
+  // cases fall through until a break
+  for (int i = start; node->children[i] != NULL; i++) {
+    Value *result = evaluate_node_children(node->children[i], env);
+    if (env->isolate->returned) return result;
+    if (env->isolate->breaking) break;
+  }
 
-      if (strcmp(value_typeof(member_value), "function") == 0) {
-        if (FUNCTION_UNWRAP(member_value)->is_property) {
-          return evaluate_function_call(member_value, v, NULL, 0, env);
-        }
-      }
+  env->isolate->breaking = 0;
+  return NULL;
+}
 
-      return member_value;
-    }
+// x = y, obj.x = y and obj[k] = y
+Value* evaluate_assignment(Node *node, Env *env) {
+  Node *left = node->children[0];
+  Node *right = node->children[1];
+  Value *right_value = evaluate_node(right, env);
 
-    case NODE_ARRAY: {
-      Value *array = value_array_new(binding);
+  switch (left->type) {
+    case NODE_IDENTIFIER: {
+      env_set_atom(env, left->atom, right_value);
+      break;
+    }
 
-      for (int i = 0; node->children[i] != NULL; i++) {
-        Node *child = node->children[i];
-        Value *el = evaluate_node(child, env);
-        value_array_set(array, value_number_new(i), el);
+    case NODE_OBJECT_MEMBER_ACCESS: {
+      Value *v = evaluate_node(left->children[0], env);
+      Node *property = left->children[1];
+      if (property->type == NODE_PRIMITIVE_STRING) {
+        value_object_set_atom(v, property->atom, right_value);
+        break;
       }
 
-      return (Value*)array;
+      Value *key = evaluate_operand(property, env);
+      // typed[i] = x stores straight into the buffer
+      if (IS_TYPED_ARRAY(v) && IS_NUMBER(key)) {
+        value_typed_array_set(v, key, right_value);
+      } else {
+        value_object_set(v, key, right_value);
+      }
+      break;
     }
 
-    default:
-      fprintf(stderr, "runtime error: unexpected node type: %s\n", NodeTypeString[node->type]);
+    default: {
+      fprintf(stderr, "runtime error: unexpected node type for left of assignment: %s\n", NodeTypeString[left->type]);
       abort();
-      break;
     }
+  }
 
-  return NULL;
+  return right_value;
 }
 
-Value* evaluate_node_from_source(char* source, Env *env) {
-  Token *token = tokenize(source);
-  Node *node = parse(token);
-  return evaluate_node(node, env);
-}
+// for (var key in object) over the keys the object has when the loop starts
+Value* evaluate_for_in(Node *node, Env *env) {
+  Node *identifier = node->args[0];
+  Value *object = evaluate_node(node->args[1], env);
+  if (object->kind != VALUE_KIND_OBJECT) return NULL;
+
+  // keys are collected up front, so the body may add or delete properties
+  Value *keys = value_object_keys(&env->isolate->binding, object);
+  unsigned int length = value_number_unwrap(value_array_length(keys));
+  for (unsigned int i = 0; i < length; i++) {
+    env_set_atom(env, identifier->atom, value_array_get(keys, value_number_new(i)));
+
+    Value *result = evaluate_node_children(node, env);
+    if (env->isolate->returned) return result;
+    if (env->isolate->breaking) {
+      env->isolate->breaking = 0;
+      break;
+    }
+  }
 
-Value* require_klass_object(Binding *binding) {
-  Value *klass = value_function_new(NULL);
-  value_object_set(klass, value_string_new("prototype"), binding->object_prototype);
-  return klass;
+  return NULL;
 }
 
-Value* native_value_array_length(Value *this, int size, Value **args) {
-  return value_number_new((double)((PrimitiveArray*)this->primitive)->size);
-}
+// delete obj[k] and new F(...)
+Value* evaluate_unary_operator(Node *node, Env *env) {
+  if (strcmp(node->value, "delete") == 0) {
+    Node *target = node->children[0];
+    if (target->type != NODE_OBJECT_MEMBER_ACCESS) {
+      RUNTIME_ERROR("delete requires a property reference");
+    }
 
-Value* require_klass_array(Binding *binding) {
-  Value *klass = value_object_create(NULL);
+    Value *object = evaluate_node(target->children[0], env);
+    Value *key = evaluate_node(target->children[1], env);
+    if (object->kind != VALUE_KIND_OBJECT) {
+      RUNTIME_ERROR("cannot delete property of %s", value_inspect(object));
+    }
 
-  Value *array_prototype = value_object_create(NULL);
-  Value *f = value_function_native_new(native_value_array_length);
-  FUNCTION_UNWRAP(f)->is_property = 1;
-  value_object_set(array_prototype, value_string_new("length"), f);
+    value_object_delete(object, key);
+    return value_true_new();
+  }
 
-  value_object_set(klass, value_string_new("prototype"), array_prototype);
-  return klass;
-}
+  if (strcmp(node->value, "new") == 0) {
+    Node *call = node->children[0];
+    if (call == NULL) {
+      RUNTIME_ERROR("new requires a constructor");
+    }
 
-Value* require_module_console() {
-  Value *f = value_function_native_new(native_console_log);
+    Value *callee = evaluate_node(call->children[0], env);
+    if (callee == NULL || FUNCTION_UNWRAP(callee) == NULL) {
+      RUNTIME_ERROR("`%s` is not a constructor", call->children[0]->value);
+    }
 
-  Value *console = value_object_create(NULL);
-  value_object_set(console, value_string_new("log"), f);
-  return console;
-}
+    int size = 0;
+    while (call->children[size + 1] != NULL) size++;
 
-Env* env_global_new() {
-  Env *global = env_new(NULL);
-  binding->global = global;
+    Value **args = malloc(size * sizeof(Value*));
+    for (int i = 0; i < size; i++) {
+      args[i] = evaluate_node(call->children[i + 1], env);
+    }
 
-  load_prelude();
+    // native constructors make their own object
+    if (FUNCTION_UNWRAP(callee)->fn != NULL) {
+      return evaluate_function_call(callee, value_undefined_new(), args, size, env);
+    }
 
-  env_set(global, "Object", require_klass_object(binding));
-  env_set(global, "Array", require_klass_array(binding));
-  env_set(global, "console", require_module_console());
+    Value *proto = value_object_get(callee, value_string_new("prototype"));
+    Value *object = value_object_create(proto->kind == VALUE_KIND_OBJECT ? proto : env->isolate->binding.object_prototype);
+    Value *result = evaluate_function_call(callee, object, args, size, env);
+    return result != NULL && result->kind == VALUE_KIND_OBJECT && VALUE_PRIMITIVE(result) == NULL ? result : object;
+  }
 
-  return global;
+  fprintf(stderr, "runtime error: operator `%s` is not defined\n", node->value);
+  abort();
 }
 
+Value* evaluate_binary_operator(Node *node, Env *env) {
+  char *identifier = node->value;
+  Node **children = node->children;
 
-Value* evaluate(Node *node) {
-  Env *global = env_global_new();
+  int size = 0;
+  while(children[size] != NULL) size++;
+
+  Value *args[2];
+  args[0] = evaluate_operand(children[0], env);
+  // the left operand would change with it if the right one updated the variable
+  if (!node_is_leaf(children[1])) value_escape(args[0]);
+  args[1] = evaluate_operand(children[1], env);
+
+  if (strcmp(identifier, "+") == 0) {
+    return value_add(size, args);
+  }
+
+  if (strcmp(identifier, "-") == 0) {
+    return value_number_subtract(size, args);
+  }
+
+  if (strcmp(identifier, "*") == 0) {
+    return value_number_multiply(size, args);
+  }
+
+  if (strcmp(identifier, "/") == 0) {
+    return value_number_divide(size, args);
+  }
+
+  if (strcmp(identifier, "===") == 0) {
+    return value_equal(size, args);
+  }
+
+  if (strcmp(identifier, ">") == 0) {
+    return value_greater_than(size, args);
+  }
+
+  if (strcmp(identifier, "<") == 0) {
+    return value_less_than(size, args);
+  }
+
+  fprintf(stderr, "runtime error: operator `%s` is not defined\n", identifier);
+  abort();
+}
+
+Value* evaluate_call(Node *node, Env *env) {
+  Node **children = (node->children) + 1;
+
+  int size = 0;
+  while(children[size] != NULL) size++;
+
+  // callees copy what they keep, so short argument lists live on the stack
+  Value *stack_args[CALL_STACK_ARGS];
+  Value **args = size <= CALL_STACK_ARGS ? stack_args : malloc(size * sizeof(Value*));
+  for (int i = 0; children[i] != NULL; i++) {
+    args[i] = evaluate_node(children[i], env);
+  }
+
+  return evaluate_call_site(node, env, args, size);
+}
+
+// a call the parser inlined runs the body with the arguments in the inline frame,
+// unless the name refers to another function by now
+Value* evaluate_inline_call(Node *node, Env *env) {
+  InlineCall *call = node->inline_call;
+  Node **children = (node->children) + 1;
+
+  Value *args[INLINE_MAX_ARGS];
+  int size = 0;
+  for (; children[size] != NULL; size++) {
+    args[size] = evaluate_node(children[size], env);
+  }
+
+  Value *callee = evaluate_callee(node->children[0], env);
+  PrimitiveFunction *function = FUNCTION_UNWRAP(callee);
+  if (function->node == call->function) {
+    memcpy(env->isolate->inline_frame, args, size * sizeof(Value*));
+    return evaluate_node(call->body, env);
+  }
+
+  // the name refers to another function now
+  return evaluate_function_call(callee, env_get_atom(env, this_atom), args, size, env);
+}
+
+Value* evaluate_member_access(Node *node, Env *env) {
+  Value *v = evaluate_node(node->children[0], env);
+  Node *property = node->children[1];
+  Value *name = property->type == NODE_PRIMITIVE_STRING ? NULL : evaluate_operand(property, env);
+  if (v->kind != VALUE_KIND_OBJECT) {
+    fprintf(stderr, "runtime error: unexpected member access: %s\n", value_inspect(v));
+    abort();
+  }
+
+  // typed[i] reads the element without going through the property lookup
+  if (name != NULL && IS_TYPED_ARRAY(v) && IS_NUMBER(name)) {
+    Value *element = value_typed_array_get(v, name);
+    return element == NULL ? value_undefined_new() : element;
+  }
+
+
+  env_set_atom(env, this_atom, v);
+  // obj.foo looks the atom up directly, without making a string value
+  Value *member_value = name == NULL ? value_object_get_atom(v, property->atom) : value_object_get(v, name);
+
+  PrimitiveFunction *function = FUNCTION_UNWRAP(member_value);
+  if (function != NULL && function->is_property) {
+    // intrinsic accessors are read here, without calling the getter
+    switch (function->intrinsic) {
+      case BUILTIN_ARRAY_LENGTH: {
+        if (IS_ARRAY(v)) return value_array_length(v);
+        break;
+      }
+
+      case BUILTIN_TYPED_ARRAY_LENGTH: {
+        if (IS_TYPED_ARRAY(v)) return value_number_new(value_typed_array_length(v));
+        break;
+      }
+    }
+
+    return evaluate_function_call(member_value, v, NULL, 0, env);
+  }
+
+  return member_value;
+}
+
+// cases with locals of their own are functions: evaluate_node is on the C stack a few
+// times for every call a script makes, and its frame has room for the locals of all of
+// its cases, which decides how deep scripts can recurse
+Value* evaluate_node(Node *node, Env *env) {
+  switch (node->type) {
+    // primitive nodes
+    case NODE_PRIMITIVE_NUMBER: {
+      char *str = node->value;
+      Value *v = value_number_new((double)atoi(str));
+      return v;
+    }
+
+    case NODE_PRIMITIVE_UNDEFINED: {
+      return value_undefined_new();
+    }
+
+    case NODE_PRIMITIVE_NULL: {
+      return value_null_new();
+    }
+
+    case NODE_PRIMITIVE_BOOLEAN: {
+      if (strcmp(node->value, "true") == 0) {
+        return value_true_new();
+      } else if (strcmp(node->value, "false") == 0) {
+        return value_false_new();
+      } else {
+        fprintf(stderr, "runtime error: unexpected value for boolean: %s\n", node->value);
+        abort();
+      }
+    }
+
+    case NODE_PRIMITIVE_STRING: {
+      return value_string_new_atom(node->atom);
+    }
+
+    case NODE_STATEMENT_LIST: {
+      // returns the value of a return statement in a for loop
+      return evaluate_node_children(node, env);
+    }
+
+    case NODE_STATEMENT_SWITCH: {
+      return evaluate_switch(node, env);
+    }
+
+    case NODE_STATEMENT_BREAK: {
+      env->isolate->breaking = 1;
+      return NULL;
+    }
+
+    case NODE_IDENTIFIER: {
+      Value *value = env_get_atom(env, node->atom);
+      value_escape(value);
+      return value;
+    }
+
+    case NODE_PREFIX_UPDATE:
+    case NODE_POSTFIX_UPDATE:
+    case NODE_COMPOUND_ASSIGNMENT: {
+      Value *value = evaluate_update(node, env, 1);
+      value_escape(value);
+      return value;
+    }
+
+    case NODE_VAR_DECLARATION: {
+      Node *identifier = node->children[0];
+      Node *right = node->children[1];
+
+      Value *value = right == NULL ? value_undefined_new() : evaluate_node(right, env);
+
+      env_set_atom(env, identifier->atom, value);
+      break;
+    }
+
+    case NODE_VAR_ASSIGNMENT: {
+      return evaluate_assignment(node, env);
+    }
+
+    case NODE_FUNCTION: {
+      Value *v = value_function_new(node);
+      return v;
+    }
+
+    case NODE_STATEMENT_RETURN: {
+      Value *value = evaluate_node(node->children[0], env);
+      env->isolate->returned = 1;
+      return value;
+    }
+
+    case NODE_STATEMENT_IF: {
+      if (evaluate_condition(node->args[0], env)) {
+        Value *result = evaluate_node_children(node, env);
+        return result;
+      }
+
+      return NULL;
+    }
+
+    case NODE_STATEMENT_WHILE: {
+      while (evaluate_condition(node->args[0], env)) {
+        Value *result = evaluate_node_children(node, env);
+        if (env->isolate->returned) return result;
+        if (env->isolate->breaking) {
+          env->isolate->breaking = 0;
+          break;
+        }
+      }
+
+      return NULL;
+    }
+
+    case NODE_STATEMENT_FOR_IN: {
+      return evaluate_for_in(node, env);
+    }
+
+    case NODE_STATEMENT_FOR_OF: {
+      return evaluate_for_of(node, env);
+    }
+
+    case NODE_YIELD: {
+      Value *value = node->children[0] == NULL ? value_undefined_new() : evaluate_node(node->children[0], env);
+      return generator_yield(env->isolate, value);
+    }
+
+    case NODE_UNARY_OPERATOR: {
+      return evaluate_unary_operator(node, env);
+    }
+
+    case NODE_BINARY_OPERATOR: {
+      return evaluate_binary_operator(node, env);
+    }
+
+    case NODE_FUNCTION_CALL: {
+      return evaluate_call(node, env);
+    }
+
+    case NODE_INLINE_CALL: {
+      return evaluate_inline_call(node, env);
+    }
+
+    case NODE_INLINE_ARGUMENT: {
+      return env->isolate->inline_frame[node->slot];
+    }
+
+
+    case NODE_OBJECT: {
+      if (node->constant && node->children[0] != NULL) {
+        void **template = isolate_slot(env->isolate, node);
+        if (*template == NULL) {
+          *template = evaluate_object_literal(node, env, value_object_create(NULL));
+          value_object_freeze_template(*template);
+        }
+
+        return value_object_from_template(env->isolate->binding.object_prototype, *template);
+      }
+
+      return evaluate_object_literal(node, env, value_object_new(&env->isolate->binding));
+    }
+
+    case NODE_OBJECT_MEMBER_ACCESS: {
+      return evaluate_member_access(node, env);
+    }
+
+    case NODE_ARRAY: {
+      if (node->constant) {
+        void **template = isolate_slot(env->isolate, node);
+        if (*template == NULL) {
+          *template = evaluate_array_literal(node, env, value_array_create(NULL));
+        }
+
+        return value_array_from_template(env->isolate->binding.array_prototype, *template);
+      }
+
+      return evaluate_array_literal(node, env, value_array_new(&env->isolate->binding));
+    }
+
+    default:
+      fprintf(stderr, "runtime error: unexpected node type: %s\n", NodeTypeString[node->type]);
+      abort();
+      break;
+    }
+
+  return NULL;
+}
+
+Value* native_object_keys(Isolate *isolate, Value *this, int size, Value **args) {
+  assert_args_size(size, 1);
+  if (args[0]->kind != VALUE_KIND_OBJECT) {
+    RUNTIME_ERROR("Object.keys called on non-object");
+  }
+
+  return value_object_keys(&isolate->binding, args[0]);
+}
+
+Value* require_klass_object(Binding *binding) {
+  Value *klass = value_function_new(NULL);
+  value_object_set(klass, value_string_new("prototype"), binding->object_prototype);
+  require_builtins(BUILTIN_OWNER_OBJECT, klass);
+  return klass;
+}
+
+Value* native_value_array_length(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_number_new((double)((PrimitiveArray*)VALUE_PRIMITIVE(this))->size);
+}
+
+// a relative index argument (negative counts from the end), clamped to [0, length]
+unsigned int value_array_relative_index(Value *arg, unsigned int length, unsigned int missing) {
+  if (arg == NULL || arg->kind == VALUE_KIND_UNDEFINED) return missing;
+
+  double n = value_number_unwrap(arg);
+  if (n != n) return 0;
+  if (n < 0) n += length;
+  if (n < 0) return 0;
+  if (n > length) return length;
+  return n;
+}
+
+Value* native_value_array_index_of(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *x = size > 0 ? args[0] : value_undefined_new();
+  unsigned int from = value_array_relative_index(size > 1 ? args[1] : NULL, ARRAY_UNWRAP(this)->size, 0);
+  return value_number_new(value_array_index_of(this, x, from, 0));
+}
+
+Value* native_value_array_includes(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *x = size > 0 ? args[0] : value_undefined_new();
+  unsigned int from = value_array_relative_index(size > 1 ? args[1] : NULL, ARRAY_UNWRAP(this)->size, 0);
+  return value_array_index_of(this, x, from, 1) >= 0 ? value_true_new() : value_false_new();
+}
+
+Value* native_value_array_fill(Isolate *isolate, Value *this, int size, Value **args) {
+  unsigned int length = ARRAY_UNWRAP(this)->size;
+  Value *x = size > 0 ? args[0] : value_undefined_new();
+  unsigned int start = value_array_relative_index(size > 1 ? args[1] : NULL, length, 0);
+  unsigned int end = value_array_relative_index(size > 2 ? args[2] : NULL, length, length);
+  value_array_fill(this, x, start, end);
+  return this;
+}
+
+Value* native_value_array_slice(Isolate *isolate, Value *this, int size, Value **args) {
+  unsigned int length = ARRAY_UNWRAP(this)->size;
+  unsigned int start = value_array_relative_index(size > 0 ? args[0] : NULL, length, 0);
+  unsigned int end = value_array_relative_index(size > 1 ? args[1] : NULL, length, length);
+
+  Value *result = value_array_new(&isolate->binding);
+  value_array_append(result, this, start, end);
+  return result;
+}
+
+Value* native_value_array_concat(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *result = value_array_new(&isolate->binding);
+  value_array_append(result, this, 0, ARRAY_UNWRAP(this)->size);
+  for (int i = 0; i < size; i++) {
+    if (IS_ARRAY(args[i])) {
+      value_array_append(result, args[i], 0, ARRAY_UNWRAP(args[i])->size);
+    } else {
+      value_array_push(result, args[i]);
+    }
+  }
+
+  return result;
+}
+
+Value* native_value_array_push1(Isolate *isolate, Value *this, Value *v) {
+  value_array_push(this, v);
+  return value_array_length(this);
+}
+
+Value* native_value_array_push(Isolate *isolate, Value *this, int size, Value **args) {
+  for (int i = 0; i < size; i++) {
+    value_array_push(this, args[i]);
+  }
+
+  return value_array_length(this);
+}
+
+Value* native_value_array_pop0(Isolate *isolate, Value *this) {
+  return value_array_pop(this);
+}
+
+Value* native_value_array_pop(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_array_pop(this);
+}
+
+Value* native_value_array_join(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *separator = size > 0 && args[0]->kind != VALUE_KIND_UNDEFINED ? value_to_string(args[0]) : NULL;
+  return value_array_join(this, separator);
+}
+
+typedef struct SortComparator {
+  Value *function;
+  Value *this;
+  Env *env;
+  // reused for every call
+  Value *args[2];
+} SortComparator;
+
+int value_sort_compare(void *a, void *b, void *data) {
+  SortComparator *comparator = data;
+  comparator->args[0] = a;
+  comparator->args[1] = b;
+
+  Value *result = evaluate_function_call(comparator->function, comparator->this, comparator->args, 2, comparator->env);
+  if (result == NULL || VALUE_PRIMITIVE(result) == NULL) return 0;
+
+  double n = value_number_unwrap(result);
+  return (n > 0) - (n < 0);
+}
+
+// recognizes `function (a, b) { return a <op> b; }` (1) and `return b <op> a;` (-1),
+// which natives can run without calling back into the script. returns 0 for anything else
+int value_function_binary_operator(Value *f, const char *op) {
+  Node *node = FUNCTION_UNWRAP(f)->node;
+  if (node == NULL || node->args[0] == NULL || node->args[1] == NULL || node->args[2] != NULL) return 0;
+  if (node->children[0] == NULL || node->children[1] != NULL) return 0;
+
+  Node *statement = node->children[0];
+  if (statement->type != NODE_STATEMENT_RETURN) return 0;
+
+  Node *expression = statement->children[0];
+  if (expression == NULL || expression->type != NODE_BINARY_OPERATOR || strcmp(expression->value, op) != 0) return 0;
+
+  Node *left = expression->children[0];
+  Node *right = expression->children[1];
+  if (left->type != NODE_IDENTIFIER || right->type != NODE_IDENTIFIER) return 0;
+
+  Atom *a = node->args[0]->atom;
+  Atom *b = node->args[1]->atom;
+  if (a == b) return 0;
+  if (left->atom == a && right->atom == b) return 1;
+  if (left->atom == b && right->atom == a) return -1;
+  return 0;
+}
+
+Value* native_value_array_sort(Isolate *isolate, Value *this, int size, Value **args) {
+  Value *function = size > 0 && args[0]->kind != VALUE_KIND_UNDEFINED ? args[0] : NULL;
+  if (function == NULL) {
+    value_array_sort(this, NULL, NULL);
+    return this;
+  }
+
+  if (FUNCTION_UNWRAP(function) == NULL) {
+    RUNTIME_ERROR("the comparison function must be either a function or undefined");
+  }
+
+  // `a - b` and `b - a` sort numbers
+  int order = value_function_binary_operator(function, "-");
+  if (order != 0 && value_array_doubles(this) != NULL) {
+    value_array_sort_doubles(this, order < 0);
+    return this;
+  }
+
+  SortComparator comparator;
+  comparator.function = function;
+  comparator.this = value_undefined_new();
+  comparator.env = isolate->env;
+  value_array_sort(this, value_sort_compare, &comparator);
+  return this;
+}
+
+// arr.reduce(fn, initial). `(a, b) => a + b` over a numeric array is summed natively
+Value* native_value_array_reduce(Isolate *isolate, Value *this, int size, Value **args) {
+  if (size < 1 || FUNCTION_UNWRAP(args[0]) == NULL) {
+    RUNTIME_ERROR("reduce: callback is not a function");
+  }
+
+  Value *function = args[0];
+  unsigned int length = ARRAY_UNWRAP(this)->size;
+  int has_initial = size > 1;
+  if (!has_initial && length == 0) {
+    RUNTIME_ERROR("reduce of empty array with no initial value");
+  }
+
+  double sum;
+  if (value_function_binary_operator(function, "+") != 0 && (!has_initial || IS_NUMBER(args[1])) &&
+      // -0 leaves the first element as it is, like starting from it
+      value_array_sum(this, has_initial ? value_number_unwrap(args[1]) : -0.0, &sum)) {
+    return value_number_new(sum);
+  }
+
+  Env *env = isolate->env;
+  Value *accumulator = has_initial ? args[1] : NULL;
+  Value *call_args[4];
+  for (unsigned int i = 0; i < length; i++) {
+    Value *element = value_array_get(this, value_number_new(i));
+    if (element == NULL) continue;
+
+    if (accumulator == NULL) {
+      accumulator = element;
+      continue;
+    }
+
+    call_args[0] = accumulator;
+    call_args[1] = element;
+    call_args[2] = value_number_new(i);
+    call_args[3] = this;
+    accumulator = evaluate_function_call(function, value_undefined_new(), call_args, 4, env);
+    if (accumulator == NULL) accumulator = value_undefined_new();
+  }
+
+  if (accumulator == NULL) {
+    RUNTIME_ERROR("reduce of empty array with no initial value");
+  }
+  return accumulator;
+}
+
+Value* require_klass_array(Binding *binding) {
+  Value *klass = value_object_create(NULL);
+
+  Value *array_prototype = value_object_create(NULL);
+  binding->array_prototype = array_prototype;
+  require_builtins(BUILTIN_OWNER_ARRAY_PROTOTYPE, array_prototype);
+
+  value_object_set(klass, value_string_new("prototype"), array_prototype);
+  return klass;
+}
+
+// a length or offset argument: an integer in [0, 2^32)
+uint32_t value_typed_array_size_arg(Value *arg, const char *what) {
+  double n = IS_NUMBER(arg) ? value_number_unwrap(arg) : -1;
+  if (!(n >= 0 && n < 4294967296.0) || n != (uint32_t)n) {
+    RUNTIME_ERROR("invalid %s: %s", what, value_inspect(arg));
+  }
+
+  return n;
+}
+
+Value* native_array_buffer(Isolate *isolate, Value *this, int size, Value **args) {
+  uint32_t byte_length = size > 0 ? value_typed_array_size_arg(args[0], "array buffer length") : 0;
+  return value_array_buffer_new(&isolate->binding, byte_length);
+}
+
+Value* native_array_buffer_byte_length(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_number_new(value_array_buffer_byte_length(this));
+}
+
+Value* require_klass_array_buffer(Binding *binding) {
+  Value *klass = value_function_native_new(native_array_buffer);
+
+  Value *prototype = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_ARRAY_BUFFER_PROTOTYPE, prototype);
+
+  value_object_set(klass, value_string_new("prototype"), prototype);
+  return klass;
+}
+
+Value* value_typed_array_allocate(Binding *binding, TypedArrayKind kind, uint32_t length) {
+  size_t element_size = value_typed_array_element_size(kind);
+  if ((uint64_t)length * element_size > UINT32_MAX) {
+    RUNTIME_ERROR("invalid typed array length: %u", length);
+  }
+
+  Value *buffer = value_array_buffer_new(binding, length * element_size);
+  return value_typed_array_new(binding, kind, buffer, 0, length);
+}
+
+// new T(), new T(length), new T(array or typed array) and new T(buffer, byteOffset, length)
+Value* value_typed_array_construct(Binding *binding, TypedArrayKind kind, int size, Value **args) {
+  if (size == 0 || args[0]->kind == VALUE_KIND_UNDEFINED) return value_typed_array_allocate(binding, kind, 0);
+
+  Value *source = args[0];
+  const char *name = value_typed_array_name(kind);
+  size_t element_size = value_typed_array_element_size(kind);
+
+  if (IS_ARRAY_BUFFER(source)) {
+    uint32_t byte_length = value_array_buffer_byte_length(source);
+    uint32_t byte_offset = size > 1 && args[1]->kind != VALUE_KIND_UNDEFINED ? value_typed_array_size_arg(args[1], "byte offset") : 0;
+    if (byte_offset % element_size != 0) {
+      RUNTIME_ERROR("start offset of %s should be a multiple of %zu", name, element_size);
+    }
+    if (byte_offset > byte_length) {
+      RUNTIME_ERROR("start offset %u is outside the bounds of the buffer", byte_offset);
+    }
+
+    uint32_t length;
+    if (size > 2 && args[2]->kind != VALUE_KIND_UNDEFINED) {
+      length = value_typed_array_size_arg(args[2], "typed array length");
+      if ((uint64_t)length * element_size > byte_length - byte_offset) {
+        RUNTIME_ERROR("invalid typed array length: %u", length);
+      }
+    } else {
+      if ((byte_length - byte_offset) % element_size != 0) {
+        RUNTIME_ERROR("byte length of %s should be a multiple of %zu", name, element_size);
+      }
+      length = (byte_length - byte_offset) / element_size;
+    }
+
+    return value_typed_array_new(binding, kind, source, byte_offset, length);
+  }
+
+  if (IS_ARRAY(source) || IS_TYPED_ARRAY(source)) {
+    uint32_t length = IS_ARRAY(source) ? ARRAY_UNWRAP(source)->size : value_typed_array_length(source);
+    Value *result = value_typed_array_allocate(binding, kind, length);
+
+    double *doubles = IS_ARRAY(source) ? value_array_doubles(source) : NULL;
+    if (doubles != NULL && kind == TYPED_ARRAY_FLOAT64) {
+      memcpy(value_typed_array_data(result), doubles, length * sizeof(double));
+      return result;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+      Value *index = value_number_new(i);
+      Value *element = IS_ARRAY(source) ? value_array_get(source, index) : value_typed_array_get(source, index);
+      value_typed_array_set(result, index, element);
+    }
+    return result;
+  }
+
+  return value_typed_array_allocate(binding, kind, value_typed_array_size_arg(source, "typed array length"));
+}
+
+#define TYPED_ARRAY_ENUM_TO_CONSTRUCTOR(KIND, NAME, TYPE) \
+  Value* native_##NAME(Isolate *isolate, Value *this, int size, Value **args) { \
+    return value_typed_array_construct(&isolate->binding, TYPED_ARRAY_##KIND, size, args); \
+  }
+
+TYPED_ARRAY_ENUM(TYPED_ARRAY_ENUM_TO_CONSTRUCTOR)
+
+Value* native_typed_array_length(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_number_new(value_typed_array_length(this));
+}
+
+Value* native_typed_array_byte_length(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_number_new((double)value_typed_array_length(this) * value_typed_array_element_size(value_typed_array_kind(this)));
+}
+
+Value* native_typed_array_byte_offset(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_number_new(value_typed_array_byte_offset(this));
+}
+
+Value* native_typed_array_buffer(Isolate *isolate, Value *this, int size, Value **args) {
+  return value_typed_array_buffer(this);
+}
+
+Value* native_typed_array_subarray(Isolate *isolate, Value *this, int size, Value **args) {
+  uint32_t length = value_typed_array_length(this);
+  uint32_t begin = value_array_relative_index(size > 0 ? args[0] : NULL, length, 0);
+  uint32_t end = value_array_relative_index(size > 1 ? args[1] : NULL, length, length);
+  return value_typed_array_subarray(&isolate->binding, this, begin, end);
+}
+
+Value* native_typed_array_fill(Isolate *isolate, Value *this, int size, Value **args) {
+  uint32_t length = value_typed_array_length(this);
+  Value *x = size > 0 ? args[0] : value_undefined_new();
+  uint32_t start = value_array_relative_index(size > 1 ? args[1] : NULL, length, 0);
+  uint32_t end = value_array_relative_index(size > 2 ? args[2] : NULL, length, length);
+  value_typed_array_fill(this, x, start, end);
+  return this;
+}
+
+// every typed array constructor gets its own prototype, inheriting the shared methods
+void require_klass_typed_arrays(Binding *binding, Env *global) {
+  Value *prototype = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_TYPED_ARRAY_PROTOTYPE, prototype);
+
+#define TYPED_ARRAY_ENUM_TO_KLASS(KIND, NAME, TYPE) { \
+    Value *klass = value_function_native_new(native_##NAME); \
+    value_object_set(klass, value_string_new("prototype"), value_object_create(prototype)); \
+    env_set(global, #NAME, klass); \
+  }
+
+  TYPED_ARRAY_ENUM(TYPED_ARRAY_ENUM_TO_KLASS)
+}
+
+Value* require_module_console() {
+  Value *console = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_CONSOLE, console);
+  return console;
+}
+
+// Math functions of one number: name and the C function
+#define MATH_UNARY_ENUM(M) \
+  M(abs, fabs) \
+  M(floor, floor) \
+  M(ceil, ceil) \
+  M(trunc, trunc) \
+  M(sqrt, sqrt)
+
+#define MATH_UNARY_TO_NATIVE(NAME, FN) \
+  Value* native_math_##NAME##1(Isolate *isolate, Value *this, Value *x) { \
+    return value_number_new(FN(value_to_number(x))); \
+  } \
+  \
+  Value* native_math_##NAME(Isolate *isolate, Value *this, int size, Value **args) { \
+    return native_math_##NAME##1(isolate, this, size > 0 ? args[0] : NULL); \
+  }
+
+MATH_UNARY_ENUM(MATH_UNARY_TO_NATIVE)
+
+// NaN if either is NaN, and -0 is less than 0
+double value_math_min(double a, double b) {
+  if (isnan(a) || isnan(b)) return NAN;
+  if (a == b) return signbit(a) ? a : b;
+  return a < b ? a : b;
+}
+
+double value_math_max(double a, double b) {
+  if (isnan(a) || isnan(b)) return NAN;
+  if (a == b) return signbit(a) ? b : a;
+  return a > b ? a : b;
+}
+
+Value* native_math_min2(Isolate *isolate, Value *this, Value *a, Value *b) {
+  return value_number_new(value_math_min(value_to_number(a), value_to_number(b)));
+}
+
+Value* native_math_min(Isolate *isolate, Value *this, int size, Value **args) {
+  double result = INFINITY;
+  for (int i = 0; i < size; i++) result = value_math_min(result, value_to_number(args[i]));
+  return value_number_new(result);
+}
+
+Value* native_math_max2(Isolate *isolate, Value *this, Value *a, Value *b) {
+  return value_number_new(value_math_max(value_to_number(a), value_to_number(b)));
+}
+
+Value* native_math_max(Isolate *isolate, Value *this, int size, Value **args) {
+  double result = -INFINITY;
+  for (int i = 0; i < size; i++) result = value_math_max(result, value_to_number(args[i]));
+  return value_number_new(result);
+}
+
+Value* require_module_math() {
+  Value *math = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_MATH, math);
+  return math;
+}
+
+Value* require_klass_worker() {
+  Value *klass = value_function_native_new(native_worker);
+
+  Value *prototype = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_WORKER_PROTOTYPE, prototype);
+
+  value_object_set(klass, value_string_new("prototype"), prototype);
+  return klass;
+}
+
+Value* require_klass_promise() {
+  Value *klass = value_function_native_new(native_promise);
+  require_builtins(BUILTIN_OWNER_PROMISE, klass);
+
+  Value *prototype = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_PROMISE_PROTOTYPE, prototype);
+
+  value_object_set(klass, value_string_new("prototype"), prototype);
+  return klass;
+}
+
+void require_generator_prototype(Binding *binding) {
+  Value *prototype = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_GENERATOR_PROTOTYPE, prototype);
+  binding->generator_prototype = prototype;
+}
+
+Value* require_module_stdin() {
+  Value *module = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_STDIN, module);
+  return module;
+}
+
+Value* require_module_json() {
+  Value *json = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_JSON, json);
+  return json;
+}
+
+Value* require_module_fs() {
+  Value *fs = value_object_create(NULL);
+  require_builtins(BUILTIN_OWNER_FS, fs);
+  return fs;
+}
+
+static const Builtin builtins[] = {
+  BUILTIN_ENUM(BUILTIN_TO_TABLE)
+};
+
+Value* builtin_function_new(int id) {
+  const Builtin *builtin = &builtins[id];
+  Value *f = value_function_native_arity_new(builtin->fn, builtin->arity, builtin->entry);
+  PrimitiveFunction *function = FUNCTION_UNWRAP(f);
+  function->is_property = builtin->is_property;
+  function->intrinsic = id;
+  return f;
+}
+
+// installs the builtins of owner as properties of object
+void require_builtins(BuiltinOwner owner, Value *object) {
+  for (int id = 0; id < BUILTIN_COUNT; id++) {
+    if (builtins[id].owner != owner) continue;
+    value_object_set(object, value_string_new(builtins[id].name), builtin_function_new(id));
+  }
+}
+
+void require_global_builtins(BuiltinOwner owner, Env *global) {
+  for (int id = 0; id < BUILTIN_COUNT; id++) {
+    if (builtins[id].owner != owner) continue;
+    env_set(global, builtins[id].name, builtin_function_new(id));
+  }
+}
+
+BuiltinOwner builtin_owner(int id) {
+  return builtins[id].owner;
+}
+
+int builtin_owner_intact(Value *object, BuiltinOwner owner) {
+  if (object == NULL || object->kind != VALUE_KIND_OBJECT) return 0;
+  for (int id = 0; id < BUILTIN_COUNT; id++) {
+    if (builtins[id].owner != owner) continue;
+    Value *f = value_object_get(object, value_string_new(builtins[id].name));
+    if (f == NULL || !IS_FUNCTION(f) || FUNCTION_UNWRAP(f)->intrinsic != id) return 0;
+  }
+  return 1;
+}
+
+#define TYPED_ARRAY_ENUM_TO_NATIVE(KIND, NAME, TYPE) (void*)native_##NAME,
+
+// natives that are not in the builtin table
+static void *builtin_constructors[] = {
+  (void*)native_array_buffer,
+  (void*)native_worker,
+  (void*)native_promise,
+  (void*)native_promise_resolve_function,
+  (void*)native_promise_reject_function,
+  TYPED_ARRAY_ENUM(TYPED_ARRAY_ENUM_TO_NATIVE)
+};
+
+#define BUILTIN_CONSTRUCTOR_COUNT (int)(sizeof(builtin_constructors) / sizeof(builtin_constructors[0]))
+
+int builtin_native_count() {
+  return 2 * BUILTIN_COUNT + BUILTIN_CONSTRUCTOR_COUNT;
+}
+
+void* builtin_native(int index) {
+  if (index < 2 * BUILTIN_COUNT) {
+    const Builtin *builtin = &builtins[index / 2];
+    return index % 2 == 0 ? (void*)builtin->fn : (void*)builtin->entry.fn0;
+  }
+
+  return builtin_constructors[index - 2 * BUILTIN_COUNT];
+}
+
+int builtin_native_index(void *native) {
+  for (int i = 0; i < builtin_native_count(); i++) {
+    if (native != NULL && builtin_native(i) == native) return i;
+  }
+
+  return -1;
+}
+
+Env* env_global_new(Isolate *isolate) {
+  Binding *binding = &isolate->binding;
+  Env *global = env_new(NULL);
+  global->isolate = isolate;
+  binding->global = global;
+
+  load_prelude(binding);
+
+  env_set(global, "Object", require_klass_object(binding));
+  env_set(global, "Array", require_klass_array(binding));
+  env_set(global, "ArrayBuffer", require_klass_array_buffer(binding));
+  require_klass_typed_arrays(binding, global);
+  env_set(global, "console", require_module_console());
+  env_set(global, "Math", require_module_math());
+  env_set(global, "Worker", require_klass_worker());
+  env_set(global, "Promise", require_klass_promise());
+  env_set(global, "fs", require_module_fs());
+  env_set(global, "stdin", require_module_stdin());
+  env_set(global, "JSON", require_module_json());
+  require_generator_prototype(binding);
+  require_global_builtins(BUILTIN_OWNER_GLOBAL, global);
+
+  return global;
+}
+
+Isolate* isolate_new(FILE *out) {
+  pthread_once(&value_atoms_once, value_atoms_init);
+
+  Isolate *isolate = malloc(sizeof(Isolate));
+  memset(isolate, 0, sizeof(Isolate));
+  isolate->out = out;
+  env_global_new(isolate);
+  return isolate;
+}
+
+Isolate* isolate_restore(Binding *binding, FILE *out) {
+  pthread_once(&value_atoms_once, value_atoms_init);
+
+  Isolate *isolate = malloc(sizeof(Isolate));
+  memset(isolate, 0, sizeof(Isolate));
+  isolate->out = out;
+  isolate->binding = *binding;
+  binding->global->isolate = isolate;
+  return isolate;
+}
+
+// runs the program, then its loop until no timer, promise job, I/O request or worker is
+// left (see loop.h)
+Value* evaluate(Isolate *isolate, Node *node) {
+  Value *result = evaluate_node(node, isolate->binding.global);
+  loop_run(isolate->binding.global);
+  return result;
+}
 
-  return evaluate_node(node, global);
+// what the slots point to is left allocated: templates are on the heap, which is never
+// freed, like the rest of the program's values
+void isolate_clear_slots(Isolate *isolate, int first) {
+  for (int i = first; i < isolate->slot_cap; i++) isolate->slots[i] = NULL;
 }
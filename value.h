@@ -2,12 +2,21 @@
 #define MJS_VALUE_H
 
 #include "parse.h"
+#include "heap.h"
+#include "inline.h"
+#include <stdio.h>
 #define PRIMITIVE_ENUM(M) \
   M(PRIMITIVE_NUMBER) \
   M(PRIMITIVE_STRING) \
   M(PRIMITIVE_ARRAY) \
   M(PRIMITIVE_FUNCTION) \
-  M(PRIMITIVE_BOOLEAN)
+  M(PRIMITIVE_BOOLEAN) \
+  M(PRIMITIVE_ARRAY_BUFFER) \
+  M(PRIMITIVE_TYPED_ARRAY) \
+  M(PRIMITIVE_WORKER) \
+  M(PRIMITIVE_PROMISE) \
+  M(PRIMITIVE_GENERATOR) \
+  M(PRIMITIVE_LINE_ITERATOR)
 
 #define PRIMITIVE_ENUM_TO_ENUM(X) X,
 #define PRIMITIVE_ENUM_TO_STRING(X) #X,
@@ -22,32 +31,155 @@ static const char *PrimitiveTypeString[] = {
 
 #define PRIMITIVE_COMMON \
   PrimitiveType type; \
+  unsigned int flags; \
   double value
 
+// a number referenced only from the variable it is stored in. ++, -- and compound
+// assignment change such a number in place instead of allocating a new one
+#define PRIMITIVE_FLAG_OWNED 1
+// a string whose bytes are in the block of a LineReader, which reuses them once the
+// block moves on (see reader.h). copied into a string of its own before that
+#define PRIMITIVE_FLAG_VIEW 2
+
 typedef struct Primitive {
   PRIMITIVE_COMMON;
 } Primitive;
 
+// dense kinds only move down this list. an array of numbers stays unboxed until
+// something else is stored in it, and a gap or a delete makes it holey. a store far
+// past the end makes it sparse, and a sparse array that fills up to half its length
+// goes back to packed or holey (value_array_to_dense), never to packed doubles.
+typedef enum ArrayKind {
+  // numbers only, stored unboxed in a double[]
+  ARRAY_KIND_PACKED_DOUBLE,
+  // any values, no holes
+  ARRAY_KIND_PACKED,
+  // any values. a missing element is NULL
+  ARRAY_KIND_HOLEY,
+  // sparse: elements live in a hash table keyed by index (see array.c)
+  ARRAY_KIND_DICTIONARY,
+} ArrayKind;
+
 typedef struct PrimitiveArray {
   PRIMITIVE_COMMON;
+  ArrayKind kind;
+  // slots in elements. 0 while the elements are shared with a literal template
   unsigned int cap;
+  // the length
   unsigned int size;
-  struct Value** values;
+  // elements present, only kept for ARRAY_KIND_DICTIONARY
+  unsigned int count;
+  // double[] for ARRAY_KIND_PACKED_DOUBLE, ArraySparseEntry[] for ARRAY_KIND_DICTIONARY,
+  // HEAP_REF(Value)[] otherwise
+  HEAP_REF(void) elements;
 } PrimitiveArray;
 
+// raw bytes shared by typed arrays. zeroed when allocated and never resized
+typedef struct PrimitiveArrayBuffer {
+  PRIMITIVE_COMMON;
+  uint32_t byte_length;
+  HEAP_REF(char) data;
+} PrimitiveArrayBuffer;
+
+// element types of typed arrays: kind, constructor name, C type
+#define TYPED_ARRAY_ENUM(M) \
+  M(FLOAT64, Float64Array, double) \
+  M(INT32, Int32Array, int32_t) \
+  M(UINT8, Uint8Array, uint8_t)
+
+#define TYPED_ARRAY_ENUM_TO_ENUM(KIND, NAME, TYPE) TYPED_ARRAY_##KIND,
+
+typedef enum TypedArrayKind {
+  TYPED_ARRAY_ENUM(TYPED_ARRAY_ENUM_TO_ENUM)
+} TypedArrayKind;
+
+// a view of length elements starting byte_offset bytes into an ArrayBuffer.
+// subarray() makes another view of the same buffer, so nothing is copied
+typedef struct PrimitiveTypedArray {
+  PRIMITIVE_COMMON;
+  TypedArrayKind kind;
+  uint32_t byte_offset;
+  uint32_t length;
+  HEAP_REF(struct Value) buffer;
+} PrimitiveTypedArray;
+
+// a Worker object: the thread running another script (see worker.h)
+typedef struct PrimitiveWorker {
+  PRIMITIVE_COMMON;
+  struct Worker *worker;
+} PrimitiveWorker;
+
+// a Promise object: its state and the reactions waiting for it (see promise.h)
+typedef struct PrimitivePromise {
+  PRIMITIVE_COMMON;
+  struct Promise *promise;
+} PrimitivePromise;
+
+// a generator object: the body of a function* and where it stopped (see generator.h)
+typedef struct PrimitiveGenerator {
+  PRIMITIVE_COMMON;
+  struct Generator *generator;
+} PrimitiveGenerator;
+
+// what stdin.lines() returns: for...of reads the lines of the reader (see reader.h)
+typedef struct PrimitiveLineIterator {
+  PRIMITIVE_COMMON;
+  struct LineReader *reader;
+} PrimitiveLineIterator;
+
+// strings are length-prefixed. a flat string has its bytes in chars (or in atom,
+// for interned strings). concatenation makes a rope node pointing at both halves,
+// and the bytes are only written out when they are needed (see string.c).
 typedef struct PrimitiveString {
   PRIMITIVE_COMMON;
-  char *string;
+  uint32_t length;
+  // where the bytes start in chars. 0 but for a view into a block of lines, whose
+  // lines start anywhere while chars is the block
+  uint32_t offset;
+  // NUL-terminated bytes. NULL for interned strings and unflattened ropes
+  HEAP_REF(char) chars;
+  // set for literals, and once the string has been used as a property key
+  HEAP_REF(struct Atom) atom;
+  // halves of a rope. cleared when it is flattened
+  HEAP_REF(struct PrimitiveString) left;
+  HEAP_REF(struct PrimitiveString) right;
 } PrimitiveString;
 
 
-typedef struct Value* (NativeFunction)(struct Value*, int, struct Value**);
+struct Isolate;
+
+// natives are called with the isolate running them, `this` and the arguments
+typedef struct Value* (NativeFunction)(struct Isolate*, struct Value*, int, struct Value**);
+
+// entry points of natives taking a fixed number of arguments as parameters
+typedef struct Value* (NativeFunction0)(struct Isolate*, struct Value*);
+typedef struct Value* (NativeFunction1)(struct Isolate*, struct Value*, struct Value*);
+typedef struct Value* (NativeFunction2)(struct Isolate*, struct Value*, struct Value*, struct Value*);
+typedef struct Value* (NativeFunction3)(struct Isolate*, struct Value*, struct Value*, struct Value*, struct Value*);
+
+typedef union NativeEntry {
+  NativeFunction0 *fn0;
+  NativeFunction1 *fn1;
+  NativeFunction2 *fn2;
+  NativeFunction3 *fn3;
+} NativeEntry;
+
+#define NATIVE_MAX_ARITY 3
+
 typedef struct PrimitiveFunction {
   PRIMITIVE_COMMON;
   char *name;
   struct Node *node;
   NativeFunction *fn;
+  // calls passing exactly arity arguments may use entry instead of fn. -1 without one
+  int arity;
+  NativeEntry entry;
   int is_property;
+  // BuiltinId of a function from the builtin table (see builtin.h), or BUILTIN_NONE
+  int intrinsic;
+  // the object a native made for it works on, e.g. the promise a resolve function
+  // settles. read through Isolate.callee
+  struct Value *bound;
 } PrimitiveFunction;
 
 typedef enum ValueKind {
@@ -58,23 +190,85 @@ typedef enum ValueKind {
 
 typedef struct Value {
   ValueKind kind;
-  struct Primitive *primitive;
-  struct HashTable *table;
-  struct Value *proto;
+  HEAP_REF(struct Primitive) primitive;
+  HEAP_REF(struct Dict) table;
+  HEAP_REF(struct Value) proto;
 } Value;
 
-Value* evaluate(Node *node);
+#define VALUE_PRIMITIVE(X) HEAP_GET(Primitive, (X)->primitive)
+#define VALUE_TABLE(X) HEAP_GET(struct Dict, (X)->table)
+#define VALUE_PROTO(X) HEAP_GET(Value, (X)->proto)
+
 void assert_args_size(int size, int expected);
 
 typedef struct Env {
   struct HashTable *table;
   struct Env *parent;
+  // the isolate the scope belongs to
+  struct Isolate *isolate;
 } Env;
 Value* env_get(Env *env, const char *key);
+Value* env_get_atom(Env *env, Atom *key);
 
 typedef struct Binding {
   struct Value *object_prototype;
+  struct Value *array_prototype;
+  // the prototype of the objects calls to a function* return
+  struct Value *generator_prototype;
   struct Env *global;
 } Binding;
 
+// everything a running program changes: its globals and prototypes, return and break
+// while they unwind, and what the evaluator keeps for the nodes it runs. the parsed
+// program is only read, so isolates on different threads can run the same one at once.
+// slots are numbered per program, so an isolate runs a single program, or programs
+// parsed one after another with parse_slots
+typedef struct Isolate {
+  // set by return until the function call ends
+  int returned;
+  // set by break until the enclosing loop or switch stops
+  int breaking;
+  // environment of the caller while a native function runs, and the function
+  Env *env;
+  struct Value *callee;
+  Binding binding;
+  // where console.log writes
+  FILE *out;
+  // the evaluator's state of nodes by Node.slot: call caches and literal templates
+  void **slots;
+  int slot_cap;
+  // the arguments of the inlined body being evaluated. inlined bodies make no calls,
+  // so no other one runs before it is done
+  struct Value *inline_frame[INLINE_MAX_ARGS];
+  // the worker the isolate runs in, NULL for the main script, and the workers it started
+  struct Worker *worker;
+  struct Worker *workers;
+  // bumped when a message, a change of a worker's state or a finished I/O request is
+  // there for the isolate. it sleeps in its loop while sleeping is set (see loop.c)
+  uint32_t wakeups;
+  int sleeping;
+  // timers, promise jobs and I/O requests, made on first use
+  struct Loop *loop;
+  // the generator whose body is running, which a yield gives its value to
+  struct Generator *generator;
+  // the reader of stdin, made on first use
+  struct LineReader *input;
+} Isolate;
+
+Isolate* isolate_new(FILE *out);
+// an isolate for globals set up before, e.g. loaded from a snapshot
+Isolate* isolate_restore(Binding *binding, FILE *out);
+Value* evaluate(Isolate *isolate, Node *node);
+// forgets the state of nodes with slots from first on, once their program is done
+void isolate_clear_slots(Isolate *isolate, int first);
+
+Env* env_new(Env *parent);
+// runs a program in a scope, e.g. one of its own on top of the globals
+Value* evaluate_node(Node *node, Env *env);
+// runs the statements of node until one returns or breaks
+Value* evaluate_node_children(Node *node, Env *env);
+Value* evaluate_function_call(Value *f, Value *this, Value **args, int size, Env *env);
+// the number a value converts to, NaN for those that don't
+double value_to_number(Value *v);
+
 #endif
@@ -0,0 +1,191 @@
+#include "vector.h"
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// integers below this add up exactly in any order
+#define VECTOR_EXACT_LIMIT 9007199254740992.0
+#define VECTOR_ROUND_MAGIC 4503599627370496.0
+
+long vector_index_of_scalar(const double *items, size_t i, size_t size, double x) {
+  for (; i < size; i++) {
+    if (items[i] == x) return i;
+  }
+
+  return -1;
+}
+
+// adds up items from i on, continuing the vector loop's totals
+int vector_sum_tail(const double *items, size_t i, size_t size, int exact, double total, double abs_total, double *sum) {
+  // total starts out as the initial value, which has to be an integer as well
+  if ((abs_total + VECTOR_ROUND_MAGIC) - VECTOR_ROUND_MAGIC != abs_total) exact = 0;
+
+  for (; i < size; i++) {
+    double a = fabs(items[i]);
+    if ((a + VECTOR_ROUND_MAGIC) - VECTOR_ROUND_MAGIC != a) exact = 0;
+    total += items[i];
+    abs_total += a;
+  }
+
+  *sum = total;
+  // a zero could be -0 when added up in order
+  return exact && abs_total < VECTOR_EXACT_LIMIT && total != 0;
+}
+
+#if defined(__AVX__)
+long vector_index_of(const double *items, size_t size, double x) {
+  __m256d needle = _mm256_set1_pd(x);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256d a = _mm256_cmp_pd(_mm256_loadu_pd(items + i), needle, _CMP_EQ_OQ);
+    __m256d b = _mm256_cmp_pd(_mm256_loadu_pd(items + i + 4), needle, _CMP_EQ_OQ);
+    // one test for both halves; the exact lane is only worked out on a hit
+    if (_mm256_movemask_pd(_mm256_or_pd(a, b)) != 0) {
+      int mask = _mm256_movemask_pd(a) | (_mm256_movemask_pd(b) << 4);
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return vector_index_of_scalar(items, i, size, x);
+}
+
+long vector_find_nan(const double *items, size_t size) {
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256d v = _mm256_loadu_pd(items + i);
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+
+  for (; i < size; i++) {
+    if (items[i] != items[i]) return i;
+  }
+  return -1;
+}
+
+void vector_fill(double *items, size_t size, double x) {
+  __m256d v = _mm256_set1_pd(x);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) _mm256_storeu_pd(items + i, v);
+  for (; i < size; i++) items[i] = x;
+}
+
+int vector_sum_exact(const double *items, size_t size, double initial, double *sum) {
+  __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d magic = _mm256_set1_pd(VECTOR_ROUND_MAGIC);
+  __m256d sums = _mm256_setzero_pd();
+  __m256d abs_sums = _mm256_setzero_pd();
+  __m256d inexact = _mm256_setzero_pd();
+
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256d v = _mm256_loadu_pd(items + i);
+    __m256d a = _mm256_andnot_pd(sign, v);
+    // (a + 2^52) - 2^52 rounds a to an integer, so it only differs for fractions and NaN
+    __m256d rounded = _mm256_sub_pd(_mm256_add_pd(a, magic), magic);
+    inexact = _mm256_or_pd(inexact, _mm256_cmp_pd(rounded, a, _CMP_NEQ_UQ));
+    sums = _mm256_add_pd(sums, v);
+    abs_sums = _mm256_add_pd(abs_sums, a);
+  }
+
+  double lanes[4], abs_lanes[4];
+  _mm256_storeu_pd(lanes, sums);
+  _mm256_storeu_pd(abs_lanes, abs_sums);
+  int exact = _mm256_movemask_pd(inexact) == 0;
+  double total = initial + ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+  double abs_total = fabs(initial) + ((abs_lanes[0] + abs_lanes[1]) + (abs_lanes[2] + abs_lanes[3]));
+  return vector_sum_tail(items, i, size, exact, total, abs_total, sum);
+}
+#elif defined(__SSE2__)
+long vector_index_of(const double *items, size_t size, double x) {
+  __m128d needle = _mm_set1_pd(x);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128d a = _mm_cmpeq_pd(_mm_loadu_pd(items + i), needle);
+    __m128d b = _mm_cmpeq_pd(_mm_loadu_pd(items + i + 2), needle);
+    // one test for both halves; the exact lane is only worked out on a hit
+    if (_mm_movemask_pd(_mm_or_pd(a, b)) != 0) {
+      int mask = _mm_movemask_pd(a) | (_mm_movemask_pd(b) << 2);
+      return i + __builtin_ctz(mask);
+    }
+  }
+
+  return vector_index_of_scalar(items, i, size, x);
+}
+
+long vector_find_nan(const double *items, size_t size) {
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    __m128d v = _mm_loadu_pd(items + i);
+    int mask = _mm_movemask_pd(_mm_cmpunord_pd(v, v));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+
+  for (; i < size; i++) {
+    if (items[i] != items[i]) return i;
+  }
+  return -1;
+}
+
+void vector_fill(double *items, size_t size, double x) {
+  __m128d v = _mm_set1_pd(x);
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) _mm_storeu_pd(items + i, v);
+  for (; i < size; i++) items[i] = x;
+}
+
+int vector_sum_exact(const double *items, size_t size, double initial, double *sum) {
+  __m128d sign = _mm_set1_pd(-0.0);
+  __m128d magic = _mm_set1_pd(VECTOR_ROUND_MAGIC);
+  __m128d sums = _mm_setzero_pd();
+  __m128d abs_sums = _mm_setzero_pd();
+  __m128d inexact = _mm_setzero_pd();
+
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) {
+    __m128d v = _mm_loadu_pd(items + i);
+    __m128d a = _mm_andnot_pd(sign, v);
+    // (a + 2^52) - 2^52 rounds a to an integer, so it only differs for fractions and NaN
+    __m128d rounded = _mm_sub_pd(_mm_add_pd(a, magic), magic);
+    inexact = _mm_or_pd(inexact, _mm_cmpneq_pd(rounded, a));
+    sums = _mm_add_pd(sums, v);
+    abs_sums = _mm_add_pd(abs_sums, a);
+  }
+
+  double lanes[2], abs_lanes[2];
+  _mm_storeu_pd(lanes, sums);
+  _mm_storeu_pd(abs_lanes, abs_sums);
+  int exact = _mm_movemask_pd(inexact) == 0;
+  double total = initial + (lanes[0] + lanes[1]);
+  double abs_total = fabs(initial) + (abs_lanes[0] + abs_lanes[1]);
+  return vector_sum_tail(items, i, size, exact, total, abs_total, sum);
+}
+#else
+long vector_index_of(const double *items, size_t size, double x) {
+  return vector_index_of_scalar(items, 0, size, x);
+}
+
+long vector_find_nan(const double *items, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (items[i] != items[i]) return i;
+  }
+  return -1;
+}
+
+void vector_fill(double *items, size_t size, double x) {
+  for (size_t i = 0; i < size; i++) items[i] = x;
+}
+
+int vector_sum_exact(const double *items, size_t size, double initial, double *sum) {
+  return vector_sum_tail(items, 0, size, 1, initial, fabs(initial), sum);
+}
+#endif
+
+long vector_find(const double *items, size_t size, double x) {
+  if (x != x) return vector_find_nan(items, size);
+  return vector_index_of(items, size, x);
+}
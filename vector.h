@@ -0,0 +1,23 @@
+#ifndef MJS_VECTOR_H
+#define MJS_VECTOR_H
+
+#include <stddef.h>
+
+// kernels over the double[] of packed numeric arrays.
+//
+// each kernel has an AVX path (4 lanes), an SSE2 path (2 lanes) and a scalar
+// fallback, picked at compile time. build with `make NATIVE=1` to enable AVX.
+
+// first index of x, or -1. NaN is never found, as with ===
+long vector_index_of(const double *items, size_t size, double x);
+// like vector_index_of, but NaN finds NaN (SameValueZero, for includes)
+long vector_find(const double *items, size_t size, double x);
+void vector_fill(double *items, size_t size, double x);
+
+// adds the items to initial into *sum and returns 1 when the result is exact
+// regardless of the order of additions: every item and initial are integers and
+// the absolute sum is below 2^53. otherwise returns 0, and the caller adds up in
+// order instead.
+int vector_sum_exact(const double *items, size_t size, double initial, double *sum);
+
+#endif
@@ -0,0 +1,149 @@
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void test_vector_index_of() {
+  // every position and every tail length the vector loops can end on
+  for (size_t size = 0; size < 40; size++) {
+    double *items = malloc((size + 1) * sizeof(double));
+    for (size_t i = 0; i < size; i++) items[i] = i * 2;
+
+    for (size_t i = 0; i < size; i++) {
+      assert(vector_index_of(items, size, i * 2) == (long)i);
+      assert(vector_find(items, size, i * 2) == (long)i);
+    }
+    assert(vector_index_of(items, size, 1) == -1);
+    assert(vector_index_of(items, size, -2) == -1);
+
+    free(items);
+  }
+
+  double items[] = { 5, -0.0, 5, NAN, 7, 7, 7, 7, 7, 7 };
+  assert(vector_index_of(items, 10, 5) == 0);
+  assert(vector_index_of(items, 10, 0) == 1);
+  assert(vector_index_of(items, 10, 7) == 4);
+  assert(vector_index_of(items, 10, NAN) == -1);
+  assert(vector_find(items, 10, NAN) == 3);
+  assert(vector_find(items, 3, NAN) == -1);
+  assert(vector_find(items, 10, INFINITY) == -1);
+}
+
+void test_vector_fill() {
+  double items[19];
+  for (size_t size = 0; size < 18; size++) {
+    for (size_t i = 0; i < 19; i++) items[i] = -1;
+
+    vector_fill(items, size, 3);
+    for (size_t i = 0; i < size; i++) assert(items[i] == 3);
+    for (size_t i = size; i < 19; i++) assert(items[i] == -1);
+  }
+}
+
+void test_vector_sum_exact() {
+  double sum;
+  double integers[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, -11 };
+  for (size_t size = 1; size <= 11; size++) {
+    assert(vector_sum_exact(integers, size, 0, &sum));
+    double expected = 0;
+    for (size_t i = 0; i < size; i++) expected += integers[i];
+    assert(sum == expected);
+  }
+  assert(vector_sum_exact(integers, 11, 100, &sum) && sum == 144);
+
+  // fractions depend on the order of additions
+  double fractions[] = { 0.1, 0.2, 0.3, 0.4, 0.5 };
+  assert(!vector_sum_exact(fractions, 5, 0, &sum));
+  assert(!vector_sum_exact(integers, 11, 0.5, &sum));
+
+  double large[] = { 9007199254740991.0, 1, 1, -2 };
+  assert(!vector_sum_exact(large, 4, 0, &sum));
+
+  double special[] = { 1, NAN, 2 };
+  assert(!vector_sum_exact(special, 3, 0, &sum));
+  special[1] = INFINITY;
+  assert(!vector_sum_exact(special, 3, 0, &sum));
+
+  // a zero sum could be -0 in order
+  double zeros[] = { -0.0, -0.0, -0.0 };
+  assert(!vector_sum_exact(zeros, 3, -0.0, &sum));
+  assert(!vector_sum_exact(zeros, 0, 0, &sum));
+}
+
+double bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// plain loops the compiler is not allowed to vectorize the same way
+long scalar_index_of(const double *items, size_t size, double x) {
+  for (size_t i = 0; i < size; i++) {
+    if (items[i] == x) return i;
+  }
+  return -1;
+}
+
+double scalar_sum(const double *items, size_t size) {
+  double total = 0;
+  for (size_t i = 0; i < size; i++) total += items[i];
+  return total;
+}
+
+void bench() {
+  size_t size = 1000000;
+  int rounds = 200;
+  double *items = malloc(size * sizeof(double));
+  for (size_t i = 0; i < size; i++) items[i] = i % 1000;
+
+  printf("%zu doubles x %d\n", size, rounds);
+
+  volatile long found = 0;
+  double start = bench_now();
+  for (int r = 0; r < rounds; r++) found += vector_index_of(items, size, -1);
+  double vector = bench_now() - start;
+  start = bench_now();
+  for (int r = 0; r < rounds; r++) found += scalar_index_of(items, size, -1);
+  double scalar = bench_now() - start;
+  printf("  %-8s vector %7.2f ms   scalar %7.2f ms\n", "indexOf", vector * 1e3, scalar * 1e3);
+
+  volatile double total = 0;
+  double sum;
+  start = bench_now();
+  for (int r = 0; r < rounds; r++) {
+    vector_sum_exact(items, size, 0, &sum);
+    total += sum;
+  }
+  vector = bench_now() - start;
+  start = bench_now();
+  for (int r = 0; r < rounds; r++) total += scalar_sum(items, size);
+  scalar = bench_now() - start;
+  printf("  %-8s vector %7.2f ms   scalar %7.2f ms\n", "sum", vector * 1e3, scalar * 1e3);
+
+  start = bench_now();
+  for (int r = 0; r < rounds; r++) vector_fill(items, size, r);
+  vector = bench_now() - start;
+  start = bench_now();
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < size; i++) ((volatile double*)items)[i] = r;
+  }
+  scalar = bench_now() - start;
+  printf("  %-8s vector %7.2f ms   scalar %7.2f ms\n", "fill", vector * 1e3, scalar * 1e3);
+
+  free(items);
+}
+
+int main(int argc, char const **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+    return 0;
+  }
+
+  test_vector_index_of();
+  test_vector_fill();
+  test_vector_sum_exact();
+  return 0;
+}
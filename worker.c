@@ -0,0 +1,721 @@
+#include "worker.h"
+#include "tokenize.h"
+#include "parse.h"
+#include "value.h"
+#include "object.h"
+#include "boolean.h"
+#include "number.h"
+#include "string.h"
+#include "array.h"
+#include "typed_array.h"
+#include "dict.h"
+#include "atom.h"
+#include "heap.h"
+#include "inspect.h"
+#include "inline.h"
+#include "builtin.h"
+#include "loop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUNTIME_ERROR(...) \
+  fprintf(stderr, "runtime error: "); \
+  fprintf(stderr, __VA_ARGS__); \
+  fprintf(stderr, " (%s:%d)\n", __FILE__, __LINE__); \
+  abort();
+
+#define PRIMITIVE_TYPE_IS(X, TYPE) (VALUE_PRIMITIVE(X) != NULL && VALUE_PRIMITIVE(X)->type == (TYPE))
+#define IS_FUNCTION(X) ((X) != NULL && PRIMITIVE_TYPE_IS(X, PRIMITIVE_FUNCTION))
+
+void message_queue_init(MessageQueue *queue) {
+  queue->write = queue->read = calloc(1, sizeof(MessageRing));
+  queue->pushed = 0;
+  queue->popped = 0;
+}
+
+void message_queue_push(MessageQueue *queue, struct Message *message) {
+  MessageRing *ring = queue->write;
+  if (ring->head == MESSAGE_RING_SIZE) {
+    MessageRing *next = calloc(1, sizeof(MessageRing));
+    __atomic_store_n(&ring->next, next, __ATOMIC_RELEASE);
+    queue->write = ring = next;
+  }
+
+  // counted before it can be taken, so popped never passes pushed
+  __atomic_fetch_add(&queue->pushed, 1, __ATOMIC_SEQ_CST);
+  ring->slots[ring->head] = message;
+  __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+struct Message* message_queue_pop(MessageQueue *queue) {
+  MessageRing *ring = queue->read;
+  if (ring->tail == MESSAGE_RING_SIZE) {
+    MessageRing *next = __atomic_load_n(&ring->next, __ATOMIC_ACQUIRE);
+    if (next == NULL) return NULL;
+
+    // the producer is done with a ring once it has linked the next one
+    queue->read = next;
+    free(ring);
+    ring = next;
+  }
+
+  if (ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) return NULL;
+
+  struct Message *message = ring->slots[ring->tail++];
+  __atomic_fetch_add(&queue->popped, 1, __ATOMIC_SEQ_CST);
+  return message;
+}
+
+int message_queue_empty(MessageQueue *queue) {
+  return __atomic_load_n(&queue->popped, __ATOMIC_SEQ_CST) == __atomic_load_n(&queue->pushed, __ATOMIC_SEQ_CST);
+}
+
+// a message is its value written out by message_new, read back by the receiver with
+// message_read. the elements of transferred arrays travel next to the bytes
+typedef enum MessageTag {
+  MESSAGE_UNDEFINED,
+  MESSAGE_NULL,
+  MESSAGE_TRUE,
+  MESSAGE_FALSE,
+  // the double
+  MESSAGE_NUMBER,
+  // the length and the bytes
+  MESSAGE_STRING,
+  // a packed double array: the size and the doubles
+  MESSAGE_DOUBLES,
+  // the size and the elements, with MESSAGE_HOLE for a missing one
+  MESSAGE_ARRAY,
+  MESSAGE_HOLE,
+  // a sparse array: the size, the count, and the index and the element of each
+  MESSAGE_SPARSE,
+  // the count, and the key and the value of each property
+  MESSAGE_OBJECT,
+  // the kind, the length and the bytes of the elements viewed
+  MESSAGE_TYPED_ARRAY,
+  // the byte length and the bytes
+  MESSAGE_ARRAY_BUFFER,
+  // an array from the transfer list: the index of its elements in Message.transfers
+  MESSAGE_TRANSFER,
+  // an array or object written before, by the order it was written in
+  MESSAGE_REF,
+} MessageTag;
+
+typedef struct MessageTransfer {
+  double *elements;
+  unsigned int cap;
+  unsigned int size;
+} MessageTransfer;
+
+typedef struct Message {
+  char *data;
+  size_t size;
+  MessageTransfer *transfers;
+  int transfer_count;
+} Message;
+
+typedef struct MessageWriter {
+  StringBuilder out;
+  // arrays and objects written so far and their ids. open addressing on the pointer,
+  // at most half full
+  Value **seen;
+  uint32_t *seen_ids;
+  size_t seen_cap;
+  uint32_t count;
+  Value **transfer;
+  int transfer_count;
+} MessageWriter;
+
+void message_write_bytes(MessageWriter *w, const void *p, size_t size) {
+  string_builder_append(&w->out, p, size);
+}
+
+void message_write_tag(MessageWriter *w, MessageTag tag) {
+  char c = tag;
+  message_write_bytes(w, &c, 1);
+}
+
+void message_write_u32(MessageWriter *w, uint32_t n) {
+  message_write_bytes(w, &n, sizeof(n));
+}
+
+size_t message_seen_slot(Value **seen, size_t cap, Value *v) {
+  size_t mask = cap - 1;
+  uint64_t h = ((uintptr_t)v >> 3) * 0x9e3779b97f4a7c15ULL;
+  size_t i = (h ^ (h >> 32)) & mask;
+  while (seen[i] != NULL && seen[i] != v) i = (i + 1) & mask;
+  return i;
+}
+
+// writes a reference if v was written before. otherwise gives it the next id and returns 0
+int message_write_seen(MessageWriter *w, Value *v) {
+  size_t i = message_seen_slot(w->seen, w->seen_cap, v);
+  if (w->seen[i] != NULL) {
+    message_write_tag(w, MESSAGE_REF);
+    message_write_u32(w, w->seen_ids[i]);
+    return 1;
+  }
+
+  w->seen[i] = v;
+  w->seen_ids[i] = w->count++;
+  if (w->count * 2 <= w->seen_cap) return 0;
+
+  size_t cap = w->seen_cap * 2;
+  Value **seen = calloc(cap, sizeof(Value*));
+  uint32_t *ids = malloc(cap * sizeof(uint32_t));
+  for (size_t j = 0; j < w->seen_cap; j++) {
+    if (w->seen[j] == NULL) continue;
+    size_t k = message_seen_slot(seen, cap, w->seen[j]);
+    seen[k] = w->seen[j];
+    ids[k] = w->seen_ids[j];
+  }
+
+  free(w->seen);
+  free(w->seen_ids);
+  w->seen = seen;
+  w->seen_ids = ids;
+  w->seen_cap = cap;
+  return 0;
+}
+
+void message_write_value(MessageWriter *w, Value *v);
+
+void message_write_array(MessageWriter *w, Value *v) {
+  for (int i = 0; i < w->transfer_count; i++) {
+    if (w->transfer[i] != v) continue;
+    message_write_tag(w, MESSAGE_TRANSFER);
+    message_write_u32(w, i);
+    return;
+  }
+
+  PrimitiveArray *array = (PrimitiveArray*)VALUE_PRIMITIVE(v);
+  double *doubles = value_array_doubles(v);
+  if (doubles != NULL) {
+    message_write_tag(w, MESSAGE_DOUBLES);
+    message_write_u32(w, array->size);
+    message_write_bytes(w, doubles, array->size * sizeof(double));
+    return;
+  }
+
+  if (array->kind == ARRAY_KIND_DICTIONARY) {
+    unsigned int count;
+    uint32_t *indices = value_array_indices(v, &count);
+    message_write_tag(w, MESSAGE_SPARSE);
+    message_write_u32(w, array->size);
+    message_write_u32(w, count);
+    for (unsigned int i = 0; i < count; i++) {
+      message_write_u32(w, indices[i]);
+      message_write_value(w, value_array_get(v, value_number_new(indices[i])));
+    }
+    free(indices);
+    return;
+  }
+
+  message_write_tag(w, MESSAGE_ARRAY);
+  message_write_u32(w, array->size);
+  for (unsigned int i = 0; i < array->size; i++) {
+    Value *element = value_array_get(v, value_number_new(i));
+    if (element == NULL) {
+      message_write_tag(w, MESSAGE_HOLE);
+    } else {
+      message_write_value(w, element);
+    }
+  }
+}
+
+void message_write_object(MessageWriter *w, Value *v) {
+  Dict *table = VALUE_TABLE(v);
+  Atom *key;
+  void *value;
+
+  uint32_t count = 0;
+  for (unsigned int pos = 0; dict_next(table, &pos, &key, &value); ) count++;
+
+  message_write_tag(w, MESSAGE_OBJECT);
+  message_write_u32(w, count);
+  for (unsigned int pos = 0; dict_next(table, &pos, &key, &value); ) {
+    message_write_u32(w, key->length);
+    message_write_bytes(w, key->string, key->length);
+    message_write_value(w, value);
+  }
+}
+
+void message_write_value(MessageWriter *w, Value *v) {
+  if (v->kind == VALUE_KIND_NULL) {
+    message_write_tag(w, MESSAGE_NULL);
+    return;
+  }
+
+  if (v->kind == VALUE_KIND_UNDEFINED) {
+    message_write_tag(w, MESSAGE_UNDEFINED);
+    return;
+  }
+
+  Primitive *primitive = VALUE_PRIMITIVE(v);
+  if (primitive == NULL) {
+    if (!message_write_seen(w, v)) message_write_object(w, v);
+    return;
+  }
+
+  switch (primitive->type) {
+    case PRIMITIVE_NUMBER: {
+      message_write_tag(w, MESSAGE_NUMBER);
+      message_write_bytes(w, &primitive->value, sizeof(double));
+      return;
+    }
+
+    case PRIMITIVE_BOOLEAN: {
+      message_write_tag(w, primitive->value != 0 ? MESSAGE_TRUE : MESSAGE_FALSE);
+      return;
+    }
+
+    case PRIMITIVE_STRING: {
+      message_write_tag(w, MESSAGE_STRING);
+      message_write_u32(w, value_string_length(v));
+      string_builder_append_value(&w->out, v);
+      return;
+    }
+
+    case PRIMITIVE_ARRAY: {
+      if (!message_write_seen(w, v)) message_write_array(w, v);
+      return;
+    }
+
+    case PRIMITIVE_TYPED_ARRAY: {
+      if (message_write_seen(w, v)) return;
+
+      TypedArrayKind kind = value_typed_array_kind(v);
+      uint32_t length = value_typed_array_length(v);
+      message_write_tag(w, MESSAGE_TYPED_ARRAY);
+      message_write_u32(w, kind);
+      message_write_u32(w, length);
+      message_write_bytes(w, value_typed_array_data(v), length * value_typed_array_element_size(kind));
+      return;
+    }
+
+    case PRIMITIVE_ARRAY_BUFFER: {
+      if (message_write_seen(w, v)) return;
+
+      uint32_t byte_length = value_array_buffer_byte_length(v);
+      message_write_tag(w, MESSAGE_ARRAY_BUFFER);
+      message_write_u32(w, byte_length);
+      message_write_bytes(w, value_array_buffer_data(v), byte_length);
+      return;
+    }
+
+    default: {
+      RUNTIME_ERROR("%s could not be cloned", value_inspect(v));
+    }
+  }
+}
+
+// clones value, and takes the elements of the arrays in transfer, which may be NULL
+Message* message_new(Value *value, Value *transfer) {
+  MessageWriter w;
+  string_builder_init(&w.out);
+  w.seen_cap = 16;
+  w.seen = calloc(w.seen_cap, sizeof(Value*));
+  w.seen_ids = malloc(w.seen_cap * sizeof(uint32_t));
+  w.count = 0;
+  w.transfer = NULL;
+  w.transfer_count = 0;
+
+  if (transfer != NULL && transfer->kind != VALUE_KIND_UNDEFINED) {
+    if (!PRIMITIVE_TYPE_IS(transfer, PRIMITIVE_ARRAY)) {
+      RUNTIME_ERROR("the transfer list should be an array: %s", value_inspect(transfer));
+    }
+
+    unsigned int size = ((PrimitiveArray*)VALUE_PRIMITIVE(transfer))->size;
+    w.transfer = malloc((size + 1) * sizeof(Value*));
+    for (unsigned int i = 0; i < size; i++) {
+      Value *array = value_array_get(transfer, value_number_new(i));
+      if (array == NULL || !PRIMITIVE_TYPE_IS(array, PRIMITIVE_ARRAY) || value_array_doubles(array) == NULL) {
+        RUNTIME_ERROR("only arrays of numbers can be transferred: %s", array == NULL ? "undefined" : value_inspect(array));
+      }
+      for (int j = 0; j < w.transfer_count; j++) {
+        if (w.transfer[j] == array) {
+          RUNTIME_ERROR("an array is in the transfer list twice");
+        }
+      }
+      w.transfer[w.transfer_count++] = array;
+    }
+  }
+
+  message_write_value(&w, value);
+
+  Message *message = malloc(sizeof(Message));
+  message->data = w.out.data;
+  message->size = w.out.length;
+  message->transfer_count = w.transfer_count;
+  message->transfers = malloc((w.transfer_count + 1) * sizeof(MessageTransfer));
+  for (int i = 0; i < w.transfer_count; i++) {
+    MessageTransfer *t = &message->transfers[i];
+    t->elements = value_array_detach_doubles(w.transfer[i], &t->cap, &t->size);
+  }
+
+  free(w.seen);
+  free(w.seen_ids);
+  free(w.transfer);
+  return message;
+}
+
+void message_free(Message *message) {
+  free(message->data);
+  free(message->transfers);
+  free(message);
+}
+
+typedef struct MessageReader {
+  Message *message;
+  size_t pos;
+  Binding *binding;
+  // arrays and objects by id
+  Value **objects;
+  uint32_t count;
+  uint32_t cap;
+} MessageReader;
+
+void message_read_bytes(MessageReader *r, void *p, size_t size) {
+  memcpy(p, r->message->data + r->pos, size);
+  r->pos += size;
+}
+
+MessageTag message_read_tag(MessageReader *r) {
+  return (unsigned char)r->message->data[r->pos++];
+}
+
+uint32_t message_read_u32(MessageReader *r) {
+  uint32_t n;
+  message_read_bytes(r, &n, sizeof(n));
+  return n;
+}
+
+Value* message_read_record(MessageReader *r, Value *v) {
+  if (r->count == r->cap) {
+    r->cap = r->cap == 0 ? 16 : r->cap * 2;
+    r->objects = realloc(r->objects, r->cap * sizeof(Value*));
+  }
+
+  r->objects[r->count++] = v;
+  return v;
+}
+
+// a heap block for an array to take over. its cap can't be 0, which marks template elements
+double* message_read_doubles(MessageReader *r, uint32_t size, unsigned int *cap) {
+  *cap = size > 0 ? size : 1;
+  double *elements = heap_alloc(*cap * sizeof(double));
+  message_read_bytes(r, elements, size * sizeof(double));
+  return elements;
+}
+
+Value* message_read_value(MessageReader *r) {
+  MessageTag tag = message_read_tag(r);
+  switch (tag) {
+    case MESSAGE_UNDEFINED: return value_undefined_new();
+    case MESSAGE_NULL: return value_null_new();
+    case MESSAGE_TRUE: return value_true_new();
+    case MESSAGE_FALSE: return value_false_new();
+
+    case MESSAGE_NUMBER: {
+      double n;
+      message_read_bytes(r, &n, sizeof(n));
+      return value_number_new(n);
+    }
+
+    case MESSAGE_STRING: {
+      uint32_t length = message_read_u32(r);
+      Value *s = value_string_new_length(r->message->data + r->pos, length);
+      r->pos += length;
+      return s;
+    }
+
+    case MESSAGE_DOUBLES: {
+      uint32_t size = message_read_u32(r);
+      unsigned int cap;
+      double *elements = message_read_doubles(r, size, &cap);
+      return message_read_record(r, value_array_adopt_doubles(r->binding, elements, cap, size));
+    }
+
+    case MESSAGE_TRANSFER: {
+      MessageTransfer *t = &r->message->transfers[message_read_u32(r)];
+      return message_read_record(r, value_array_adopt_doubles(r->binding, t->elements, t->cap, t->size));
+    }
+
+    case MESSAGE_ARRAY: {
+      uint32_t size = message_read_u32(r);
+      Value *array = message_read_record(r, value_array_new(r->binding));
+      for (uint32_t i = 0; i < size; i++) {
+        if (r->message->data[r->pos] == MESSAGE_HOLE) {
+          r->pos++;
+          continue;
+        }
+        value_array_set(array, value_number_new(i), message_read_value(r));
+      }
+      // trailing holes are not set, but count towards the length
+      value_array_extend(array, size);
+      return array;
+    }
+
+    case MESSAGE_SPARSE: {
+      uint32_t size = message_read_u32(r);
+      uint32_t count = message_read_u32(r);
+      Value *array = message_read_record(r, value_array_new(r->binding));
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = message_read_u32(r);
+        value_array_set(array, value_number_new(index), message_read_value(r));
+      }
+      value_array_extend(array, size);
+      return array;
+    }
+
+    case MESSAGE_OBJECT: {
+      uint32_t count = message_read_u32(r);
+      Value *object = message_read_record(r, value_object_new(r->binding));
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t length = message_read_u32(r);
+        const char *name = r->message->data + r->pos;
+        uint32_t index = atom_array_index(name, length);
+        Atom *key = index == ATOM_NOT_INDEX ? atom_intern_length(name, length) : NULL;
+        r->pos += length;
+        if (key == NULL) {
+          value_object_set_index(object, index, message_read_value(r));
+        } else {
+          value_object_set_atom(object, key, message_read_value(r));
+        }
+      }
+      return object;
+    }
+
+    case MESSAGE_TYPED_ARRAY: {
+      TypedArrayKind kind = message_read_u32(r);
+      uint32_t length = message_read_u32(r);
+      size_t byte_length = length * value_typed_array_element_size(kind);
+      Value *buffer = value_array_buffer_new(r->binding, byte_length);
+      message_read_bytes(r, value_array_buffer_data(buffer), byte_length);
+      return message_read_record(r, value_typed_array_new(r->binding, kind, buffer, 0, length));
+    }
+
+    case MESSAGE_ARRAY_BUFFER: {
+      uint32_t byte_length = message_read_u32(r);
+      Value *buffer = value_array_buffer_new(r->binding, byte_length);
+      message_read_bytes(r, value_array_buffer_data(buffer), byte_length);
+      return message_read_record(r, buffer);
+    }
+
+    case MESSAGE_REF: {
+      return r->objects[message_read_u32(r)];
+    }
+
+    default: {
+      fprintf(stderr, "unexpected message tag %d\n", tag);
+      abort();
+    }
+  }
+}
+
+// the value of a message, made in the isolate of binding
+Value* message_read(Binding *binding, Message *message) {
+  MessageReader r = { message, 0, binding, NULL, 0, 0 };
+  Value *value = message_read_value(&r);
+  free(r.objects);
+  return value;
+}
+
+// calls handler in env with an event carrying the message's data, if handler is a function
+void worker_dispatch(Env *env, Message *message, Value *handler, Value *this) {
+  Isolate *isolate = env->isolate;
+  Value *data = message_read(&isolate->binding, message);
+  message_free(message);
+  if (!IS_FUNCTION(handler)) return;
+
+  Value *event = value_object_new(&isolate->binding);
+  value_object_set(event, value_string_new("data"), data);
+  Value *args[] = { event };
+  evaluate_function_call(handler, this, args, 1, env);
+  isolate->returned = 0;
+}
+
+char* worker_read_source(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) return NULL;
+
+  StringBuilder source;
+  string_builder_init(&source);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) string_builder_append(&source, buf, n);
+  string_builder_append(&source, "", 1);
+  fclose(fp);
+  return source.data;
+}
+
+void* worker_thread(void *data) {
+  Worker *worker = data;
+  Node *program = parse(tokenize(worker->source));
+  inline_functions(program);
+  evaluate(worker->isolate, program);
+
+  __atomic_store_n(&worker->finished, 1, __ATOMIC_SEQ_CST);
+  loop_wake(worker->parent);
+  return NULL;
+}
+
+Worker* worker_unwrap(Value *v) {
+  if (!PRIMITIVE_TYPE_IS(v, PRIMITIVE_WORKER)) {
+    RUNTIME_ERROR("%s is not a Worker", value_inspect(v));
+  }
+
+  return ((PrimitiveWorker*)VALUE_PRIMITIVE(v))->worker;
+}
+
+Value* native_worker(Isolate *isolate, Value *this, int size, Value **args) {
+  if (size < 1 || !PRIMITIVE_TYPE_IS(args[0], PRIMITIVE_STRING)) {
+    RUNTIME_ERROR("Worker expects the file name of a script");
+  }
+
+  const char *path = value_string_unwrap(args[0]);
+  char *source = worker_read_source(path);
+  if (source == NULL) {
+    RUNTIME_ERROR("could not read the worker script %s", path);
+  }
+
+  Worker *worker = calloc(1, sizeof(Worker));
+  message_queue_init(&worker->inbound);
+  message_queue_init(&worker->outbound);
+  worker->parent = isolate;
+  worker->source = source;
+  worker->isolate = isolate_new(isolate->out);
+  worker->isolate->worker = worker;
+  require_global_builtins(BUILTIN_OWNER_WORKER_SCOPE, worker->isolate->binding.global);
+
+  Value *klass = env_get(isolate->binding.global, "Worker");
+  Value *object = value_object_create(value_object_get(klass, value_string_new("prototype")));
+  PrimitiveWorker *primitive = heap_alloc(sizeof(PrimitiveWorker));
+  primitive->type = PRIMITIVE_WORKER;
+  primitive->flags = 0;
+  primitive->value = 0;
+  primitive->worker = worker;
+  object->primitive = heap_encode((Primitive*)primitive);
+  worker->object = object;
+
+  // kept in the order they were started
+  Worker **last = &isolate->workers;
+  while (*last != NULL) last = &(*last)->next;
+  *last = worker;
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
+  if (pthread_create(&worker->thread, &attr, worker_thread, worker) != 0) {
+    RUNTIME_ERROR("could not start a worker thread");
+  }
+  pthread_attr_destroy(&attr);
+
+  return object;
+}
+
+// messages to a worker that is done are dropped
+Value* native_worker_post_message(Isolate *isolate, Value *this, int size, Value **args) {
+  Worker *worker = worker_unwrap(this);
+  Message *message = message_new(size > 0 ? args[0] : value_undefined_new(), size > 1 ? args[1] : NULL);
+  if (__atomic_load_n(&worker->closing, __ATOMIC_SEQ_CST) || __atomic_load_n(&worker->finished, __ATOMIC_SEQ_CST)) {
+    message_free(message);
+    return value_undefined_new();
+  }
+
+  message_queue_push(&worker->inbound, message);
+  loop_wake(worker->isolate);
+  return value_undefined_new();
+}
+
+Value* native_worker_terminate(Isolate *isolate, Value *this, int size, Value **args) {
+  Worker *worker = worker_unwrap(this);
+  __atomic_store_n(&worker->closing, 1, __ATOMIC_SEQ_CST);
+  loop_wake(worker->isolate);
+  return value_undefined_new();
+}
+
+Value* native_worker_scope_post_message(Isolate *isolate, Value *this, int size, Value **args) {
+  Worker *worker = isolate->worker;
+  Message *message = message_new(size > 0 ? args[0] : value_undefined_new(), size > 1 ? args[1] : NULL);
+  message_queue_push(&worker->outbound, message);
+  loop_wake(worker->parent);
+  return value_undefined_new();
+}
+
+Value* native_worker_scope_close(Isolate *isolate, Value *this, int size, Value **args) {
+  __atomic_store_n(&isolate->worker->closing, 1, __ATOMIC_SEQ_CST);
+  return value_undefined_new();
+}
+
+// whether no worker of the isolate can send it anything without being sent a message
+// first: each one has finished, or waits with both queues empty. a worker clears idle
+// before it takes a message, and sets it again only after sending what the message made
+// it send, so reading its inbound queue, then its outbound one, then idle can't miss one
+int worker_children_quiet(Isolate *isolate) {
+  for (Worker *child = isolate->workers; child != NULL; child = child->next) {
+    // what a finished worker sent was pushed before finished was set
+    int finished = __atomic_load_n(&child->finished, __ATOMIC_SEQ_CST);
+    if (finished) {
+      if (!message_queue_empty(&child->outbound)) return 0;
+      continue;
+    }
+
+    if (!message_queue_empty(&child->inbound) || !message_queue_empty(&child->outbound)) return 0;
+    if (!__atomic_load_n(&child->idle, __ATOMIC_SEQ_CST)) return 0;
+  }
+
+  return 1;
+}
+
+// joins the workers that finished and whose messages were all handled
+void worker_reap(Isolate *isolate) {
+  Worker **p = &isolate->workers;
+  while (*p != NULL) {
+    Worker *child = *p;
+    if (__atomic_load_n(&child->finished, __ATOMIC_SEQ_CST) && message_queue_empty(&child->outbound)) {
+      pthread_join(child->thread, NULL);
+      *p = child->next;
+      continue;
+    }
+    p = &child->next;
+  }
+}
+
+// the Worker objects keep pointing at their workers, which are left allocated
+void worker_terminate_all(Isolate *isolate) {
+  for (Worker *child = isolate->workers; child != NULL; child = child->next) {
+    __atomic_store_n(&child->closing, 1, __ATOMIC_SEQ_CST);
+    loop_wake(child->isolate);
+  }
+
+  for (Worker *child = isolate->workers; child != NULL; child = child->next) {
+    pthread_join(child->thread, NULL);
+  }
+  isolate->workers = NULL;
+}
+
+int worker_handle_messages(Env *env) {
+  Isolate *isolate = env->isolate;
+  Worker *self = isolate->worker;
+  int handled = 0;
+  Message *message;
+  while (self != NULL && !__atomic_load_n(&self->closing, __ATOMIC_SEQ_CST) &&
+         (message = message_queue_pop(&self->inbound)) != NULL) {
+    worker_dispatch(env, message, env_get(env, "onmessage"), value_undefined_new());
+    loop_run_microtasks(env);
+    handled++;
+  }
+
+  for (Worker *child = isolate->workers; child != NULL; child = child->next) {
+    while ((message = message_queue_pop(&child->outbound)) != NULL) {
+      worker_dispatch(env, message, value_object_get(child->object, value_string_new("onmessage")), child->object);
+      loop_run_microtasks(env);
+      handled++;
+    }
+  }
+
+  worker_reap(isolate);
+  return handled;
+}
@@ -0,0 +1,96 @@
+#ifndef MJS_WORKER_H
+#define MJS_WORKER_H
+
+#include "value.h"
+#include <pthread.h>
+
+// Worker: another script running in an isolate of its own on a thread of its own.
+//
+//   var worker = new Worker('part.js');
+//   worker.onmessage = function (event) { console.log(event.data); };
+//   worker.postMessage([1, 2, 3]);
+//
+// and in part.js, postMessage() and close() are globals, and a global onmessage gets the
+// messages sent to the worker:
+//
+//   function onmessage(event) { postMessage(event.data.length); }
+//
+// messages are structured clones: numbers, strings, booleans, null, undefined, arrays,
+// plain objects and typed arrays are copied into the receiving isolate, keeping objects
+// that are reached twice, or in a cycle, shared. postMessage(value, [array]) transfers
+// arrays of numbers instead: their elements move to the receiver without being copied,
+// and the sender's array is left empty.
+//
+// an isolate handles messages after its script has run, in its loop (see loop.h). the main
+// script ends once every worker has finished or waits for a message that can no longer
+// come; then the workers still waiting are terminated. a worker without an onmessage
+// function finishes after its script, and its workers.
+//
+// each direction of a worker is a queue with one producer and one consumer: a list of
+// fixed rings that the two threads share without a lock.
+#define MESSAGE_RING_SIZE 256
+
+// scripts recurse on the C stack, so workers get more than the default
+#define WORKER_STACK_SIZE ((size_t)64 << 20)
+
+struct Message;
+
+typedef struct MessageRing {
+  struct Message *slots[MESSAGE_RING_SIZE];
+  // slots filled, written by the producer
+  uint32_t head;
+  // slots taken, only used by the consumer
+  uint32_t tail;
+  // the ring the producer went on to once this one was full
+  struct MessageRing *next;
+} MessageRing;
+
+typedef struct MessageQueue {
+  // the ring the producer fills, and the one the consumer takes from
+  MessageRing *write;
+  MessageRing *read;
+  // counts of messages in and out, so that either side can tell the queue is empty
+  uint64_t pushed;
+  uint64_t popped;
+} MessageQueue;
+
+void message_queue_init(MessageQueue *queue);
+void message_queue_push(MessageQueue *queue, struct Message *message);
+// NULL when the queue is empty
+struct Message* message_queue_pop(MessageQueue *queue);
+int message_queue_empty(MessageQueue *queue);
+
+typedef struct Worker {
+  // messages from the isolate that started the worker, and to it
+  MessageQueue inbound;
+  MessageQueue outbound;
+  Isolate *parent;
+  Isolate *isolate;
+  // the Worker object in the parent, which gets the worker's messages
+  Value *object;
+  char *source;
+  pthread_t thread;
+  // set while the worker, and every worker it started, waits for a message
+  int idle;
+  // set by terminate() and close(). the worker stops before its next message
+  int closing;
+  // set once its thread is done
+  int finished;
+  struct Worker *next;
+} Worker;
+
+// handles the messages waiting for env's isolate: those to it, if it is a worker, and
+// those from its workers, in the scope the program ran in. returns how many it handled
+int worker_handle_messages(Env *env);
+// whether no worker of the isolate can send it anything before it is sent a message
+int worker_children_quiet(Isolate *isolate);
+// terminates the isolate's workers and waits for their threads
+void worker_terminate_all(Isolate *isolate);
+
+Value* native_worker(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_worker_post_message(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_worker_terminate(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_worker_scope_post_message(Isolate *isolate, Value *this, int size, Value **args);
+Value* native_worker_scope_close(Isolate *isolate, Value *this, int size, Value **args);
+
+#endif
@@ -0,0 +1,52 @@
+#include "worker.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// enough to go through several rings
+#define MESSAGES (MESSAGE_RING_SIZE * 10 + 3)
+
+void* produce(void *data) {
+  MessageQueue *queue = data;
+  for (uintptr_t i = 1; i <= MESSAGES; i++) message_queue_push(queue, (struct Message*)i);
+  return NULL;
+}
+
+void test_queue_keeps_order() {
+  MessageQueue queue;
+  message_queue_init(&queue);
+  assert(message_queue_empty(&queue));
+  assert(message_queue_pop(&queue) == NULL);
+
+  pthread_t producer;
+  pthread_create(&producer, NULL, produce, &queue);
+
+  uintptr_t expected = 1;
+  while (expected <= MESSAGES) {
+    struct Message *message = message_queue_pop(&queue);
+    if (message == NULL) continue;
+    assert((uintptr_t)message == expected);
+    expected++;
+  }
+
+  pthread_join(producer, NULL);
+  assert(message_queue_pop(&queue) == NULL);
+  assert(message_queue_empty(&queue));
+}
+
+void test_queue_empty() {
+  MessageQueue queue;
+  message_queue_init(&queue);
+  message_queue_push(&queue, (struct Message*)1);
+  assert(!message_queue_empty(&queue));
+  assert(message_queue_pop(&queue) == (struct Message*)1);
+  assert(message_queue_empty(&queue));
+}
+
+int main(int argc, char const **argv) {
+  test_queue_keeps_order();
+  test_queue_empty();
+  return 0;
+}